@@ -1,3 +1,4 @@
+#include "cli_batch.hpp"
 #include "cli_params.hpp"
 #include "cli_simulate.hpp"
 #include <fmt/core.h>
@@ -6,6 +7,13 @@ int main(int argc, char *argv[]) {
   CLI::App app;
   auto params{sme::cli::setupCLI(app)};
   CLI11_PARSE(app, argc, argv);
+  if (!params.batchFile.empty()) {
+    if (sme::cli::doBatch(params)) {
+      fmt::print("# Batch complete.\n");
+      return 0;
+    }
+    return 1;
+  }
   if (params.outputFile.empty()) {
     params.outputFile = params.inputFile;
   }
@@ -0,0 +1,437 @@
+#include "cli_batch.hpp"
+#include "geometry.hpp"
+#include "logger.hpp"
+#include "model.hpp"
+#include "simulate.hpp"
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QSaveFile>
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <fmt/core.h>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <numeric>
+#include <thread>
+
+namespace sme::cli {
+
+static void printError(const std::string &message) {
+  fmt::print("\n\nError: {}\n\n", message);
+}
+
+static std::optional<std::vector<std::pair<std::string, double>>>
+readParameterSet(const QJsonValue &value) {
+  if (!value.isObject()) {
+    printError("batch manifest parameters must be objects");
+    return {};
+  }
+  std::vector<std::pair<std::string, double>> parameters;
+  auto object{value.toObject()};
+  for (auto iter{object.constBegin()}; iter != object.constEnd(); ++iter) {
+    if (!iter.value().isDouble()) {
+      printError(fmt::format("batch manifest parameter '{}' must be a number",
+                             iter.key().toStdString()));
+      return {};
+    }
+    parameters.emplace_back(iter.key().toStdString(), iter.value().toDouble());
+  }
+  return parameters;
+}
+
+std::optional<BatchManifest> readBatchManifest(const std::string &filename) {
+  QFile file(QString::fromStdString(filename));
+  if (!file.open(QIODevice::ReadOnly)) {
+    printError(fmt::format("failed to open batch manifest '{}'", filename));
+    return {};
+  }
+  QJsonParseError parseError;
+  auto doc{QJsonDocument::fromJson(file.readAll(), &parseError)};
+  if (!doc.isObject()) {
+    printError(fmt::format("invalid batch manifest '{}': {}", filename,
+                           parseError.errorString().toStdString()));
+    return {};
+  }
+  auto json{doc.object()};
+  QFileInfo fileInfo(file);
+  auto dir{fileInfo.absoluteDir()};
+  BatchManifest manifest;
+  for (const auto &model : json.value("models").toArray()) {
+    if (!model.isString()) {
+      printError("batch manifest models must be filenames");
+      return {};
+    }
+    manifest.models.push_back(
+        QDir::cleanPath(dir.absoluteFilePath(model.toString())).toStdString());
+  }
+  if (manifest.models.empty()) {
+    printError("batch manifest does not contain any models");
+    return {};
+  }
+  std::vector<std::vector<std::pair<std::string, double>>> parameterSets;
+  for (const auto &value : json.value("parameters").toArray()) {
+    auto parameters{readParameterSet(value)};
+    if (!parameters.has_value()) {
+      return {};
+    }
+    parameterSets.push_back(std::move(parameters.value()));
+  }
+  if (parameterSets.empty()) {
+    // no parameter overrides
+    parameterSets.emplace_back();
+  }
+  std::vector<std::pair<std::string, std::string>> times;
+  for (const auto &value : json.value("times").toArray()) {
+    auto object{value.toObject()};
+    auto lengths{object.value("simulation_times").toVariant().toString()};
+    auto intervals{object.value("image_intervals").toVariant().toString()};
+    if (!simulate::parseSimulationTimes(lengths, intervals).has_value()) {
+      printError(fmt::format("invalid batch manifest simulation times '{}' "
+                             "with image intervals '{}'",
+                             lengths.toStdString(), intervals.toStdString()));
+      return {};
+    }
+    times.emplace_back(lengths.toStdString(), intervals.toStdString());
+  }
+  if (times.empty()) {
+    printError("batch manifest does not contain any simulation times");
+    return {};
+  }
+  auto outputDir{json.value("output_dir")
+                     .toString(fileInfo.completeBaseName() + "_results")};
+  manifest.outputDir =
+      QDir::cleanPath(dir.absoluteFilePath(outputDir)).toStdString();
+  if (auto timeout{json.value("timeout_seconds")}; !timeout.isUndefined()) {
+    if (!timeout.isDouble() || timeout.toDouble() <= 0.0) {
+      printError("batch manifest timeout_seconds must be a positive number");
+      return {};
+    }
+    manifest.timeoutSeconds = timeout.toDouble();
+  }
+  // one job for each combination of model, parameters and times
+  auto nJobs{manifest.models.size() * parameterSets.size() * times.size()};
+  auto nDigits{fmt::format("{}", nJobs - 1).size()};
+  for (std::size_t iModel = 0; iModel < manifest.models.size(); ++iModel) {
+    for (const auto &parameters : parameterSets) {
+      for (const auto &[lengths, intervals] : times) {
+        manifest.jobs.push_back(
+            {fmt::format("job-{:0{}}", manifest.jobs.size(), nDigits), iModel,
+             parameters, lengths, intervals});
+      }
+    }
+  }
+  return manifest;
+}
+
+std::vector<std::size_t>
+getBatchJobOrder(const std::vector<double> &estimatedSizes) {
+  std::vector<std::size_t> order(estimatedSizes.size());
+  std::iota(order.begin(), order.end(), 0);
+  std::stable_sort(order.begin(), order.end(),
+                   [&estimatedSizes](std::size_t a, std::size_t b) {
+                     return estimatedSizes[a] > estimatedSizes[b];
+                   });
+  return order;
+}
+
+namespace {
+
+// a model imported once at the start of the batch, to check the parameters
+// and estimate the cost of its jobs: each worker then imports its own copy
+// from the xml, including the geometry, so nothing is shared between workers
+struct BatchModel {
+  std::string xml;
+  // parameter name or id used in the manifest -> parameter id
+  std::map<std::string, std::string, std::less<>> parameterIds;
+  // parameters overridden by any job: inputs to the compiled kernels, so
+  // that jobs of this model can share them
+  std::vector<std::string> runtimeParameterIds;
+  std::map<std::string, QString, std::less<>> originalExpressions;
+  // estimated cost of simulating one unit of time
+  double sizePerUnitTime{0.0};
+};
+
+// a worker's copy of a model, re-used for each of this worker's jobs of this
+// model, so that its geometry and meshes are only constructed once per worker
+struct WorkerModel {
+  std::unique_ptr<model::Model> model;
+  // most recent simulation, kept so that its compiled kernels can be re-used
+  std::unique_ptr<simulate::Simulation> sim;
+};
+
+} // namespace
+
+static std::optional<BatchModel>
+importBatchModel(const BatchManifest &manifest, std::size_t modelIndex) {
+  const auto &filename{manifest.models[modelIndex]};
+  model::Model m;
+  m.importFile(filename);
+  if (!m.getIsValid() || !m.getGeometry().getIsValid()) {
+    printError(fmt::format("invalid model '{}'", filename));
+    return {};
+  }
+  BatchModel batchModel;
+  const auto &params{m.getParameters()};
+  auto constants{params.getGlobalConstants()};
+  for (const auto &job : manifest.jobs) {
+    if (job.modelIndex != modelIndex) {
+      continue;
+    }
+    for (const auto &[name, value] : job.parameters) {
+      if (batchModel.parameterIds.find(name) !=
+          batchModel.parameterIds.cend()) {
+        continue;
+      }
+      auto i{params.getIds().indexOf(QString::fromStdString(name))};
+      if (i < 0) {
+        i = params.getNames().indexOf(QString::fromStdString(name));
+      }
+      if (i < 0) {
+        printError(fmt::format("parameter '{}' not found in model '{}'", name,
+                               filename));
+        return {};
+      }
+      auto id{params.getIds()[i].toStdString()};
+      if (std::none_of(constants.cbegin(), constants.cend(),
+                       [&id](const auto &c) { return c.id == id; })) {
+        printError(fmt::format("parameter '{}' in model '{}' is not a constant",
+                               name, filename));
+        return {};
+      }
+      batchModel.parameterIds[name] = id;
+      if (batchModel.originalExpressions.find(id) ==
+          batchModel.originalExpressions.cend()) {
+        batchModel.runtimeParameterIds.push_back(id);
+        batchModel.originalExpressions[id] = params.getExpression(id.c_str());
+      }
+    }
+  }
+  for (const auto &compartmentId : m.getCompartments().getIds()) {
+    std::size_t nSpecies{0};
+    for (const auto &speciesId : m.getSpecies().getIds(compartmentId)) {
+      if (!m.getSpecies().getIsConstant(speciesId)) {
+        ++nSpecies;
+      }
+    }
+    if (const auto *c{m.getCompartments().getCompartment(compartmentId)};
+        c != nullptr) {
+      batchModel.sizePerUnitTime +=
+          static_cast<double>(nSpecies * c->nPixels());
+    }
+  }
+  batchModel.xml = m.getXml().toStdString();
+  return batchModel;
+}
+
+static void writeStatus(const QString &filename, const BatchJob &job,
+                        const std::string &modelFile, const QString &status,
+                        const std::string &errorMessage = {},
+                        double runtimeSeconds = 0.0) {
+  QJsonObject parameters;
+  for (const auto &[name, value] : job.parameters) {
+    parameters[QString::fromStdString(name)] = value;
+  }
+  QJsonObject json;
+  json["job"] = QString::fromStdString(job.name);
+  json["model"] = QString::fromStdString(modelFile);
+  json["parameters"] = parameters;
+  json["simulation_times"] = QString::fromStdString(job.simulationTimes);
+  json["image_intervals"] = QString::fromStdString(job.imageIntervals);
+  json["status"] = status;
+  json["error"] = QString::fromStdString(errorMessage);
+  json["runtime_seconds"] = runtimeSeconds;
+  // written to a temporary file which then replaces any existing status file
+  QSaveFile file(filename);
+  if (file.open(QIODevice::WriteOnly)) {
+    file.write(QJsonDocument(json).toJson());
+    file.commit();
+  }
+}
+
+// returns an error message, or an empty string on success
+static std::string runBatchJob(WorkerModel &workerModel,
+                               const BatchModel &batchModel,
+                               const BatchJob &job,
+                               const std::string &outputFile,
+                               double timeoutSeconds) {
+  QElapsedTimer timer;
+  timer.start();
+  auto &m{*workerModel.model};
+  for (const auto &id : batchModel.runtimeParameterIds) {
+    m.getParameters().setExpression(id.c_str(),
+                                    batchModel.originalExpressions.at(id));
+  }
+  for (const auto &[name, value] : job.parameters) {
+    m.getParameters().setExpression(
+        batchModel.parameterIds.at(name).c_str(),
+        QString::number(value, 'g', 17));
+  }
+  auto times{simulate::parseSimulationTimes(job.simulationTimes.c_str(),
+                                            job.imageIntervals.c_str())};
+  m.getSimulationData().clear();
+  m.getSimulationSettings().times.clear();
+  // the previous simulation is only deleted after this one is constructed,
+  // so that its compiled kernels are still in use and can be re-used
+  auto sim{std::make_unique<simulate::Simulation>(
+      m, batchModel.runtimeParameterIds)};
+  workerModel.sim = std::move(sim);
+  if (const auto &e{workerModel.sim->errorMessage()}; !e.empty()) {
+    return fmt::format("Error in simulation setup: {}", e);
+  }
+  // the time limit includes the setup of the simulation
+  double timeout_ms{-1.0};
+  if (timeoutSeconds > 0.0) {
+    timeout_ms = std::max(
+        timeoutSeconds * 1000.0 - static_cast<double>(timer.elapsed()), 0.0);
+  }
+  workerModel.sim->doMultipleTimesteps(times.value(), timeout_ms);
+  if (const auto &e{workerModel.sim->errorMessage()}; !e.empty()) {
+    if (timeout_ms >= 0.0 &&
+        static_cast<double>(timer.elapsed()) >= timeoutSeconds * 1000.0) {
+      return fmt::format("Timeout: job did not finish within {}s",
+                         timeoutSeconds);
+    }
+    return fmt::format("Error during simulation: {}", e);
+  }
+  m.exportSMEFile(outputFile);
+  m.getSimulationData().clear();
+  return {};
+}
+
+bool doBatch(const Params &params) {
+  // disable logging
+  spdlog::set_level(spdlog::level::off);
+
+  auto manifest{readBatchManifest(params.batchFile)};
+  if (!manifest.has_value()) {
+    return false;
+  }
+  const auto &jobs{manifest->jobs};
+  QDir outputDir(QString::fromStdString(manifest->outputDir));
+  if (!outputDir.mkpath(".")) {
+    printError(fmt::format("failed to create output directory '{}'",
+                           manifest->outputDir));
+    return false;
+  }
+
+  // import each model once to check the manifest before starting any jobs
+  std::vector<BatchModel> models;
+  for (std::size_t i = 0; i < manifest->models.size(); ++i) {
+    auto batchModel{importBatchModel(manifest.value(), i)};
+    if (!batchModel.has_value()) {
+      return false;
+    }
+    models.push_back(std::move(batchModel.value()));
+  }
+
+  std::vector<double> sizes;
+  for (const auto &job : jobs) {
+    auto times{simulate::parseSimulationTimes(job.simulationTimes.c_str(),
+                                              job.imageIntervals.c_str())};
+    double simulationTime{0.0};
+    for (const auto &[n, dt] : times.value()) {
+      simulationTime += static_cast<double>(n) * dt;
+    }
+    sizes.push_back(models[job.modelIndex].sizePerUnitTime * simulationTime);
+  }
+  auto order{getBatchJobOrder(sizes)};
+
+  // one single-threaded job per cpu thread
+  auto nWorkers{params.maxThreads};
+  if (nWorkers == 0) {
+    nWorkers = std::max(std::thread::hardware_concurrency(), 1u);
+  }
+  nWorkers = std::min(nWorkers, jobs.size());
+  fmt::print("\n# Batch: {} jobs, {} at a time\n", jobs.size(), nWorkers);
+  fmt::print("#   - Manifest: {}\n", params.batchFile);
+  fmt::print("#   - Output directory: {}\n\n", manifest->outputDir);
+
+  auto statusFile{[&outputDir](const BatchJob &job) {
+    return outputDir.filePath(QString::fromStdString(job.name) + ".json");
+  }};
+  for (const auto &job : jobs) {
+    writeStatus(statusFile(job), job, manifest->models[job.modelIndex],
+                "queued");
+  }
+
+  std::atomic<std::size_t> nextJob{0};
+  std::mutex printMutex;
+  std::size_t nFinished{0};
+  std::vector<char> succeeded(jobs.size(), 0);
+  auto worker{[&]() {
+    // model index -> this worker's copy of the model
+    std::map<std::size_t, WorkerModel> workerModels;
+    for (auto i{nextJob++}; i < order.size(); i = nextJob++) {
+      const auto &job{jobs[order[i]]};
+      const auto &modelFile{manifest->models[job.modelIndex]};
+      writeStatus(statusFile(job), job, modelFile, "running");
+      QElapsedTimer timer;
+      timer.start();
+      std::string error;
+      // an exception only fails this job: the worker continues with the next
+      try {
+        auto &workerModel{workerModels[job.modelIndex]};
+        if (workerModel.model == nullptr) {
+          workerModel.model = std::make_unique<model::Model>();
+          workerModel.model->importSBMLString(models[job.modelIndex].xml,
+                                              modelFile);
+          auto &settings{workerModel.model->getSimulationSettings()};
+          settings.simulatorType = params.simType;
+          settings.options.pixel.enableMultiThreading = false;
+          if (params.keepLast > 0) {
+            settings.retention = {params.keepLast, params.keepEvery};
+          }
+          if (params.compress) {
+            settings.storage.compress = true;
+            settings.storage.maxAbsError = params.maxAbsError;
+          }
+        }
+        error = runBatchJob(
+            workerModel, models[job.modelIndex], job,
+            outputDir.filePath(QString::fromStdString(job.name) + ".sme")
+                .toStdString(),
+            manifest->timeoutSeconds);
+      } catch (const std::exception &e) {
+        error = fmt::format("Exception: {}", e.what());
+        // the model may have been left in an invalid state
+        workerModels.erase(job.modelIndex);
+      } catch (...) {
+        error = "Unknown exception";
+        workerModels.erase(job.modelIndex);
+      }
+      auto seconds{static_cast<double>(timer.elapsed()) / 1000.0};
+      writeStatus(statusFile(job), job, modelFile,
+                  error.empty() ? "completed" : "failed", error, seconds);
+      succeeded[order[i]] = error.empty() ? 1 : 0;
+      std::scoped_lock lock{printMutex};
+      ++nFinished;
+      fmt::print("# [{}/{}] {} ({}): {} in {:.1f}s\n", nFinished, jobs.size(),
+                 job.name, modelFile, error.empty() ? "completed" : error,
+                 seconds);
+    }
+  }};
+  std::vector<std::thread> threads;
+  for (std::size_t i = 0; i < nWorkers; ++i) {
+    threads.emplace_back(worker);
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+  auto nSucceeded{static_cast<std::size_t>(
+      std::count(succeeded.cbegin(), succeeded.cend(), 1))};
+  if (nSucceeded != jobs.size()) {
+    printError(fmt::format("{} of {} jobs failed", jobs.size() - nSucceeded,
+                           jobs.size()));
+    return false;
+  }
+  return true;
+}
+
+} // namespace sme::cli
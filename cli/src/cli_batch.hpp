@@ -0,0 +1,45 @@
+#pragma once
+
+#include "cli_params.hpp"
+#include <cstddef>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace sme::cli {
+
+struct BatchJob {
+  std::string name;
+  std::size_t modelIndex;
+  std::vector<std::pair<std::string, double>> parameters;
+  std::string simulationTimes;
+  std::string imageIntervals;
+};
+
+// Batch manifest: a JSON file containing
+//  - "models": list of model files
+//  - "parameters": optional list of parameter overrides, e.g. {"k1": 0.2}
+//  - "times": list of {"simulation_times": "10", "image_intervals": "1"}
+//  - "output_dir": optional output directory
+//  - "timeout_seconds": optional time limit for each job
+// with one job for each combination of model, parameters and times.
+// Relative paths are relative to the directory containing the manifest.
+struct BatchManifest {
+  std::vector<std::string> models;
+  std::string outputDir;
+  // zero if there is no time limit
+  double timeoutSeconds{0.0};
+  std::vector<BatchJob> jobs;
+};
+
+std::optional<BatchManifest> readBatchManifest(const std::string &filename);
+
+// job indices in the order they should be started: largest estimated size
+// first, so that the jobs are evenly packed onto the available cores
+std::vector<std::size_t>
+getBatchJobOrder(const std::vector<double> &estimatedSizes);
+
+bool doBatch(const Params &params);
+
+} // namespace sme::cli
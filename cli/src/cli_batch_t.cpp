@@ -0,0 +1,150 @@
+#include "catch_wrapper.hpp"
+#include "cli_batch.hpp"
+#include "model.hpp"
+#include <QDir>
+#include <QFile>
+#include <QJsonDocument>
+#include <QJsonObject>
+
+using namespace sme;
+
+static void writeManifest(const char *filename, const char *json) {
+  QFile f(filename);
+  f.open(QIODevice::WriteOnly | QIODevice::Text);
+  f.write(json);
+}
+
+static QJsonObject readStatus(const QString &filename) {
+  QFile f(filename);
+  f.open(QIODevice::ReadOnly);
+  return QJsonDocument::fromJson(f.readAll()).object();
+}
+
+TEST_CASE("CLI Batch", "[cli][batch]") {
+  const char *tmpModelFile{"tmpclibatch.xml"};
+  const char *tmpManifestFile{"tmpclibatch.json"};
+  QFile::remove(tmpModelFile);
+  QFile::copy(":/models/gray-scott.xml", tmpModelFile);
+  SECTION("job order") {
+    REQUIRE(cli::getBatchJobOrder({}).empty());
+    REQUIRE(cli::getBatchJobOrder({1.0, 3.0, 2.0, 3.0}) ==
+            std::vector<std::size_t>{1, 3, 2, 0});
+  }
+  SECTION("read manifest") {
+    writeManifest(tmpManifestFile,
+                  R"({"models": ["tmpclibatch.xml"],
+                      "parameters": [{"k": 0.05}, {"k": 0.06, "f": 0.04}],
+                      "times": [{"simulation_times": "2",
+                                 "image_intervals": "1"},
+                                {"simulation_times": 1,
+                                 "image_intervals": 0.5}]})");
+    auto manifest{cli::readBatchManifest(tmpManifestFile)};
+    REQUIRE(manifest.has_value());
+    REQUIRE(manifest->models.size() == 1);
+    REQUIRE(manifest->models[0] ==
+            QDir::current().absoluteFilePath(tmpModelFile).toStdString());
+    auto outputDir{QDir::current().absoluteFilePath("tmpclibatch_results")};
+    REQUIRE(manifest->outputDir == outputDir.toStdString());
+    REQUIRE(manifest->timeoutSeconds == dbl_approx(0.0));
+    REQUIRE(manifest->jobs.size() == 4);
+    const auto &job{manifest->jobs[3]};
+    REQUIRE(job.name == "job-3");
+    REQUIRE(job.modelIndex == 0);
+    REQUIRE(job.parameters.size() == 2);
+    REQUIRE(job.simulationTimes == "1");
+    REQUIRE(job.imageIntervals == "0.5");
+    REQUIRE(manifest->jobs[0].parameters ==
+            std::vector<std::pair<std::string, double>>{{"k", 0.05}});
+    // invalid manifests
+    writeManifest(tmpManifestFile, R"({"models": ["tmpclibatch.xml"]})");
+    REQUIRE(cli::readBatchManifest(tmpManifestFile).has_value() == false);
+    writeManifest(tmpManifestFile,
+                  R"({"models": ["tmpclibatch.xml"],
+                      "times": [{"simulation_times": "2;3",
+                                 "image_intervals": "1"}]})");
+    REQUIRE(cli::readBatchManifest(tmpManifestFile).has_value() == false);
+    writeManifest(tmpManifestFile,
+                  R"({"models": ["tmpclibatch.xml"],
+                      "times": [{"simulation_times": "2",
+                                 "image_intervals": "1"}],
+                      "timeout_seconds": -1})");
+    REQUIRE(cli::readBatchManifest(tmpManifestFile).has_value() == false);
+    writeManifest(tmpManifestFile, R"({"models": [)");
+    REQUIRE(cli::readBatchManifest(tmpManifestFile).has_value() == false);
+    REQUIRE(cli::readBatchManifest("idontexist.json").has_value() == false);
+  }
+  SECTION("run batch, pixel sim") {
+    QDir("tmpclibatch_out").removeRecursively();
+    writeManifest(tmpManifestFile,
+                  R"({"models": ["tmpclibatch.xml"],
+                      "parameters": [{"k": 0.05}, {"k": 0.06, "f": 0.04},
+                                     {"f": 0.05}],
+                      "times": [{"simulation_times": "2",
+                                 "image_intervals": "1"}],
+                      "output_dir": "tmpclibatch_out"})");
+    model::Model original;
+    original.importFile(tmpModelFile);
+    auto originalF{
+        original.getParameters().getExpression("f").toDouble()};
+    auto originalK{
+        original.getParameters().getExpression("k").toDouble()};
+    cli::Params params;
+    params.batchFile = tmpManifestFile;
+    params.simType = simulate::SimulatorType::Pixel;
+    params.maxThreads = 2;
+    REQUIRE(cli::doBatch(params) == true);
+    std::vector<std::pair<double, double>> kf{
+        {0.05, originalF}, {0.06, 0.04}, {originalK, 0.05}};
+    for (std::size_t i = 0; i < kf.size(); ++i) {
+      auto name{QString("tmpclibatch_out/job-%1").arg(i)};
+      auto status{readStatus(name + ".json")};
+      REQUIRE(status["job"].toString() == QString("job-%1").arg(i));
+      REQUIRE(status["status"].toString() == "completed");
+      REQUIRE(status["error"].toString().isEmpty());
+      model::Model m;
+      m.importFile((name + ".sme").toStdString());
+      REQUIRE(m.getSimulationData().timePoints.size() == 3);
+      REQUIRE(m.getSimulationData().timePoints[2] == dbl_approx(2.0));
+      REQUIRE(m.getParameters().getExpression("k").toDouble() ==
+              dbl_approx(kf[i].first));
+      REQUIRE(m.getParameters().getExpression("f").toDouble() ==
+              dbl_approx(kf[i].second));
+    }
+    QDir("tmpclibatch_out").removeRecursively();
+  }
+  SECTION("job that times out fails, pixel sim") {
+    QDir("tmpclibatch_out").removeRecursively();
+    writeManifest(tmpManifestFile,
+                  R"({"models": ["tmpclibatch.xml"],
+                      "times": [{"simulation_times": "1000",
+                                 "image_intervals": "1"}],
+                      "output_dir": "tmpclibatch_out",
+                      "timeout_seconds": 0.5})");
+    auto manifest{cli::readBatchManifest(tmpManifestFile)};
+    REQUIRE(manifest.has_value());
+    REQUIRE(manifest->timeoutSeconds == dbl_approx(0.5));
+    cli::Params params;
+    params.batchFile = tmpManifestFile;
+    params.simType = simulate::SimulatorType::Pixel;
+    params.maxThreads = 1;
+    REQUIRE(cli::doBatch(params) == false);
+    auto status{readStatus("tmpclibatch_out/job-0.json")};
+    REQUIRE(status["status"].toString() == "failed");
+    REQUIRE(status["error"].toString().startsWith("Timeout"));
+    REQUIRE(status["runtime_seconds"].toDouble() < 100.0);
+    QDir("tmpclibatch_out").removeRecursively();
+  }
+  SECTION("unknown parameter") {
+    writeManifest(tmpManifestFile,
+                  R"({"models": ["tmpclibatch.xml"],
+                      "parameters": [{"idontexist": 0.05}],
+                      "times": [{"simulation_times": "2",
+                                 "image_intervals": "1"}],
+                      "output_dir": "tmpclibatch_out"})");
+    cli::Params params;
+    params.batchFile = tmpManifestFile;
+    REQUIRE(cli::doBatch(params) == false);
+    QDir("tmpclibatch_out").removeRecursively();
+  }
+  QFile::remove(tmpManifestFile);
+}
@@ -6,16 +6,16 @@
 namespace sme::cli {
 
 static void addParams(CLI::App &app, Params &params) {
-  app.add_option("file", params.inputFile, "The spatial SBML model to simulate")
-      ->required()
-      ->check(CLI::ExistingFile);
-  app.add_option("times", params.simulationTimes,
-                 "The simulation time(s) (in model units of time)")
-      ->required();
-  app.add_option(
-         "image-intervals", params.imageIntervals,
-         "The interval(s) between saving images (in model units of time)")
-      ->required();
+  // the positional arguments are required unless a batch manifest is given
+  auto *file{app.add_option("file", params.inputFile,
+                            "The spatial SBML model to simulate")};
+  file->check(CLI::ExistingFile);
+  auto *times{app.add_option(
+      "times", params.simulationTimes,
+      "The simulation time(s) (in model units of time)")};
+  auto *imageIntervals{app.add_option(
+      "image-intervals", params.imageIntervals,
+      "The interval(s) between saving images (in model units of time)")};
   app.add_option("-s,--simulator", params.simType,
                  "The simulator to use: dune or pixel")
       ->transform(CLI::CheckedTransformer(
@@ -27,10 +27,54 @@ static void addParams(CLI::App &app, Params &params) {
   app.add_option("-o,--output-file", params.outputFile,
                  "The output file to write the results to. If not set, then "
                  "the input file is used.");
+  app.add_option("--stream-file", params.streamFile,
+                 "Also write each timepoint to this file as soon as it is "
+                 "simulated, and keep only a few timepoints in memory. The "
+                 "file can be read while the simulation is running.");
   app.add_option("-n,--nthreads", params.maxThreads,
                  "The maximum number of CPU threads to use (0 means unlimited)")
       ->check(CLI::NonNegativeNumber)
       ->capture_default_str();
+  app.add_option("--keep-last", params.keepLast,
+                 "Keep the concentrations of only this many of the most recent "
+                 "timepoints (0 means use the model's retention policy). The "
+                 "statistics of every timepoint are always kept.")
+      ->check(CLI::NonNegativeNumber)
+      ->capture_default_str();
+  app.add_option("--keep-every", params.keepEvery,
+                 "With --keep-last, also keep the concentrations of every n-th "
+                 "older timepoint (0 means keep none of them)")
+      ->check(CLI::NonNegativeNumber)
+      ->capture_default_str();
+  app.add_flag("--compress", params.compress,
+               "Compress the concentrations of each timepoint, which reduces "
+               "the memory or disk space used by long simulations");
+  app.add_option("--max-abs-error", params.maxAbsError,
+                 "With --compress, the maximum absolute error of the stored "
+                 "concentrations (0 means lossless compression)")
+      ->check(CLI::NonNegativeNumber)
+      ->capture_default_str();
+  auto *batch{app.add_option(
+      "-b,--batch", params.batchFile,
+      "Run all the jobs in this JSON batch manifest instead of a single "
+      "simulation. Each job is a combination of a model file, parameter "
+      "values and simulation times. The jobs are run concurrently, largest "
+      "first, with one CPU thread each, and each job writes a .sme results "
+      "file and a .json status file to the output directory.")};
+  batch->excludes(file)->excludes(times)->excludes(imageIntervals);
+  app.callback([&params]() {
+    if (!params.batchFile.empty()) {
+      return;
+    }
+    for (const auto &[value, name] :
+         {std::pair{&params.inputFile, "file"},
+          std::pair{&params.simulationTimes, "times"},
+          std::pair{&params.imageIntervals, "image-intervals"}}) {
+      if (value->empty()) {
+        throw CLI::RequiredError(name);
+      }
+    }
+  });
 }
 
 static void addCallbacks(CLI::App &app) {
@@ -77,7 +121,13 @@ void printParams(const Params &params) {
   fmt::print("#   - Simulation Length(s): {}\n", params.simulationTimes);
   fmt::print("#   - Image Interval(s): {}\n", params.imageIntervals);
   fmt::print("#   - Output file: {}\n", params.outputFile);
+  fmt::print("#   - Stream file: {}\n", params.streamFile);
   fmt::print("#   - Max CPU threads: {}\n", params.maxThreads);
+  fmt::print("#   - Keep last timepoints: {}\n", params.keepLast);
+  fmt::print("#   - Keep every n-th timepoint: {}\n", params.keepEvery);
+  fmt::print("#   - Compress: {}\n", params.compress);
+  fmt::print("#   - Max absolute error: {}\n", params.maxAbsError);
+  fmt::print("#   - Batch manifest: {}\n", params.batchFile);
 }
 
 } // namespace sme::cli
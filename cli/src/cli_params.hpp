@@ -11,7 +11,15 @@ struct Params {
   std::string imageIntervals;
   simulate::SimulatorType simType{simulate::SimulatorType::DUNE};
   std::string outputFile{};
+  std::string streamFile{};
   std::size_t maxThreads{0};
+  // if non-zero, replaces the retention policy of the model
+  std::size_t keepLast{0};
+  std::size_t keepEvery{0};
+  // if true, replaces the storage options of the model
+  bool compress{false};
+  double maxAbsError{0.0};
+  std::string batchFile{};
 };
 
 Params setupCLI(CLI::App &app);
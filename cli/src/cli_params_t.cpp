@@ -13,8 +13,48 @@ TEST_CASE("CLI Params", "[cli][params]") {
   cli::setupCLI(a);
   REQUIRE(a.get_description().substr(0, 24) == "Spatial Model Editor CLI");
   REQUIRE(a.get_groups().size() == 1);
-  REQUIRE(a.get_options().size() == 10);
-  REQUIRE(a.get_option("file")->get_required() == true);
-  REQUIRE(a.get_option("times")->get_required() == true);
-  REQUIRE(a.get_option("image-intervals")->get_required() == true);
+  REQUIRE(a.get_options().size() == 16);
+  // positional arguments are required unless a batch manifest is given
+  REQUIRE(a.get_option("file")->get_required() == false);
+  REQUIRE(a.get_option("times")->get_required() == false);
+  REQUIRE(a.get_option("image-intervals")->get_required() == false);
+  REQUIRE(a.get_option("--batch")->get_required() == false);
+}
+
+TEST_CASE("CLI Params: batch manifest", "[cli][params]") {
+  CLI::App a;
+  auto params{cli::setupCLI(a)};
+  REQUIRE_THROWS_AS(a.parse(""), CLI::RequiredError);
+  a.clear();
+  REQUIRE_THROWS_AS(a.parse("--batch jobs.json 10"), CLI::ParseError);
+  a.clear();
+  REQUIRE_NOTHROW(a.parse("--batch jobs.json"));
+  REQUIRE(params.batchFile == "jobs.json");
+  REQUIRE(params.inputFile.empty());
+}
+
+TEST_CASE("CLI Params: retention", "[cli][params]") {
+  CLI::App a;
+  auto params{cli::setupCLI(a)};
+  REQUIRE_NOTHROW(a.parse("--batch jobs.json --keep-last 3 --keep-every 10"));
+  REQUIRE(params.keepLast == 3);
+  REQUIRE(params.keepEvery == 10);
+  a.clear();
+  REQUIRE_THROWS_AS(a.parse("--batch jobs.json --keep-last -1"),
+                    CLI::ParseError);
+}
+
+TEST_CASE("CLI Params: compression", "[cli][params]") {
+  CLI::App a;
+  auto params{cli::setupCLI(a)};
+  REQUIRE_NOTHROW(a.parse("--batch jobs.json"));
+  REQUIRE(params.compress == false);
+  a.clear();
+  REQUIRE_NOTHROW(
+      a.parse("--batch jobs.json --compress --max-abs-error 1e-6"));
+  REQUIRE(params.compress == true);
+  REQUIRE(params.maxAbsError == dbl_approx(1e-6));
+  a.clear();
+  REQUIRE_THROWS_AS(a.parse("--batch jobs.json --max-abs-error -1"),
+                    CLI::ParseError);
 }
@@ -1,9 +1,13 @@
 #include "cli_simulate.hpp"
 #include "logger.hpp"
 #include "model.hpp"
+#include "result_stream.hpp"
 #include "simulate.hpp"
 #include <QFile>
+#include <QTemporaryDir>
 #include <fmt/core.h>
+#include <memory>
+#include <optional>
 
 namespace sme::cli {
 
@@ -24,10 +28,37 @@ void printSimulationTimes(
   }
 }
 
+static std::unique_ptr<simulate::ResultStreamWriter>
+startStreaming(const std::string &filename, simulate::Simulation &sim,
+               simulate::SimulationData &data) {
+  auto stream{std::make_unique<simulate::ResultStreamWriter>(
+      QString::fromStdString(filename))};
+  if (!stream->isValid()) {
+    return nullptr;
+  }
+  fmt::print("\n# Streaming results to '{}'\n", filename);
+  // existing timepoints are written first, so the stream has all results
+  for (std::size_t i = 0; i < data.size(); ++i) {
+    stream->append(data.timePoints[i], data.concPadding[i],
+                   data.concentration.get(i));
+  }
+  sim.setTimestepStoredCallback([s = stream.get(), &data](std::size_t i) {
+    s->append(data.timePoints[i], data.concPadding[i],
+              data.concentration.get(i));
+  });
+  return stream;
+}
+
 bool doSimulation(const Params &params) {
   // disable logging
   spdlog::set_level(spdlog::level::off);
 
+  // when streaming, concentrations are cached on disk instead of in memory
+  std::optional<QTemporaryDir> cacheDir;
+  if (!params.streamFile.empty()) {
+    cacheDir.emplace();
+  }
+
   // import model
   model::Model s;
   s.importFile(params.inputFile);
@@ -52,15 +83,46 @@ bool doSimulation(const Params &params) {
   if (params.maxThreads == 1) {
     options.pixel.enableMultiThreading = false;
   }
+  if (params.keepLast > 0) {
+    s.getSimulationSettings().retention = {params.keepLast, params.keepEvery};
+  }
+  if (params.compress) {
+    auto &storage{s.getSimulationSettings().storage};
+    storage.compress = true;
+    storage.maxAbsError = params.maxAbsError;
+  }
+  std::unique_ptr<simulate::ResultStreamWriter> stream;
   simulate::Simulation sim(s);
   if (const auto &e = sim.errorMessage(); !e.empty()) {
     fmt::print("\n\nError in simulation setup: {}\n\n", e);
     return false;
   }
+  if (cacheDir.has_value()) {
+    // after the simulation applies the storage settings of the model
+    s.getSimulationData().concentration.useMemoryMappedFile(
+        cacheDir->filePath("concentrations.dat"));
+  }
 
   printSimulationInfo(s);
 
+  if (!params.streamFile.empty()) {
+    stream = startStreaming(params.streamFile, sim, s.getSimulationData());
+    if (stream == nullptr) {
+      fmt::print("\n\nError: failed to open stream file '{}'\n\n",
+                 params.streamFile);
+      return false;
+    }
+  }
+
   sim.doMultipleTimesteps(times.value());
+  if (stream != nullptr) {
+    stream->close();
+    if (!stream->isValid()) {
+      fmt::print("\n\nError writing to stream file '{}'\n\n",
+                 params.streamFile);
+      return false;
+    }
+  }
   if (const auto &e = sim.errorMessage(); !e.empty()) {
     fmt::print("\n\nError during simulation: {}\n\n", e);
     return false;
@@ -1,6 +1,7 @@
 #include "catch_wrapper.hpp"
 #include "cli_simulate.hpp"
 #include "model.hpp"
+#include "result_stream.hpp"
 #include <QFile>
 
 using namespace sme;
@@ -51,4 +52,82 @@ TEST_CASE("CLI Simulate", "[cli][simulate]") {
     REQUIRE(m2.getSimulationData().timePoints.size() == 13);
     REQUIRE(m2.getSimulationData().timePoints[12] == dbl_approx(1.20));
   }
+  SECTION("Keep only the last timepoints, pixel sim") {
+    cli::Params params;
+    params.inputFile = tmpInputFile;
+    params.simulationTimes = "0.5";
+    params.imageIntervals = "0.1";
+    params.outputFile = tmpOutputFile;
+    params.simType = simulate::SimulatorType::Pixel;
+    params.keepLast = 2;
+    params.keepEvery = 2;
+    REQUIRE(doSimulation(params) == true);
+    model::Model m;
+    m.importFile(tmpOutputFile);
+    const auto &data{m.getSimulationData()};
+    REQUIRE(m.getSimulationSettings().retention.keepLast == 2);
+    REQUIRE(m.getSimulationSettings().retention.keepEvery == 2);
+    REQUIRE(data.timePoints.size() == 6);
+    REQUIRE(data.avgMinMax.size() == 6);
+    for (std::size_t i = 0; i < 6; ++i) {
+      bool retained{i % 2 == 0 || i >= 4};
+      REQUIRE(data.concentration.isRetained(i) == retained);
+      REQUIRE(data.concentration.get(i)->empty() == !retained);
+    }
+  }
+  SECTION("Compressed storage, pixel sim") {
+    cli::Params params;
+    params.inputFile = tmpInputFile;
+    params.simulationTimes = "0.2";
+    params.imageIntervals = "0.1";
+    params.outputFile = tmpOutputFile;
+    params.simType = simulate::SimulatorType::Pixel;
+    params.compress = true;
+    params.maxAbsError = 1e-8;
+    REQUIRE(doSimulation(params) == true);
+    model::Model m;
+    m.importFile(tmpOutputFile);
+    const auto &data{m.getSimulationData()};
+    REQUIRE(m.getSimulationSettings().storage.compress);
+    REQUIRE(m.getSimulationSettings().storage.maxAbsError ==
+            dbl_approx(1e-8));
+    REQUIRE(data.concentration.getCompression().enabled);
+    REQUIRE(data.concentration.getCompression().maxAbsError ==
+            dbl_approx(1e-8));
+    REQUIRE(data.timePoints.size() == 3);
+    REQUIRE(!data.concentration.get(2)->empty());
+  }
+  SECTION("Stream results to file, pixel sim") {
+    const char *tmpStreamFile{"tmpcli.dat"};
+    cli::Params params;
+    params.inputFile = tmpInputFile;
+    params.simulationTimes = "0.1;0.2";
+    params.imageIntervals = "0.05;0.1";
+    params.outputFile = tmpOutputFile;
+    params.streamFile = tmpStreamFile;
+    params.simType = simulate::SimulatorType::Pixel;
+    REQUIRE(doSimulation(params) == true);
+    model::Model m;
+    m.importFile(tmpOutputFile);
+    const auto &data{m.getSimulationData()};
+    REQUIRE(data.timePoints.size() == 5);
+    simulate::ResultStreamReader reader(tmpStreamFile);
+    REQUIRE(reader.isValid());
+    REQUIRE(reader.isComplete());
+    REQUIRE(reader.size() == 5);
+    for (std::size_t i = 0; i < reader.size(); ++i) {
+      REQUIRE(reader.getTime(i) == dbl_approx(data.timePoints[i]));
+      REQUIRE(reader.getConcPadding(i) == data.concPadding[i]);
+      REQUIRE(reader.getConcentrations(i) == *data.concentration.get(i));
+    }
+    // continuing the simulation also streams the existing timepoints
+    params.inputFile = tmpOutputFile;
+    REQUIRE(doSimulation(params) == true);
+    simulate::ResultStreamReader reader2(tmpStreamFile);
+    REQUIRE(reader2.isComplete());
+    REQUIRE(reader2.size() == 9);
+    REQUIRE(reader2.getTime(4) == dbl_approx(0.3));
+    REQUIRE(reader2.getTime(8) == dbl_approx(0.6));
+    QFile::remove(tmpStreamFile);
+  }
 }
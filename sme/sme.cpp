@@ -8,7 +8,10 @@
 #include "sme_membrane.hpp"
 #include "sme_model.hpp"
 #include "sme_module.hpp"
+#include "sme_observable.hpp"
 #include "sme_parameter.hpp"
+#include "sme_parameterscan.hpp"
+#include "sme_probe.hpp"
 #include "sme_reaction.hpp"
 #include "sme_reactionparameter.hpp"
 #include "sme_simulationresult.hpp"
@@ -26,4 +29,7 @@ PYBIND11_MODULE(sme, m) {
   sme::pybindReaction(m);
   sme::pybindReactionParameter(m);
   sme::pybindSimulationResult(m);
+  sme::pybindParameterScan(m);
+  sme::pybindObservable(m);
+  sme::pybindProbe(m);
 }
@@ -199,6 +199,12 @@ void pybindModel(pybind11::module &m) {
 
            Raises:
                RuntimeError: if the simulation times out or fails
+
+           Note:
+               The GIL is released while the simulation is running, so different models
+               can be simulated concurrently from multiple Python threads, e.g. using
+               ``concurrent.futures.ThreadPoolExecutor``. The same model should not be
+               used from more than one thread at a time.
            )")
       .def("simulate", &sme::Model::simulateString,
            pybind11::arg("simulation_times"), pybind11::arg("image_intervals"),
@@ -226,6 +232,12 @@ void pybindModel(pybind11::module &m) {
 
            Raises:
                RuntimeError: if the simulation times out or fails
+
+           Note:
+               The GIL is released while the simulation is running, so different models
+               can be simulated concurrently from multiple Python threads, e.g. using
+               ``concurrent.futures.ThreadPoolExecutor``. The same model should not be
+               used from more than one thread at a time.
            )")
       .def("simulation_results", &sme::Model::getSimulationResults,
            R"(
@@ -234,6 +246,173 @@ void pybindModel(pybind11::module &m) {
           Returns:
               SimulationResultList: the simulation results
           )")
+      .def("simulation_preview_image", &sme::Model::getSimulationPreviewImage,
+           pybind11::arg("time_index"), pybind11::arg("width"),
+           pybind11::arg("height"),
+           R"(
+          returns an image of the concentrations at a timepoint, for display at the given size.
+
+          For large geometry images this is a downsampled version of the
+          `concentration_image` of the corresponding simulation result,
+          which is much faster to generate. Otherwise it is identical to it.
+
+          Args:
+              time_index (int): The index of the simulation timepoint
+              width (int): The width in pixels that the image will be displayed at
+              height (int): The height in pixels that the image will be displayed at
+
+          Returns:
+              numpy.ndarray: an image of the concentrations, at least as large as `width` x `height` if possible
+
+          Raises:
+              InvalidArgument: if the time index is out of range
+          )")
+      .def_property_readonly("observables", &sme::Model::getObservables,
+                             R"(
+                    List[Observable]: the spatial observables of the simulation
+
+                    these are saved with the simulation results in a sme file,
+                    and are evaluated for each timepoint of any later simulation
+                    of this model
+                    )")
+      .def("set_observables", &sme::Model::setObservables,
+           pybind11::arg("observables"),
+           R"(
+          sets the spatial observables of the simulation, replacing any previous observables
+
+          The observables are evaluated for all existing timepoints of the simulation,
+          and then for each new timepoint.
+
+          Args:
+              observables (List[Observable]): the observables to evaluate
+
+          Returns:
+              List[str]: an error message for each observable, which is empty if it is valid. An invalid observable has the value NaN at every timepoint
+
+          Raises:
+              RuntimeError: if the simulation cannot be set up
+
+          Examples:
+              >>> import sme
+              >>> model = sme.open_example_model()
+              >>> errors = model.set_observables([sme.Observable("A_nucleus", "A_c3", ["c3"])])
+              >>> errors
+              ['']
+              >>> results = model.simulate(10, 5, continue_existing_simulation=True)
+              >>> model.observable_values()["A_nucleus"].shape
+              (3,)
+          )")
+      .def("observable_values", &sme::Model::getObservableValues,
+           R"(
+          returns the value of each observable at each timepoint of the simulation
+
+          Returns:
+              Dict[str, numpy.ndarray]: the values of each observable, indexed by its name
+          )")
+      .def_property("probes", &sme::Model::getProbes, &sme::Model::setProbes,
+                    R"(
+                    List[Probe]: the probes recorded during a simulation
+
+                    this is a copy of the probes: to change them assign a new list.
+                    Probes are only recorded if `probe_interval` is positive.
+                    )")
+      .def_property("probe_interval", &sme::Model::getProbeInterval,
+                    &sme::Model::setProbeInterval,
+                    R"(
+                    float: the simulation time between probe samples, probes are not recorded if this is not positive
+                    )")
+      .def_property("probe_capacity", &sme::Model::getProbeCapacity,
+                    &sme::Model::setProbeCapacity,
+                    R"(
+                    int: the number of probe samples kept, once full the oldest samples are overwritten
+                    )")
+      .def_property("retention_keep_last", &sme::Model::getRetentionKeepLast,
+                    &sme::Model::setRetentionKeepLast,
+                    R"(
+                    int: the number of most recent simulation timepoints whose concentrations are always kept, zero to keep all timepoints
+
+                    the concentrations of older timepoints are discarded unless kept by
+                    `retention_keep_every`, which limits the memory used by long simulations.
+                    The concentrations of discarded timepoints are NaN, but their
+                    statistics and observables are kept.
+
+                    Examples:
+                        >>> import sme
+                        >>> model = sme.open_example_model()
+                        >>> model.retention_keep_last = 2
+                        >>> model.retention_keep_every = 5
+                        >>> results = model.simulate(10, 1)
+                        >>> import numpy as np
+                        >>> [bool(np.isnan(r.species_concentration["A_c3"]).any()) for r in results[:3]]
+                        [False, True, True]
+                    )")
+      .def_property("retention_keep_every", &sme::Model::getRetentionKeepEvery,
+                    &sme::Model::setRetentionKeepEvery,
+                    R"(
+                    int: of the simulation timepoints older than `retention_keep_last`, keep the concentrations of every n-th one, zero to keep none
+                    )")
+      .def_property("compress_results", &sme::Model::getCompressResults,
+                    &sme::Model::setCompressResults,
+                    R"(
+                    bool: compress the concentrations of each simulation timepoint
+
+                    this reduces the memory used by long simulations, at the cost of
+                    some extra time to store and read each timepoint. It applies to
+                    new simulations, and is saved with the model.
+
+                    Examples:
+                        >>> import sme
+                        >>> model = sme.open_example_model()
+                        >>> model.compress_results = True
+                        >>> model.compression_max_abs_error = 1e-9
+                        >>> results = model.simulate(10, 5)
+                        >>> len(results)
+                        3
+                    )")
+      .def_property("compression_max_abs_error",
+                    &sme::Model::getCompressionMaxAbsError,
+                    &sme::Model::setCompressionMaxAbsError,
+                    R"(
+                    float: with `compress_results`, the maximum absolute error of the stored concentrations, zero for lossless compression
+                    )")
+      .def_property("store_results_in_file",
+                    &sme::Model::getStoreResultsInFile,
+                    &sme::Model::setStoreResultsInFile,
+                    R"(
+                    bool: store the concentrations of each simulation timepoint in a temporary file
+
+                    only a few recently used timepoints are kept in memory, and the
+                    others are read from the file when needed. This reduces the memory
+                    used by long simulations. It applies to new simulations, and is
+                    saved with the model.
+
+                    Examples:
+                        >>> import sme
+                        >>> model = sme.open_example_model()
+                        >>> model.store_results_in_file = True
+                        >>> results = model.simulate(10, 5)
+                        >>> len(results)
+                        3
+                    )")
+      .def("probe_samples", &sme::Model::getProbeSamples,
+           R"(
+          returns the samples recorded by the probes during the last simulation
+
+          Returns:
+              ProbeSamples: the time of each sample and the value of each probe and species
+
+          Examples:
+              >>> import sme
+              >>> model = sme.open_example_model()
+              >>> model.probes = [sme.Probe("centre", "c3", 50, 50)]
+              >>> model.probe_interval = 1
+              >>> results = model.simulate(10, 5)
+              >>> samples = model.probe_samples()
+              >>> samples.names
+              ['centre/A_c3', 'centre/B_c3']
+              >>> samples.values.shape
+              (11, 2)
+          )")
       .def("__repr__",
            [](const sme::Model &a) {
              return fmt::format("<sme.Model named '{}'>", a.getName());
@@ -243,30 +422,13 @@ void pybindModel(pybind11::module &m) {
 
 static std::vector<SimulationResult>
 constructSimulationResults(const simulate::Simulation *sim, bool getDcdt) {
+  // images and arrays are only generated when a result is accessed
+  auto simulationResults{std::make_shared<const simulate::SimulationResults>(
+      sim->getResults(getDcdt))};
   std::vector<SimulationResult> results;
-  results.reserve(sim->getTimePoints().size());
-  for (std::size_t i = 0; i < sim->getTimePoints().size(); ++i) {
-    auto &result = results.emplace_back();
-    result.timePoint = sim->getTimePoints()[i];
-    result.concentration_image = toPyImageRgb(sim->getConcImage(i, {}, true));
-    std::vector<ssize_t> shape{result.concentration_image.shape(0),
-                               result.concentration_image.shape(1)};
-    for (std::size_t ci = 0; ci < sim->getCompartmentIds().size(); ++ci) {
-      const auto &names{sim->getPyNames(ci)};
-      auto concs{sim->getPyConcs(i, ci)};
-      for (std::size_t si = 0; si < names.size(); ++si) {
-        result.species_concentration[pybind11::str(names[si])] =
-            as_ndarray(std::move(concs[si]), shape);
-      }
-      if (getDcdt && i + 1 == sim->getTimePoints().size()) {
-        if (auto dcdts{sim->getPyDcdts(ci)}; !dcdts.empty()) {
-          for (std::size_t si = 0; si < names.size(); ++si) {
-            result.species_dcdt[pybind11::str(names[si])] =
-                as_ndarray(std::move(dcdts[si]), shape);
-          }
-        }
-      }
-    }
+  results.reserve(simulationResults->size());
+  for (std::size_t i = 0; i < simulationResults->size(); ++i) {
+    results.emplace_back(simulationResults, i);
   }
   return results;
 }
@@ -346,6 +508,8 @@ void Model::exportSmeFile(const std::string &filename) {
   s->exportSMEFile(filename);
 }
 
+std::string Model::exportSbmlString() { return s->getXml().toStdString(); }
+
 std::vector<SimulationResult>
 Model::simulateString(const std::string &lengths, const std::string &intervals,
                       int timeoutSeconds, bool throwOnTimeout,
@@ -373,19 +537,36 @@ Model::simulateString(const std::string &lengths, const std::string &intervals,
   if (!times.has_value()) {
     throw SmeRuntimeError("Invalid simulation lengths or intervals");
   }
-  // ensure any existing DUNE objects are destroyed to avoid later segfaults
-  sim.reset();
-  sim = std::make_unique<simulate::Simulation>(*(s.get()));
+  // release the GIL while setting up and running the simulation, so that other
+  // Python threads can run, including simulations of other models
+  {
+    pybind11::gil_scoped_release release;
+    // ensure any existing DUNE objects are destroyed to avoid later segfaults
+    sim.reset();
+    sim = std::make_unique<simulate::Simulation>(*(s.get()));
+  }
   if (const auto &e = sim->errorMessage(); !e.empty()) {
     throw SmeRuntimeError(fmt::format("Error in simulation setup: {}", e));
   }
-  sim->doMultipleTimesteps(times.value(), timeoutMillisecs, []() {
-    if (PyErr_CheckSignals() != 0) {
-      throw pybind11::error_already_set();
-      return true;
-    }
-    return false;
-  });
+  {
+    pybind11::gil_scoped_release release;
+    QElapsedTimer signalCheckTimer;
+    signalCheckTimer.start();
+    sim->doMultipleTimesteps(
+        times.value(), timeoutMillisecs, [&signalCheckTimer]() {
+          // briefly re-acquire the GIL to check for e.g. KeyboardInterrupt
+          constexpr qint64 signalCheckIntervalMillisecs{50};
+          if (signalCheckTimer.elapsed() < signalCheckIntervalMillisecs) {
+            return false;
+          }
+          signalCheckTimer.restart();
+          pybind11::gil_scoped_acquire acquire;
+          if (PyErr_CheckSignals() != 0) {
+            throw pybind11::error_already_set();
+          }
+          return false;
+        });
+  }
   if (const auto &e = sim->errorMessage(); throwOnTimeout && !e.empty()) {
     throw SmeRuntimeError(fmt::format("Error during simulation: {}", e));
   }
@@ -414,6 +595,129 @@ std::vector<SimulationResult> Model::getSimulationResults() {
   return constructSimulationResults(sim.get(), false);
 }
 
+pybind11::array Model::getSimulationPreviewImage(std::size_t timeIndex,
+                                                 int width, int height) {
+  if (sim == nullptr) {
+    sim = std::make_unique<simulate::Simulation>(*(s.get()));
+    if (const auto &e{sim->errorMessage()}; !e.empty()) {
+      throw SmeRuntimeError(fmt::format("Error in simulation setup: {}", e));
+    }
+  }
+  if (timeIndex >= sim->getTimePoints().size()) {
+    throw SmeInvalidArgument(
+        fmt::format("time index {} out of bounds", timeIndex));
+  }
+  return toPyImageRgb(
+      sim->getConcImagePreview(timeIndex, QSize(width, height), {}, true));
+}
+
+std::vector<std::string>
+Model::setObservables(const std::vector<simulate::Observable> &observables) {
+  if (sim == nullptr) {
+    sim = std::make_unique<simulate::Simulation>(*(s.get()));
+    if (const auto &e{sim->errorMessage()}; !e.empty()) {
+      throw SmeRuntimeError(fmt::format("Error in simulation setup: {}", e));
+    }
+  }
+  return sim->setObservables(observables);
+}
+
+const std::vector<simulate::Observable> &Model::getObservables() const {
+  return s->getSimulationData().observableDefinitions;
+}
+
+pybind11::dict Model::getObservableValues() const {
+  pybind11::dict dict;
+  const auto &data{s->getSimulationData()};
+  const auto &observables{data.observableDefinitions};
+  for (std::size_t i = 0; i < observables.size(); ++i) {
+    std::vector<double> values;
+    values.reserve(data.observables.size());
+    for (const auto &v : data.observables) {
+      values.push_back(v[i]);
+    }
+    dict[pybind11::str(observables[i].name)] = as_ndarray(std::move(values));
+  }
+  return dict;
+}
+
+std::vector<simulate::Probe> Model::getProbes() const {
+  return s->getSimulationSettings().probes.probes;
+}
+
+void Model::setProbes(const std::vector<simulate::Probe> &probes) {
+  s->getSimulationSettings().probes.probes = probes;
+}
+
+double Model::getProbeInterval() const {
+  return s->getSimulationSettings().probes.interval;
+}
+
+void Model::setProbeInterval(double interval) {
+  s->getSimulationSettings().probes.interval = interval;
+}
+
+std::size_t Model::getProbeCapacity() const {
+  return s->getSimulationSettings().probes.capacity;
+}
+
+void Model::setProbeCapacity(std::size_t capacity) {
+  if (capacity == 0) {
+    throw SmeInvalidArgument("probe capacity must be positive");
+  }
+  s->getSimulationSettings().probes.capacity = capacity;
+}
+
+simulate::ProbeSamples Model::getProbeSamples() const {
+  if (sim == nullptr) {
+    return {};
+  }
+  return sim->getProbeSamples();
+}
+
+std::size_t Model::getRetentionKeepLast() const {
+  return s->getSimulationSettings().retention.keepLast;
+}
+
+void Model::setRetentionKeepLast(std::size_t keepLast) {
+  s->getSimulationSettings().retention.keepLast = keepLast;
+}
+
+std::size_t Model::getRetentionKeepEvery() const {
+  return s->getSimulationSettings().retention.keepEvery;
+}
+
+void Model::setRetentionKeepEvery(std::size_t keepEvery) {
+  s->getSimulationSettings().retention.keepEvery = keepEvery;
+}
+
+bool Model::getCompressResults() const {
+  return s->getSimulationSettings().storage.compress;
+}
+
+void Model::setCompressResults(bool compress) {
+  s->getSimulationSettings().storage.compress = compress;
+}
+
+double Model::getCompressionMaxAbsError() const {
+  return s->getSimulationSettings().storage.maxAbsError;
+}
+
+void Model::setCompressionMaxAbsError(double maxAbsError) {
+  if (!(maxAbsError >= 0.0)) {
+    throw SmeInvalidArgument("max absolute error must not be negative");
+  }
+  s->getSimulationSettings().storage.maxAbsError = maxAbsError;
+}
+
+bool Model::getStoreResultsInFile() const {
+  return s->getSimulationSettings().storage.useFile;
+}
+
+void Model::setStoreResultsInFile(bool useFile) {
+  s->getSimulationSettings().storage.useFile = useFile;
+}
+
 std::string Model::getStr() const {
   std::string str("<sme.Model>\n");
   str.append(fmt::format("  - name: '{}'\n", getName()));
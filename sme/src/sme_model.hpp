@@ -2,6 +2,7 @@
 
 #include "model.hpp"
 #include "simulate.hpp"
+#include "simulate_probes.hpp"
 #include "sme_common.hpp"
 #include "sme_compartment.hpp"
 #include "sme_membrane.hpp"
@@ -31,6 +32,7 @@ public:
   void importGeometryFromImage(const std::string &filename);
   void exportSbmlFile(const std::string &filename);
   void exportSmeFile(const std::string &filename);
+  std::string exportSbmlString();
   std::vector<Compartment> compartments;
   std::vector<Membrane> membranes;
   std::vector<Parameter> parameters;
@@ -47,6 +49,30 @@ public:
                 bool continueExistingSimulation, bool returnResults,
                 int nThreads);
   std::vector<SimulationResult> getSimulationResults();
+  pybind11::array getSimulationPreviewImage(std::size_t timeIndex, int width,
+                                            int height);
+  std::vector<std::string>
+  setObservables(const std::vector<simulate::Observable> &observables);
+  [[nodiscard]] const std::vector<simulate::Observable> &
+  getObservables() const;
+  [[nodiscard]] pybind11::dict getObservableValues() const;
+  [[nodiscard]] std::vector<simulate::Probe> getProbes() const;
+  void setProbes(const std::vector<simulate::Probe> &probes);
+  [[nodiscard]] double getProbeInterval() const;
+  void setProbeInterval(double interval);
+  [[nodiscard]] std::size_t getProbeCapacity() const;
+  void setProbeCapacity(std::size_t capacity);
+  [[nodiscard]] simulate::ProbeSamples getProbeSamples() const;
+  [[nodiscard]] std::size_t getRetentionKeepLast() const;
+  void setRetentionKeepLast(std::size_t keepLast);
+  [[nodiscard]] std::size_t getRetentionKeepEvery() const;
+  void setRetentionKeepEvery(std::size_t keepEvery);
+  [[nodiscard]] bool getCompressResults() const;
+  void setCompressResults(bool compress);
+  [[nodiscard]] double getCompressionMaxAbsError() const;
+  void setCompressionMaxAbsError(double maxAbsError);
+  [[nodiscard]] bool getStoreResultsInFile() const;
+  void setStoreResultsInFile(bool useFile);
   [[nodiscard]] std::string getStr() const;
 };
 
@@ -0,0 +1,71 @@
+// Python.h (included by pybind11.h) must come first
+// https://docs.python.org/3.2/c-api/intro.html#include-files
+#include <pybind11/pybind11.h>
+
+#include "simulate_options.hpp"
+#include "sme_common.hpp"
+#include "sme_observable.hpp"
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace sme {
+
+void pybindObservable(pybind11::module &m) {
+  pybind11::enum_<simulate::ObservableReduction>(m, "ObservableReduction",
+                                                 R"(
+                                                 how an observable is reduced over the pixels of its compartments
+                                                 )")
+      .value("Integral", simulate::ObservableReduction::Integral)
+      .value("Average", simulate::ObservableReduction::Average)
+      .value("Min", simulate::ObservableReduction::Min)
+      .value("Max", simulate::ObservableReduction::Max);
+  pybind11::class_<simulate::Observable>(m, "Observable",
+                                         R"(
+                                         a spatial observable of a simulation
+
+                                         an expression in terms of the species, the spatial
+                                         coordinates x, y and the time t, which is evaluated at each
+                                         pixel of one or more compartments and reduced to a single
+                                         value for each timepoint of the simulation
+                                         )")
+      .def(pybind11::init([](std::string name, std::string expression,
+                             std::vector<std::string> compartments,
+                             simulate::ObservableReduction reduction) {
+             return simulate::Observable{std::move(name),
+                                         std::move(expression),
+                                         std::move(compartments), reduction};
+           }),
+           pybind11::arg("name"), pybind11::arg("expression"),
+           pybind11::arg("compartments") = std::vector<std::string>{},
+           pybind11::arg("reduction") =
+               simulate::ObservableReduction::Integral,
+           R"(
+           Args:
+               name (str): the name of the observable
+               expression (str): the expression to evaluate at each pixel, in terms of species ids, x, y and t
+               compartments (List[str]): the ids of the compartments to reduce over, all compartments if empty. Default value: empty
+               reduction (sme.ObservableReduction): how the values are reduced over the pixels. Default value: Integral
+           )")
+      .def_readwrite("name", &simulate::Observable::name,
+                     R"(
+                     str: the name of this observable
+                     )")
+      .def_readwrite("expression", &simulate::Observable::expression,
+                     R"(
+                     str: the expression evaluated at each pixel
+                     )")
+      .def_readwrite("compartments", &simulate::Observable::compartmentIds,
+                     R"(
+                     List[str]: the ids of the compartments to reduce over, all compartments if empty
+                     )")
+      .def_readwrite("reduction", &simulate::Observable::reduction,
+                     R"(
+                     sme.ObservableReduction: how the values are reduced over the pixels
+                     )")
+      .def("__repr__", [](const simulate::Observable &a) {
+        return fmt::format("<sme.Observable named '{}'>", a.name);
+      });
+}
+
+} // namespace sme
@@ -0,0 +1,396 @@
+// Python.h (included by pybind11.h) must come first
+// https://docs.python.org/3.2/c-api/intro.html#include-files
+#include <pybind11/pybind11.h>
+
+#include "logger.hpp"
+#include "model.hpp"
+#include "simulate.hpp"
+#include "sme_parameterscan.hpp"
+#include <QString>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <exception>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace sme {
+
+void pybindParameterScan(pybind11::module &m) {
+  pybind11::class_<ParameterScanResult>(m, "ParameterScanResult",
+                                        R"(
+                                        the results of a parameter scan
+                                        )")
+      .def_readonly("parameters", &ParameterScanResult::parameters,
+                    R"(
+                    Dict[str, numpy.ndarray]: the values of each scanned parameter
+
+                    the parameters are in the same order as the axes of the
+                    arrays in ``species_concentration``
+                    )")
+      .def_readonly("time_points", &ParameterScanResult::timePoints,
+                    R"(
+                    numpy.ndarray: the timepoints of the simulation results
+                    )")
+      .def_readonly("species_concentration",
+                    &ParameterScanResult::speciesConcentration,
+                    R"(
+                    Dict[str, numpy.ndarray]: the species concentrations for each combination of parameter values
+
+                    for each species, the concentrations are provided as an
+                    array with one axis for each scanned parameter, followed by
+                    the time, y and x axes, e.g. for a scan over two parameters
+                    ``species_concentration['A'][i][j][t][y][x]``
+                    is the concentration of species "A" at the point (x,y)
+                    at the timepoint with index t, for the simulation with
+                    the i-th value of the first parameter and the j-th value
+                    of the second parameter
+                    )")
+      .def("__repr__",
+           [](const ParameterScanResult &a) {
+             return fmt::format(
+                 "<sme.ParameterScanResult with {} parameter(s)>",
+                 pybind11::len(a.parameters));
+           })
+      .def("__str__", &ParameterScanResult::getStr);
+  constexpr const char *docString{R"(
+        simulates a model for each combination of the given parameter values
+
+        Each simulation uses a copy of the model, with the scanned parameters
+        set to the values for that simulation. The simulations are distributed
+        over a pool of worker threads, each of which has its own copy of the
+        model, and the GIL is released while they are running.
+
+        With the Pixel simulator the scanned parameters are inputs to the
+        compiled reaction kernels, rather than being inlined as constants,
+        so the kernels are compiled once and then shared by all the
+        simulations.
+
+        Args:
+            model (Model): the model to simulate, which is not modified
+            parameters (Dict[str, List[float]]): the names of the parameters to scan, and the values that each of them should take
+            simulation_times (str | float): The length(s) of the simulation in model units of time, as for :meth:`Model.simulate`
+            image_intervals (str | float): The interval(s) between images in model units of time, as for :meth:`Model.simulate`
+            n_workers (int): The number of simulations to run concurrently. Default value is 0, which means use all available cpu threads divided by `n_threads`.
+            n_threads (int): The number of cpu threads to use for each (Pixel) simulation. Default value is 1.
+            timeout_seconds (int): The maximum time in seconds that each simulation can run for. Default value: 86400 = 1 day.
+            simulator_type (sme.SimulatorType): The simulator to use: `sme.SimulatorType.DUNE` or `sme.SimulatorType.Pixel`. Default value: Pixel.
+
+        Returns:
+            ParameterScanResult: the results of all of the simulations
+
+        Raises:
+            InvalidArgument: if a parameter is not found, or has no values
+            RuntimeError: if any of the simulations times out or fails
+
+        Examples:
+            >>> import sme
+            >>> model = sme.open_example_model("gray-scott")
+            >>> scan = sme.parameter_scan(model, {"k": [0.05, 0.06], "f": [0.03, 0.04, 0.05]}, 10, 5)
+            >>> scan.species_concentration["V"].shape
+            (2, 3, 3, 100, 100)
+        )"};
+  m.def("parameter_scan", &parameterScanFloat, pybind11::arg("model"),
+        pybind11::arg("parameters"), pybind11::arg("simulation_time"),
+        pybind11::arg("image_interval"), pybind11::arg("n_workers") = 0,
+        pybind11::arg("n_threads") = 1,
+        pybind11::arg("timeout_seconds") = 86400,
+        pybind11::arg("simulator_type") = simulate::SimulatorType::Pixel,
+        docString);
+  m.def("parameter_scan", &parameterScan, pybind11::arg("model"),
+        pybind11::arg("parameters"), pybind11::arg("simulation_times"),
+        pybind11::arg("image_intervals"), pybind11::arg("n_workers") = 0,
+        pybind11::arg("n_threads") = 1,
+        pybind11::arg("timeout_seconds") = 86400,
+        pybind11::arg("simulator_type") = simulate::SimulatorType::Pixel,
+        docString);
+}
+
+std::string ParameterScanResult::getStr() const {
+  std::string str("<sme.ParameterScanResult>\n");
+  str.append("  - parameters:");
+  for (const auto &item : parameters) {
+    str.append(fmt::format("\n     - {}: {} values",
+                           pybind11::str(item.first).cast<std::string>(),
+                           pybind11::len(item.second)));
+  }
+  str.append(fmt::format("\n  - timepoints: {}", pybind11::len(timePoints)));
+  str.append("\n  - species:");
+  for (const auto &item : speciesConcentration) {
+    str.append(fmt::format("\n     - {}",
+                           pybind11::str(item.first).cast<std::string>()));
+  }
+  return str;
+}
+
+namespace {
+
+// simulations of copies of a model, one for each set of parameter values
+class ParameterScan {
+private:
+  std::vector<std::string> ids;
+  // run->parameter values
+  std::vector<std::vector<double>> runValues;
+  std::vector<std::pair<std::size_t, double>> times;
+  double timeoutMillisecs;
+  std::size_t nTimePoints;
+  std::atomic<std::size_t> nextRun{0};
+  std::atomic<bool> stopRequested{false};
+  std::once_flag layoutInitialised;
+  void initLayout(const simulate::SimulationResults &results) {
+    imageSize = results.getImageSize();
+    for (std::size_t i = 0; i < results.size(); ++i) {
+      timePoints.push_back(results.getTimePoint(i));
+    }
+    auto nPixels{static_cast<std::size_t>(imageSize.width()) *
+                 static_cast<std::size_t>(imageSize.height())};
+    for (std::size_t ci = 0; ci < results.getNumCompartments(); ++ci) {
+      const auto &names{speciesNames.emplace_back(results.getPyNames(ci))};
+      concs.emplace_back(names.size() * runValues.size() * nTimePoints *
+                         nPixels);
+    }
+  }
+  void storeResults(std::size_t runIndex,
+                    const simulate::SimulationResults &results) {
+    std::call_once(layoutInitialised, [this, &results]() {
+      initLayout(results);
+    });
+    auto nPixels{static_cast<std::size_t>(imageSize.width()) *
+                 static_cast<std::size_t>(imageSize.height())};
+    auto nRuns{runValues.size()};
+    for (std::size_t ci = 0; ci < concs.size(); ++ci) {
+      for (std::size_t ti = 0; ti < nTimePoints; ++ti) {
+        // (species, y, x) for this run & timepoint
+        auto c{results.getPyConcs(ti, ci)};
+        for (std::size_t si = 0; si < speciesNames[ci].size(); ++si) {
+          auto offset{((si * nRuns + runIndex) * nTimePoints + ti) * nPixels};
+          std::copy_n(c.cbegin() + static_cast<std::ptrdiff_t>(si * nPixels),
+                      nPixels,
+                      concs[ci].begin() + static_cast<std::ptrdiff_t>(offset));
+        }
+      }
+    }
+  }
+
+public:
+  ParameterScan(std::vector<std::string> parameterIds,
+                std::vector<std::vector<double>> values,
+                std::vector<std::pair<std::size_t, double>> simulationTimes,
+                double timeout_ms)
+      : ids{std::move(parameterIds)}, runValues{std::move(values)},
+        times{std::move(simulationTimes)}, timeoutMillisecs{timeout_ms} {
+    nTimePoints = 1;
+    for (const auto &[nSteps, dt] : times) {
+      nTimePoints += nSteps;
+    }
+  }
+  // layout & results, valid once all runs are complete
+  QSize imageSize{};
+  std::vector<double> timePoints{};
+  // compartment->species names
+  std::vector<std::vector<std::string>> speciesNames{};
+  // compartment->(species, run, time, y, x) concentrations
+  std::vector<std::vector<double>> concs{};
+  void requestStop() { stopRequested.store(true); }
+  // do runs using this copy of the model until there are none left
+  void run(model::Model &m) {
+    std::unique_ptr<simulate::Simulation> sim;
+    for (auto runIndex{nextRun++}; runIndex < runValues.size();
+         runIndex = nextRun++) {
+      if (stopRequested.load()) {
+        return;
+      }
+      SPDLOG_INFO("Parameter scan run {}/{}", runIndex + 1, runValues.size());
+      for (std::size_t i = 0; i < ids.size(); ++i) {
+        m.getParameters().setExpression(
+            ids[i].c_str(), QString::number(runValues[runIndex][i], 'g', 17));
+      }
+      m.getSimulationData().clear();
+      m.getSimulationSettings().times.clear();
+      // the previous simulation is only deleted after this one is constructed,
+      // so that its compiled kernels are still in use and can be re-used
+      auto nextSim{std::make_unique<simulate::Simulation>(m, ids)};
+      sim = std::move(nextSim);
+      if (const auto &e{sim->errorMessage()}; !e.empty()) {
+        throw SmeRuntimeError(fmt::format("Error in simulation setup: {}", e));
+      }
+      sim->doMultipleTimesteps(times, timeoutMillisecs,
+                               [this]() { return stopRequested.load(); });
+      if (stopRequested.load()) {
+        return;
+      }
+      if (const auto &e{sim->errorMessage()}; !e.empty()) {
+        throw SmeRuntimeError(fmt::format("Error during simulation: {}", e));
+      }
+      auto results{sim->getResults()};
+      if (results.size() != nTimePoints) {
+        throw SmeRuntimeError("Simulation did not complete");
+      }
+      storeResults(runIndex, results);
+    }
+  }
+};
+
+} // namespace
+
+ParameterScanResult parameterScan(Model &model, const pybind11::dict &params,
+                                  const std::string &lengths,
+                                  const std::string &intervals, int nWorkers,
+                                  int nThreads, int timeoutSeconds,
+                                  simulate::SimulatorType simulatorType) {
+  auto times{
+      simulate::parseSimulationTimes(lengths.c_str(), intervals.c_str())};
+  if (!times.has_value()) {
+    throw SmeRuntimeError("Invalid simulation lengths or intervals");
+  }
+  std::vector<std::string> names;
+  std::vector<std::vector<double>> values;
+  for (const auto &item : params) {
+    names.push_back(pybind11::str(item.first).cast<std::string>());
+    values.push_back(item.second.cast<std::vector<double>>());
+    if (values.back().empty()) {
+      throw SmeInvalidArgument(
+          fmt::format("no values given for parameter '{}'", names.back()));
+    }
+  }
+  // every combination of parameter values, with the last parameter varying
+  // fastest, i.e. in row-major order of the parameter axes
+  std::vector<std::vector<double>> runValues{{}};
+  for (const auto &v : values) {
+    std::vector<std::vector<double>> newRunValues;
+    newRunValues.reserve(runValues.size() * v.size());
+    for (const auto &run : runValues) {
+      for (auto value : v) {
+        newRunValues.push_back(run);
+        newRunValues.back().push_back(value);
+      }
+    }
+    runValues = std::move(newRunValues);
+  }
+  auto nRuns{runValues.size()};
+  if (nThreads < 1) {
+    nThreads = 1;
+  }
+  if (nWorkers < 1) {
+    nWorkers = std::max(
+        1, static_cast<int>(std::thread::hardware_concurrency()) / nThreads);
+  }
+  auto nModels{std::min(static_cast<std::size_t>(nWorkers), nRuns)};
+  auto xml{model.exportSbmlString()};
+  std::vector<std::unique_ptr<model::Model>> models;
+  std::vector<std::string> ids;
+  {
+    pybind11::gil_scoped_release release;
+    // each worker has its own copy of the model
+    for (std::size_t i = 0; i < nModels; ++i) {
+      auto &m{models.emplace_back(std::make_unique<model::Model>())};
+      m->importSBMLString(xml);
+      m->getSimulationSettings().simulatorType = simulatorType;
+      auto &pixelOpts{m->getSimulationSettings().options.pixel};
+      pixelOpts.enableMultiThreading = nThreads > 1;
+      pixelOpts.maxThreads = static_cast<std::size_t>(nThreads);
+    }
+  }
+  const auto &paramIds{models.front()->getParameters().getIds()};
+  const auto &paramNames{models.front()->getParameters().getNames()};
+  for (const auto &name : names) {
+    auto i{paramNames.indexOf(QString::fromStdString(name))};
+    if (i < 0) {
+      throw SmeInvalidArgument(fmt::format("name '{}' not found", name));
+    }
+    ids.push_back(paramIds[i].toStdString());
+  }
+  ParameterScan scan(std::move(ids), std::move(runValues), times.value(),
+                     static_cast<double>(timeoutSeconds) * 1000.0);
+  std::vector<std::future<void>> futures;
+  {
+    pybind11::gil_scoped_release release;
+    for (auto &m : models) {
+      futures.push_back(
+          std::async(std::launch::async, [&scan, &clone = *m]() {
+            try {
+              scan.run(clone);
+            } catch (...) {
+              scan.requestStop();
+              throw;
+            }
+          }));
+    }
+  }
+  // wait for the workers, periodically re-acquiring the GIL to check for
+  // e.g. KeyboardInterrupt
+  auto waitForAll{[&futures]() {
+    pybind11::gil_scoped_release release;
+    for (auto &f : futures) {
+      f.wait();
+    }
+  }};
+  for (auto &f : futures) {
+    constexpr std::chrono::milliseconds signalCheckInterval{50};
+    while (true) {
+      std::future_status status;
+      {
+        pybind11::gil_scoped_release release;
+        status = f.wait_for(signalCheckInterval);
+      }
+      if (status == std::future_status::ready) {
+        break;
+      }
+      if (PyErr_CheckSignals() != 0) {
+        scan.requestStop();
+        waitForAll();
+        throw pybind11::error_already_set();
+      }
+    }
+  }
+  // re-throw the first exception from a worker, if any
+  for (auto &f : futures) {
+    f.get();
+  }
+  ParameterScanResult result;
+  for (std::size_t i = 0; i < names.size(); ++i) {
+    result.parameters[pybind11::str(names[i])] =
+        as_ndarray(std::move(values[i]));
+  }
+  auto nTimePoints{static_cast<ssize_t>(scan.timePoints.size())};
+  result.timePoints = as_ndarray(std::move(scan.timePoints));
+  // shape of the results for one species
+  std::vector<ssize_t> shape;
+  for (const auto &item : result.parameters) {
+    shape.push_back(static_cast<ssize_t>(pybind11::len(item.second)));
+  }
+  shape.push_back(nTimePoints);
+  shape.push_back(scan.imageSize.height());
+  shape.push_back(scan.imageSize.width());
+  auto nElements{static_cast<ssize_t>(nRuns) * nTimePoints *
+                 scan.imageSize.height() * scan.imageSize.width()};
+  // each species array is a view of the dense array of its compartment
+  for (std::size_t ci = 0; ci < scan.concs.size(); ++ci) {
+    const auto &speciesNames{scan.speciesNames[ci]};
+    auto nSpecies{static_cast<ssize_t>(speciesNames.size())};
+    auto all{as_ndarray(std::move(scan.concs[ci]), {nSpecies * nElements})};
+    for (ssize_t si = 0; si < nSpecies; ++si) {
+      result.speciesConcentration[pybind11::str(
+          speciesNames[static_cast<std::size_t>(si)])] =
+          pybind11::array_t<double>(shape, all.data() + si * nElements, all);
+    }
+  }
+  return result;
+}
+
+ParameterScanResult
+parameterScanFloat(Model &model, const pybind11::dict &params,
+                   double simulationTime, double imageInterval, int nWorkers,
+                   int nThreads, int timeoutSeconds,
+                   simulate::SimulatorType simulatorType) {
+  return parameterScan(
+      model, params, QString::number(simulationTime, 'g', 17).toStdString(),
+      QString::number(imageInterval, 'g', 17).toStdString(), nWorkers,
+      nThreads, timeoutSeconds, simulatorType);
+}
+
+} // namespace sme
@@ -0,0 +1,33 @@
+#pragma once
+
+#include "sme_common.hpp"
+#include "sme_model.hpp"
+#include "simulate_options.hpp"
+#include <pybind11/pybind11.h>
+#include <string>
+
+namespace sme {
+
+void pybindParameterScan(pybind11::module &m);
+
+// results of simulations of a model for each combination of parameter values
+struct ParameterScanResult {
+  pybind11::dict parameters{};
+  pybind11::array timePoints{};
+  pybind11::dict speciesConcentration{};
+  [[nodiscard]] std::string getStr() const;
+};
+
+ParameterScanResult parameterScan(Model &model, const pybind11::dict &params,
+                                  const std::string &lengths,
+                                  const std::string &intervals, int nWorkers,
+                                  int nThreads, int timeoutSeconds,
+                                  simulate::SimulatorType simulatorType);
+
+ParameterScanResult
+parameterScanFloat(Model &model, const pybind11::dict &params,
+                   double simulationTime, double imageInterval, int nWorkers,
+                   int nThreads, int timeoutSeconds,
+                   simulate::SimulatorType simulatorType);
+
+} // namespace sme
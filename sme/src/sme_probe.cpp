@@ -0,0 +1,109 @@
+// Python.h (included by pybind11.h) must come first
+// https://docs.python.org/3.2/c-api/intro.html#include-files
+#include <pybind11/pybind11.h>
+
+#include "simulate_options.hpp"
+#include "simulate_probes.hpp"
+#include "sme_common.hpp"
+#include "sme_probe.hpp"
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace sme {
+
+void pybindProbe(pybind11::module &m) {
+  pybind11::class_<simulate::Probe>(m, "Probe",
+                                    R"(
+                                    a point or rectangular region of interest in a compartment
+
+                                    the concentration of each species in the compartment at this
+                                    point, or averaged over this region, is recorded during a
+                                    simulation at a finer cadence than the full-field results
+                                    )")
+      .def(pybind11::init([](std::string name, std::string compartment,
+                             double x, double y, double width, double height) {
+             return simulate::Probe{std::move(name), std::move(compartment), x,
+                                    y, width, height};
+           }),
+           pybind11::arg("name"), pybind11::arg("compartment"),
+           pybind11::arg("x"), pybind11::arg("y"),
+           pybind11::arg("width") = 0.0, pybind11::arg("height") = 0.0,
+           R"(
+           Args:
+               name (str): the name of the probe
+               compartment (str): the id of the compartment to sample
+               x (float): the x coordinate of the point, or of the bottom-left corner of the region
+               y (float): the y coordinate of the point, or of the bottom-left corner of the region
+               width (float): the width of the region, zero for a point. Default value: 0
+               height (float): the height of the region, zero for a point. Default value: 0
+           )")
+      .def_readwrite("name", &simulate::Probe::name,
+                     R"(
+                     str: the name of this probe
+                     )")
+      .def_readwrite("compartment", &simulate::Probe::compartmentId,
+                     R"(
+                     str: the id of the compartment sampled by this probe
+                     )")
+      .def_readwrite("x", &simulate::Probe::x,
+                     R"(
+                     float: the x coordinate of the point, or of the bottom-left corner of the region
+                     )")
+      .def_readwrite("y", &simulate::Probe::y,
+                     R"(
+                     float: the y coordinate of the point, or of the bottom-left corner of the region
+                     )")
+      .def_readwrite("width", &simulate::Probe::width,
+                     R"(
+                     float: the width of the region, zero for a point
+                     )")
+      .def_readwrite("height", &simulate::Probe::height,
+                     R"(
+                     float: the height of the region, zero for a point
+                     )")
+      .def("__repr__", [](const simulate::Probe &a) {
+        return fmt::format("<sme.Probe named '{}'>", a.name);
+      });
+  pybind11::class_<simulate::ProbeSamples>(m, "ProbeSamples",
+                                           R"(
+                                           the samples recorded by the probes of a simulation
+                                           )")
+      .def_readonly("names", &simulate::ProbeSamples::names,
+                    R"(
+                    List[str]: the name of each column of values, as "probe name/species id"
+                    )")
+      .def_property_readonly(
+          "times",
+          [](const simulate::ProbeSamples &a) {
+            return as_ndarray(std::vector<double>(a.times));
+          },
+          R"(
+          numpy.ndarray: the time of each sample, oldest first
+          )")
+      .def_property_readonly(
+          "values",
+          [](const simulate::ProbeSamples &a) {
+            auto nRows{static_cast<ssize_t>(a.values.size())};
+            auto nCols{static_cast<ssize_t>(a.names.size())};
+            std::vector<double> values;
+            values.reserve(a.values.size() * a.names.size());
+            for (const auto &row : a.values) {
+              values.insert(values.end(), row.cbegin(), row.cend());
+            }
+            return as_ndarray(std::move(values), {nRows, nCols});
+          },
+          R"(
+          numpy.ndarray: the value of each column for each sample, with one row per sample
+          )")
+      .def_readonly("n_overwritten", &simulate::ProbeSamples::nOverwritten,
+                    R"(
+                    int: the number of older samples that were overwritten once the buffer was full
+                    )")
+      .def("__repr__", [](const simulate::ProbeSamples &a) {
+        return fmt::format("<sme.ProbeSamples with {} samples>",
+                           a.times.size());
+      });
+}
+
+} // namespace sme
@@ -0,0 +1,9 @@
+#pragma once
+
+#include <pybind11/pybind11.h>
+
+namespace sme {
+
+void pybindProbe(pybind11::module &m);
+
+} // namespace sme
@@ -3,6 +3,7 @@
 #include <pybind11/pybind11.h>
 
 #include "sme_simulationresult.hpp"
+#include <utility>
 
 namespace sme {
 
@@ -16,9 +17,9 @@ void pybindSimulationResult(pybind11::module &m) {
                     R"(
                     float: the timepoint these simulation results are from
                     )")
-      .def_readonly("concentration_image",
-                    &SimulationResult::concentration_image,
-                    R"(
+      .def_property_readonly("concentration_image",
+                             &SimulationResult::getConcentrationImage,
+                             R"(
                     numpy.ndarray: an image of the species concentrations at this timepoint
 
                     An array of RGB integer values for each pixel in the image of
@@ -54,9 +55,9 @@ void pybindSimulationResult(pybind11::module &m) {
                         >>> import matplotlib.pyplot as plt
                         >>> imgplot = plt.imshow(concentration_image)
                     )")
-      .def_readonly("species_concentration",
-                    &SimulationResult::species_concentration,
-                    R"(
+      .def_property_readonly("species_concentration",
+                             &SimulationResult::getSpeciesConcentration,
+                             R"(
                     Dict[str, numpy.ndarray]: the species concentrations at this timepoint
 
                     for each species, the concentrations are provided as a
@@ -94,8 +95,9 @@ void pybindSimulationResult(pybind11::module &m) {
                         >>> import matplotlib.pyplot as plt
                         >>> imgplot = plt.imshow(b_cell)
                     )")
-      .def_readonly("species_dcdt", &SimulationResult::species_dcdt,
-                    R"(
+      .def_property_readonly("species_dcdt",
+                             &SimulationResult::getSpeciesDcdt,
+                             R"(
                     Dict[str, numpy.ndarray]: the species concentration rate of change at this timepoint
 
                     for each species, the rate of change of concentration is provided as a
@@ -147,11 +149,79 @@ void pybindSimulationResult(pybind11::module &m) {
       .def("__str__", &SimulationResult::getStr);
 }
 
+SimulationResult::SimulationResult(
+    std::shared_ptr<const simulate::SimulationResults> simulationResults,
+    std::size_t index)
+    : results{std::move(simulationResults)}, timeIndex{index},
+      timePoint{results->getTimePoint(index)} {}
+
+const pybind11::array &SimulationResult::getConcentrationImage() {
+  if (!concentrationImage.has_value()) {
+    concentrationImage =
+        toPyImageRgb(results == nullptr ? QImage()
+                                        : results->getConcImage(timeIndex));
+  }
+  return concentrationImage.value();
+}
+
+// add a 2d (height, width) array for each species to dict, each a view of
+// the dense (species, height, width) array pyArray, without copying the data
+static void addSpeciesArrays(pybind11::dict &dict,
+                             const std::vector<std::string> &names,
+                             std::vector<double> &&pyArray, ssize_t height,
+                             ssize_t width) {
+  auto nSpecies{static_cast<ssize_t>(names.size())};
+  auto all{as_ndarray(std::move(pyArray), {nSpecies, height, width})};
+  for (ssize_t si = 0; si < nSpecies; ++si) {
+    dict[pybind11::str(names[static_cast<std::size_t>(si)])] =
+        pybind11::array_t<double>({height, width}, all.data(si, 0, 0), all);
+  }
+}
+
+const pybind11::dict &SimulationResult::getSpeciesConcentration() {
+  if (!speciesConcentration.has_value()) {
+    pybind11::dict dict;
+    if (results != nullptr) {
+      auto height{static_cast<ssize_t>(results->getImageSize().height())};
+      auto width{static_cast<ssize_t>(results->getImageSize().width())};
+      for (std::size_t ci = 0; ci < results->getNumCompartments(); ++ci) {
+        addSpeciesArrays(dict, results->getPyNames(ci),
+                         results->getPyConcs(timeIndex, ci), height, width);
+      }
+    }
+    speciesConcentration = std::move(dict);
+  }
+  return speciesConcentration.value();
+}
+
+const pybind11::dict &SimulationResult::getSpeciesDcdt() {
+  if (!speciesDcdt.has_value()) {
+    pybind11::dict dict;
+    if (results != nullptr) {
+      auto height{static_cast<ssize_t>(results->getImageSize().height())};
+      auto width{static_cast<ssize_t>(results->getImageSize().width())};
+      for (std::size_t ci = 0; ci < results->getNumCompartments(); ++ci) {
+        if (auto dcdts{results->getPyDcdts(timeIndex, ci)}; !dcdts.empty()) {
+          addSpeciesArrays(dict, results->getPyNames(ci), std::move(dcdts),
+                           height, width);
+        }
+      }
+    }
+    speciesDcdt = std::move(dict);
+  }
+  return speciesDcdt.value();
+}
+
 std::string SimulationResult::getStr() const {
+  std::size_t nSpecies{0};
+  if (results != nullptr) {
+    for (std::size_t ci = 0; ci < results->getNumCompartments(); ++ci) {
+      nSpecies += results->getPyNames(ci).size();
+    }
+  }
   std::string str("<sme.SimulationResult>\n");
   str.append(fmt::format("  - timepoint: {}\n", timePoint));
-  str.append(
-      fmt::format("  - number of species: {}\n", species_concentration.size()));
+  str.append(fmt::format("  - number of species: {}\n", nSpecies));
   return str;
 }
 
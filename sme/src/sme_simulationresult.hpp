@@ -1,8 +1,10 @@
 #pragma once
 
 #include "sme_common.hpp"
+#include "simulate.hpp"
 #include <map>
 #include <memory>
+#include <optional>
 #include <pybind11/pybind11.h>
 #include <string>
 #include <vector>
@@ -11,11 +13,25 @@ namespace sme {
 
 void pybindSimulationResult(pybind11::module &m);
 
-struct SimulationResult {
+// results at a timepoint: the image and arrays are only generated from the
+// simulation results when they are first accessed
+class SimulationResult {
+private:
+  std::shared_ptr<const simulate::SimulationResults> results{};
+  std::size_t timeIndex{0};
+  std::optional<pybind11::array> concentrationImage{};
+  std::optional<pybind11::dict> speciesConcentration{};
+  std::optional<pybind11::dict> speciesDcdt{};
+
+public:
+  SimulationResult() = default;
+  SimulationResult(
+      std::shared_ptr<const simulate::SimulationResults> simulationResults,
+      std::size_t index);
   double timePoint{0.0};
-  pybind11::array concentration_image{};
-  pybind11::dict species_concentration{};
-  pybind11::dict species_dcdt{};
+  const pybind11::array &getConcentrationImage();
+  const pybind11::dict &getSpeciesConcentration();
+  const pybind11::dict &getSpeciesDcdt();
   [[nodiscard]] std::string getStr() const;
   [[nodiscard]] std::string getName() const;
 };
@@ -1,4 +1,5 @@
 import unittest
+import concurrent.futures
 import sme
 import os.path
 import numpy as np
@@ -132,6 +133,10 @@ class TestModel(unittest.TestCase):
                 self.assertEqual(len(conc), 100)
                 self.assertEqual(len(conc[0]), 100)
                 self.assertEqual(conc[0][0], 0.0)
+                # species in a compartment are views of the same array
+                conc_a = res.species_concentration["A_cell"]
+                self.assertIs(conc.base, conc_a.base)
+                self.assertFalse(np.shares_memory(conc, conc_a))
 
             # set timeout to 1 second: by default simulation throws on timeout
             # multiple timesteps before timeout:
@@ -181,6 +186,183 @@ class TestModel(unittest.TestCase):
             sim_results2 = m.simulation_results()
             self.assertEqual(len(sim_results2), 3)
 
+    def test_simulate_concurrently(self):
+        models = [sme.open_example_model() for _ in range(4)]
+        expected = models[0].simulate(0.002, 0.001)[-1].species_concentration
+        with concurrent.futures.ThreadPoolExecutor(max_workers=4) as executor:
+            futures = [executor.submit(m.simulate, 0.002, 0.001) for m in models]
+            for future in futures:
+                results = future.result()
+                self.assertEqual(len(results), 3)
+                for name, conc in results[-1].species_concentration.items():
+                    self.assertTrue(np.array_equal(conc, expected[name]))
+
+    def test_simulation_results_generated_when_accessed(self):
+        m = sme.open_example_model()
+        results = m.simulate(0.002, 0.001)
+        img = results[2].concentration_image
+        conc = results[2].species_concentration
+        dcdt = results[2].species_dcdt
+        # generated once, then the same object is returned
+        self.assertIs(results[2].concentration_image, img)
+        self.assertIs(results[2].species_concentration, conc)
+        self.assertIs(results[2].species_dcdt, dcdt)
+        self.assertEqual(len(dcdt), 5)
+        self.assertEqual(len(results[1].species_dcdt), 0)
+        # results remain valid after the model's simulation data is replaced
+        m.simulate(0.001, 0.001)
+        self.assertEqual(len(m.simulation_results()), 2)
+        self.assertEqual(results[1].concentration_image.shape, (100, 100, 3))
+        self.assertEqual(len(results[1].species_concentration), 5)
+        expected = sme.open_example_model().simulate(0.002, 0.001)
+        self.assertTrue(
+            np.array_equal(
+                results[1].species_concentration["B_cell"],
+                expected[1].species_concentration["B_cell"],
+            )
+        )
+
+    def test_simulation_preview_image(self):
+        m = sme.open_example_model()
+        sim_results = m.simulate(0.002, 0.001)
+        # small geometry image: preview is the full image
+        for time_index in range(len(sim_results)):
+            img = m.simulation_preview_image(time_index, 10, 10)
+            self.assertTrue(
+                np.array_equal(img, sim_results[time_index].concentration_image)
+            )
+        with self.assertRaises(sme.InvalidArgument):
+            m.simulation_preview_image(3, 10, 10)
+
+    def test_observables(self):
+        m = sme.open_example_model()
+        self.assertEqual(len(m.observables), 0)
+        self.assertEqual(len(m.observable_values()), 0)
+        errors = m.set_observables(
+            [
+                sme.Observable("total_A", "A_c2", ["c2"]),
+                sme.Observable(
+                    "max_B", "B_c2 + B_c3", [], sme.ObservableReduction.Max
+                ),
+                sme.Observable("invalid", "idontexist + "),
+            ]
+        )
+        self.assertEqual(len(errors), 3)
+        self.assertEqual(errors[0], "")
+        self.assertEqual(errors[1], "")
+        self.assertNotEqual(errors[2], "")
+        self.assertEqual(len(m.observables), 3)
+        self.assertEqual(m.observables[1].name, "max_B")
+        self.assertEqual(m.observables[1].reduction, sme.ObservableReduction.Max)
+        self.assertEqual(m.observables[0].compartments, ["c2"])
+        # observables are evaluated for each timepoint of a new simulation
+        m.simulate(0.02, 0.01)
+        values = m.observable_values()
+        self.assertEqual(list(values.keys()), ["total_A", "max_B", "invalid"])
+        self.assertEqual(values["total_A"].shape, (3,))
+        self.assertTrue(np.all(values["max_B"] >= 0))
+        self.assertTrue(np.all(np.isnan(values["invalid"])))
+        # and are saved with the simulation results
+        m.export_sme_file("tmp_observables.sme")
+        m2 = sme.open_file("tmp_observables.sme")
+        self.assertEqual(len(m2.observables), 3)
+        self.assertEqual(m2.observables[2].expression, "idontexist + ")
+        values2 = m2.observable_values()
+        self.assertTrue(np.array_equal(values2["total_A"], values["total_A"]))
+        self.assertTrue(np.array_equal(values2["max_B"], values["max_B"]))
+
+    def test_probes(self):
+        m = sme.open_example_model()
+        self.assertEqual(len(m.probes), 0)
+        self.assertEqual(m.probe_interval, 0.0)
+        self.assertEqual(len(m.probe_samples().times), 0)
+        m.probes = [
+            sme.Probe("all", "c2", -1e6, -1e6, 2e6, 2e6),
+            sme.Probe("invalid", "idontexist", 0, 0),
+        ]
+        self.assertEqual(len(m.probes), 2)
+        self.assertEqual(m.probes[0].name, "all")
+        self.assertEqual(m.probes[0].compartment, "c2")
+        self.assertEqual(m.probes[1].width, 0.0)
+        # no samples without a positive interval
+        m.simulate(0.02, 0.01)
+        self.assertEqual(len(m.probe_samples().times), 0)
+        m.probe_interval = 0.005
+        m.probe_capacity = 3
+        self.assertEqual(m.probe_capacity, 3)
+        with self.assertRaises(sme.InvalidArgument):
+            m.probe_capacity = 0
+        m.simulate(0.02, 0.01)
+        samples = m.probe_samples()
+        self.assertEqual(samples.names, ["all/A_c2", "all/B_c2"])
+        self.assertEqual(samples.n_overwritten, 2)
+        self.assertTrue(np.allclose(samples.times, [0.01, 0.015, 0.02]))
+        self.assertEqual(samples.values.shape, (3, 2))
+        self.assertTrue(np.all(samples.values >= 0))
+
+    def test_retention(self):
+        m = sme.open_example_model()
+        self.assertEqual(m.retention_keep_last, 0)
+        self.assertEqual(m.retention_keep_every, 0)
+        m.retention_keep_last = 2
+        m.retention_keep_every = 2
+        self.assertEqual(m.retention_keep_last, 2)
+        self.assertEqual(m.retention_keep_every, 2)
+        results = m.simulate(0.05, 0.01)
+        self.assertEqual(len(results), 6)
+        # the last 2 timepoints and every 2nd older timepoint are kept
+        for i, res in enumerate(results):
+            conc = res.species_concentration["A_c2"]
+            self.assertEqual(bool(np.isnan(conc).any()), i in [1, 3])
+        # the retention policy is saved with the model
+        m.export_sme_file("tmp_retention.sme")
+        m2 = sme.open_file("tmp_retention.sme")
+        self.assertEqual(m2.retention_keep_last, 2)
+        self.assertEqual(m2.retention_keep_every, 2)
+        self.assertEqual(len(m2.simulation_results()), 6)
+
+    def test_compression(self):
+        m = sme.open_example_model()
+        self.assertEqual(m.compress_results, False)
+        self.assertEqual(m.compression_max_abs_error, 0.0)
+        ref = m.simulate(0.05, 0.01)
+        m.compress_results = True
+        m.compression_max_abs_error = 1e-6
+        self.assertEqual(m.compress_results, True)
+        self.assertAlmostEqual(m.compression_max_abs_error, 1e-6)
+        with self.assertRaises(sme.InvalidArgument):
+            m.compression_max_abs_error = -1.0
+        results = m.simulate(0.05, 0.01)
+        self.assertEqual(len(results), len(ref))
+        for res, res_ref in zip(results, ref):
+            a = res.species_concentration["A_c2"]
+            b = res_ref.species_concentration["A_c2"]
+            self.assertLessEqual(np.max(np.abs(a - b)), 1.000001e-6)
+        # the compression settings are saved with the model
+        m.export_sme_file("tmp_compression.sme")
+        m2 = sme.open_file("tmp_compression.sme")
+        self.assertEqual(m2.compress_results, True)
+        self.assertAlmostEqual(m2.compression_max_abs_error, 1e-6)
+        self.assertEqual(len(m2.simulation_results()), len(ref))
+
+    def test_store_results_in_file(self):
+        m = sme.open_example_model()
+        self.assertEqual(m.store_results_in_file, False)
+        ref = m.simulate(0.05, 0.01)
+        m.store_results_in_file = True
+        self.assertEqual(m.store_results_in_file, True)
+        results = m.simulate(0.05, 0.01)
+        self.assertEqual(len(results), len(ref))
+        for res, res_ref in zip(results, ref):
+            a = res.species_concentration["A_c2"]
+            b = res_ref.species_concentration["A_c2"]
+            self.assertTrue(np.allclose(a, b))
+        # the setting is saved with the model
+        m.export_sme_file("tmp_store_results_in_file.sme")
+        m2 = sme.open_file("tmp_store_results_in_file.sme")
+        self.assertEqual(m2.store_results_in_file, True)
+        self.assertEqual(len(m2.simulation_results()), len(ref))
+
     def test_import_geometry_from_image(self):
         imgfile_original = _get_abs_path("concave-cell-nucleus-100x100.png")
         imgfile_modified = _get_abs_path("modified-concave-cell-nucleus-100x100.png")
@@ -0,0 +1,58 @@
+import unittest
+import sme
+import numpy as np
+
+
+class TestParameterScan(unittest.TestCase):
+    def test_parameter_scan(self):
+        m = sme.open_example_model("gray-scott")
+        k_original = m.parameters["k"].value
+        f_original = m.parameters["f"].value
+        k_values = [0.05, 0.06]
+        f_values = [0.03, 0.04, 0.05]
+        scan = sme.parameter_scan(
+            m, {"k": k_values, "f": f_values}, 2, 1, n_workers=3
+        )
+        self.assertEqual(repr(scan), "<sme.ParameterScanResult with 2 parameter(s)>")
+        self.assertEqual(
+            str(scan)[0:98],
+            "<sme.ParameterScanResult>\n  - parameters:\n     - k: 2 values\n     - f: 3 values\n  - timepoints: 3\n",
+        )
+        self.assertEqual(list(scan.parameters.keys()), ["k", "f"])
+        self.assertTrue(np.array_equal(scan.parameters["k"], k_values))
+        self.assertTrue(np.array_equal(scan.parameters["f"], f_values))
+        self.assertTrue(np.allclose(scan.time_points, [0, 1, 2]))
+        u = scan.species_concentration["U"]
+        v = scan.species_concentration["V"]
+        self.assertEqual(u.shape, (2, 3, 3, 100, 100))
+        self.assertEqual(v.shape, (2, 3, 3, 100, 100))
+        # the model itself is not modified
+        self.assertEqual(m.parameters["k"].value, k_original)
+        self.assertEqual(m.parameters["f"].value, f_original)
+        # compare with the equivalent individual simulations
+        for i, k in enumerate(k_values):
+            for j, f in enumerate(f_values):
+                m.parameters["k"].value = str(k)
+                m.parameters["f"].value = str(f)
+                results = m.simulate(2, 1)
+                for t, result in enumerate(results):
+                    for name, conc in result.species_concentration.items():
+                        self.assertTrue(
+                            np.allclose(
+                                scan.species_concentration[name][i, j, t],
+                                conc,
+                                rtol=1e-10,
+                                atol=1e-12,
+                            )
+                        )
+        # different parameter values give different results
+        self.assertFalse(np.allclose(v[0, 0, 2], v[1, 2, 2]))
+
+    def test_parameter_scan_invalid(self):
+        m = sme.open_example_model("gray-scott")
+        with self.assertRaises(sme.InvalidArgument):
+            sme.parameter_scan(m, {"idontexist": [1, 2]}, 1, 1)
+        with self.assertRaises(sme.InvalidArgument):
+            sme.parameter_scan(m, {"k": []}, 1, 1)
+        with self.assertRaises(sme.RuntimeError):
+            sme.parameter_scan(m, {"k": [0.05]}, "1;2", "1")
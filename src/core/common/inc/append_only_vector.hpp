@@ -0,0 +1,184 @@
+// AppendOnlyVector
+//  - vector-like container where elements never move once added
+//  - elements are stored in segments of increasing size, so appending
+//    never reallocates or copies existing elements
+//  - the number of elements is published atomically after each append
+//  - a single writer can append while any number of readers concurrently
+//    access elements with index < size() without locks
+//  - pop_back, clear and assignment are not safe with concurrent readers
+//  - serialized in the same format as std::vector
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cereal/cereal.hpp>
+#include <cstddef>
+#include <initializer_list>
+#include <iterator>
+#include <utility>
+
+namespace sme::common {
+
+template <typename T> class AppendOnlyVector {
+private:
+  // segment i contains 2^(i+firstSegmentBits) elements
+  static constexpr std::size_t firstSegmentBits{6};
+  static constexpr std::size_t maxSegments{8 * sizeof(std::size_t) -
+                                           firstSegmentBits};
+  std::array<std::atomic<T *>, maxSegments> segments{};
+  std::atomic<std::size_t> nElements{0};
+
+  static constexpr std::size_t segmentSize(std::size_t segment) {
+    return std::size_t{1} << (segment + firstSegmentBits);
+  }
+  // segment and offset within segment of element
+  static constexpr std::pair<std::size_t, std::size_t>
+  locate(std::size_t index) {
+    std::size_t i{index + segmentSize(0)};
+    std::size_t bit{firstSegmentBits};
+    while ((i >> (bit + 1)) != 0) {
+      ++bit;
+    }
+    return {bit - firstSegmentBits, i - (std::size_t{1} << bit)};
+  }
+  T &element(std::size_t index) const {
+    auto [segment, offset] = locate(index);
+    return segments[segment].load(std::memory_order_relaxed)[offset];
+  }
+  T &allocate(std::size_t index) {
+    auto [segment, offset] = locate(index);
+    T *s{segments[segment].load(std::memory_order_relaxed)};
+    if (s == nullptr) {
+      s = new T[segmentSize(segment)];
+      segments[segment].store(s, std::memory_order_release);
+    }
+    return s[offset];
+  }
+  void deallocate() {
+    for (auto &segment : segments) {
+      delete[] segment.exchange(nullptr);
+    }
+  }
+
+public:
+  using value_type = T;
+  using size_type = std::size_t;
+  using reference = T &;
+  using const_reference = const T &;
+
+  class const_iterator {
+  private:
+    const AppendOnlyVector *v{nullptr};
+    std::size_t i{0};
+
+  public:
+    using iterator_category = std::forward_iterator_tag;
+    using value_type = T;
+    using difference_type = std::ptrdiff_t;
+    using pointer = const T *;
+    using reference = const T &;
+    const_iterator() = default;
+    const_iterator(const AppendOnlyVector *vector, std::size_t index)
+        : v{vector}, i{index} {}
+    reference operator*() const { return (*v)[i]; }
+    pointer operator->() const { return &(*v)[i]; }
+    const_iterator &operator++() {
+      ++i;
+      return *this;
+    }
+    const_iterator operator++(int) {
+      auto old{*this};
+      ++i;
+      return old;
+    }
+    bool operator==(const const_iterator &other) const { return i == other.i; }
+    bool operator!=(const const_iterator &other) const { return i != other.i; }
+  };
+
+  AppendOnlyVector() = default;
+  AppendOnlyVector(std::initializer_list<T> values) { *this = values; }
+  AppendOnlyVector(const AppendOnlyVector &) = delete;
+  AppendOnlyVector &operator=(const AppendOnlyVector &) = delete;
+  AppendOnlyVector(AppendOnlyVector &&other) noexcept {
+    *this = std::move(other);
+  }
+  AppendOnlyVector &operator=(AppendOnlyVector &&other) noexcept {
+    if (this != &other) {
+      deallocate();
+      for (std::size_t i = 0; i < maxSegments; ++i) {
+        segments[i].store(other.segments[i].exchange(nullptr));
+      }
+      nElements.store(other.nElements.exchange(0));
+    }
+    return *this;
+  }
+  AppendOnlyVector &operator=(std::initializer_list<T> values) {
+    clear();
+    for (const auto &value : values) {
+      push_back(value);
+    }
+    return *this;
+  }
+  ~AppendOnlyVector() { deallocate(); }
+
+  [[nodiscard]] std::size_t size() const {
+    return nElements.load(std::memory_order_acquire);
+  }
+  [[nodiscard]] bool empty() const { return size() == 0; }
+  const T &operator[](std::size_t index) const { return element(index); }
+  T &operator[](std::size_t index) { return element(index); }
+  const T &back() const { return element(size() - 1); }
+  T &back() { return element(size() - 1); }
+  [[nodiscard]] const_iterator begin() const { return {this, 0}; }
+  [[nodiscard]] const_iterator end() const { return {this, size()}; }
+  [[nodiscard]] const_iterator cbegin() const { return begin(); }
+  [[nodiscard]] const_iterator cend() const { return end(); }
+
+  // pre-allocate storage for n elements
+  void reserve(std::size_t n) {
+    if (n == 0) {
+      return;
+    }
+    auto lastSegment{locate(n - 1).first};
+    for (std::size_t segment = 0; segment <= lastSegment; ++segment) {
+      allocate(segmentSize(segment) - segmentSize(0));
+    }
+  }
+  template <typename... Args> T &emplace_back(Args &&...args) {
+    std::size_t n{nElements.load(std::memory_order_relaxed)};
+    auto &e{allocate(n)};
+    e = T(std::forward<Args>(args)...);
+    nElements.store(n + 1, std::memory_order_release);
+    return e;
+  }
+  void push_back(const T &value) { emplace_back(value); }
+  void push_back(T &&value) { emplace_back(std::move(value)); }
+  void pop_back() {
+    std::size_t n{nElements.load(std::memory_order_relaxed) - 1};
+    nElements.store(n, std::memory_order_release);
+    element(n) = T{};
+  }
+  void clear() {
+    nElements.store(0, std::memory_order_release);
+    deallocate();
+  }
+
+  template <class Archive> void save(Archive &ar) const {
+    ar(cereal::make_size_tag(static_cast<cereal::size_type>(size())));
+    for (const auto &value : *this) {
+      ar(value);
+    }
+  }
+  template <class Archive> void load(Archive &ar) {
+    clear();
+    cereal::size_type n{0};
+    ar(cereal::make_size_tag(n));
+    reserve(static_cast<std::size_t>(n));
+    for (cereal::size_type i = 0; i < n; ++i) {
+      ar(emplace_back());
+    }
+  }
+};
+
+} // namespace sme::common
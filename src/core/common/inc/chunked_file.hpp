@@ -0,0 +1,86 @@
+// Chunked binary file format
+//  - used by sme files and by streamed simulation results, which each have
+//    their own magic, version and chunk types
+//  - header: magic, format version, reserved
+//  - followed by a sequence of chunks, each of which starts with its type,
+//    reserved, and payload size in bytes, so chunks can be skipped without
+//    reading their payload
+//  - optionally ends with an index chunk followed by a footer: offset of the
+//    index chunk, index magic, so the index can be found from the end of the
+//    file
+//  - chunks can be appended after the footer, followed by a new index chunk
+//    and footer: until the new footer is written, the previous footer is
+//    the last valid footer in the file
+//  - all values are stored in native byte order
+
+#pragma once
+
+#include <QByteArray>
+#include <QIODevice>
+#include <cstdint>
+#include <cstring>
+#include <optional>
+
+namespace sme::common {
+
+constexpr qint64 chunkedFileHeaderBytes{16};
+constexpr qint64 chunkHeaderBytes{16};
+constexpr qint64 chunkedFileFooterBytes{16};
+
+using ChunkedFileMagic = char[8];
+
+struct ChunkHeader {
+  std::uint32_t type{0};
+  std::uint64_t payloadBytes{0};
+};
+
+struct IndexChunk {
+  std::uint64_t offset{0};
+  QByteArray payload{};
+};
+
+template <typename T> void appendValue(QByteArray &bytes, T value) {
+  bytes.append(reinterpret_cast<const char *>(&value), sizeof(T));
+}
+
+template <typename T> T readValue(const char *&ptr) {
+  T value;
+  std::memcpy(&value, ptr, sizeof(T));
+  ptr += sizeof(T);
+  return value;
+}
+
+QByteArray chunkedFileHeader(const ChunkedFileMagic &magic,
+                             std::uint32_t version);
+
+// format version of the file, empty if it does not start with this magic
+std::optional<std::uint32_t>
+readChunkedFileVersion(QIODevice &file, const ChunkedFileMagic &magic);
+
+QByteArray chunkHeader(std::uint32_t type, std::uint64_t payloadBytes);
+
+bool writeChunk(QIODevice &file, std::uint32_t type,
+                const QByteArray &payload);
+
+// empty if there is no complete chunk header at this offset
+std::optional<ChunkHeader> readChunkHeader(QIODevice &file,
+                                           std::uint64_t offset);
+
+// empty if there is no complete chunk of this type at this offset
+std::optional<QByteArray> readChunk(QIODevice &file, std::uint64_t offset,
+                                    std::uint32_t type);
+
+// writes the index chunk at the current position, followed by the footer,
+// which for a file is only written once the index chunk has been flushed
+bool writeIndexChunk(QIODevice &file, std::uint32_t type,
+                     const QByteArray &payload);
+
+// empty if the file does not end with an index chunk of this type and footer
+std::optional<IndexChunk> readIndexChunk(QIODevice &file, std::uint32_t type);
+
+// as above, but if the file does not end with a valid footer, e.g. after an
+// incomplete append, uses the last valid footer in the file
+std::optional<IndexChunk> readLastIndexChunk(QIODevice &file,
+                                             std::uint32_t type);
+
+} // namespace sme::common
@@ -0,0 +1,28 @@
+// parallelFor
+//  - calls func(i) for each i in [0, n)
+//  - uses TBB or OpenMP if available, otherwise a serial loop
+//  - func must be safe to call concurrently for different values of i
+
+#pragma once
+
+#include <cstddef>
+#ifdef SPATIAL_MODEL_EDITOR_WITH_TBB
+#include <tbb/parallel_for.h>
+#endif
+
+namespace sme::common {
+
+template <typename Func> void parallelFor(std::size_t n, Func &&func) {
+#ifdef SPATIAL_MODEL_EDITOR_WITH_TBB
+  tbb::parallel_for(std::size_t{0}, n, func);
+#else
+#ifdef SPATIAL_MODEL_EDITOR_WITH_OPENMP
+#pragma omp parallel for
+#endif
+  for (std::size_t i = 0; i < n; ++i) {
+    func(i);
+  }
+#endif
+}
+
+} // namespace sme::common
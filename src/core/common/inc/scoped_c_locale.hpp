@@ -0,0 +1,22 @@
+// ScopedCLocale
+//  - sets the global locale to the classic "C" locale while in scope
+//  - for libraries that rely on strtod and assume the C locale
+//  - safe to use concurrently from multiple threads: the global locale
+//    remains "C" until the last ScopedCLocale goes out of scope, at which
+//    point the previous global locale is restored
+
+#pragma once
+
+namespace sme::common {
+
+class ScopedCLocale {
+public:
+  ScopedCLocale();
+  ~ScopedCLocale();
+  ScopedCLocale(const ScopedCLocale &) = delete;
+  ScopedCLocale &operator=(const ScopedCLocale &) = delete;
+  ScopedCLocale(ScopedCLocale &&) = delete;
+  ScopedCLocale &operator=(ScopedCLocale &&) = delete;
+};
+
+} // namespace sme::common
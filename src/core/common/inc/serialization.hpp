@@ -12,9 +12,14 @@ struct SmeFileContents {
   std::unique_ptr<simulate::SimulationData> simulationData{};
 };
 
+// timepoint concentrations are read from the file when used
 std::unique_ptr<SmeFileContents> importSmeFile(const std::string &filename);
 bool exportSmeFile(const std::string &filename,
                    const SmeFileContents &contents);
+// add any timepoints of contents that follow those already in the file,
+// without modifying the existing data in the file
+bool appendSmeFile(const std::string &filename,
+                   const SmeFileContents &contents);
 
 std::string toXml(const model::Settings &sbmlAnnotation);
 model::Settings fromXml(const std::string &xml);
@@ -6,7 +6,10 @@
 //  - parses & validates expressions
 //  - returns simplified expressions with constants/functions inlined as string
 //  - returns differential of any expression wrt any variable as string
+//  - checks if an expression depends on a variable (structural non-zero diff)
+//  - constructs linear combinations of already parsed expressions
 //  - compiles expressions using LLVM for fast repeated evaluation
+//  - identical compiled expressions share the same compiled code
 
 #pragma once
 
@@ -47,11 +50,17 @@ public:
   Symbolic &operator=(const Symbolic &) = delete;
   ~Symbolic();
   static const char *getLLVMVersion();
+  static Symbolic
+  linearCombination(const std::vector<Symbolic> &terms,
+                    const std::vector<std::vector<double>> &coefficients,
+                    const std::vector<std::string> &variables = {});
   void compile(bool doCSE = true, unsigned optLevel = 3);
   [[nodiscard]] std::string expr(std::size_t i = 0) const;
   [[nodiscard]] std::string inlinedExpr(std::size_t i = 0) const;
   [[nodiscard]] std::string diff(const std::string &var,
                                  std::size_t i = 0) const;
+  [[nodiscard]] bool dependsOn(const std::string &var,
+                               std::size_t i = 0) const;
   void relabel(const std::vector<std::string> &newVariables);
   void rescale(double factor, const std::vector<std::string> &exclusions = {});
   void eval(std::vector<double> &results,
@@ -0,0 +1,103 @@
+#include "append_only_vector.hpp"
+#include "catch_wrapper.hpp"
+#include <atomic>
+#include <cereal/archives/binary.hpp>
+#include <cereal/types/vector.hpp>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+using namespace sme;
+
+TEST_CASE("AppendOnlyVector", "[core/common/append_only_vector][core/common]"
+                              "[core][append_only_vector]") {
+  SECTION("vector-like interface") {
+    common::AppendOnlyVector<double> v;
+    REQUIRE(v.empty());
+    REQUIRE(v.size() == 0);
+    v.push_back(1.0);
+    v.emplace_back(2.0);
+    REQUIRE(v.size() == 2);
+    REQUIRE(v[0] == dbl_approx(1.0));
+    REQUIRE(v.back() == dbl_approx(2.0));
+    v.pop_back();
+    REQUIRE(v.size() == 1);
+    REQUIRE(v.back() == dbl_approx(1.0));
+    v = {3.0, 4.0, 5.0};
+    REQUIRE(v.size() == 3);
+    REQUIRE(v[2] == dbl_approx(5.0));
+    double sum{0};
+    for (auto x : v) {
+      sum += x;
+    }
+    REQUIRE(sum == dbl_approx(12.0));
+    v.clear();
+    REQUIRE(v.empty());
+    common::AppendOnlyVector<std::vector<int>> w{{1, 2}, {3}};
+    REQUIRE(w.size() == 2);
+    REQUIRE(w[0][1] == 2);
+    auto moved{std::move(w)};
+    REQUIRE(moved.size() == 2);
+    REQUIRE(moved[1][0] == 3);
+  }
+  SECTION("elements never move") {
+    common::AppendOnlyVector<std::size_t> v;
+    v.push_back(0);
+    const auto *first{&v[0]};
+    std::vector<const std::size_t *> addresses;
+    for (std::size_t i = 0; i < 10000; ++i) {
+      addresses.push_back(&v.emplace_back(i));
+    }
+    REQUIRE(&v[0] == first);
+    for (std::size_t i = 0; i < 10000; ++i) {
+      REQUIRE(&v[i + 1] == addresses[i]);
+      REQUIRE(v[i + 1] == i);
+    }
+    v.reserve(100000);
+    REQUIRE(v.size() == 10001);
+    REQUIRE(&v[0] == first);
+  }
+  SECTION("concurrent reads while appending") {
+    common::AppendOnlyVector<std::vector<std::size_t>> v;
+    constexpr std::size_t n{20000};
+    std::atomic<bool> valid{true};
+    std::thread reader([&v, &valid]() {
+      std::size_t nRead{0};
+      while (nRead < n) {
+        nRead = v.size();
+        if (nRead > 0) {
+          const auto &e{v[nRead - 1]};
+          if (e.size() != 2 || e[0] != nRead - 1 || e[1] != 2 * (nRead - 1)) {
+            valid = false;
+          }
+        }
+      }
+    });
+    for (std::size_t i = 0; i < n; ++i) {
+      v.push_back({i, 2 * i});
+    }
+    reader.join();
+    REQUIRE(valid);
+  }
+  SECTION("serialization compatible with std::vector") {
+    std::vector<double> a{1.0, -2.0, 3.5};
+    std::stringstream ss;
+    {
+      cereal::BinaryOutputArchive ar(ss);
+      ar(a);
+    }
+    common::AppendOnlyVector<double> b;
+    {
+      cereal::BinaryInputArchive ar(ss);
+      ar(b);
+    }
+    REQUIRE(b.size() == 3);
+    REQUIRE(b[1] == dbl_approx(-2.0));
+    std::stringstream ss2;
+    {
+      cereal::BinaryOutputArchive ar(ss2);
+      ar(b);
+    }
+    REQUIRE(ss2.str() == ss.str());
+  }
+}
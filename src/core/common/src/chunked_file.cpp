@@ -0,0 +1,162 @@
+#include "chunked_file.hpp"
+#include <QFileDevice>
+#include <algorithm>
+#include <utility>
+
+namespace sme::common {
+
+constexpr ChunkedFileMagic footerMagic{'S', 'M', 'E', 'I', 'N', 'D', 'E', 'X'};
+
+QByteArray chunkedFileHeader(const ChunkedFileMagic &magic,
+                             std::uint32_t version) {
+  QByteArray bytes(magic, sizeof(magic));
+  appendValue(bytes, version);
+  appendValue(bytes, std::uint32_t{0});
+  return bytes;
+}
+
+std::optional<std::uint32_t>
+readChunkedFileVersion(QIODevice &file, const ChunkedFileMagic &magic) {
+  if (!file.seek(0)) {
+    return {};
+  }
+  auto header{file.read(chunkedFileHeaderBytes)};
+  if (header.size() != chunkedFileHeaderBytes ||
+      std::memcmp(header.constData(), magic, sizeof(magic)) != 0) {
+    return {};
+  }
+  const char *ptr{header.constData() + sizeof(magic)};
+  return readValue<std::uint32_t>(ptr);
+}
+
+QByteArray chunkHeader(std::uint32_t type, std::uint64_t payloadBytes) {
+  QByteArray bytes;
+  appendValue(bytes, type);
+  appendValue(bytes, std::uint32_t{0});
+  appendValue(bytes, payloadBytes);
+  return bytes;
+}
+
+bool writeChunk(QIODevice &file, std::uint32_t type,
+                const QByteArray &payload) {
+  auto header{chunkHeader(type, static_cast<std::uint64_t>(payload.size()))};
+  return file.write(header) == header.size() &&
+         file.write(payload) == payload.size();
+}
+
+std::optional<ChunkHeader> readChunkHeader(QIODevice &file,
+                                           std::uint64_t offset) {
+  if (!file.seek(static_cast<qint64>(offset))) {
+    return {};
+  }
+  auto bytes{file.read(chunkHeaderBytes)};
+  if (bytes.size() != chunkHeaderBytes) {
+    return {};
+  }
+  const char *ptr{bytes.constData()};
+  ChunkHeader header;
+  header.type = readValue<std::uint32_t>(ptr);
+  ptr += sizeof(std::uint32_t);
+  header.payloadBytes = readValue<std::uint64_t>(ptr);
+  return header;
+}
+
+std::optional<QByteArray> readChunk(QIODevice &file, std::uint64_t offset,
+                                    std::uint32_t type) {
+  auto header{readChunkHeader(file, offset)};
+  if (!header.has_value() || header->type != type ||
+      offset + chunkHeaderBytes + header->payloadBytes >
+          static_cast<std::uint64_t>(file.size())) {
+    return {};
+  }
+  auto payload{file.read(static_cast<qint64>(header->payloadBytes))};
+  if (static_cast<std::uint64_t>(payload.size()) != header->payloadBytes) {
+    return {};
+  }
+  return payload;
+}
+
+bool writeIndexChunk(QIODevice &file, std::uint32_t type,
+                     const QByteArray &payload) {
+  auto offset{static_cast<std::uint64_t>(file.pos())};
+  if (!writeChunk(file, type, payload)) {
+    return false;
+  }
+  // the footer is only written once the index chunk has been written
+  if (auto *fileDevice{qobject_cast<QFileDevice *>(&file)};
+      fileDevice != nullptr && !fileDevice->flush()) {
+    return false;
+  }
+  QByteArray footer;
+  appendValue(footer, offset);
+  footer.append(footerMagic, sizeof(footerMagic));
+  return file.write(footer) == footer.size();
+}
+
+// index chunk with a footer that ends at footerEnd
+static std::optional<IndexChunk>
+readIndexChunkAt(QIODevice &file, std::uint32_t type, qint64 footerEnd) {
+  if (footerEnd < chunkedFileHeaderBytes + chunkHeaderBytes +
+                      chunkedFileFooterBytes ||
+      !file.seek(footerEnd - chunkedFileFooterBytes)) {
+    return {};
+  }
+  auto footer{file.read(chunkedFileFooterBytes)};
+  if (footer.size() != chunkedFileFooterBytes ||
+      std::memcmp(footer.constData() + sizeof(std::uint64_t), footerMagic,
+                  sizeof(footerMagic)) != 0) {
+    return {};
+  }
+  const char *ptr{footer.constData()};
+  IndexChunk index;
+  index.offset = readValue<std::uint64_t>(ptr);
+  auto payload{readChunk(file, index.offset, type)};
+  // the index chunk must be immediately followed by the footer
+  if (!payload.has_value() ||
+      index.offset + chunkHeaderBytes +
+              static_cast<std::uint64_t>(payload->size()) +
+              chunkedFileFooterBytes !=
+          static_cast<std::uint64_t>(footerEnd)) {
+    return {};
+  }
+  index.payload = std::move(payload.value());
+  return index;
+}
+
+std::optional<IndexChunk> readIndexChunk(QIODevice &file, std::uint32_t type) {
+  return readIndexChunkAt(file, type, file.size());
+}
+
+std::optional<IndexChunk> readLastIndexChunk(QIODevice &file,
+                                             std::uint32_t type) {
+  if (auto index{readIndexChunk(file, type)}; index.has_value()) {
+    return index;
+  }
+  // search backwards for the magic of an earlier footer, one block at a time,
+  // with blocks overlapping so that a magic is not split between two blocks
+  constexpr qint64 blockBytes{1 << 20};
+  constexpr auto magicBytes{static_cast<qint64>(sizeof(footerMagic))};
+  const QByteArray magic(footerMagic, sizeof(footerMagic));
+  auto end{file.size()};
+  while (end >= chunkedFileHeaderBytes + magicBytes) {
+    auto begin{std::max(end - blockBytes, chunkedFileHeaderBytes)};
+    if (!file.seek(begin)) {
+      return {};
+    }
+    auto block{file.read(end - begin)};
+    for (auto i{block.lastIndexOf(magic)}; i >= 0;
+         i = i > 0 ? block.lastIndexOf(magic, i - 1) : -1) {
+      if (auto index{readIndexChunkAt(file, type, begin + i + magicBytes)};
+          index.has_value()) {
+        return index;
+      }
+    }
+    if (begin == chunkedFileHeaderBytes) {
+      break;
+    }
+    end = begin + magicBytes - 1;
+  }
+  return {};
+}
+
+} // namespace sme::common
@@ -0,0 +1,88 @@
+#include "catch_wrapper.hpp"
+#include "chunked_file.hpp"
+#include <QBuffer>
+
+using namespace sme;
+
+TEST_CASE("Chunked file",
+          "[core/common/chunked_file][core/common][core][chunked_file]") {
+  constexpr common::ChunkedFileMagic magic{'T', 'E', 'S', 'T',
+                                           'F', 'I', 'L', 'E'};
+  constexpr common::ChunkedFileMagic otherMagic{'O', 'T', 'H', 'E',
+                                                'R', 'F', 'I', 'L'};
+  QByteArray bytes;
+  QBuffer file(&bytes);
+  REQUIRE(file.open(QIODevice::ReadWrite));
+  auto header{common::chunkedFileHeader(magic, 3)};
+  REQUIRE(header.size() == common::chunkedFileHeaderBytes);
+  REQUIRE(file.write(header) == header.size());
+  REQUIRE(common::writeChunk(file, 1, QByteArray("first")));
+  auto secondOffset{static_cast<std::uint64_t>(file.pos())};
+  REQUIRE(common::writeChunk(file, 2, QByteArray("second chunk")));
+  SECTION("header") {
+    REQUIRE(common::readChunkedFileVersion(file, magic) == 3);
+    REQUIRE(common::readChunkedFileVersion(file, otherMagic).has_value() ==
+            false);
+  }
+  SECTION("chunks") {
+    auto chunkHeader{common::readChunkHeader(file, secondOffset)};
+    REQUIRE(chunkHeader.has_value());
+    REQUIRE(chunkHeader->type == 2);
+    REQUIRE(chunkHeader->payloadBytes == 12);
+    REQUIRE(common::readChunk(file, common::chunkedFileHeaderBytes, 1) ==
+            QByteArray("first"));
+    REQUIRE(common::readChunk(file, secondOffset, 2) ==
+            QByteArray("second chunk"));
+    // wrong type
+    REQUIRE(common::readChunk(file, secondOffset, 1).has_value() == false);
+    // incomplete chunk
+    bytes.chop(1);
+    REQUIRE(common::readChunk(file, secondOffset, 2).has_value() == false);
+    auto end{static_cast<std::uint64_t>(bytes.size())};
+    REQUIRE(common::readChunkHeader(file, end).has_value() == false);
+  }
+  SECTION("index and footer") {
+    REQUIRE(common::readIndexChunk(file, 3).has_value() == false);
+    auto indexOffset{static_cast<std::uint64_t>(bytes.size())};
+    REQUIRE(file.seek(bytes.size()));
+    REQUIRE(common::writeIndexChunk(file, 3, QByteArray("index")));
+    REQUIRE(static_cast<qint64>(bytes.size()) ==
+            static_cast<qint64>(indexOffset) + common::chunkHeaderBytes + 5 +
+                common::chunkedFileFooterBytes);
+    auto index{common::readIndexChunk(file, 3)};
+    REQUIRE(index.has_value());
+    REQUIRE(index->offset == indexOffset);
+    REQUIRE(index->payload == QByteArray("index"));
+    REQUIRE(common::readIndexChunk(file, 2).has_value() == false);
+    // the footer must immediately follow the index chunk
+    bytes.insert(
+        static_cast<int>(bytes.size() - common::chunkedFileFooterBytes), 'x');
+    REQUIRE(common::readIndexChunk(file, 3).has_value() == false);
+  }
+  SECTION("appending after the footer") {
+    REQUIRE(file.seek(bytes.size()));
+    REQUIRE(common::writeIndexChunk(file, 3, QByteArray("index")));
+    auto firstIndexOffset{static_cast<std::uint64_t>(
+        bytes.size() - common::chunkedFileFooterBytes - 5 -
+        common::chunkHeaderBytes)};
+    // incomplete append: a chunk and part of a new index chunk
+    REQUIRE(common::writeChunk(file, 1, QByteArray("third")));
+    auto secondIndexOffset{static_cast<std::uint64_t>(bytes.size())};
+    REQUIRE(common::writeChunk(file, 3, QByteArray("new index")));
+    bytes.chop(2);
+    REQUIRE(common::readIndexChunk(file, 3).has_value() == false);
+    auto index{common::readLastIndexChunk(file, 3)};
+    REQUIRE(index.has_value());
+    REQUIRE(index->offset == firstIndexOffset);
+    REQUIRE(index->payload == QByteArray("index"));
+    // complete append: the new footer is used
+    REQUIRE(file.seek(bytes.size()));
+    REQUIRE(common::writeIndexChunk(file, 3, QByteArray("new index")));
+    index = common::readLastIndexChunk(file, 3);
+    REQUIRE(index.has_value());
+    REQUIRE(index->offset > secondIndexOffset);
+    REQUIRE(index->payload == QByteArray("new index"));
+    // no valid footer
+    REQUIRE(common::readLastIndexChunk(file, 2).has_value() == false);
+  }
+}
@@ -0,0 +1,23 @@
+#include "catch_wrapper.hpp"
+#include "parallel_for.hpp"
+#include <numeric>
+#include <vector>
+
+using namespace sme;
+
+TEST_CASE("parallelFor",
+          "[core/common/parallel_for][core/common][core][parallel_for]") {
+  SECTION("no items") {
+    std::size_t calls{0};
+    common::parallelFor(0, [&calls](std::size_t) { ++calls; });
+    REQUIRE(calls == 0);
+  }
+  SECTION("each item is visited once") {
+    std::vector<int> v(1000, 0);
+    common::parallelFor(v.size(), [&v](std::size_t i) { v[i] += 1; });
+    REQUIRE(std::accumulate(v.cbegin(), v.cend(), 0) == 1000);
+    for (auto x : v) {
+      REQUIRE(x == 1);
+    }
+  }
+}
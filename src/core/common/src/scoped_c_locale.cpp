@@ -0,0 +1,38 @@
+#include "scoped_c_locale.hpp"
+#include <cstddef>
+#include <locale>
+#include <mutex>
+
+namespace sme::common {
+
+// state shared by all ScopedCLocale instances
+struct ScopedCLocaleState {
+  std::mutex mutex{};
+  std::size_t count{0};
+  std::locale userLocale{};
+};
+
+static ScopedCLocaleState &getState() {
+  static ScopedCLocaleState state;
+  return state;
+}
+
+ScopedCLocale::ScopedCLocale() {
+  auto &state{getState()};
+  std::scoped_lock lock{state.mutex};
+  if (state.count == 0) {
+    state.userLocale = std::locale::global(std::locale::classic());
+  }
+  ++state.count;
+}
+
+ScopedCLocale::~ScopedCLocale() {
+  auto &state{getState()};
+  std::scoped_lock lock{state.mutex};
+  --state.count;
+  if (state.count == 0) {
+    std::locale::global(state.userLocale);
+  }
+}
+
+} // namespace sme::common
@@ -0,0 +1,57 @@
+#include "catch_wrapper.hpp"
+#include "scoped_c_locale.hpp"
+#include <locale>
+#include <thread>
+#include <vector>
+
+using namespace sme;
+
+TEST_CASE("ScopedCLocale", "[core/common/scoped_c_locale][core/common]"
+                           "[core][scoped_c_locale]") {
+  // use an unnamed custom locale as the user locale
+  std::locale userLocale(std::locale::classic(), new std::numpunct<char>());
+  auto originalLocale{std::locale::global(userLocale)};
+  SECTION("single scope") {
+    {
+      common::ScopedCLocale cLocale;
+      REQUIRE(std::locale() == std::locale::classic());
+    }
+    REQUIRE(std::locale() == userLocale);
+  }
+  SECTION("nested scopes") {
+    {
+      common::ScopedCLocale cLocale;
+      {
+        common::ScopedCLocale cLocaleInner;
+        REQUIRE(std::locale() == std::locale::classic());
+      }
+      // still in outer scope
+      REQUIRE(std::locale() == std::locale::classic());
+    }
+    REQUIRE(std::locale() == userLocale);
+  }
+  SECTION("concurrent scopes in multiple threads") {
+    constexpr std::size_t nThreads{8};
+    constexpr std::size_t nRepeats{1000};
+    std::vector<std::thread> threads;
+    std::vector<int> nonClassic(nThreads, 0);
+    for (std::size_t i = 0; i < nThreads; ++i) {
+      threads.emplace_back([&nonClassic, i]() {
+        for (std::size_t j = 0; j < nRepeats; ++j) {
+          common::ScopedCLocale cLocale;
+          if (!(std::locale() == std::locale::classic())) {
+            ++nonClassic[i];
+          }
+        }
+      });
+    }
+    for (auto &thread : threads) {
+      thread.join();
+    }
+    for (auto n : nonClassic) {
+      REQUIRE(n == 0);
+    }
+    REQUIRE(std::locale() == userLocale);
+  }
+  std::locale::global(originalLocale);
+}
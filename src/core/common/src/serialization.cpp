@@ -1,14 +1,23 @@
 #include "serialization.hpp"
+#include "chunked_file.hpp"
 #include "logger.hpp"
+#include "scoped_c_locale.hpp"
 #include "model_settings.hpp"
 #include "simulate_data.hpp"
 #include "simulate_options.hpp"
 #include "xml_annotation.hpp"
+#include <QByteArray>
+#include <QFile>
+#include <QSaveFile>
+#include <algorithm>
 #include <cereal/archives/binary.hpp>
 #include <cereal/archives/xml.hpp>
 #include <cereal/cereal.hpp>
 #include <cereal/types/memory.hpp>
+#include <cereal/types/string.hpp>
+#include <cereal/types/vector.hpp>
 #include <fstream>
+#include <optional>
 #include <sbml/SBMLTransforms.h>
 #include <sbml/SBMLTypes.h>
 #include <sbml/extension/SBMLDocumentPlugin.h>
@@ -64,7 +73,275 @@ void load(Archive &ar, sme::common::SmeFileContents &contents,
   }
 }
 
+// Sme container: a chunked file, see chunked_file.hpp
+//  - model chunk: sbml model, concentration compression settings and, since
+//    version 2, the definitions of any observables
+//  - one chunk per timepoint: the encoded concentrations of each compartment,
+//    which are not delta encoded, so each timepoint can be loaded on its own
+//  - index chunk: offset of the model chunk, and for each timepoint its time,
+//    summary statistics and the location of its concentrations, followed
+//    since version 2 by the observable values of each timepoint
+//  - timepoints are appended after the footer, followed by a new index and
+//    footer: existing data is never modified, so if appending fails the
+//    previous index is still used
+constexpr ChunkedFileMagic containerMagic{'S', 'M', 'E', 'C',
+                                          'H', 'U', 'N', 'K'};
+constexpr std::uint32_t containerVersion{2};
+constexpr std::uint32_t chunkModel{1};
+constexpr std::uint32_t chunkTimepoint{2};
+constexpr std::uint32_t chunkIndex{3};
+
+namespace {
+
+struct ContainerModel {
+  std::string xmlModel{};
+  std::string simulationXmlModel{};
+  simulate::ConcentrationCompression compression{};
+  std::vector<simulate::Observable> observableDefinitions{};
+  // container version, not serialized
+  std::uint32_t version{containerVersion};
+
+  template <class Archive> void serialize(Archive &ar) {
+    ar(xmlModel, simulationXmlModel, compression);
+    if (version >= 2) {
+      ar(observableDefinitions);
+    }
+  }
+};
+
+struct ContainerTimepoint {
+  double time{0.0};
+  std::vector<std::vector<simulate::AvgMinMax>> avgMinMax{};
+  std::vector<std::vector<double>> concentrationMax{};
+  std::uint64_t concPadding{0};
+  // offset of timepoint chunk, size of each compartment's concentrations
+  std::uint64_t offset{0};
+  std::vector<std::uint64_t> nBytes{};
+
+  template <class Archive> void serialize(Archive &ar) {
+    ar(time, avgMinMax, concentrationMax, concPadding, offset, nBytes);
+  }
+};
+
+struct ContainerIndex {
+  std::uint64_t modelOffset{0};
+  std::vector<ContainerTimepoint> timepoints{};
+  // time->observable, empty if there are no observables
+  std::vector<std::vector<double>> observables{};
+  // offset of the index chunk itself, not serialized
+  std::uint64_t offset{0};
+  // container version, not serialized
+  std::uint32_t version{containerVersion};
+
+  template <class Archive> void serialize(Archive &ar) {
+    ar(modelOffset, timepoints);
+    if (version >= 2) {
+      ar(observables);
+    }
+  }
+};
+
+} // namespace
+
+template <typename T> static QByteArray toBytes(const T &value) {
+  std::ostringstream ss;
+  {
+    cereal::BinaryOutputArchive ar(ss);
+    ar(value);
+  }
+  auto str{ss.str()};
+  return {str.data(), static_cast<int>(str.size())};
+}
+
+// throws if the bytes are not a valid serialized T,
+// value is used to initialise any non-serialized members
+template <typename T>
+static T fromBytes(const QByteArray &bytes, T value = {}) {
+  std::istringstream ss(bytes.toStdString());
+  cereal::BinaryInputArchive ar(ss);
+  ar(value);
+  return value;
+}
+
+// container version of file, empty if it is not a supported container
+static std::optional<std::uint32_t> readContainerVersion(QFile &file) {
+  auto version{readChunkedFileVersion(file, containerMagic)};
+  if (!version.has_value()) {
+    return {};
+  }
+  if (version.value() > containerVersion) {
+    SPDLOG_WARN("Unsupported sme container version {}", version.value());
+    return {};
+  }
+  return version;
+}
+
+static std::optional<ContainerIndex> readIndex(QFile &file,
+                                               std::uint32_t version) {
+  auto indexChunk{readLastIndexChunk(file, chunkIndex)};
+  if (!indexChunk.has_value()) {
+    return {};
+  }
+  auto offset{indexChunk->offset};
+  ContainerIndex index;
+  index.version = version;
+  try {
+    index = fromBytes(indexChunk->payload, std::move(index));
+  } catch (const std::exception &e) {
+    SPDLOG_WARN("Invalid sme container index: {}", e.what());
+    return {};
+  }
+  index.offset = offset;
+  // all timepoint chunks must precede the index
+  for (const auto &timepoint : index.timepoints) {
+    auto end{timepoint.offset + chunkHeaderBytes};
+    for (auto n : timepoint.nBytes) {
+      end += n;
+    }
+    if (end > offset) {
+      return {};
+    }
+  }
+  return index;
+}
+
+static QByteArray modelPayload(const SmeFileContents &contents) {
+  ContainerModel model{contents.xmlModel};
+  if (const auto *data{contents.simulationData.get()}; data != nullptr) {
+    model.simulationXmlModel = data->xmlModel;
+    model.compression = data->concentration.getCompression();
+    model.observableDefinitions = data->observableDefinitions;
+  }
+  return toBytes(model);
+}
+
+// write timepoints starting from timeIndex first, adding them to the index
+static bool writeTimepoints(QFileDevice &file, const SmeFileContents &contents,
+                            std::size_t first, ContainerIndex &index) {
+  const auto *data{contents.simulationData.get()};
+  if (data == nullptr) {
+    return true;
+  }
+  // timepoints may still be being added by a running simulation
+  auto n{std::min({data->timePoints.size(), data->concentration.size(),
+                   data->avgMinMax.size(), data->concentrationMax.size(),
+                   data->concPadding.size()})};
+  // observables are only saved if available for every timepoint
+  bool withObservables{!data->observableDefinitions.empty() &&
+                       data->observables.size() >= n &&
+                       index.observables.size() == first};
+  if (!withObservables) {
+    index.observables.clear();
+  }
+  for (std::size_t i = first; i < n; ++i) {
+    if (withObservables) {
+      index.observables.push_back(data->observables[i]);
+    }
+    auto &timepoint{index.timepoints.emplace_back()};
+    timepoint.time = data->timePoints[i];
+    timepoint.avgMinMax = data->avgMinMax[i];
+    timepoint.concentrationMax = data->concentrationMax[i];
+    timepoint.concPadding = data->concPadding[i];
+    timepoint.offset = static_cast<std::uint64_t>(file.pos());
+    QByteArray payload;
+    for (const auto &blob :
+         data->concentration.getCompressedTimepoint(i, true)) {
+      timepoint.nBytes.push_back(blob.size());
+      payload.append(blob.data(), static_cast<int>(blob.size()));
+    }
+    if (!writeChunk(file, chunkTimepoint, payload)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+static bool writeIndex(QFileDevice &file, const ContainerIndex &index) {
+  return writeIndexChunk(file, chunkIndex, toBytes(index));
+}
+
+// location of the encoded concentrations of a timepoint
+static simulate::ConcentrationFileLocation
+fileLocation(const ContainerTimepoint &timepoint) {
+  simulate::ConcentrationFileLocation location;
+  location.offset = static_cast<qint64>(timepoint.offset) + chunkHeaderBytes;
+  for (auto nBytes : timepoint.nBytes) {
+    location.nBytes.push_back(static_cast<qint64>(nBytes));
+  }
+  return location;
+}
+
+static std::unique_ptr<SmeFileContents> importContainer(QFile &file,
+                                                        std::uint32_t version) {
+  auto filename{file.fileName().toStdString()};
+  auto index{readIndex(file, version)};
+  if (!index.has_value()) {
+    SPDLOG_WARN("Failed to import file '{}'. Invalid index", filename);
+    return {};
+  }
+  auto payload{readChunk(file, index->modelOffset, chunkModel)};
+  if (!payload.has_value()) {
+    SPDLOG_WARN("Failed to import file '{}'. Invalid model", filename);
+    return {};
+  }
+  ContainerModel model;
+  model.version = version;
+  try {
+    model = fromBytes(payload.value(), std::move(model));
+  } catch (const std::exception &e) {
+    SPDLOG_WARN("Failed to import file '{}'. {}", filename, e.what());
+    return {};
+  }
+  if (model.xmlModel.empty()) {
+    SPDLOG_WARN("Failed to import file '{}'. Imported Model is empty",
+                filename);
+    return {};
+  }
+  auto contents{std::make_unique<SmeFileContents>()};
+  contents->xmlModel = std::move(model.xmlModel);
+  contents->simulationData = std::make_unique<simulate::SimulationData>();
+  auto &data{*contents->simulationData};
+  data.xmlModel = std::move(model.simulationXmlModel);
+  data.observableDefinitions = std::move(model.observableDefinitions);
+  // only the summary statistics are loaded, concentrations are loaded from
+  // the file when they are used
+  auto n{index->timepoints.size()};
+  data.timePoints.reserve(n);
+  data.avgMinMax.reserve(n);
+  data.concentrationMax.reserve(n);
+  data.concPadding.reserve(n);
+  std::vector<simulate::ConcentrationFileLocation> locations;
+  locations.reserve(n);
+  for (auto &timepoint : index->timepoints) {
+    data.timePoints.push_back(timepoint.time);
+    data.avgMinMax.push_back(std::move(timepoint.avgMinMax));
+    data.concentrationMax.push_back(std::move(timepoint.concentrationMax));
+    data.concPadding.push_back(timepoint.concPadding);
+    locations.push_back(fileLocation(timepoint));
+  }
+  if (index->observables.size() == n) {
+    data.observables.reserve(n);
+    for (auto &values : index->observables) {
+      data.observables.push_back(std::move(values));
+    }
+  }
+  if (model.compression.enabled) {
+    data.concentration.useCompression(model.compression);
+  }
+  if (!data.concentration.useExistingFile(file.fileName(), locations)) {
+    return {};
+  }
+  return contents;
+}
+
 std::unique_ptr<SmeFileContents> importSmeFile(const std::string &filename) {
+  if (QFile file(QString::fromStdString(filename));
+      file.open(QIODevice::ReadOnly)) {
+    if (auto version{readContainerVersion(file)}; version.has_value()) {
+      return importContainer(file, version.value());
+    }
+  }
+  // older sme files are a single cereal archive
   auto contents{std::make_unique<SmeFileContents>()};
   std::ifstream fs(filename, std::ios::binary);
   if (!fs) {
@@ -95,18 +372,101 @@ std::unique_ptr<SmeFileContents> importSmeFile(const std::string &filename) {
 
 bool exportSmeFile(const std::string &filename,
                    const SmeFileContents &contents) {
-  std::ofstream fs(filename, std::ios::binary);
-  if (!fs) {
+  // written to a temporary file which then replaces any existing file, which
+  // may be the file that timepoints in contents are being read from: that
+  // file must first be closed, as an open file cannot be replaced on Windows
+  QSaveFile file(QString::fromStdString(filename));
+  if (auto *data{contents.simulationData.get()}; data != nullptr) {
+    data->concentration.releaseExistingFile(file.fileName());
+  }
+  if (!file.open(QIODevice::WriteOnly)) {
+    return false;
+  }
+  auto header{chunkedFileHeader(containerMagic, containerVersion)};
+  ContainerIndex index;
+  bool success{file.write(header) == header.size()};
+  index.modelOffset = static_cast<std::uint64_t>(file.pos());
+  success = success && writeChunk(file, chunkModel, modelPayload(contents)) &&
+            writeTimepoints(file, contents, 0, index) &&
+            writeIndex(file, index);
+  if (!success) {
+    file.cancelWriting();
+    return false;
+  }
+  return file.commit();
+}
+
+bool appendSmeFile(const std::string &filename,
+                   const SmeFileContents &contents) {
+  QFile file(QString::fromStdString(filename));
+  if (!file.open(QIODevice::ReadWrite) ||
+      readContainerVersion(file) != containerVersion) {
+    // older containers are replaced using exportSmeFile
+    SPDLOG_WARN("Failed to open sme file '{}' for appending", filename);
+    return false;
+  }
+  auto index{readIndex(file, containerVersion)};
+  if (!index.has_value()) {
+    SPDLOG_WARN("Failed to append to file '{}'. Invalid index", filename);
+    return false;
+  }
+  // existing timepoints must be the first timepoints of contents
+  const auto &timepoints{index->timepoints};
+  const auto *data{contents.simulationData.get()};
+  if (!timepoints.empty() &&
+      (data == nullptr || timepoints.size() > data->timePoints.size() ||
+       !std::equal(timepoints.cbegin(), timepoints.cend(),
+                   data->timePoints.cbegin(),
+                   [](const auto &timepoint, double time) {
+                     return timepoint.time == time;
+                   }))) {
+    SPDLOG_WARN("Failed to append to file '{}'. File contains different "
+                "timepoints",
+                filename);
     return false;
   }
-  cereal::BinaryOutputArchive ar{fs};
-  ar(contents);
+  // timepoints read from this file must not have been modified since
+  bool isReadingFrom{data != nullptr &&
+                     data->concentration.isReadingFrom(file.fileName())};
+  if (isReadingFrom &&
+      data->concentration.getNumUnchangedFileTimepoints() < timepoints.size()) {
+    SPDLOG_WARN("Failed to append to file '{}'. Timepoints in the file have "
+                "been modified",
+                filename);
+    return false;
+  }
+  auto first{timepoints.size()};
+  auto model{modelPayload(contents)};
+  bool modelChanged{readChunk(file, index->modelOffset, chunkModel) != model};
+  auto size{file.size()};
+  bool success{file.seek(size)};
+  if (success && modelChanged) {
+    index->modelOffset = static_cast<std::uint64_t>(size);
+    success = writeChunk(file, chunkModel, model);
+  }
+  success = success && writeTimepoints(file, contents, first, *index) &&
+            writeIndex(file, *index) && file.flush();
+  if (!success) {
+    SPDLOG_WARN("Failed to append to file '{}'", filename);
+    // remove any incomplete data after the previous footer
+    file.resize(size);
+    return false;
+  }
+  if (isReadingFrom) {
+    // the new timepoints can now also be read from the file
+    std::vector<simulate::ConcentrationFileLocation> locations;
+    for (std::size_t i = first; i < index->timepoints.size(); ++i) {
+      locations.push_back(fileLocation(index->timepoints[i]));
+    }
+    contents.simulationData->concentration.useExistingFileLocations(
+        first, locations);
+  }
   return true;
 }
 
 std::string toXml(const model::Settings &sbmlAnnotation) {
   std::string s;
-  std::locale userLocale = std::locale::global(std::locale::classic());
+  ScopedCLocale cLocale;
   std::stringstream ss;
   try {
     cereal::XMLOutputArchive ar(ss);
@@ -124,7 +484,6 @@ std::string toXml(const model::Settings &sbmlAnnotation) {
   for (std::size_t i = 2; i + 2 < lines.size(); ++i) {
     s.append(lines[i]).append("\n");
   }
-  std::locale::global(userLocale);
   return s;
 }
 
@@ -133,7 +492,7 @@ model::Settings fromXml(const std::string &xml) {
   // hack until
   // https://github.com/spatial-model-editor/spatial-model-editor/issues/535 is
   // resolved: (cereal relies on strtod to read doubles and assumes C locale)
-  std::locale userLocale = std::locale::global(std::locale::classic());
+  ScopedCLocale cLocale;
   // re-insert header & footer
   // todo: do this in a less fragile way
   std::string fullXml{R"(<?xml version="1.0" encoding="utf-8"?><cereal>)"};
@@ -148,7 +507,6 @@ model::Settings fromXml(const std::string &xml) {
                 e.what());
     return {};
   }
-  std::locale::global(userLocale);
   return sbmlAnnotation;
 }
 
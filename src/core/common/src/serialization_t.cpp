@@ -51,12 +51,13 @@ TEST_CASE("Serialization",
     REQUIRE(contents->simulationData->timePoints[1] == dbl_approx(0.5));
     REQUIRE(contents->simulationData->timePoints[2] == dbl_approx(1.0));
     REQUIRE(contents->simulationData->concentration.size() == 3);
-    REQUIRE(contents->simulationData->concentration[2][0].size() == 5441);
-    REQUIRE(contents->simulationData->concentration[0][0][1642] ==
+    REQUIRE((*contents->simulationData->concentration.get(2))[0].size() ==
+            5441);
+    REQUIRE((*contents->simulationData->concentration.get(0))[0][1642] ==
             dbl_approx(0));
-    REQUIRE(contents->simulationData->concentration[1][0][1642] ==
+    REQUIRE((*contents->simulationData->concentration.get(1))[0][1642] ==
             dbl_approx(1.5083400377522022672849289e-70));
-    REQUIRE(contents->simulationData->concentration[2][0][1642] ==
+    REQUIRE((*contents->simulationData->concentration.get(2))[0][1642] ==
             dbl_approx(2.3650364527146514603828109e-55));
   }
   SECTION("Valid v1 smefile (SimulationSettings not stored in model)") {
@@ -71,14 +72,15 @@ TEST_CASE("Serialization",
     REQUIRE(contents->simulationData->timePoints[2] == dbl_approx(0.10));
     REQUIRE(contents->simulationData->timePoints[3] == dbl_approx(0.15));
     REQUIRE(contents->simulationData->concentration.size() == 4);
-    REQUIRE(contents->simulationData->concentration[2][0].size() == 5441);
-    REQUIRE(contents->simulationData->concentration[0][0][1642] ==
+    REQUIRE((*contents->simulationData->concentration.get(2))[0].size() ==
+            5441);
+    REQUIRE((*contents->simulationData->concentration.get(0))[0][1642] ==
             dbl_approx(0));
-    REQUIRE(contents->simulationData->concentration[1][0][1642] ==
+    REQUIRE((*contents->simulationData->concentration.get(1))[0][1642] ==
             dbl_approx(4.800088138108658530889272e-128));
-    REQUIRE(contents->simulationData->concentration[2][0][1642] ==
+    REQUIRE((*contents->simulationData->concentration.get(2))[0][1642] ==
             dbl_approx(4.7061442226124325927116843e-110));
-    REQUIRE(contents->simulationData->concentration[3][0][1642] ==
+    REQUIRE((*contents->simulationData->concentration.get(3))[0][1642] ==
             dbl_approx(1.06406832003626607985324881e-99));
     // in v1, SimulationSettings are stored in contents
     // but when imported, they are transferred to the sbml doc as xml
@@ -115,18 +117,18 @@ TEST_CASE("Serialization",
     REQUIRE(contents->simulationData->timePoints[2] == dbl_approx(0.10));
     REQUIRE(contents->simulationData->timePoints[3] == dbl_approx(0.15));
     REQUIRE(contents->simulationData->concentration.size() == 4);
-    REQUIRE(contents->simulationData->concentration[2][0].size() == 5441);
-    REQUIRE(contents->simulationData->concentration[0][0][1642] ==
+    REQUIRE((*contents->simulationData->concentration.get(2))[0].size() ==
+            5441);
+    REQUIRE((*contents->simulationData->concentration.get(0))[0][1642] ==
             dbl_approx(0));
-    REQUIRE(contents->simulationData->concentration[1][0][1642] ==
+    REQUIRE((*contents->simulationData->concentration.get(1))[0][1642] ==
             dbl_approx(4.800088138108658530889272e-128));
-    REQUIRE(contents->simulationData->concentration[2][0][1642] ==
+    REQUIRE((*contents->simulationData->concentration.get(2))[0][1642] ==
             dbl_approx(4.7061442226124325927116843e-110));
-    REQUIRE(contents->simulationData->concentration[3][0][1642] ==
+    REQUIRE((*contents->simulationData->concentration.get(3))[0][1642] ==
             dbl_approx(1.06406832003626607985324881e-99));
   }
-  SECTION("Valid current (v3) sme file") {
-    // sme versions >= 1.1.5
+  SECTION("Valid current sme file") {
     QFile f(":/models/brusselator-model.xml");
     f.open(QIODevice::ReadOnly);
     model::Model m;
@@ -137,10 +139,191 @@ TEST_CASE("Serialization",
     const auto &s{m2.getSimulationSettings()};
     REQUIRE(s.options.pixel.maxErr.rel == dbl_approx(0.005));
   }
+  SECTION("Chunked sme file: on demand loading & appending timepoints") {
+    common::SmeFileContents contents;
+    contents.xmlModel = "<sbml/>";
+    contents.simulationData = std::make_unique<simulate::SimulationData>();
+    auto &data{*contents.simulationData};
+    data.xmlModel = "<sbml>sim</sbml>";
+    data.observableDefinitions = {
+        {"total_A", "A", {"c1"}},
+        {"max_B", "B", {}, simulate::ObservableReduction::Max}};
+    auto addTimepoint{[&data]() {
+      auto i{data.size()};
+      auto t{static_cast<double>(i)};
+      data.observables.push_back({t, -t});
+      data.timePoints.push_back(0.5 * t);
+      data.concentration.push_back({{t, 1.0 + t, 2.0}, {3.0 * t}});
+      data.avgMinMax.push_back({{simulate::AvgMinMax{t, 0.0, 2.0 * t}}});
+      data.concentrationMax.push_back({{3.0 * t}});
+      data.concPadding.push_back(i);
+    }};
+    for (int i = 0; i < 3; ++i) {
+      addTimepoint();
+    }
+    REQUIRE(common::exportSmeFile("chunked.sme", contents));
+    auto c{common::importSmeFile("chunked.sme")};
+    REQUIRE(c != nullptr);
+    REQUIRE(c->xmlModel == contents.xmlModel);
+    const auto &d{*c->simulationData};
+    REQUIRE(d.xmlModel == data.xmlModel);
+    REQUIRE(d.timePoints.size() == 3);
+    REQUIRE(d.timePoints[2] == dbl_approx(1.0));
+    REQUIRE(d.avgMinMax[2][0][0].max == dbl_approx(4.0));
+    REQUIRE(d.concentrationMax[1][0][0] == dbl_approx(3.0));
+    REQUIRE(d.concPadding[1] == 1);
+    // observables and their values
+    REQUIRE(d.observableDefinitions.size() == 2);
+    REQUIRE(d.observableDefinitions[0].name == "total_A");
+    REQUIRE(d.observableDefinitions[0].compartmentIds ==
+            std::vector<std::string>{"c1"});
+    REQUIRE(d.observableDefinitions[1].expression == "B");
+    REQUIRE(d.observableDefinitions[1].reduction ==
+            simulate::ObservableReduction::Max);
+    REQUIRE(d.observables.size() == 3);
+    REQUIRE(d.observables[2][0] == dbl_approx(2.0));
+    REQUIRE(d.observables[2][1] == dbl_approx(-2.0));
+    // concentrations are only loaded from the file when used
+    REQUIRE(d.concentration.size() == 3);
+    REQUIRE(d.concentration.getNumResidentTimepoints() == 0);
+    REQUIRE(*d.concentration.get(1) == *data.concentration.get(1));
+    REQUIRE(d.concentration.getNumResidentTimepoints() == 1);
+    REQUIRE(*d.concentration.get(0) == *data.concentration.get(0));
+    REQUIRE(*d.concentration.get(2) == *data.concentration.get(2));
+    // append new timepoints without modifying existing data
+    QByteArray original;
+    if (QFile f("chunked.sme"); f.open(QIODevice::ReadOnly)) {
+      original = f.readAll();
+    }
+    REQUIRE(!original.isEmpty());
+    addTimepoint();
+    addTimepoint();
+    REQUIRE(common::appendSmeFile("chunked.sme", contents));
+    if (QFile f("chunked.sme"); f.open(QIODevice::ReadOnly)) {
+      REQUIRE(f.size() > original.size());
+      REQUIRE(f.read(original.size()) == original);
+    }
+    c = common::importSmeFile("chunked.sme");
+    REQUIRE(c != nullptr);
+    REQUIRE(c->simulationData->timePoints.size() == 5);
+    REQUIRE(c->simulationData->observables.size() == 5);
+    REQUIRE(c->simulationData->observables[4][1] == dbl_approx(-4.0));
+    for (std::size_t i = 0; i < 5; ++i) {
+      REQUIRE(c->simulationData->timePoints[i] ==
+              dbl_approx(data.timePoints[i]));
+      REQUIRE(*c->simulationData->concentration.get(i) ==
+              *data.concentration.get(i));
+    }
+    // an incomplete append leaves the previous index in use
+    {
+      QFile f("chunked.sme");
+      REQUIRE(f.open(QIODevice::Append));
+      REQUIRE(f.write(QByteArray(100, 'x')) == 100);
+    }
+    c = common::importSmeFile("chunked.sme");
+    REQUIRE(c != nullptr);
+    REQUIRE(c->simulationData->timePoints.size() == 5);
+    REQUIRE(*c->simulationData->concentration.get(4) ==
+            *data.concentration.get(4));
+    // appending again writes a new index after the incomplete data
+    REQUIRE(common::appendSmeFile("chunked.sme", contents));
+    c = common::importSmeFile("chunked.sme");
+    REQUIRE(c != nullptr);
+    REQUIRE(c->simulationData->timePoints.size() == 5);
+    REQUIRE(*c->simulationData->concentration.get(4) ==
+            *data.concentration.get(4));
+    // new timepoints can be added to the imported contents
+    auto &concentration{c->simulationData->concentration};
+    REQUIRE(concentration.isReadingFrom("chunked.sme"));
+    REQUIRE(concentration.isReadingFrom("chunked2.sme") == false);
+    REQUIRE(concentration.getNumUnchangedFileTimepoints() == 5);
+    concentration.push_back({{7.0, 8.0, 9.0}, {1.0}});
+    REQUIRE(concentration.size() == 6);
+    REQUIRE(concentration.getNumUnchangedFileTimepoints() == 5);
+    REQUIRE(*concentration.get(3) == *data.concentration.get(3));
+    concentration.pop_back();
+    // a modified timepoint is no longer the one in the file
+    concentration.replaceBack(
+        simulate::ConcentrationSnapshot(*concentration.get(4)));
+    REQUIRE(concentration.getNumUnchangedFileTimepoints() == 4);
+    REQUIRE(common::appendSmeFile("chunked.sme", *c) == false);
+    // imported contents can be saved while they are being loaded on demand
+    REQUIRE(common::exportSmeFile("chunked2.sme", *c));
+    auto c2{common::importSmeFile("chunked2.sme")};
+    REQUIRE(c2 != nullptr);
+    REQUIRE(c2->simulationData->timePoints.size() == 5);
+    REQUIRE(*c2->simulationData->concentration.get(4) ==
+            *data.concentration.get(4));
+    // or saved over the file they are being loaded from
+    REQUIRE(c2->simulationData->concentration.getNumResidentTimepoints() == 1);
+    REQUIRE(c2->simulationData->concentration.isReadingFrom("chunked2.sme"));
+    REQUIRE(common::exportSmeFile("chunked2.sme", *c2));
+    REQUIRE(c2->simulationData->concentration.isReadingFrom("chunked2.sme") ==
+            false);
+    REQUIRE(QFile::remove("chunked2.sme"));
+    REQUIRE(common::exportSmeFile("chunked2.sme", *c2));
+    auto c3{common::importSmeFile("chunked2.sme")};
+    REQUIRE(c3 != nullptr);
+    REQUIRE(c3->simulationData->timePoints.size() == 5);
+    for (std::size_t i = 0; i < 5; ++i) {
+      REQUIRE(*c2->simulationData->concentration.get(i) ==
+              *data.concentration.get(i));
+      REQUIRE(*c3->simulationData->concentration.get(i) ==
+              *data.concentration.get(i));
+    }
+    // new timepoints can still be added once the file is released
+    c2->simulationData->concentration.push_back({{7.0, 8.0, 9.0}, {1.0}});
+    REQUIRE(c2->simulationData->concentration.size() == 6);
+    REQUIRE(*c2->simulationData->concentration.get(5) ==
+            simulate::ConcentrationSnapshot{{7.0, 8.0, 9.0}, {1.0}});
+    // can only append to a file that contains the first timepoints
+    data.timePoints[1] = 0.7;
+    REQUIRE(common::appendSmeFile("chunked.sme", contents) == false);
+    REQUIRE(common::appendSmeFile("idontexist.sme", contents) == false);
+  }
+  SECTION("Chunked sme file: compressed concentrations") {
+    common::SmeFileContents contents;
+    contents.xmlModel = "<sbml/>";
+    contents.simulationData = std::make_unique<simulate::SimulationData>();
+    auto &data{*contents.simulationData};
+    simulate::ConcentrationCompression compression{};
+    compression.enabled = true;
+    compression.keyframeInterval = 4;
+    data.concentration.useCompression(compression);
+    for (int i = 0; i < 6; ++i) {
+      auto t{static_cast<double>(i)};
+      data.timePoints.push_back(t);
+      data.concentration.push_back({{t, 1.0 + t, 0.1 * t}});
+      data.avgMinMax.emplace_back();
+      data.concentrationMax.emplace_back();
+      data.concPadding.push_back(0);
+    }
+    REQUIRE(common::exportSmeFile("chunked.sme", contents));
+    auto c{common::importSmeFile("chunked.sme")};
+    REQUIRE(c != nullptr);
+    const auto &concentration{c->simulationData->concentration};
+    REQUIRE(concentration.getCompression().enabled);
+    REQUIRE(concentration.getCompression().keyframeInterval == 4);
+    REQUIRE(concentration.size() == 6);
+    // each timepoint is independent: no other timepoints need to be loaded
+    REQUIRE(*concentration.get(5) == *data.concentration.get(5));
+    REQUIRE(concentration.getNumResidentTimepoints() == 1);
+    REQUIRE(*concentration.get(3) == *data.concentration.get(3));
+    REQUIRE(concentration.getNumResidentTimepoints() == 2);
+  }
   SECTION("settings xml roundtrip") {
     sme::model::Settings s{};
     s.simulationSettings.times = {{1, 0.3}, {2, 0.1}};
     s.simulationSettings.options.pixel.maxErr.rel = 0.02;
+    s.simulationSettings.probes.probes = {{"p1", "c1", 1.0, 2.0, 0.0, 0.0},
+                                          {"r1", "c2", 0.5, 0.0, 3.0, 4.0}};
+    s.simulationSettings.probes.interval = 0.125;
+    s.simulationSettings.probes.capacity = 99;
+    s.simulationSettings.retention.keepLast = 7;
+    s.simulationSettings.retention.keepEvery = 3;
+    s.simulationSettings.storage.compress = true;
+    s.simulationSettings.storage.maxAbsError = 1e-6;
+    s.simulationSettings.storage.useFile = true;
     auto xml{common::toXml(s)};
     auto s2{common::fromXml(xml)};
     REQUIRE(s2.simulationSettings.simulatorType ==
@@ -148,6 +331,19 @@ TEST_CASE("Serialization",
     REQUIRE(s2.simulationSettings.times == s.simulationSettings.times);
     REQUIRE(s2.simulationSettings.options.pixel.maxErr.rel ==
             dbl_approx(s.simulationSettings.options.pixel.maxErr.rel));
+    const auto &probes{s2.simulationSettings.probes};
+    REQUIRE(probes.interval == dbl_approx(0.125));
+    REQUIRE(probes.capacity == 99);
+    REQUIRE(probes.probes.size() == 2);
+    REQUIRE(probes.probes[1].name == "r1");
+    REQUIRE(probes.probes[1].compartmentId == "c2");
+    REQUIRE(probes.probes[1].x == dbl_approx(0.5));
+    REQUIRE(probes.probes[1].height == dbl_approx(4.0));
+    REQUIRE(s2.simulationSettings.retention.keepLast == 7);
+    REQUIRE(s2.simulationSettings.retention.keepEvery == 3);
+    REQUIRE(s2.simulationSettings.storage.compress);
+    REQUIRE(s2.simulationSettings.storage.maxAbsError == dbl_approx(1e-6));
+    REQUIRE(s2.simulationSettings.storage.useFile);
   }
   SECTION("check DE locale doesn't break settings xml roundtrip") {
     // https://github.com/spatial-model-editor/spatial-model-editor/issues/535
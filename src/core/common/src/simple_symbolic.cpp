@@ -1,5 +1,6 @@
 #include "simple_symbolic.hpp"
 #include "logger.hpp"
+#include "scoped_c_locale.hpp"
 #include <symengine/basic.h>
 #include <symengine/parser.h>
 #include <symengine/parser/sbml/sbml_parser.h>
@@ -12,9 +13,8 @@ using namespace SymEngine;
 static RCP<const Basic> safeParse(const std::string &expr) {
   // hack until https://github.com/symengine/symengine/issues/1566 is resolved:
   // (SymEngine parser relies on strtod and assumes C locale)
-  std::locale userLocale{std::locale::global(std::locale::classic())};
+  ScopedCLocale cLocale;
   auto e{parse_sbml(expr)};
-  std::locale::global(userLocale);
   return e;
 }
 
@@ -1,7 +1,11 @@
 #include "symbolic.hpp"
 #include "logger.hpp"
+#include "scoped_c_locale.hpp"
+#include <algorithm>
+#include <cmath>
 #include <llvm/Config/llvm-config.h>
 #include <map>
+#include <mutex>
 #include <symengine/basic.h>
 #include <symengine/llvm_double.h>
 #include <symengine/parser/sbml/sbml_parser.h>
@@ -29,7 +33,11 @@ Symbolic::SymEngineFunc::SymEngineFunc(const SymbolicFunction &symbolicFunction)
 }
 
 struct Symbolic::SymEngineWrapper {
-  LLVMDoubleVisitor lambdaLLVM{};
+  // compiled code may be shared with other identical compiled expressions
+  std::shared_ptr<const LLVMDoubleVisitor> lambdaLLVM{};
+  // exact description of the inputs that determine the expressions,
+  // empty if unknown
+  std::string key{};
   vec_basic exprInlined{};
   vec_basic exprOriginal{};
   vec_basic varVec{};
@@ -37,6 +45,23 @@ struct Symbolic::SymEngineWrapper {
   std::string errorMessage{};
 };
 
+// compiled expressions that are currently in use, so that identical
+// expressions, e.g. from simulations of the same model that differ only in the
+// values of runtime parameters, are only compiled once
+static std::mutex compileMutex;
+static std::map<std::string, std::weak_ptr<const LLVMDoubleVisitor>,
+                std::less<>>
+    compiledCache;
+
+// comma-delimited list, doubles formatted as the shortest exact string
+template <typename T> static std::string toKey(const std::vector<T> &values) {
+  std::string str;
+  for (const auto &value : values) {
+    str.append(fmt::format("{},", value));
+  }
+  return str;
+}
+
 Symbolic::Symbolic() = default;
 
 Symbolic::Symbolic(const std::vector<std::string> &expressions,
@@ -45,6 +70,18 @@ Symbolic::Symbolic(const std::vector<std::string> &expressions,
                    const std::vector<SymbolicFunction> &functions)
     : se{std::make_unique<SymEngineWrapper>()} {
   SPDLOG_DEBUG("parsing {} expressions", expressions.size());
+  for (const auto &expression : expressions) {
+    se->key.append(fmt::format("e:{}\n", expression));
+  }
+  for (const auto &v : variables) {
+    se->key.append(fmt::format("v:{}\n", v));
+  }
+  for (const auto &[name, value] : constants) {
+    se->key.append(fmt::format("c:{}={}\n", name, value));
+  }
+  for (const auto &f : functions) {
+    se->key.append(fmt::format("f:{}({})={}\n", f.id, toKey(f.args), f.body));
+  }
   for (const auto &v : variables) {
     SPDLOG_DEBUG("  - variable {}", v);
     se->symbols[v] = symbol(v);
@@ -57,7 +94,7 @@ Symbolic::Symbolic(const std::vector<std::string> &expressions,
   }
   // hack until https://github.com/symengine/symengine/issues/1566 is resolved:
   // (SymEngine parser relies on strtod and assumes C locale)
-  std::locale userLocale{std::locale::global(std::locale::classic())};
+  ScopedCLocale cLocale;
   SbmlParser parser;
   // map from function id to symengine expressions
   std::map<std::string, SymEngineFunc, std::less<>> symEngineFuncs;
@@ -92,7 +129,6 @@ Symbolic::Symbolic(const std::vector<std::string> &expressions,
                   fmt::format("Function '{}' requires {} argument(s), found {}",
                               f.name, f.args.size(), args.size());
               SPDLOG_WARN("{}", se->errorMessage);
-              std::locale::global(userLocale);
               return;
             }
             map_basic_basic arg_map;
@@ -113,7 +149,6 @@ Symbolic::Symbolic(const std::vector<std::string> &expressions,
       if (remainingAllowedReplaceLoops <= 0) {
         se->errorMessage = "Recursive function calls not supported";
         SPDLOG_WARN("{}", se->errorMessage);
-        std::locale::global(userLocale);
         return;
       }
       se->exprInlined.push_back(e->subs(d));
@@ -121,7 +156,6 @@ Symbolic::Symbolic(const std::vector<std::string> &expressions,
       // if SymEngine failed to parse, capture error message
       SPDLOG_WARN("{}", e.what());
       se->errorMessage = e.what();
-      std::locale::global(userLocale);
       return;
     }
     SPDLOG_DEBUG("  --> {}", sbml(*se->exprInlined.back()));
@@ -135,19 +169,16 @@ Symbolic::Symbolic(const std::vector<std::string> &expressions,
         iter != fs.cend()) {
       se->errorMessage = "Unknown symbol: " + sbml(*(*iter));
       SPDLOG_WARN("{}", se->errorMessage);
-      std::locale::global(userLocale);
       return;
     }
     auto fn{function_symbols(*se->exprInlined.back())};
     if (!fn.empty()) {
       se->errorMessage = "Unknown function: " + sbml(*(*fn.begin()));
       SPDLOG_WARN("{}", se->errorMessage);
-      std::locale::global(userLocale);
       return;
     }
   }
   valid = true;
-  std::locale::global(userLocale);
 }
 
 Symbolic::~Symbolic() = default;
@@ -158,6 +189,66 @@ Symbolic &Symbolic::operator=(Symbolic &&) noexcept = default;
 
 const char *Symbolic::getLLVMVersion() { return LLVM_VERSION_STRING; }
 
+// integer coefficients are kept exact, as they would be if parsed from a string
+static RCP<const Basic> toSymEngineNumber(double x) {
+  constexpr double maxExactInteger{1e9};
+  if (std::trunc(x) == x && std::abs(x) < maxExactInteger) {
+    return integer(static_cast<int>(x));
+  }
+  return real_double(x);
+}
+
+Symbolic Symbolic::linearCombination(
+    const std::vector<Symbolic> &terms,
+    const std::vector<std::vector<double>> &coefficients,
+    const std::vector<std::string> &variables) {
+  // expression i = sum_j coefficients[i][j] * (first expression of terms[j])
+  // done at the SymEngine expression level: no re-parsing of any expressions
+  Symbolic sym;
+  sym.se = std::make_unique<SymEngineWrapper>();
+  for (const auto &v : variables) {
+    sym.se->symbols[v] = symbol(v);
+    sym.se->varVec.push_back(sym.se->symbols[v]);
+  }
+  for (const auto &term : terms) {
+    if (!term.isValid()) {
+      sym.se->errorMessage = term.getErrorMessage();
+      return sym;
+    }
+  }
+  if (std::none_of(terms.cbegin(), terms.cend(),
+                   [](const auto &term) { return term.se->key.empty(); })) {
+    for (const auto &v : variables) {
+      sym.se->key.append(fmt::format("v:{}\n", v));
+    }
+    for (const auto &term : terms) {
+      sym.se->key.append(fmt::format("t:{{\n{}}}\n", term.se->key));
+    }
+    for (const auto &row : coefficients) {
+      sym.se->key.append(fmt::format("r:{}\n", toKey(row)));
+    }
+  }
+  for (const auto &row : coefficients) {
+    vec_basic summands;
+    for (std::size_t j = 0; j < row.size() && j < terms.size(); ++j) {
+      if (row[j] != 0.0) {
+        summands.push_back(
+            mul(toSymEngineNumber(row[j]), terms[j].se->exprInlined.front()));
+      }
+    }
+    // an empty sum is a floating point zero, as if "0.0" had been parsed
+    RCP<const Basic> e{real_double(0.0)};
+    if (!summands.empty()) {
+      e = add(summands);
+    }
+    SPDLOG_DEBUG("  --> {}", sbml(*e));
+    sym.se->exprOriginal.push_back(e);
+    sym.se->exprInlined.push_back(e);
+  }
+  sym.valid = true;
+  return sym;
+}
+
 void Symbolic::compile(bool doCSE, unsigned optLevel) {
   if (!valid) {
     return;
@@ -172,7 +263,35 @@ void Symbolic::compile(bool doCSE, unsigned optLevel) {
   }
 #endif
   try {
-    se->lambdaLLVM.init(se->varVec, se->exprInlined, doCSE, optLevel);
+    // SymEngine initialises global LLVM target state on each compilation,
+    // so compilations from different threads are done one at a time
+    std::scoped_lock lock{compileMutex};
+    std::string key{};
+    if (!se->key.empty()) {
+      key = fmt::format("{}o:{},{}\n", se->key, doCSE, optLevel);
+      if (auto iter{compiledCache.find(key)}; iter != compiledCache.end()) {
+        if (auto lambda{iter->second.lock()}; lambda != nullptr) {
+          SPDLOG_DEBUG("re-using identical compiled expressions");
+          se->lambdaLLVM = std::move(lambda);
+          compiled = true;
+          return;
+        }
+      }
+    }
+    auto lambda{std::make_shared<LLVMDoubleVisitor>()};
+    lambda->init(se->varVec, se->exprInlined, doCSE, optLevel);
+    se->lambdaLLVM = lambda;
+    if (!key.empty()) {
+      // remove compiled expressions that are no longer in use
+      for (auto iter{compiledCache.begin()}; iter != compiledCache.end();) {
+        if (iter->second.expired()) {
+          iter = compiledCache.erase(iter);
+        } else {
+          ++iter;
+        }
+      }
+      compiledCache[key] = lambda;
+    }
   } catch (const std::exception &e) {
     // if SymEngine failed to compile, capture error message
     SPDLOG_WARN("{}", e.what());
@@ -197,6 +316,13 @@ std::string Symbolic::diff(const std::string &var, std::size_t i) const {
   return sbml(*se->exprInlined[i]->diff(se->symbols.at(var)));
 }
 
+bool Symbolic::dependsOn(const std::string &var, std::size_t i) const {
+  if (auto iter{se->symbols.find(var)}; iter != se->symbols.cend()) {
+    return has_symbol(*se->exprInlined[i], *iter->second);
+  }
+  return false;
+}
+
 void Symbolic::relabel(const std::vector<std::string> &newVariables) {
   if (se->varVec.size() != newVariables.size()) {
     SPDLOG_WARN("cannot relabel variables: newVariables size {} "
@@ -226,6 +352,9 @@ void Symbolic::relabel(const std::vector<std::string> &newVariables) {
     e = e->subs(d);
     SPDLOG_DEBUG("  -> '{}'", sbml(*e));
   }
+  if (!se->key.empty()) {
+    se->key.append(fmt::format("relabel:{}\n", toKey(newVariables)));
+  }
   // replace old variables with new variables in vector & map
   std::swap(se->varVec, newVarVec);
   std::swap(se->symbols, newSymbols);
@@ -256,6 +385,10 @@ void Symbolic::rescale(double factor,
     e = e->subs(d);
     SPDLOG_DEBUG("  -> '{}'", sbml(*e));
   }
+  if (!se->key.empty()) {
+    se->key.append(
+        fmt::format("rescale:{}({})\n", factor, toKey(exclusions)));
+  }
   if (compiled) {
     compile(true, 3);
   }
@@ -263,11 +396,11 @@ void Symbolic::rescale(double factor,
 
 void Symbolic::eval(std::vector<double> &results,
                     const std::vector<double> &vars) const {
-  se->lambdaLLVM.call(results.data(), vars.data());
+  se->lambdaLLVM->call(results.data(), vars.data());
 }
 
 void Symbolic::eval(double *results, const double *vars) const {
-  se->lambdaLLVM.call(results, vars);
+  se->lambdaLLVM->call(results, vars);
 }
 
 bool Symbolic::isValid() const { return valid; }
@@ -293,6 +293,42 @@ TEST_CASE("Symbolic", "[core/common/symbolic][core/common][core][symbolic]") {
     REQUIRE(sym.isValid() == true);
     REQUIRE(sym.isCompiled() == true);
   }
+  SECTION("identical compiled expressions") {
+    std::vector<std::string> exprs{"a*x + 2*y", "x*y"};
+    common::Symbolic sym1(exprs, {"x", "y"}, {{"a", 3.0}});
+    common::Symbolic sym2(exprs, {"x", "y"}, {{"a", 3.0}});
+    common::Symbolic sym3(exprs, {"x", "y"}, {{"a", 3.0000000000000004}});
+    sym1.compile();
+    sym2.compile();
+    sym3.compile();
+    REQUIRE(sym2.isCompiled() == true);
+    std::vector<double> res1(2, 0);
+    std::vector<double> res2(2, 0);
+    std::vector<double> res3(2, 0);
+    sym1.eval(res1, {1.0, 2.0});
+    sym2.eval(res2, {1.0, 2.0});
+    sym3.eval(res3, {1.0, 0.0});
+    REQUIRE(res2[0] == dbl_approx(7.0));
+    REQUIRE(res2[1] == dbl_approx(2.0));
+    REQUIRE(res1 == res2);
+    // constants that differ in the last bit are not treated as identical
+    REQUIRE(res3[0] > 3.0);
+    // rescaling one doesn't affect the other
+    sym1.rescale(2.0);
+    sym1.eval(res1, {1.0, 2.0});
+    sym2.eval(res2, {1.0, 2.0});
+    REQUIRE(res1[0] == dbl_approx(14.0));
+    REQUIRE(res2[0] == dbl_approx(7.0));
+    // compiled code remains valid after the other expressions are deleted
+    sym1 = {};
+    sym3 = {};
+    common::Symbolic sym4(exprs, {"x", "y"}, {{"a", 3.0}});
+    sym4.compile();
+    std::vector<double> res4(2, 0);
+    sym4.eval(res4, {1.0, 2.0});
+    sym2.eval(res2, {1.0, 2.0});
+    REQUIRE(res4 == res2);
+  }
   SECTION("invalid variable relabeling is a no-op") {
     std::string expr{"3*x + 12*sin(y)"};
     common::Symbolic sym(expr, {"x", "y"});
@@ -514,4 +550,41 @@ TEST_CASE("Symbolic", "[core/common/symbolic][core/common][core][symbolic]") {
     REQUIRE(sym.getErrorMessage().substr(0, 30) ==
             "Failed to compile expression: ");
   }
+  SECTION("linear combination of expressions") {
+    std::vector<common::Symbolic> terms;
+    terms.emplace_back("a*x", std::vector<std::string>{"x", "y"},
+                       std::vector<std::pair<std::string, double>>{{"a", 2}});
+    terms.emplace_back("a*y^2", std::vector<std::string>{"x", "y"},
+                       std::vector<std::pair<std::string, double>>{{"a", 3}});
+    auto sym{common::Symbolic::linearCombination(
+        terms, {{1, 0}, {-1, 2}, {0, 0}, {0.5, 0}}, {"x", "y"})};
+    REQUIRE(sym.isValid() == true);
+    REQUIRE(symEq(sym.inlinedExpr(0), "2*x"));
+    REQUIRE(symEq(sym.inlinedExpr(1), "-2*x + 6*y^2"));
+    REQUIRE(sym.inlinedExpr(2) == "0.0");
+    REQUIRE(symEq(sym.inlinedExpr(3), "x"));
+    REQUIRE(symEq(sym.diff("y", 1), "12*y"));
+    REQUIRE(sym.diff("x", 2) == "0");
+    REQUIRE(sym.dependsOn("x", 0) == true);
+    REQUIRE(sym.dependsOn("y", 0) == false);
+    REQUIRE(sym.dependsOn("x", 1) == true);
+    REQUIRE(sym.dependsOn("y", 1) == true);
+    REQUIRE(sym.dependsOn("x", 2) == false);
+    REQUIRE(sym.dependsOn("y", 2) == false);
+    REQUIRE(sym.dependsOn("z", 0) == false);
+    sym.compile();
+    REQUIRE(sym.isCompiled() == true);
+    std::vector<double> res(4, 0);
+    sym.eval(res, {1.0, 2.0});
+    REQUIRE(res[0] == dbl_approx(2.0));
+    REQUIRE(res[1] == dbl_approx(22.0));
+    REQUIRE(res[2] == dbl_approx(0.0));
+    REQUIRE(res[3] == dbl_approx(1.0));
+    // invalid term
+    terms.emplace_back("z", std::vector<std::string>{"x", "y"});
+    auto invalid{
+        common::Symbolic::linearCombination(terms, {{1, 1, 1}}, {"x", "y"})};
+    REQUIRE(invalid.isValid() == false);
+    REQUIRE(invalid.getErrorMessage() == "Unknown symbol: z");
+  }
 }
@@ -55,6 +55,9 @@ struct SimulationSettings {
   std::vector<std::pair<std::size_t, double>> times{};
   simulate::Options options{};
   sme::simulate::SimulatorType simulatorType{};
+  simulate::ProbeOptions probes{};
+  simulate::RetentionPolicy retention{};
+  simulate::StorageOptions storage{};
 
   template <class Archive>
   void serialize(Archive &ar, std::uint32_t const version) {
@@ -62,6 +65,15 @@ struct SimulationSettings {
       ar(times, options, simulatorType);
     } else if (version == 1) {
       ar(CEREAL_NVP(times), CEREAL_NVP(options), CEREAL_NVP(simulatorType));
+    } else if (version == 2) {
+      ar(CEREAL_NVP(times), CEREAL_NVP(options), CEREAL_NVP(simulatorType),
+         CEREAL_NVP(probes));
+    } else if (version == 3) {
+      ar(CEREAL_NVP(times), CEREAL_NVP(options), CEREAL_NVP(simulatorType),
+         CEREAL_NVP(probes), CEREAL_NVP(retention));
+    } else if (version == 4) {
+      ar(CEREAL_NVP(times), CEREAL_NVP(options), CEREAL_NVP(simulatorType),
+         CEREAL_NVP(probes), CEREAL_NVP(retention), CEREAL_NVP(storage));
     }
   }
 };
@@ -85,5 +97,5 @@ struct Settings {
 
 CEREAL_CLASS_VERSION(sme::model::MeshParameters, 1);
 CEREAL_CLASS_VERSION(sme::model::DisplayOptions, 1);
-CEREAL_CLASS_VERSION(sme::model::SimulationSettings, 1);
+CEREAL_CLASS_VERSION(sme::model::SimulationSettings, 4);
 CEREAL_CLASS_VERSION(sme::model::Settings, 0);
@@ -166,7 +166,14 @@ void Model::exportSMEFile(const std::string &filename) {
   }
   updateSBMLDoc();
   smeFileContents->xmlModel = getXml().toStdString();
-  if (!common::exportSmeFile(filename, *smeFileContents)) {
+  bool saved{false};
+  if (const auto *data{smeFileContents->simulationData.get()};
+      data != nullptr &&
+      data->concentration.isReadingFrom(QString::fromStdString(filename))) {
+    // the existing timepoints are already in this file: only add new ones
+    saved = common::appendSmeFile(filename, *smeFileContents);
+  }
+  if (!saved && !common::exportSmeFile(filename, *smeFileContents)) {
     SPDLOG_WARN("Failed to save file '{}'", filename);
   }
   setHasUnsavedChanges(false);
@@ -4,6 +4,7 @@
 #include "model.hpp"
 #include "model_test_utils.hpp"
 #include "utils.hpp"
+#include <QFile>
 #include <sbml/SBMLTypes.h>
 #include <sbml/extension/SBMLDocumentPlugin.h>
 #include <sbml/packages/spatial/common/SpatialExtensionTypes.h>
@@ -899,6 +900,46 @@ TEST_CASE("SBML: load .xml model, simulate, save as .sme, load .sme",
   REQUIRE(s3.getSimulationData().timePoints.size() == 0);
 }
 
+TEST_CASE("SBML: load .sme, simulate, save appends new timepoints",
+          "[core/model/model][core/model][core][model]") {
+  auto s{getExampleModel(Mod::ABtoC)};
+  simulate::Simulation sim(s);
+  sim.doTimesteps(0.1, 2);
+  s.exportSMEFile("tmpmodelsmeappend.sme");
+  auto readFile{[]() {
+    QFile f("tmpmodelsmeappend.sme");
+    f.open(QIODevice::ReadOnly);
+    return f.readAll();
+  }};
+  auto original{readFile()};
+  REQUIRE(!original.isEmpty());
+  model::Model s2;
+  s2.importFile("tmpmodelsmeappend.sme");
+  const auto &data2{s2.getSimulationData()};
+  REQUIRE(data2.timePoints.size() == 3);
+  simulate::Simulation sim2(s2);
+  sim2.doTimesteps(0.1, 2);
+  REQUIRE(data2.timePoints.size() == 5);
+  s2.exportSMEFile("tmpmodelsmeappend.sme");
+  // only the new timepoints are written, after the existing data
+  auto appended{readFile()};
+  REQUIRE(appended.size() > original.size());
+  REQUIRE(appended.left(original.size()) == original);
+  // saving again without new timepoints only adds a new index
+  s2.exportSMEFile("tmpmodelsmeappend.sme");
+  auto resaved{readFile()};
+  REQUIRE(resaved.left(appended.size()) == appended);
+  REQUIRE(resaved.size() - appended.size() < original.size());
+  model::Model s3;
+  s3.importFile("tmpmodelsmeappend.sme");
+  const auto &data3{s3.getSimulationData()};
+  REQUIRE(data3.timePoints.size() == 5);
+  REQUIRE(data3.timePoints[4] == dbl_approx(0.4));
+  for (std::size_t i = 0; i < 5; ++i) {
+    REQUIRE(*data3.concentration.get(i) == *data2.concentration.get(i));
+  }
+}
+
 TEST_CASE("SBML: import multi-compartment SBML doc without spatial geometry",
           "[core/model/model][core/model][core][model]") {
   auto s{getTestModel("non-spatial-multi-compartment")};
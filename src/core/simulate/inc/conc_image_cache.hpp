@@ -0,0 +1,84 @@
+// Concentration image cache
+//  - images are rendered on demand, e.g. as a time slider is moved
+//  - least recently used images are evicted once the total size of the
+//    cached images exceeds a limit
+//  - when an image is requested, its neighbouring timepoints are rendered
+//    speculatively on a worker thread
+//  - changing the renderer (e.g. display options) invalidates the cache
+//  - all images can be requested at once, e.g. for export: any that are not
+//    cached are rendered on a separate thread while progress is reported
+
+#pragma once
+
+#include <QImage>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <list>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace sme::simulate {
+
+class ConcImageCache {
+public:
+  using Renderer = std::function<QImage(std::size_t timeIndex)>;
+  // number of images done so far, returns false to cancel
+  using Progress = std::function<bool(std::size_t nDone)>;
+
+private:
+  struct CachedImage {
+    QImage image;
+    std::list<std::size_t>::iterator lruPosition;
+  };
+  Renderer renderer;
+  std::size_t maxBytes;
+  std::size_t nNeighbours;
+  std::unordered_map<std::size_t, CachedImage> images{};
+  // most recently used first
+  std::list<std::size_t> lru{};
+  std::size_t nBytes{0};
+  // incremented when the renderer changes, to discard outdated images
+  std::size_t generation{0};
+  mutable std::mutex mutex{};
+  std::condition_variable queueChanged{};
+  std::deque<std::size_t> queue{};
+  bool isRendering{false};
+  bool stopRequested{false};
+  std::thread worker;
+  void prerender();
+  void insert(std::size_t timeIndex, const QImage &image);
+
+public:
+  explicit ConcImageCache(Renderer imageRenderer = {},
+                          std::size_t maxCachedBytes = 256 * 1024 * 1024,
+                          std::size_t nNeighboursToPrerender = 2);
+  ConcImageCache(const ConcImageCache &) = delete;
+  ConcImageCache &operator=(const ConcImageCache &) = delete;
+  ~ConcImageCache();
+  // clear the cache and use a new renderer, waits for any image that is
+  // currently being rendered with the previous renderer
+  void setRenderer(Renderer imageRenderer);
+  // clear the cache, keeping the current renderer
+  void invalidate();
+  // image at this timepoint, rendered now if not already cached,
+  // neighbouring timepoints < nTimepoints are then rendered in the background
+  [[nodiscard]] QImage get(std::size_t timeIndex, std::size_t nTimepoints);
+  // images of all timepoints < nTimepoints, rendered on a separate thread if
+  // not already cached, while progress is called periodically from this
+  // thread, which must not change the renderer: empty if cancelled
+  [[nodiscard]] std::vector<QImage> getAll(std::size_t nTimepoints,
+                                           const Progress &progress = {});
+  [[nodiscard]] bool contains(std::size_t timeIndex) const;
+  // number of cached images
+  [[nodiscard]] std::size_t size() const;
+  // total size of cached images in bytes
+  [[nodiscard]] std::size_t sizeInBytes() const;
+  // wait until all queued neighbouring timepoints have been rendered
+  void waitForPrerender();
+};
+
+} // namespace sme::simulate
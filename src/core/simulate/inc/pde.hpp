@@ -2,7 +2,11 @@
 //  - construct PDE for given compartment or membrane
 //  - constructs PDE reaction terms:
 //  R(speciesScaleFactor*species_vector)*reactionScaleFactor
+//  - each reaction term is parsed once, then combined with the stoich matrix
 //  - also Jacobian of reaction terms for each species
+//     - sparsity pattern from the variables each reaction term depends on
+//     - only generated on request, only non-zero entries are differentiated
+//     - generated once, getJacobian() can be called from multiple threads
 //  - factor to rescale species
 //  - factor to rescale reaction
 // Reaction class
@@ -11,8 +15,10 @@
 
 #pragma once
 
+#include "symbolic.hpp"
 #include <cstddef>
 #include <map>
+#include <mutex>
 #include <stdexcept>
 #include <string>
 #include <utility>
@@ -38,8 +44,12 @@ struct PdeScaleFactors {
 
 class Pde {
 private:
+  common::Symbolic sym;
+  std::vector<std::string> outputSpecies;
   std::vector<std::string> rhs;
-  std::vector<std::vector<std::string>> jacobian;
+  std::vector<std::vector<std::size_t>> jacobianPattern;
+  mutable std::vector<std::vector<std::string>> jacobian;
+  mutable std::once_flag jacobianGenerated;
 
 public:
   explicit Pde(
@@ -51,6 +61,8 @@ public:
       const std::vector<std::string> &relabelledExtraVariables = {},
       const std::map<std::string, double, std::less<>> &substitutions = {});
   [[nodiscard]] const std::vector<std::string> &getRHS() const;
+  [[nodiscard]] const std::vector<std::vector<std::size_t>> &
+  getJacobianPattern() const;
   [[nodiscard]] const std::vector<std::vector<std::string>> &
   getJacobian() const;
 };
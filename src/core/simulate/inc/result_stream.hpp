@@ -0,0 +1,99 @@
+// Streamed simulation results
+//  - timepoints are appended to a binary file as they are computed
+//  - a chunked file, see chunked_file.hpp, so chunks can be skipped without
+//    reading their contents
+//  - one chunk per timepoint: time, padding and concentrations
+//  - when the stream is closed an index chunk is appended, containing the
+//    time and file offset of each timepoint, followed by a fixed size footer
+//  - the file can be read while it is being written: without an index the
+//    reader scans the chunk headers, ignoring any incomplete final chunk
+//  - ResultStreamWriter writes on a background thread, with a bounded queue
+
+#pragma once
+
+#include "simulate_data_store.hpp"
+#include <QFile>
+#include <QString>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace sme::simulate {
+
+class ResultStreamWriter {
+private:
+  struct Timepoint {
+    double time;
+    std::size_t concPadding;
+    std::shared_ptr<const ConcentrationSnapshot> concentration;
+  };
+  QFile file;
+  std::size_t maxQueued;
+  std::vector<std::pair<double, std::uint64_t>> index{};
+  mutable std::mutex mutex{};
+  std::condition_variable queueChanged{};
+  std::deque<Timepoint> queue{};
+  std::size_t nWritten{0};
+  bool isWriting{false};
+  bool stopRequested{false};
+  bool hasError{false};
+  std::thread writer;
+  void consume();
+  bool write(const Timepoint &timepoint);
+  bool writeIndex();
+
+public:
+  explicit ResultStreamWriter(const QString &filename,
+                              std::size_t maxQueuedTimepoints = 4);
+  ResultStreamWriter(const ResultStreamWriter &) = delete;
+  ResultStreamWriter &operator=(const ResultStreamWriter &) = delete;
+  // writes any queued timepoints, then closes the stream
+  ~ResultStreamWriter();
+  [[nodiscard]] bool isValid() const;
+  // queue timepoint for writing, blocks if too many timepoints are queued
+  void append(double time, std::size_t concPadding,
+              std::shared_ptr<const ConcentrationSnapshot> concentration);
+  // wait until all queued timepoints have been written to the file
+  void flush();
+  // write any queued timepoints and the index, no further appends possible
+  void close();
+  // number of timepoints written to the file
+  [[nodiscard]] std::size_t size() const;
+};
+
+class ResultStreamReader {
+private:
+  struct Entry {
+    double time;
+    std::uint64_t offset;
+  };
+  QFile file;
+  std::vector<Entry> entries{};
+  // offset of the first chunk that has not yet been scanned
+  std::uint64_t scanOffset{0};
+  bool valid{false};
+  bool complete{false};
+  bool readIndex();
+
+public:
+  explicit ResultStreamReader(const QString &filename);
+  [[nodiscard]] bool isValid() const;
+  // true if the stream was closed by the writer
+  [[nodiscard]] bool isComplete() const;
+  // scan for timepoints written since the last update, returns new size
+  std::size_t update();
+  [[nodiscard]] std::size_t size() const;
+  [[nodiscard]] double getTime(std::size_t timeIndex) const;
+  // zero if the timepoint can't be read
+  [[nodiscard]] std::size_t getConcPadding(std::size_t timeIndex);
+  // empty if the timepoint can't be read, or if its chunk is invalid
+  [[nodiscard]] ConcentrationSnapshot
+  getConcentrations(std::size_t timeIndex);
+};
+
+} // namespace sme::simulate
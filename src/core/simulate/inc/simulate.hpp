@@ -4,7 +4,9 @@
 
 #include "model_settings.hpp"
 #include "simulate_data.hpp"
+#include "simulate_observables.hpp"
 #include "simulate_options.hpp"
+#include "simulate_probes.hpp"
 #include <QImage>
 #include <QRgb>
 #include <QSize>
@@ -31,23 +33,69 @@ class Compartment;
 namespace simulate {
 
 class BaseSim;
+class ConcImagePyramid;
+class SnapshotPublisher;
+struct SpeciesColour;
 
 struct SimEvent {
   double time;
   std::vector<std::string> ids;
 };
 
+// Results of a simulation, converted to images or arrays when requested
+//  - a self-contained copy of the results: remains valid if the simulation
+//    or model that produced it is later changed or deleted
+//  - concentrations are read from the concentration store of the simulation
+//    data when requested, not copied: see ConcentrationStore::Reader
+class SimulationResults {
+private:
+  struct Layout;
+  std::shared_ptr<const Layout> layout;
+  std::vector<double> timePoints;
+  ConcentrationStore::Reader concentrations;
+  std::vector<std::size_t> concPadding;
+  // compartment->(ix->species) dcdt at last timepoint, if available
+  std::vector<std::vector<double>> dcdt;
+  std::size_t dcdtPadding{0};
+  friend class Simulation;
+
+public:
+  SimulationResults();
+  [[nodiscard]] std::size_t size() const;
+  [[nodiscard]] double getTimePoint(std::size_t timeIndex) const;
+  [[nodiscard]] const QSize &getImageSize() const;
+  [[nodiscard]] std::size_t getNumCompartments() const;
+  [[nodiscard]] const std::vector<std::string> &
+  getPyNames(std::size_t compartmentIndex) const;
+  // all species, normalised to the max of each species over all timepoints
+  [[nodiscard]] QImage getConcImage(std::size_t timeIndex) const;
+  // see Simulation::getPyConcs
+  [[nodiscard]] std::vector<double>
+  getPyConcs(std::size_t timeIndex, std::size_t compartmentIndex) const;
+  // only available for the last timepoint, empty if not available
+  [[nodiscard]] std::vector<double>
+  getPyDcdts(std::size_t timeIndex, std::size_t compartmentIndex) const;
+};
+
 class Simulation {
 private:
   std::unique_ptr<BaseSim> simulator;
   std::vector<const geometry::Compartment *> compartments;
   std::vector<std::string> compartmentIds;
   std::map<std::string, double, std::less<>> eventSubstitutions{};
+  std::vector<std::string> runtimeParameterIds;
   // compartment->species
   std::vector<std::vector<std::string>> compartmentSpeciesIds;
   std::vector<std::vector<std::string>> compartmentSpeciesNames;
   std::vector<std::vector<std::size_t>> compartmentSpeciesIndices;
   std::vector<std::vector<QRgb>> compartmentSpeciesColors;
+  struct ImagePixel {
+    int x;
+    std::size_t compartmentIndex;
+    std::size_t pixelIndex;
+  };
+  // image row->compartment pixels in that row
+  std::vector<std::vector<ImagePixel>> imageRows;
   model::Model &model;
   model::SimulationSettings *settings;
   SimulationData *data;
@@ -56,13 +104,39 @@ private:
   std::atomic<bool> stopRequested{false};
   std::atomic<std::size_t> nCompletedTimesteps{0};
   std::queue<SimEvent> simEvents;
+  // time of the most recently published timepoint
+  double lastTimePoint{0.0};
+  std::function<void(std::size_t)> timestepStoredCallback{};
+  std::unique_ptr<ConcImagePyramid> pyramid;
+  std::unique_ptr<SnapshotPublisher> publisher;
+  double quantileAccuracy{0.0};
+  std::unique_ptr<ProbeRecorder> probeRecorder;
   void initModel();
   void initEvents();
+  // apply the storage options of the settings to the simulation data
+  void initStorage();
+  // evaluate the observables of the simulation data for any timepoints
+  // without values, and for each new timepoint
+  std::vector<std::string> initObservables();
   void applyNextEvent();
-  void updateConcentrations(double t);
+  void updateConcentrations(double t, bool isTimestep = true);
+  void recordProbes(double t);
+  // run the simulator from startTime for time, stopping to record the
+  // probes each time a multiple of the probe interval is reached
+  std::size_t runSimulator(double startTime, double time, double timeout_ms,
+                           const std::function<bool()> &stopRunningCallback);
+  [[nodiscard]] std::vector<std::vector<SpeciesColour>>
+  getSpeciesColours(std::size_t timeIndex,
+                    const std::vector<std::vector<std::size_t>> &speciesToDraw,
+                    bool normaliseOverAllTimepoints,
+                    bool normaliseOverAllSpecies) const;
 
 public:
-  explicit Simulation(model::Model &model);
+  // runtimeParamIds: parameters that are inputs to the compiled pixel
+  // simulator kernels rather than inlined constants, so that simulations which
+  // only differ in the values of these parameters share the compiled kernels
+  explicit Simulation(model::Model &model,
+                      std::vector<std::string> runtimeParamIds = {});
   ~Simulation();
 
   std::size_t doTimesteps(double time, std::size_t nSteps = 1,
@@ -71,6 +145,11 @@ public:
       const std::vector<std::pair<std::size_t, double>> &timesteps,
       double timeout_ms = -1.0,
       const std::function<bool()> &stopRunningCallback = {});
+  // called on the storage thread each time a timestep has been stored,
+  // with its time index: should not be changed while a simulation is running
+  void setTimestepStoredCallback(
+      std::function<void(std::size_t timeIndex)> callback);
+  // error from the simulator, or from storing a timepoint
   [[nodiscard]] const std::string &errorMessage() const;
   [[nodiscard]] const QImage &errorImage() const;
   [[nodiscard]] const std::vector<std::string> &getCompartmentIds() const;
@@ -78,10 +157,34 @@ public:
   getSpeciesIds(std::size_t compartmentIndex) const;
   [[nodiscard]] const std::vector<QRgb> &
   getSpeciesColors(std::size_t compartmentIndex) const;
-  [[nodiscard]] const std::vector<double> &getTimePoints() const;
+  [[nodiscard]] const common::AppendOnlyVector<double> &getTimePoints() const;
   [[nodiscard]] const AvgMinMax &getAvgMinMax(std::size_t timeIndex,
                                               std::size_t compartmentIndex,
                                               std::size_t speciesIndex) const;
+  // sum, l2 norm, integral and optionally quantiles of a species: only
+  // computed for timepoints simulated in this session, otherwise empty
+  [[nodiscard]] const SpeciesReduction &
+  getReduction(std::size_t timeIndex, std::size_t compartmentIndex,
+               std::size_t speciesIndex) const;
+  // estimate quantiles with this relative accuracy in the reductions of
+  // subsequent timepoints, disabled if not positive (the default)
+  void setQuantileAccuracy(double relativeAccuracy);
+  // spatial observables, evaluated for all existing timepoints and then for
+  // each new timepoint: replaces any previous observables.
+  // Stored in the simulation data, so they are saved with the results and
+  // also evaluated by any later simulation of the model.
+  // Returns an error message for each observable, empty if valid.
+  // Rejected with an error for each observable if a simulation is running
+  std::vector<std::string> setObservables(std::vector<Observable> observables);
+  [[nodiscard]] const std::vector<Observable> &getObservables() const;
+  // value of an observable at each timepoint, NaN if invalid
+  [[nodiscard]] std::vector<double>
+  getObservableValues(std::size_t observableIndex) const;
+  // probes recorded at a finer cadence than the timepoints, as defined in
+  // the simulation settings when this simulation was constructed
+  [[nodiscard]] ProbeSamples getProbeSamples() const;
+  // concentrations are NaN for timepoints whose concentrations were
+  // discarded by the retention policy of the simulation settings
   [[nodiscard]] std::vector<double> getConc(std::size_t timeIndex,
                                             std::size_t compartmentIndex,
                                             std::size_t speciesIndex) const;
@@ -99,12 +202,25 @@ public:
                const std::vector<std::vector<std::size_t>> &speciesToDraw = {},
                bool normaliseOverAllTimepoints = false,
                bool normaliseOverAllSpecies = false) const;
+  // image to be displayed at displaySize: downsampled if the image is much
+  // larger than displaySize, otherwise the same as getConcImage
+  [[nodiscard]] QImage getConcImagePreview(
+      std::size_t timeIndex, const QSize &displaySize,
+      const std::vector<std::vector<std::size_t>> &speciesToDraw = {},
+      bool normaliseOverAllTimepoints = false,
+      bool normaliseOverAllSpecies = false) const;
   [[nodiscard]] const std::vector<std::string> &
   getPyNames(std::size_t compartmentIndex) const;
-  [[nodiscard]] std::vector<std::vector<double>>
+  // concentrations of all species in a compartment as a dense array of
+  // shape (species, image height, image width) in row-major order
+  [[nodiscard]] std::vector<double>
   getPyConcs(std::size_t timeIndex, std::size_t compartmentIndex) const;
-  [[nodiscard]] std::vector<std::vector<double>>
+  // as above for dcdt, only available for the last timepoint of a pixel sim
+  [[nodiscard]] std::vector<double>
   getPyDcdts(std::size_t compartmentIndex) const;
+  // copy of the completed timepoints, optionally including the dcdt of the
+  // last timepoint of a pixel sim
+  [[nodiscard]] SimulationResults getResults(bool includeDcdt = false) const;
   [[nodiscard]] std::size_t getNCompletedTimesteps() const;
   [[nodiscard]] const SimulationData &getSimulationData() const;
   [[nodiscard]] bool getIsRunning() const;
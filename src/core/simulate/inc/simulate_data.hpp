@@ -2,25 +2,38 @@
 
 #pragma once
 
+#include "append_only_vector.hpp"
+#include "simulate_data_store.hpp"
 #include "simulate_options.hpp"
+#include "simulate_reductions.hpp"
 #include <cereal/cereal.hpp>
 #include <cereal/types/string.hpp>
+#include <cereal/types/vector.hpp>
 #include <string>
 #include <vector>
 
 namespace sme::simulate {
 
+// append-only storage: timepoints can be read while new ones are being added
 class SimulationData {
 public:
-  std::vector<double> timePoints;
+  common::AppendOnlyVector<double> timePoints;
   // time->compartment->(ix->species)
-  std::vector<std::vector<std::vector<double>>> concentration;
+  ConcentrationStore concentration;
   // time->compartment->species
-  std::vector<std::vector<std::vector<AvgMinMax>>> avgMinMax;
+  common::AppendOnlyVector<std::vector<std::vector<AvgMinMax>>> avgMinMax;
   // time->compartment->species
-  std::vector<std::vector<std::vector<double>>> concentrationMax;
+  common::AppendOnlyVector<std::vector<std::vector<double>>> concentrationMax;
   // time->concPadding
-  std::vector<std::size_t> concPadding;
+  common::AppendOnlyVector<std::size_t> concPadding;
+  // time->compartment->species, not saved: empty for timepoints from a file
+  common::AppendOnlyVector<std::vector<std::vector<SpeciesReduction>>>
+      reductions;
+  // spatial observables, kept by clear() so they are also evaluated for a
+  // new simulation
+  std::vector<Observable> observableDefinitions;
+  // time->observable, empty if there are no observables
+  common::AppendOnlyVector<std::vector<double>> observables;
   std::string xmlModel;
   void clear();
   [[nodiscard]] std::size_t size() const;
@@ -28,8 +41,27 @@ public:
   void pop_back();
 
   template <class Archive>
-  void serialize(Archive &ar, std::uint32_t const version) {
-    if (version == 0) {
+  void save(Archive &ar, std::uint32_t const version) const {
+    if (version == 2) {
+      ar(timePoints);
+      concentration.saveCompressed(ar);
+      ar(avgMinMax, concentrationMax, concPadding, xmlModel,
+         observableDefinitions, observables);
+    }
+  }
+
+  template <class Archive> void load(Archive &ar, std::uint32_t const version) {
+    if (version == 2) {
+      ar(timePoints);
+      concentration.loadCompressed(ar);
+      ar(avgMinMax, concentrationMax, concPadding, xmlModel,
+         observableDefinitions, observables);
+    } else if (version == 1) {
+      ar(timePoints);
+      concentration.loadCompressed(ar);
+      ar(avgMinMax, concentrationMax, concPadding, xmlModel);
+    } else if (version == 0) {
+      // concentrations were stored uncompressed until version 1
       ar(timePoints, concentration, avgMinMax, concentrationMax, concPadding,
          xmlModel);
     }
@@ -38,4 +70,4 @@ public:
 
 } // namespace sme::simulate
 
-CEREAL_CLASS_VERSION(sme::simulate::SimulationData, 0);
+CEREAL_CLASS_VERSION(sme::simulate::SimulationData, 2);
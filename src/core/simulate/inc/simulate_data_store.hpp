@@ -0,0 +1,190 @@
+// Concentration data storage
+//  - time->compartment->(ix->species) concentrations
+//  - snapshots are returned as shared pointers, which remain valid even if
+//    the store is modified or the timepoint is evicted from memory
+//  - in memory (default), or appended to a memory-mapped file on disk
+//  - with a memory-mapped file only a bounded number of the most recently
+//    used timepoints are kept in memory
+//  - optionally compressed: delta encoded against the previous timepoint,
+//    optionally quantised with a bounded absolute error, then zlib compressed
+//  - or read on demand from encoded timepoints in an existing file, such as
+//    an sme file, which the store never modifies: timepoints that are later
+//    appended to the file can also be read from it
+//  - optionally with a retention policy, which discards the concentrations
+//    of older timepoints as new ones are added: a discarded timepoint keeps
+//    its index but has an empty snapshot
+//  - a reader is a handle to the timepoints of the store, which fetches each
+//    snapshot when requested: it remains valid if the store is later
+//    cleared, replaced or deleted, in which case it keeps the timepoints
+//    that the store had at that point
+
+#pragma once
+
+#include "simulate_options.hpp"
+#include <QString>
+#include <cereal/cereal.hpp>
+#include <cereal/types/string.hpp>
+#include <cereal/types/vector.hpp>
+#include <cstddef>
+#include <initializer_list>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace sme::simulate {
+
+// compartment->(ix->species)
+using ConcentrationSnapshot = std::vector<std::vector<double>>;
+
+struct ConcentrationCompression {
+  bool enabled{false};
+  // max absolute error of stored values, zero for lossless compression
+  double maxAbsError{0.0};
+  // every n-th timepoint is stored without delta encoding
+  std::size_t keyframeInterval{16};
+  // zlib compression level, from 1 (fastest) to 9 (smallest)
+  int level{1};
+
+  template <class Archive> void serialize(Archive &ar) {
+    ar(enabled, maxAbsError, keyframeInterval, level);
+  }
+};
+
+// location of an encoded timepoint in a file
+struct ConcentrationFileLocation {
+  qint64 offset{0};
+  // size of each compartment's encoded data, stored consecutively
+  std::vector<qint64> nBytes{};
+};
+
+class ConcentrationStore {
+private:
+  struct Storage;
+  std::shared_ptr<Storage> storage;
+
+public:
+  class Reader {
+  private:
+    std::shared_ptr<Storage> storage{};
+    explicit Reader(std::shared_ptr<Storage> sharedStorage);
+    friend class ConcentrationStore;
+
+  public:
+    Reader() = default;
+    // empty if the concentrations of the timepoint have been discarded
+    [[nodiscard]] std::shared_ptr<const ConcentrationSnapshot>
+    get(std::size_t timeIndex) const;
+  };
+  ConcentrationStore();
+  ConcentrationStore(std::initializer_list<ConcentrationSnapshot> snapshots);
+  ConcentrationStore(ConcentrationStore &&) noexcept;
+  ConcentrationStore(const ConcentrationStore &) = delete;
+  ConcentrationStore &operator=(ConcentrationStore &&) noexcept;
+  ConcentrationStore &operator=(const ConcentrationStore &) = delete;
+  ConcentrationStore &
+  operator=(std::initializer_list<ConcentrationSnapshot> snapshots);
+  ~ConcentrationStore();
+  bool useMemoryMappedFile(const QString &filename,
+                           std::size_t maxResidentTimepoints = 4);
+  void useMemory();
+  // replace contents with independently encoded timepoints in an existing
+  // file, which are read on demand: any new timepoints are kept in memory
+  bool useExistingFile(const QString &filename,
+                       const std::vector<ConcentrationFileLocation> &locations,
+                       std::size_t maxResidentTimepoints = 4);
+  // if timepoints are read from this existing file, close it and keep their
+  // encoded data in memory instead, so that the file can be replaced
+  void releaseExistingFile(const QString &filename);
+  // true if timepoints are read from this existing file
+  [[nodiscard]] bool isReadingFrom(const QString &filename) const;
+  // number of leading timepoints that are unchanged since they were read
+  // from the existing file, including any that have since been discarded
+  [[nodiscard]] std::size_t getNumUnchangedFileTimepoints() const;
+  // timepoints from first onwards have been appended to the existing file:
+  // read them from these locations instead of keeping them in memory
+  void useExistingFileLocations(
+      std::size_t first,
+      const std::vector<ConcentrationFileLocation> &locations);
+  void useCompression(const ConcentrationCompression &compression,
+                      std::size_t maxResidentTimepoints = 4);
+  [[nodiscard]] ConcentrationCompression getCompression() const;
+  [[nodiscard]] bool isMemoryMapped() const;
+  [[nodiscard]] std::size_t getMaxResidentTimepoints() const;
+  [[nodiscard]] std::size_t getNumResidentTimepoints() const;
+  // applied to the existing timepoints, then to each new timepoint
+  void setRetention(const RetentionPolicy &retention);
+  [[nodiscard]] RetentionPolicy getRetention() const;
+  // false if the concentrations of the timepoint have been discarded
+  [[nodiscard]] bool isRetained(std::size_t timeIndex) const;
+  [[nodiscard]] std::size_t getNumRetainedTimepoints() const;
+  [[nodiscard]] std::size_t size() const;
+  [[nodiscard]] bool empty() const;
+  [[nodiscard]] std::shared_ptr<const ConcentrationSnapshot>
+  get(std::size_t timeIndex) const;
+  [[nodiscard]] std::shared_ptr<const ConcentrationSnapshot> back() const;
+  [[nodiscard]] Reader getReader() const;
+  // throws if the timepoint cannot be stored, which then leaves the store
+  // unchanged
+  void push_back(ConcentrationSnapshot snapshot);
+  void replaceBack(ConcentrationSnapshot snapshot);
+  void pop_back();
+  // if shared with a reader, the reader keeps the existing timepoints and
+  // the store continues with new storage in memory, with the same settings
+  void clear();
+  void reserve(std::size_t n);
+  // per-compartment encoded data, always compressed, and if independent not
+  // delta encoded so that it can be decoded on its own
+  [[nodiscard]] std::vector<std::string>
+  getCompressedTimepoint(std::size_t timeIndex,
+                         bool independent = false) const;
+  void pushCompressedTimepoint(const std::vector<std::string> &compressed);
+
+  // serialized as a vector of snapshots, for backwards compatibility
+  template <class Archive> void save(Archive &ar) const {
+    ar(cereal::make_size_tag(static_cast<cereal::size_type>(size())));
+    for (std::size_t i = 0; i < size(); ++i) {
+      ar(*get(i));
+    }
+  }
+
+  template <class Archive> void load(Archive &ar) {
+    clear();
+    cereal::size_type n{0};
+    ar(cereal::make_size_tag(n));
+    reserve(static_cast<std::size_t>(n));
+    for (cereal::size_type i = 0; i < n; ++i) {
+      ConcentrationSnapshot snapshot;
+      ar(snapshot);
+      push_back(std::move(snapshot));
+    }
+  }
+
+  // serialized as compressed timepoints
+  template <class Archive> void saveCompressed(Archive &ar) const {
+    ar(getCompression());
+    ar(cereal::make_size_tag(static_cast<cereal::size_type>(size())));
+    for (std::size_t i = 0; i < size(); ++i) {
+      ar(getCompressedTimepoint(i));
+    }
+  }
+
+  template <class Archive> void loadCompressed(Archive &ar) {
+    clear();
+    ConcentrationCompression compression{};
+    ar(compression);
+    if (compression.enabled && !getCompression().enabled) {
+      useCompression(compression);
+    }
+    cereal::size_type n{0};
+    ar(cereal::make_size_tag(n));
+    reserve(static_cast<std::size_t>(n));
+    for (cereal::size_type i = 0; i < n; ++i) {
+      std::vector<std::string> compressed;
+      ar(compressed);
+      pushCompressedTimepoint(compressed);
+    }
+  }
+};
+
+} // namespace sme::simulate
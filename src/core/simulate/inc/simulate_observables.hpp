@@ -0,0 +1,67 @@
+// Spatial observables
+//  - an expression evaluated at each pixel of a compartment, in terms of the
+//    species in the simulation, the spatial coordinates x, y and time t
+//  - reduced over the pixels of one or more compartments to a single value
+//    for each timepoint, e.g. the total amount of a species in a nucleus
+//  - compiled with LLVM and evaluated in parallel over blocks of pixels
+//  - species that are not in a compartment are zero in that compartment
+
+#pragma once
+
+#include "simulate_data_store.hpp"
+#include "simulate_options.hpp"
+#include "symbolic.hpp"
+#include <cstddef>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace sme {
+
+namespace model {
+class Model;
+}
+
+namespace simulate {
+
+class ObservableEvaluator {
+private:
+  struct CompartmentObservables {
+    std::size_t nPixels{0};
+    // physical coordinates of each pixel
+    std::vector<double> x;
+    std::vector<double> y;
+    // index of each species of the compartment in the variables
+    std::vector<std::size_t> speciesVariables;
+    // the observables reduced over this compartment, compiled together
+    std::vector<std::size_t> observableIndices;
+    std::optional<common::Symbolic> symbolic;
+  };
+  std::vector<Observable> observables;
+  std::vector<std::string> errorMessages;
+  std::vector<CompartmentObservables> compartments;
+  std::size_t nVariables{0};
+  double pixelArea{1.0};
+
+public:
+  // compartmentSpeciesIds: the species in each simulated compartment, in the
+  // same order as in the concentrations to be evaluated
+  ObservableEvaluator(
+      const model::Model &model, std::vector<Observable> observableDefinitions,
+      const std::vector<std::string> &compartmentIds,
+      const std::vector<std::vector<std::string>> &compartmentSpeciesIds);
+  [[nodiscard]] const std::vector<Observable> &getObservables() const;
+  // empty if the observable is valid and compiled, otherwise it always
+  // evaluates to NaN
+  [[nodiscard]] const std::string &
+  getErrorMessage(std::size_t observableIndex) const;
+  // value of each observable at this time, given concentrations with layout
+  // compartment->(ix, species+padding)
+  [[nodiscard]] std::vector<double>
+  evaluate(double time, const ConcentrationSnapshot &concentrations,
+           std::size_t concPadding) const;
+};
+
+} // namespace simulate
+
+} // namespace sme
@@ -6,6 +6,7 @@
 #include <cereal/cereal.hpp>
 #include <cereal/types/string.hpp>
 #include <cereal/types/utility.hpp>
+#include <cereal/types/vector.hpp>
 #include <cstddef>
 #include <limits>
 #include <optional>
@@ -90,6 +91,99 @@ struct Options {
   }
 };
 
+// a point, or a rectangular region of interest if width or height is
+// non-zero, in physical coordinates with (x, y) the bottom-left corner.
+// A point samples the compartment pixel that contains it, a region the
+// average over the compartment pixels with centres inside it
+struct Probe {
+  std::string name{};
+  std::string compartmentId{};
+  double x{0.0};
+  double y{0.0};
+  double width{0.0};
+  double height{0.0};
+
+  template <class Archive>
+  void serialize(Archive &ar, std::uint32_t const version) {
+    if (version == 0) {
+      ar(CEREAL_NVP(name), CEREAL_NVP(compartmentId), CEREAL_NVP(x),
+         CEREAL_NVP(y), CEREAL_NVP(width), CEREAL_NVP(height));
+    }
+  }
+};
+
+// probes are recorded at a finer cadence than the full-field snapshots
+struct ProbeOptions {
+  std::vector<Probe> probes{};
+  // time between samples, probes are not recorded if this is not positive
+  double interval{0.0};
+  // number of samples kept: once full, the oldest samples are overwritten
+  std::size_t capacity{65536};
+
+  template <class Archive>
+  void serialize(Archive &ar, std::uint32_t const version) {
+    if (version == 0) {
+      ar(CEREAL_NVP(probes), CEREAL_NVP(interval), CEREAL_NVP(capacity));
+    }
+  }
+};
+
+// which timepoints of the simulation history keep their full concentrations:
+// the statistics and observables of every timepoint are always kept
+struct RetentionPolicy {
+  // number of most recent timepoints that are always kept, zero to keep all
+  std::size_t keepLast{0};
+  // of the older timepoints, keep every n-th one, zero to keep none
+  std::size_t keepEvery{0};
+
+  template <class Archive>
+  void serialize(Archive &ar, std::uint32_t const version) {
+    if (version == 0) {
+      ar(CEREAL_NVP(keepLast), CEREAL_NVP(keepEvery));
+    }
+  }
+};
+
+// how the concentrations of each timepoint are stored, which is applied
+// when a new simulation is started
+struct StorageOptions {
+  // compress the stored concentrations, see ConcentrationStore
+  bool compress{false};
+  // max absolute error of compressed values, zero for lossless compression
+  double maxAbsError{0.0};
+  // store the concentrations in a temporary memory-mapped file, and keep
+  // only a few recently used timepoints in memory
+  bool useFile{false};
+
+  template <class Archive>
+  void serialize(Archive &ar, std::uint32_t const version) {
+    if (version == 0) {
+      ar(CEREAL_NVP(compress), CEREAL_NVP(maxAbsError));
+    } else if (version == 1) {
+      ar(CEREAL_NVP(compress), CEREAL_NVP(maxAbsError), CEREAL_NVP(useFile));
+    }
+  }
+};
+
+enum class ObservableReduction { Integral, Average, Min, Max };
+
+// a spatial observable, see ObservableEvaluator
+struct Observable {
+  std::string name;
+  std::string expression;
+  // compartments to reduce over, all compartments if empty
+  std::vector<std::string> compartmentIds{};
+  ObservableReduction reduction{ObservableReduction::Integral};
+
+  template <class Archive>
+  void serialize(Archive &ar, std::uint32_t const version) {
+    if (version == 0) {
+      ar(CEREAL_NVP(name), CEREAL_NVP(expression), CEREAL_NVP(compartmentIds),
+         CEREAL_NVP(reduction));
+    }
+  }
+};
+
 struct AvgMinMax {
   double avg = 0;
   double min = std::numeric_limits<double>::max();
@@ -111,4 +205,9 @@ CEREAL_CLASS_VERSION(sme::simulate::Options, 0);
 CEREAL_CLASS_VERSION(sme::simulate::DuneOptions, 0);
 CEREAL_CLASS_VERSION(sme::simulate::PixelIntegratorError, 0);
 CEREAL_CLASS_VERSION(sme::simulate::PixelOptions, 0);
+CEREAL_CLASS_VERSION(sme::simulate::Probe, 0);
+CEREAL_CLASS_VERSION(sme::simulate::ProbeOptions, 0);
+CEREAL_CLASS_VERSION(sme::simulate::RetentionPolicy, 0);
+CEREAL_CLASS_VERSION(sme::simulate::StorageOptions, 1);
+CEREAL_CLASS_VERSION(sme::simulate::Observable, 0);
 CEREAL_CLASS_VERSION(sme::simulate::AvgMinMax, 0);
@@ -0,0 +1,80 @@
+// Probe recorder
+//  - samples the concentrations of each species at a few points or regions
+//    of interest, at a finer cadence than the full-field snapshots
+//  - samples are stored in a fixed capacity ring buffer: once full, the
+//    oldest samples are overwritten
+//  - a single writer (the simulation thread) records samples while any
+//    number of readers copy the buffered samples
+
+#pragma once
+
+#include "simulate_options.hpp"
+#include <cstddef>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace sme {
+
+namespace model {
+class Model;
+}
+
+namespace simulate {
+
+struct ProbeSamples {
+  // "probe name/species id" for each column
+  std::vector<std::string> names{};
+  std::vector<double> times{};
+  // sample->column
+  std::vector<std::vector<double>> values{};
+  // number of older samples that were overwritten
+  std::size_t nOverwritten{0};
+};
+
+class ProbeRecorder {
+private:
+  struct Column {
+    std::size_t compartmentIndex;
+    std::size_t speciesIndex;
+    std::size_t nSpecies;
+    // pixels of the compartment covered by the probe, empty if invalid
+    const std::vector<std::size_t> *pixels;
+  };
+  std::vector<std::vector<std::size_t>> probePixels;
+  std::vector<Column> columns;
+  std::vector<std::string> names;
+  double interval;
+  std::size_t capacity;
+  mutable std::mutex mutex;
+  std::vector<double> times;
+  // sample->column, flattened
+  std::vector<double> values;
+  // index of the oldest sample once the buffer is full
+  std::size_t first{0};
+  std::size_t nOverwritten{0};
+
+public:
+  // compartmentSpeciesIds: the species in each simulated compartment, in the
+  // same order as in the concentrations to be recorded
+  ProbeRecorder(
+      const model::Model &model, const ProbeOptions &options,
+      const std::vector<std::string> &compartmentIds,
+      const std::vector<std::vector<std::string>> &compartmentSpeciesIds);
+  ProbeRecorder(const ProbeRecorder &) = delete;
+  ProbeRecorder &operator=(const ProbeRecorder &) = delete;
+  [[nodiscard]] double getInterval() const;
+  [[nodiscard]] const std::vector<std::string> &getNames() const;
+  // concentrations: compartment->(ix, species+padding)
+  void record(double time,
+              const std::vector<const std::vector<double> *> &concentrations,
+              std::size_t concPadding);
+  // copy of the buffered samples, oldest first
+  [[nodiscard]] ProbeSamples getSamples() const;
+  [[nodiscard]] std::size_t size() const;
+  void clear();
+};
+
+} // namespace simulate
+
+} // namespace sme
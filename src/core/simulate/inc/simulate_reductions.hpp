@@ -0,0 +1,93 @@
+// Reductions of species concentrations
+//  - per species sum, sum of squares, min and max of the concentrations in a
+//    compartment, from which avg/min/max, l2 norm and integral are obtained
+//  - optionally a quantile sketch, to estimate percentiles
+//  - partial reductions can be merged, so that they can be computed in
+//    parallel over blocks of pixels, which only depend on the number of
+//    pixels: the result doesn't depend on the number of threads
+
+#pragma once
+
+#include "simulate_options.hpp"
+#include <algorithm>
+#include <cstddef>
+#include <limits>
+#include <optional>
+#include <utility>
+#include <vector>
+
+namespace sme::simulate {
+
+// DDSketch: values are counted in logarithmically sized buckets, so that any
+// quantile is estimated with a relative error of at most relativeAccuracy
+class QuantileSketch {
+private:
+  struct Buckets {
+    int offset{0};
+    std::vector<std::size_t> counts{};
+    void add(int index, std::size_t count);
+  };
+  double relativeAccuracy;
+  double gamma;
+  double logGamma;
+  // buckets of the magnitudes of positive and negative values
+  Buckets positive{};
+  Buckets negative{};
+  std::size_t nZero{0};
+  std::size_t n{0};
+  [[nodiscard]] int getIndex(double magnitude) const;
+  [[nodiscard]] double getValue(int index) const;
+
+public:
+  explicit QuantileSketch(double relativeAccuracy = 0.01);
+  void add(double value);
+  // other must have the same relative accuracy
+  void merge(const QuantileSketch &other);
+  [[nodiscard]] double getRelativeAccuracy() const;
+  [[nodiscard]] std::size_t size() const;
+  // estimate of the q-quantile, q in [0,1], NaN if empty
+  [[nodiscard]] double getQuantile(double q) const;
+};
+
+struct SpeciesReduction {
+  std::size_t count{0};
+  double sum{0.0};
+  double sumSquares{0.0};
+  double min{std::numeric_limits<double>::max()};
+  double max{std::numeric_limits<double>::lowest()};
+  // only present if quantiles are estimated
+  std::optional<QuantileSketch> sketch{};
+
+  SpeciesReduction() = default;
+  // quantiles are estimated if quantileAccuracy is positive
+  explicit SpeciesReduction(double quantileAccuracy);
+  void add(double value) {
+    ++count;
+    sum += value;
+    sumSquares += value * value;
+    min = std::min(min, value);
+    max = std::max(max, value);
+    if (sketch.has_value()) {
+      sketch->add(value);
+    }
+  }
+  void merge(const SpeciesReduction &other);
+  // max is at least zero, as for the avg/min/max of previous versions
+  [[nodiscard]] AvgMinMax getAvgMinMax() const;
+  [[nodiscard]] double getL2Norm() const;
+  // integral over the compartment, given the area of a pixel
+  [[nodiscard]] double getIntegral(double pixelArea) const;
+  // NaN if quantiles are not estimated
+  [[nodiscard]] double getQuantile(double q) const;
+};
+
+// fixed blocks of items [begin, end) for a parallel reduction over n items
+[[nodiscard]] std::vector<std::pair<std::size_t, std::size_t>>
+getReductionBlocks(std::size_t n);
+
+// per species reductions of concentrations with layout (ix, species+padding)
+[[nodiscard]] std::vector<SpeciesReduction>
+reduceConcentrations(const std::vector<double> &concs, std::size_t nSpecies,
+                     std::size_t concPadding, double quantileAccuracy = 0.0);
+
+} // namespace sme::simulate
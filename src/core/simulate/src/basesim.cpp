@@ -1 +1,17 @@
 #include "basesim.hpp"
+
+namespace sme::simulate {
+
+void BaseSim::takeConcentrations(std::size_t compartmentIndex,
+                                 std::vector<double> &buffer) {
+  const auto &concentrations{getConcentrations(compartmentIndex)};
+  buffer.assign(concentrations.cbegin(), concentrations.cend());
+}
+
+bool BaseSim::takeReductions(std::size_t, std::vector<SpeciesReduction> &) {
+  return false;
+}
+
+void BaseSim::setQuantileAccuracy(double) {}
+
+} // namespace sme::simulate
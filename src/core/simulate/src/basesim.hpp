@@ -2,6 +2,7 @@
 
 #pragma once
 
+#include "simulate_reductions.hpp"
 #include <QImage>
 #include <string>
 #include <vector>
@@ -15,6 +16,17 @@ public:
                           const std::function<bool()> &stopRunningCallback) = 0;
   [[nodiscard]] virtual const std::vector<double> &
   getConcentrations(std::size_t compartmentIndex) const = 0;
+  // hand off the current concentrations to the caller:
+  // buffer may be swapped with an internal output buffer, in which case
+  // getConcentrations() is only valid again after the next call to run()
+  virtual void takeConcentrations(std::size_t compartmentIndex,
+                                  std::vector<double> &buffer);
+  // hand off per variable reductions of the current concentrations, if they
+  // were computed while integrating, otherwise returns false
+  virtual bool takeReductions(std::size_t compartmentIndex,
+                              std::vector<SpeciesReduction> &reductions);
+  // quantiles are estimated by reductions if relativeAccuracy is positive
+  virtual void setQuantileAccuracy(double relativeAccuracy);
   [[nodiscard]] virtual std::size_t getConcentrationPadding() const = 0;
   [[nodiscard]] virtual const std::string &errorMessage() const = 0;
   [[nodiscard]] virtual const QImage &errorImage() const = 0;
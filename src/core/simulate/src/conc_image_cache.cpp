@@ -0,0 +1,198 @@
+#include "conc_image_cache.hpp"
+#include "logger.hpp"
+#include <atomic>
+#include <chrono>
+#include <utility>
+
+namespace sme::simulate {
+
+ConcImageCache::ConcImageCache(Renderer imageRenderer,
+                               std::size_t maxCachedBytes,
+                               std::size_t nNeighboursToPrerender)
+    : renderer{std::move(imageRenderer)}, maxBytes{maxCachedBytes},
+      nNeighbours{nNeighboursToPrerender},
+      worker{&ConcImageCache::prerender, this} {}
+
+ConcImageCache::~ConcImageCache() {
+  {
+    std::scoped_lock lock{mutex};
+    stopRequested = true;
+    queue.clear();
+  }
+  queueChanged.notify_all();
+  worker.join();
+}
+
+void ConcImageCache::setRenderer(Renderer imageRenderer) {
+  std::unique_lock lock{mutex};
+  queue.clear();
+  // the previous renderer may refer to data that is about to be deleted
+  queueChanged.wait(lock, [this]() { return !isRendering; });
+  renderer = std::move(imageRenderer);
+  images.clear();
+  lru.clear();
+  nBytes = 0;
+  ++generation;
+}
+
+void ConcImageCache::invalidate() {
+  std::scoped_lock lock{mutex};
+  queue.clear();
+  images.clear();
+  lru.clear();
+  nBytes = 0;
+  ++generation;
+}
+
+QImage ConcImageCache::get(std::size_t timeIndex, std::size_t nTimepoints) {
+  std::unique_lock lock{mutex};
+  QImage image;
+  if (auto iter{images.find(timeIndex)}; iter != images.end()) {
+    lru.splice(lru.begin(), lru, iter->second.lruPosition);
+    image = iter->second.image;
+  } else if (renderer) {
+    SPDLOG_DEBUG("rendering timepoint {}", timeIndex);
+    auto render{renderer};
+    auto renderGeneration{generation};
+    lock.unlock();
+    image = render(timeIndex);
+    lock.lock();
+    if (renderGeneration == generation) {
+      insert(timeIndex, image);
+    }
+  }
+  // replace any outstanding requests with the neighbours of this timepoint
+  queue.clear();
+  for (std::size_t i = 1; i <= nNeighbours; ++i) {
+    if (timeIndex + i < nTimepoints) {
+      queue.push_back(timeIndex + i);
+    }
+    if (i <= timeIndex && timeIndex - i < nTimepoints) {
+      queue.push_back(timeIndex - i);
+    }
+  }
+  lock.unlock();
+  queueChanged.notify_all();
+  return image;
+}
+
+std::vector<QImage> ConcImageCache::getAll(std::size_t nTimepoints,
+                                           const Progress &progress) {
+  std::vector<QImage> allImages(nTimepoints);
+  std::vector<bool> cached(nTimepoints, false);
+  std::unique_lock lock{mutex};
+  for (std::size_t i = 0; i < nTimepoints; ++i) {
+    if (auto iter{images.find(i)}; iter != images.end()) {
+      allImages[i] = iter->second.image;
+      cached[i] = true;
+    }
+  }
+  if (!renderer) {
+    return allImages;
+  }
+  auto render{renderer};
+  auto renderGeneration{generation};
+  lock.unlock();
+  std::atomic<std::size_t> nDone{0};
+  std::atomic<bool> cancel{false};
+  std::thread thread([&]() {
+    for (std::size_t i = 0; i < nTimepoints && !cancel; ++i) {
+      if (!cached[i]) {
+        SPDLOG_DEBUG("rendering timepoint {}", i);
+        allImages[i] = render(i);
+      }
+      ++nDone;
+    }
+  });
+  constexpr std::chrono::milliseconds progressInterval{50};
+  while (nDone < nTimepoints) {
+    if (progress && !progress(nDone)) {
+      cancel = true;
+      break;
+    }
+    std::this_thread::sleep_for(progressInterval);
+  }
+  thread.join();
+  if (cancel) {
+    return {};
+  }
+  if (progress) {
+    progress(nTimepoints);
+  }
+  lock.lock();
+  if (renderGeneration == generation) {
+    for (std::size_t i = 0; i < nTimepoints; ++i) {
+      if (!cached[i]) {
+        insert(i, allImages[i]);
+      }
+    }
+  }
+  return allImages;
+}
+
+bool ConcImageCache::contains(std::size_t timeIndex) const {
+  std::scoped_lock lock{mutex};
+  return images.find(timeIndex) != images.end();
+}
+
+std::size_t ConcImageCache::size() const {
+  std::scoped_lock lock{mutex};
+  return images.size();
+}
+
+std::size_t ConcImageCache::sizeInBytes() const {
+  std::scoped_lock lock{mutex};
+  return nBytes;
+}
+
+void ConcImageCache::waitForPrerender() {
+  std::unique_lock lock{mutex};
+  queueChanged.wait(lock, [this]() { return queue.empty() && !isRendering; });
+}
+
+void ConcImageCache::insert(std::size_t timeIndex, const QImage &image) {
+  if (images.find(timeIndex) != images.end()) {
+    return;
+  }
+  lru.push_front(timeIndex);
+  images[timeIndex] = {image, lru.begin()};
+  nBytes += static_cast<std::size_t>(image.sizeInBytes());
+  // evict least recently used images, but always keep the newest one
+  while (nBytes > maxBytes && lru.size() > 1) {
+    auto iter{images.find(lru.back())};
+    nBytes -= static_cast<std::size_t>(iter->second.image.sizeInBytes());
+    images.erase(iter);
+    lru.pop_back();
+  }
+}
+
+void ConcImageCache::prerender() {
+  std::unique_lock lock{mutex};
+  while (true) {
+    queueChanged.wait(lock,
+                      [this]() { return !queue.empty() || stopRequested; });
+    if (stopRequested) {
+      return;
+    }
+    auto timeIndex{queue.front()};
+    queue.pop_front();
+    if (!renderer || images.find(timeIndex) != images.end()) {
+      queueChanged.notify_all();
+      continue;
+    }
+    auto render{renderer};
+    auto renderGeneration{generation};
+    isRendering = true;
+    lock.unlock();
+    SPDLOG_DEBUG("pre-rendering timepoint {}", timeIndex);
+    auto image{render(timeIndex)};
+    lock.lock();
+    if (renderGeneration == generation) {
+      insert(timeIndex, image);
+    }
+    isRendering = false;
+    queueChanged.notify_all();
+  }
+}
+
+} // namespace sme::simulate
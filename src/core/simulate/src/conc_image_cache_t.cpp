@@ -0,0 +1,134 @@
+#include "catch_wrapper.hpp"
+#include "conc_image_cache.hpp"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+using namespace sme;
+
+// 10x10 image filled with a colour that depends on the time index
+static QImage makeImage(std::size_t timeIndex, int offset = 0) {
+  QImage img(10, 10, QImage::Format_ARGB32_Premultiplied);
+  img.fill(qRgb(static_cast<int>(timeIndex) + offset, 0, 0));
+  return img;
+}
+
+TEST_CASE("ConcImageCache", "[core/simulate/conc_image_cache][core/"
+                            "simulate][core][conc_image_cache]") {
+  std::atomic<std::size_t> nRendered{0};
+  auto renderer{[&nRendered](std::size_t timeIndex) {
+    ++nRendered;
+    return makeImage(timeIndex);
+  }};
+  auto imageBytes{static_cast<std::size_t>(makeImage(0).sizeInBytes())};
+  SECTION("no renderer") {
+    simulate::ConcImageCache cache;
+    REQUIRE(cache.get(0, 1).isNull());
+    REQUIRE(cache.size() == 0);
+  }
+  SECTION("render on demand, no pre-rendering") {
+    simulate::ConcImageCache cache(renderer, 100 * imageBytes, 0);
+    REQUIRE(cache.size() == 0);
+    REQUIRE(!cache.contains(3));
+    REQUIRE(cache.get(3, 10).pixel(0, 0) == qRgb(3, 0, 0));
+    REQUIRE(nRendered == 1);
+    REQUIRE(cache.contains(3));
+    REQUIRE(cache.size() == 1);
+    REQUIRE(cache.sizeInBytes() == imageBytes);
+    // cached
+    REQUIRE(cache.get(3, 10).pixel(0, 0) == qRgb(3, 0, 0));
+    REQUIRE(nRendered == 1);
+    // invalidate
+    cache.invalidate();
+    REQUIRE(cache.size() == 0);
+    REQUIRE(cache.sizeInBytes() == 0);
+    REQUIRE(cache.get(3, 10).pixel(0, 0) == qRgb(3, 0, 0));
+    REQUIRE(nRendered == 2);
+  }
+  SECTION("least recently used images are evicted") {
+    simulate::ConcImageCache cache(renderer, 3 * imageBytes, 0);
+    for (std::size_t i = 0; i < 3; ++i) {
+      REQUIRE(cache.get(i, 10).pixel(0, 0) == qRgb(static_cast<int>(i), 0, 0));
+    }
+    REQUIRE(cache.size() == 3);
+    // use 0: 1 is now least recently used
+    REQUIRE(cache.get(0, 10).pixel(0, 0) == qRgb(0, 0, 0));
+    REQUIRE(cache.get(5, 10).pixel(0, 0) == qRgb(5, 0, 0));
+    REQUIRE(cache.size() == 3);
+    REQUIRE(cache.sizeInBytes() == 3 * imageBytes);
+    REQUIRE(cache.contains(0));
+    REQUIRE(!cache.contains(1));
+    REQUIRE(cache.contains(2));
+    REQUIRE(cache.contains(5));
+    REQUIRE(nRendered == 4);
+  }
+  SECTION("neighbouring timepoints are pre-rendered") {
+    simulate::ConcImageCache cache(renderer, 100 * imageBytes, 2);
+    REQUIRE(cache.get(5, 7).pixel(0, 0) == qRgb(5, 0, 0));
+    cache.waitForPrerender();
+    REQUIRE(cache.size() == 4);
+    REQUIRE(cache.contains(3));
+    REQUIRE(cache.contains(4));
+    REQUIRE(cache.contains(5));
+    REQUIRE(cache.contains(6));
+    REQUIRE(nRendered == 4);
+    REQUIRE(cache.get(6, 7).pixel(0, 0) == qRgb(6, 0, 0));
+    REQUIRE(nRendered == 4);
+    cache.waitForPrerender();
+    REQUIRE(nRendered == 4);
+    REQUIRE(cache.get(0, 7).pixel(0, 0) == qRgb(0, 0, 0));
+    cache.waitForPrerender();
+    REQUIRE(cache.contains(1));
+    REQUIRE(cache.contains(2));
+    REQUIRE(cache.size() == 7);
+  }
+  SECTION("all images at once") {
+    simulate::ConcImageCache cache(renderer, 100 * imageBytes, 0);
+    REQUIRE(cache.get(2, 10).pixel(0, 0) == qRgb(2, 0, 0));
+    REQUIRE(nRendered == 1);
+    std::vector<std::size_t> progress;
+    auto allImages{cache.getAll(5, [&progress](std::size_t nDone) {
+      progress.push_back(nDone);
+      return true;
+    })};
+    REQUIRE(allImages.size() == 5);
+    for (std::size_t i = 0; i < 5; ++i) {
+      REQUIRE(allImages[i].pixel(0, 0) == qRgb(static_cast<int>(i), 0, 0));
+    }
+    // cached image is re-used, others are rendered and cached
+    REQUIRE(nRendered == 5);
+    REQUIRE(cache.size() == 5);
+    REQUIRE(!progress.empty());
+    REQUIRE(std::is_sorted(progress.cbegin(), progress.cend()));
+    REQUIRE(progress.back() == 5);
+    REQUIRE(cache.getAll(5).size() == 5);
+    REQUIRE(nRendered == 5);
+  }
+  SECTION("all images at once, cancelled") {
+    auto slowRenderer{[&nRendered](std::size_t timeIndex) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+      ++nRendered;
+      return makeImage(timeIndex);
+    }};
+    simulate::ConcImageCache cache(slowRenderer, 100 * imageBytes, 0);
+    auto allImages{
+        cache.getAll(1000, [](std::size_t nDone) { return nDone > 1000; })};
+    REQUIRE(allImages.empty());
+    REQUIRE(cache.size() == 0);
+    REQUIRE(nRendered < 1000);
+  }
+  SECTION("new renderer invalidates cache") {
+    simulate::ConcImageCache cache(renderer, 100 * imageBytes, 2);
+    REQUIRE(cache.get(1, 10).pixel(0, 0) == qRgb(1, 0, 0));
+    cache.setRenderer([](std::size_t timeIndex) {
+      return makeImage(timeIndex, 100);
+    });
+    REQUIRE(cache.size() == 0);
+    REQUIRE(cache.get(1, 10).pixel(0, 0) == qRgb(101, 0, 0));
+    cache.waitForPrerender();
+    REQUIRE(cache.get(2, 10).pixel(0, 0) == qRgb(102, 0, 0));
+    REQUIRE(cache.get(0, 10).pixel(0, 0) == qRgb(100, 0, 0));
+  }
+}
@@ -0,0 +1,163 @@
+#include "conc_image_pyramid.hpp"
+#include "geometry.hpp"
+#include "logger.hpp"
+#include <algorithm>
+#include <utility>
+
+namespace sme::simulate {
+
+static QSize levelSize(const QSize &imageSize, int scale) {
+  return {(imageSize.width() + scale - 1) / scale,
+          (imageSize.height() + scale - 1) / scale};
+}
+
+static int maxDimension(const QSize &size) {
+  return std::max(size.width(), size.height());
+}
+
+ConcImagePyramid::ConcImagePyramid(
+    const QSize &imageSize,
+    const std::vector<const geometry::Compartment *> &comps,
+    std::vector<std::size_t> compartmentNSpecies, int maxLevelSize,
+    int minLevelSize, std::size_t maxCachedBytes)
+    : nSpecies{std::move(compartmentNSpecies)}, maxBytes{maxCachedBytes} {
+  if (maxDimension(imageSize) <= maxLevelSize) {
+    // image is small enough to be used directly
+    return;
+  }
+  int scale{2};
+  while (maxDimension(levelSize(imageSize, scale)) > maxLevelSize) {
+    scale *= 2;
+  }
+  while (true) {
+    auto &level{levels.emplace_back()};
+    level.size = levelSize(imageSize, scale);
+    level.scale = scale;
+    level.pixels.resize(comps.size());
+    SPDLOG_INFO("Image pyramid level {}: {}x{}", levels.size() - 1,
+                level.size.width(), level.size.height());
+    if (maxDimension(level.size) <= minLevelSize) {
+      break;
+    }
+    scale *= 2;
+  }
+  // each level is a subset of the pixels of the previous level
+  for (std::size_t ic = 0; ic < comps.size(); ++ic) {
+    const auto &pixels{comps[ic]->getPixels()};
+    for (std::size_t ix = 0; ix < pixels.size(); ++ix) {
+      const auto &p{pixels[ix]};
+      for (auto &level : levels) {
+        if (p.x() % level.scale != 0 || p.y() % level.scale != 0) {
+          break;
+        }
+        level.pixels[ic].push_back(
+            {QPoint(p.x() / level.scale, p.y() / level.scale), ix});
+      }
+    }
+  }
+}
+
+std::size_t ConcImagePyramid::nLevels() const { return levels.size(); }
+
+const ConcImagePyramid::Level &
+ConcImagePyramid::getLevel(std::size_t levelIndex) const {
+  return levels[levelIndex];
+}
+
+std::size_t ConcImagePyramid::findLevel(const QSize &size) const {
+  auto iter{std::find_if(levels.crbegin(), levels.crend(),
+                         [&size](const Level &level) {
+                           return level.size.width() >= size.width() &&
+                                  level.size.height() >= size.height();
+                         })};
+  if (iter == levels.crend()) {
+    return levels.size();
+  }
+  return static_cast<std::size_t>(std::distance(iter, levels.crend())) - 1;
+}
+
+std::shared_ptr<const ConcImagePyramid::Concentrations>
+ConcImagePyramid::add(std::size_t timeIndex,
+                      const ConcentrationSnapshot &concentration,
+                      std::size_t concPadding) {
+  if (levels.empty()) {
+    return nullptr;
+  }
+  auto concs{std::make_shared<Concentrations>(levels.size())};
+  std::size_t n{0};
+  for (std::size_t il = 0; il < levels.size(); ++il) {
+    auto &levelConcs{(*concs)[il]};
+    levelConcs.resize(nSpecies.size());
+    for (std::size_t ic = 0; ic < nSpecies.size(); ++ic) {
+      const auto &pixels{levels[il].pixels[ic]};
+      const auto &c{concentration[ic]};
+      auto ns{nSpecies[ic]};
+      auto stride{ns + concPadding};
+      auto &lc{levelConcs[ic]};
+      lc.reserve(pixels.size() * ns);
+      for (const auto &pixel : pixels) {
+        for (std::size_t is = 0; is < ns; ++is) {
+          lc.push_back(static_cast<float>(c[pixel.pixelIndex * stride + is]));
+        }
+      }
+      n += lc.size() * sizeof(float);
+    }
+  }
+  std::scoped_lock lock{mutex};
+  if (auto iter{timepoints.find(timeIndex)}; iter != timepoints.end()) {
+    nBytes -= iter->second.nBytes;
+    lru.erase(iter->second.lruPosition);
+    timepoints.erase(iter);
+  }
+  lru.push_front(timeIndex);
+  timepoints[timeIndex] = {concs, n, lru.begin()};
+  nBytes += n;
+  // evict least recently used timepoints, but always keep the newest one
+  while (nBytes > maxBytes && lru.size() > 1) {
+    auto iter{timepoints.find(lru.back())};
+    SPDLOG_TRACE("evicting timepoint {}", lru.back());
+    nBytes -= iter->second.nBytes;
+    timepoints.erase(iter);
+    lru.pop_back();
+  }
+  return concs;
+}
+
+std::shared_ptr<const ConcImagePyramid::Concentrations>
+ConcImagePyramid::get(std::size_t timeIndex) {
+  std::scoped_lock lock{mutex};
+  auto iter{timepoints.find(timeIndex)};
+  if (iter == timepoints.end()) {
+    return nullptr;
+  }
+  lru.splice(lru.begin(), lru, iter->second.lruPosition);
+  return iter->second.concentrations;
+}
+
+void ConcImagePyramid::remove(std::size_t timeIndex) {
+  std::scoped_lock lock{mutex};
+  if (auto iter{timepoints.find(timeIndex)}; iter != timepoints.end()) {
+    nBytes -= iter->second.nBytes;
+    lru.erase(iter->second.lruPosition);
+    timepoints.erase(iter);
+  }
+}
+
+void ConcImagePyramid::clear() {
+  std::scoped_lock lock{mutex};
+  timepoints.clear();
+  lru.clear();
+  nBytes = 0;
+}
+
+std::size_t ConcImagePyramid::size() const {
+  std::scoped_lock lock{mutex};
+  return timepoints.size();
+}
+
+std::size_t ConcImagePyramid::sizeInBytes() const {
+  std::scoped_lock lock{mutex};
+  return nBytes;
+}
+
+} // namespace sme::simulate
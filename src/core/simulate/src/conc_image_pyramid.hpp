@@ -0,0 +1,94 @@
+// Concentration image pyramid
+//  - downsampled concentrations for fast previews of large images
+//  - each level has half the width and height of the previous level
+//  - a pixel in a level samples the image pixel at its top-left corner,
+//    as done when an image is displayed scaled down without interpolation
+//  - only levels between minLevelSize and maxLevelSize pixels in the
+//    largest dimension are stored, and only for images larger than that
+//  - levels for a timepoint are computed when it is first displayed,
+//    stored as float
+//  - least recently used timepoints are evicted once the total size of the
+//    stored levels exceeds a limit
+
+#pragma once
+
+#include "simulate_data_store.hpp"
+#include <QPoint>
+#include <QSize>
+#include <cstddef>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+namespace sme {
+
+namespace geometry {
+class Compartment;
+}
+
+namespace simulate {
+
+class ConcImagePyramid {
+public:
+  struct LevelPixel {
+    QPoint point;
+    // index of sampled pixel in compartment
+    std::size_t pixelIndex;
+  };
+  struct Level {
+    QSize size;
+    // number of image pixels per level pixel in each direction
+    int scale;
+    // compartment->pixels
+    std::vector<std::vector<LevelPixel>> pixels;
+  };
+  // level->compartment->(level pixel->species) concentrations
+  using Concentrations = std::vector<std::vector<std::vector<float>>>;
+
+private:
+  struct CachedConcentrations {
+    std::shared_ptr<const Concentrations> concentrations;
+    std::size_t nBytes;
+    std::list<std::size_t>::iterator lruPosition;
+  };
+  std::vector<Level> levels;
+  std::vector<std::size_t> nSpecies;
+  std::size_t maxBytes;
+  mutable std::mutex mutex{};
+  std::unordered_map<std::size_t, CachedConcentrations> timepoints{};
+  // most recently used first
+  std::list<std::size_t> lru{};
+  std::size_t nBytes{0};
+
+public:
+  ConcImagePyramid(const QSize &imageSize,
+                   const std::vector<const geometry::Compartment *> &comps,
+                   std::vector<std::size_t> compartmentNSpecies,
+                   int maxLevelSize = 1024, int minLevelSize = 64,
+                   std::size_t maxCachedBytes = 64 * 1024 * 1024);
+  [[nodiscard]] std::size_t nLevels() const;
+  [[nodiscard]] const Level &getLevel(std::size_t levelIndex) const;
+  // smallest level that is at least as large as size in both dimensions,
+  // or nLevels() if no level is large enough
+  [[nodiscard]] std::size_t findLevel(const QSize &size) const;
+  // returns the added levels, nullptr if there are no levels
+  std::shared_ptr<const Concentrations>
+  add(std::size_t timeIndex, const ConcentrationSnapshot &concentration,
+      std::size_t concPadding);
+  // nullptr if this timepoint has not been added or has been evicted
+  [[nodiscard]] std::shared_ptr<const Concentrations>
+  get(std::size_t timeIndex);
+  // e.g. if the concentrations of the timepoint have changed or been removed
+  void remove(std::size_t timeIndex);
+  void clear();
+  // number of stored timepoints
+  [[nodiscard]] std::size_t size() const;
+  // total size of stored levels in bytes
+  [[nodiscard]] std::size_t sizeInBytes() const;
+};
+
+} // namespace simulate
+
+} // namespace sme
@@ -0,0 +1,106 @@
+#include "catch_wrapper.hpp"
+#include "conc_image_pyramid.hpp"
+#include "geometry.hpp"
+
+using namespace sme;
+
+TEST_CASE("ConcImagePyramid", "[core/simulate/conc_image_pyramid][core/"
+                              "simulate][core][conc_image_pyramid]") {
+  // 40x20 image: compartment 0 is x < 20, compartment 1 is x >= 20
+  QImage img(40, 20, QImage::Format_RGB32);
+  auto col0{qRgb(0, 0, 0)};
+  auto col1{qRgb(255, 255, 255)};
+  img.fill(col0);
+  for (int x = 20; x < 40; ++x) {
+    for (int y = 0; y < 20; ++y) {
+      img.setPixel(x, y, col1);
+    }
+  }
+  geometry::Compartment comp0("c0", img, col0);
+  geometry::Compartment comp1("c1", img, col1);
+  std::vector<const geometry::Compartment *> comps{&comp0, &comp1};
+  // compartment 0: 1 species, compartment 1: 2 species, concentration is
+  // x + 100 * y + 1000 * species index
+  simulate::ConcentrationSnapshot conc(2);
+  for (const auto &p : comp0.getPixels()) {
+    conc[0].push_back(p.x() + 100.0 * p.y());
+  }
+  for (const auto &p : comp1.getPixels()) {
+    conc[1].push_back(p.x() + 100.0 * p.y());
+    conc[1].push_back(p.x() + 100.0 * p.y() + 1000.0);
+  }
+  SECTION("small image: no levels") {
+    simulate::ConcImagePyramid pyramid(img.size(), comps, {1, 2}, 40, 4);
+    REQUIRE(pyramid.nLevels() == 0);
+    REQUIRE(pyramid.findLevel({10, 10}) == 0);
+    pyramid.add(0, conc, 0);
+    REQUIRE(pyramid.get(0) == nullptr);
+  }
+  SECTION("levels") {
+    simulate::ConcImagePyramid pyramid(img.size(), comps, {1, 2}, 16, 4);
+    REQUIRE(pyramid.nLevels() == 3);
+    REQUIRE(pyramid.getLevel(0).size == QSize(10, 5));
+    REQUIRE(pyramid.getLevel(0).scale == 4);
+    REQUIRE(pyramid.getLevel(1).size == QSize(5, 3));
+    REQUIRE(pyramid.getLevel(1).scale == 8);
+    REQUIRE(pyramid.getLevel(2).size == QSize(3, 2));
+    REQUIRE(pyramid.getLevel(2).scale == 16);
+    // smallest level that is at least as large as display size
+    REQUIRE(pyramid.findLevel({1, 1}) == 2);
+    REQUIRE(pyramid.findLevel({3, 2}) == 2);
+    REQUIRE(pyramid.findLevel({4, 2}) == 1);
+    REQUIRE(pyramid.findLevel({10, 5}) == 0);
+    REQUIRE(pyramid.findLevel({10, 6}) == 3);
+    REQUIRE(pyramid.findLevel({100, 100}) == 3);
+    // each level pixel samples the image pixel at its top-left corner
+    const auto &level1{pyramid.getLevel(1)};
+    REQUIRE(level1.pixels[0].size() == 9);
+    REQUIRE(level1.pixels[1].size() == 6);
+    for (std::size_t ic = 0; ic < 2; ++ic) {
+      for (const auto &pixel : level1.pixels[ic]) {
+        REQUIRE(comps[ic]->getPixel(pixel.pixelIndex) == pixel.point * 8);
+      }
+    }
+    REQUIRE(pyramid.get(0) == nullptr);
+    pyramid.add(1, conc, 0);
+    REQUIRE(pyramid.get(0) == nullptr);
+    auto levels{pyramid.get(1)};
+    REQUIRE(levels != nullptr);
+    REQUIRE(levels->size() == 3);
+    for (std::size_t il = 0; il < 3; ++il) {
+      const auto &level{pyramid.getLevel(il)};
+      const auto &c{(*levels)[il]};
+      REQUIRE(c[0].size() == level.pixels[0].size());
+      REQUIRE(c[1].size() == 2 * level.pixels[1].size());
+      for (std::size_t i = 0; i < level.pixels[1].size(); ++i) {
+        auto p{level.pixels[1][i].point * level.scale};
+        auto expected{static_cast<float>(p.x() + 100 * p.y())};
+        REQUIRE(c[1][2 * i] == Catch::Approx(expected));
+        REQUIRE(c[1][2 * i + 1] == Catch::Approx(expected + 1000.0f));
+      }
+    }
+    pyramid.clear();
+    REQUIRE(pyramid.get(1) == nullptr);
+    REQUIRE(pyramid.size() == 0);
+    REQUIRE(pyramid.sizeInBytes() == 0);
+  }
+  SECTION("least recently used timepoints are evicted") {
+    // 104 floats per timepoint: room for two timepoints
+    simulate::ConcImagePyramid pyramid(img.size(), comps, {1, 2}, 16, 4,
+                                       1000);
+    REQUIRE(pyramid.add(0, conc, 0) != nullptr);
+    REQUIRE(pyramid.sizeInBytes() == 104 * sizeof(float));
+    pyramid.add(1, conc, 0);
+    REQUIRE(pyramid.size() == 2);
+    REQUIRE(pyramid.get(0) != nullptr);
+    pyramid.add(2, conc, 0);
+    REQUIRE(pyramid.size() == 2);
+    REQUIRE(pyramid.get(0) != nullptr);
+    REQUIRE(pyramid.get(1) == nullptr);
+    REQUIRE(pyramid.get(2) != nullptr);
+    pyramid.remove(2);
+    REQUIRE(pyramid.get(2) == nullptr);
+    REQUIRE(pyramid.size() == 1);
+    REQUIRE(pyramid.sizeInBytes() == 104 * sizeof(float));
+  }
+}
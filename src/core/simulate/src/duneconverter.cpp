@@ -84,6 +84,31 @@ static void addWriter(IniFile &ini) {
   ini.addValue("file_path", "vtk");
 }
 
+// sparse reaction term jacobian: only structurally non-zero entries are
+// differentiated, but dune-copasi expects a value for every species pair, so
+// the remaining entries are written as zero
+static void addJacobian(IniFile &ini, const Pde &pde,
+                        const std::vector<std::string> &rowNames,
+                        const std::vector<std::string> &colNames) {
+  const auto &pattern{pde.getJacobianPattern()};
+  const auto &jacobian{pde.getJacobian()};
+  for (std::size_t i = 0; i < rowNames.size(); ++i) {
+    std::size_t nNonZero{pattern[i].size()};
+    SPDLOG_TRACE("  - d{}: {}/{} non-zero entries", rowNames[i], nNonZero,
+                 colNames.size());
+    for (std::size_t j = 0; j < colNames.size(); ++j) {
+      QString lhs =
+          QString("d%1__d%2").arg(rowNames[i].c_str(), colNames[j].c_str());
+      if (std::find(pattern[i].cbegin(), pattern[i].cend(), j) ==
+          pattern[i].cend()) {
+        ini.addValue(lhs, "0");
+      } else {
+        ini.addValue(lhs, jacobian[i][j].c_str());
+      }
+    }
+  }
+}
+
 static void addCompartment(
     IniFile &ini, const model::Model &model,
     const std::map<std::string, double, std::less<>> &substitutions,
@@ -187,6 +212,7 @@ static void addCompartment(
       if (const auto &simConcs{model.getSimulationData().concentration};
           simConcs.size() > 1) {
         // use concentrations from existing simulation data
+        auto lastConcs{simConcs.back()};
         auto simField{*f};
         const std::size_t nPixels{f->getCompartment()->nPixels()};
         const std::size_t padding{model.getSimulationData().concPadding.back()};
@@ -198,7 +224,7 @@ static void addCompartment(
         SPDLOG_INFO("- species dune index {}", indices[i]);
         for (std::size_t iPixel = 0; iPixel < nPixels; ++iPixel) {
           c[iPixel] =
-              simConcs.back()[simDataCompartmentIndex][iPixel * stride + i];
+              (*lastConcs)[simDataCompartmentIndex][iPixel * stride + i];
         }
         simField.setConcentration(c);
         concs[indices[i]] = simField.getConcentrationImageArray();
@@ -242,15 +268,7 @@ static void addCompartment(
 
   // reaction term jacobian
   ini.addSection("model", compartmentId, "reaction.jacobian");
-  for (std::size_t i = 0; i < nSpecies; ++i) {
-    for (std::size_t j = 0; j < nSpecies; ++j) {
-      QString lhs =
-          QString("d%1__d%2")
-              .arg(duneSpeciesNames[i].c_str(), duneSpeciesNames[j].c_str());
-      QString rhs = pde.getJacobian()[i][j].c_str();
-      ini.addValue(lhs, rhs);
-    }
-  }
+  addJacobian(ini, pde, duneSpeciesNames, duneSpeciesNames);
 
   // diffusion coefficients
   ini.addSection("model", compartmentId, "diffusion");
@@ -306,15 +324,7 @@ static void addCompartment(
       // reaction term jacobian
       ini.addSection("model", compartmentId, "boundary", otherCompId, "outflow",
                      "jacobian");
-      for (std::size_t i = 0; i < nSpecies; ++i) {
-        for (std::size_t j = 0; j < mDuneSpecies.size(); ++j) {
-          QString lhs =
-              QString("d%1__d%2")
-                  .arg(duneSpeciesNames[i].c_str(), mDuneSpecies[j].c_str());
-          QString rhs = pdeBcs.getJacobian()[i][j].c_str();
-          ini.addValue(lhs, rhs);
-        }
-      }
+      addJacobian(ini, pdeBcs, duneSpeciesNames, mDuneSpecies);
     }
   }
 }
@@ -11,18 +11,33 @@
 #include "model.hpp"
 #include "model_compartments.hpp"
 #include "model_geometry.hpp"
+#include "parallel_for.hpp"
 #include "utils.hpp"
 #include <QElapsedTimer>
 #include <QFile>
 #include <QImage>
 #include <QPainter>
 #include <algorithm>
+#include <cmath>
+#include <limits>
+#include <mutex>
 #include <numeric>
+#include <utility>
 
 using QTriangleF = std::array<QPointF, 3>;
 
 namespace sme::simulate {
 
+// corners of the DUNE reference triangle
+constexpr std::array<std::array<double, 2>, 3> referenceCorners{
+    {{0.0, 0.0}, {1.0, 0.0}, {0.0, 1.0}}};
+
+// first order (P1) basis functions of the reference triangle at a local
+// point, in the same order as the corners
+static std::array<double, 3> getP1Weights(const std::array<double, 2> &p) {
+  return {1.0 - p[0] - p[1], p[0], p[1]};
+}
+
 void DuneSim::initDuneSimCompartments(
 
     const std::vector<const geometry::Compartment *> &comps) {
@@ -83,47 +98,154 @@ void DuneSim::initDuneSimCompartments(
   }
 }
 
-static std::pair<QPoint, QPoint> getBoundingBox(const QTriangleF &t,
-                                                double pixelSize,
-                                                const QPointF &pixelOrigin) {
-  // get triangle bounding box in physical units
-  QPointF fmin(t[0].x(), t[0].y());
-  QPointF fmax = fmin;
-  for (std::size_t i = 1; i < 3; ++i) {
-    fmin.setX(std::min(fmin.x(), t[i].x()));
-    fmax.setX(std::max(fmax.x(), t[i].x()));
-    fmin.setY(std::min(fmin.y(), t[i].y()));
-    fmax.setY(std::max(fmax.y(), t[i].y()));
+// pixels whose centres lie inside the triangle, with their local coords
+static std::vector<PixelLocalPair>
+rasteriseTriangle(const QTriangleF &t, double pixelSize,
+                  const QPointF &pixelOrigin, int imageHeight,
+                  const common::QPointIndexer &qpi) {
+  // tolerance for pixel centres that lie on an edge of the triangle
+  constexpr double eps{1e-10};
+  std::vector<PixelLocalPair> pixels;
+  // corners in units of pixels: local coords are unchanged by this
+  std::array<QPointF, 3> p;
+  for (std::size_t i = 0; i < 3; ++i) {
+    p[i] = (t[i] - pixelOrigin) / pixelSize;
+  }
+  QPointF e1{p[1] - p[0]};
+  QPointF e2{p[2] - p[0]};
+  double det{e1.x() * e2.y() - e1.y() * e2.x()};
+  if (std::abs(det) < eps) {
+    return pixels;
   }
-  // convert physical points to pixel locations
-  fmin -= pixelOrigin;
-  fmin /= pixelSize;
-  fmax -= pixelOrigin;
-  fmax /= pixelSize;
-  return std::make_pair<QPoint, QPoint>(
-      QPoint(static_cast<int>(fmin.x()), static_cast<int>(fmin.y())),
-      QPoint(static_cast<int>(fmax.x()), static_cast<int>(fmax.y())));
+  auto [yMin, yMax] = std::minmax({p[0].y(), p[1].y(), p[2].y()});
+  // scan each row of pixel centres that may intersect the triangle
+  auto yBegin{static_cast<int>(std::floor(yMin - 0.5))};
+  auto yEnd{static_cast<int>(std::ceil(yMax - 0.5))};
+  for (int y = yBegin; y <= yEnd; ++y) {
+    double yc{static_cast<double>(y) + 0.5};
+    // x range of the intersection of this row with the triangle edges
+    double xMin{std::numeric_limits<double>::max()};
+    double xMax{std::numeric_limits<double>::lowest()};
+    for (std::size_t i = 0; i < 3; ++i) {
+      const auto &a{p[i]};
+      const auto &b{p[(i + 1) % 3]};
+      if (yc < std::min(a.y(), b.y()) - eps ||
+          yc > std::max(a.y(), b.y()) + eps) {
+        continue;
+      }
+      if (a.y() == b.y()) {
+        // horizontal edge along this row
+        xMin = std::min({xMin, a.x(), b.x()});
+        xMax = std::max({xMax, a.x(), b.x()});
+        continue;
+      }
+      double f{std::clamp((yc - a.y()) / (b.y() - a.y()), 0.0, 1.0)};
+      double x{a.x() + f * (b.x() - a.x())};
+      xMin = std::min(xMin, x);
+      xMax = std::max(xMax, x);
+    }
+    if (xMin > xMax) {
+      continue;
+    }
+    auto xBegin{static_cast<int>(std::floor(xMin - 0.5))};
+    auto xEnd{static_cast<int>(std::ceil(xMax - 0.5))};
+    for (int x = xBegin; x <= xEnd; ++x) {
+      QPointF d{static_cast<double>(x) + 0.5 - p[0].x(), yc - p[0].y()};
+      std::array<double, 2> local{(d.x() * e2.y() - d.y() * e2.x()) / det,
+                                  (e1.x() * d.y() - e1.y() * d.x()) / det};
+      if (local[0] < -eps || local[1] < -eps ||
+          local[0] + local[1] > 1.0 + eps) {
+        continue;
+      }
+      // note: qpi/QImage has (0,0) in top-left corner:
+      if (auto ix{qpi.getIndex(QPoint(x, imageHeight - 1 - y))};
+          ix.has_value()) {
+        pixels.push_back({*ix, local});
+      }
+    }
+  }
+  return pixels;
 }
 
-static std::size_t getIxValidNeighbour(std::size_t ix,
-                                       const std::vector<bool> &ixValid,
-                                       const geometry::Compartment *g) {
-  std::vector<std::size_t> queue{ix};
-  std::size_t queueIndex = 0;
-  // return nearest neighbour if valid, otherwise add to queue
-  for (std::size_t iter = 0; iter < 10 * ixValid.size(); ++iter) {
-    std::size_t i = queue[queueIndex];
+// nearest pixel that is inside a triangle for each pixel that is not,
+// found with a single breadth-first search from all pixels inside triangles
+static std::vector<std::pair<std::size_t, std::size_t>>
+getMissingPixels(const std::vector<bool> &ixAssigned,
+                 const geometry::Compartment *g) {
+  constexpr std::size_t noPixel{std::numeric_limits<std::size_t>::max()};
+  std::vector<std::pair<std::size_t, std::size_t>> missingPixels;
+  std::vector<std::size_t> nearest(ixAssigned.size(), noPixel);
+  std::vector<std::size_t> queue;
+  queue.reserve(ixAssigned.size());
+  for (std::size_t ix = 0; ix < ixAssigned.size(); ++ix) {
+    if (ixAssigned[ix]) {
+      nearest[ix] = ix;
+      queue.push_back(ix);
+    }
+  }
+  if (queue.size() == ixAssigned.size()) {
+    return missingPixels;
+  }
+  for (std::size_t queueIndex = 0; queueIndex < queue.size(); ++queueIndex) {
+    std::size_t i{queue[queueIndex]};
     for (auto iy : {g->up_x(i), g->dn_x(i), g->up_y(i), g->dn_y(i)}) {
-      if (ixValid[iy]) {
-        return iy;
-      } else {
+      if (nearest[iy] == noPixel) {
+        nearest[iy] = nearest[i];
         queue.push_back(iy);
       }
     }
-    ++queueIndex;
   }
-  SPDLOG_WARN("Failed to find valid neighbour of pixel {}", ix);
-  return 0;
+  for (std::size_t ix = 0; ix < ixAssigned.size(); ++ix) {
+    if (ixAssigned[ix]) {
+      continue;
+    }
+    SPDLOG_DEBUG("pixel {} not in a triangle", ix);
+    if (nearest[ix] == noPixel) {
+      SPDLOG_WARN("Failed to find valid neighbour of pixel {}", ix);
+      nearest[ix] = 0;
+    }
+    SPDLOG_DEBUG("  -> using concentration from pixel {}", nearest[ix]);
+    missingPixels.push_back({ix, nearest[ix]});
+  }
+  return missingPixels;
+}
+
+// each pixel is interpolated from the vertices of the last triangle that
+// contains it, and each missing pixel in the same way as its neighbour
+static DuneInterpolationMatrix makeInterpolationMatrix(
+    const DuneSimCompartment &comp, std::size_t nPixels,
+    const std::vector<std::array<std::size_t, 3>> &triangleVertices) {
+  constexpr std::size_t noTriangle{std::numeric_limits<std::size_t>::max()};
+  std::vector<std::size_t> pixelTriangles(nPixels, noTriangle);
+  std::vector<std::array<double, 2>> pixelPoints(nPixels);
+  for (std::size_t iTriangle = 0; iTriangle < comp.pixels.size();
+       ++iTriangle) {
+    for (const auto &[ix, point] : comp.pixels[iTriangle]) {
+      pixelTriangles[ix] = iTriangle;
+      pixelPoints[ix] = point;
+    }
+  }
+  for (const auto &[ixMissing, ixNeighbour] : comp.missingPixels) {
+    pixelTriangles[ixMissing] = pixelTriangles[ixNeighbour];
+    pixelPoints[ixMissing] = pixelPoints[ixNeighbour];
+  }
+  DuneInterpolationMatrix m;
+  m.rowOffsets.reserve(nPixels + 1);
+  m.columns.reserve(3 * nPixels);
+  m.weights.reserve(3 * nPixels);
+  m.rowOffsets.push_back(0);
+  for (std::size_t ix = 0; ix < nPixels; ++ix) {
+    if (pixelTriangles[ix] != noTriangle) {
+      auto weights{getP1Weights(pixelPoints[ix])};
+      const auto &vertices{triangleVertices[pixelTriangles[ix]]};
+      for (std::size_t i = 0; i < 3; ++i) {
+        m.columns.push_back(vertices[i]);
+        m.weights.push_back(weights[i]);
+      }
+    }
+    m.rowOffsets.push_back(m.columns.size());
+  }
+  return m;
 }
 
 void DuneSim::updatePixels() {
@@ -131,54 +253,58 @@ void DuneSim::updatePixels() {
   for (auto &comp : duneCompartments) {
     comp.pixels.clear();
     comp.missingPixels.clear();
+    comp.vertexCorners.clear();
     const auto &gridview{
         pDuneImpl->grid->subDomain(static_cast<int>(comp.index))
             .leafGridView()};
     SPDLOG_TRACE("compartment[{}]: {}", comp.index, comp.name);
     const auto &qpi{comp.qPointIndexer};
     std::vector<bool> ixAssigned(qpi.getNumPoints(), false);
-    // get local coord for each pixel in each triangle
+    const auto &indexSet{gridview.indexSet()};
+    auto nVertices{static_cast<std::size_t>(gridview.size(2))};
+    std::vector<bool> vertexAssigned(nVertices, false);
+    std::vector<std::array<std::size_t, 3>> triangleVertices;
+    comp.vertexValues.assign(nVertices * comp.speciesIndices.size(), 0.0);
+    std::vector<QTriangleF> triangles;
     for (const auto e : elements(gridview)) {
-      auto &pixelsTriangle = comp.pixels.emplace_back();
+      auto &vertices{triangleVertices.emplace_back()};
+      auto &corners{comp.vertexCorners.emplace_back()};
+      for (int i = 0; i < 3; ++i) {
+        auto iv{static_cast<std::size_t>(indexSet.subIndex(e, i, 2))};
+        vertices[static_cast<std::size_t>(i)] = iv;
+        if (!vertexAssigned[iv]) {
+          vertexAssigned[iv] = true;
+          corners.push_back({i, iv});
+        }
+      }
       const auto &geo = e.geometry();
       assert(geo.type().isTriangle());
-      auto ref = Dune::referenceElement(geo);
-      QPointF c0(geo.corner(0)[0], geo.corner(0)[1]);
-      QPointF c1(geo.corner(1)[0], geo.corner(1)[1]);
-      QPointF c2(geo.corner(2)[0], geo.corner(2)[1]);
-      auto [pMin, pMax] =
-          getBoundingBox({{c0, c1, c2}}, pixelSize, pixelOrigin);
-      SPDLOG_TRACE("  - bounding box ({},{}) - ({},{})", pMin.x(), pMin.y(),
-                   pMax.x(), pMax.y());
-      for (int x = pMin.x(); x < pMax.x() + 1; ++x) {
-        for (int y = pMin.y(); y < pMax.y() + 1; ++y) {
-          auto localPoint = e.geometry().local(
-              {(static_cast<double>(x) + 0.5) * pixelSize + pixelOrigin.x(),
-               (static_cast<double>(y) + 0.5) * pixelSize + pixelOrigin.y()});
-          // note: qpi/QImage has (0,0) in top-left corner:
-          QPoint pix = QPoint(x, geometryImageSize.height() - 1 - y);
-          if (auto ix{qpi.getIndex(pix)};
-              ix.has_value() && ref.checkInside(localPoint)) {
-            pixelsTriangle.push_back({*ix, {localPoint[0], localPoint[1]}});
-            ixAssigned[*ix] = true;
-          }
-        }
+      auto &t{triangles.emplace_back()};
+      for (int i = 0; i < 3; ++i) {
+        t[static_cast<std::size_t>(i)] = {geo.corner(i)[0], geo.corner(i)[1]};
+      }
+    }
+    // get local coord for each pixel in each triangle
+    comp.pixels.resize(triangles.size());
+    common::parallelFor(triangles.size(), [&](std::size_t iTriangle) {
+      comp.pixels[iTriangle] =
+          rasteriseTriangle(triangles[iTriangle], pixelSize, pixelOrigin,
+                            geometryImageSize.height(), qpi);
+    });
+    for (const auto &pixelsTriangle : comp.pixels) {
+      for (const auto &pixel : pixelsTriangle) {
+        ixAssigned[pixel.first] = true;
       }
-      SPDLOG_TRACE("    - found {} pixels", pixelsTriangle.size());
     }
     // Deal with pixels that fell outside of mesh (either in a membrane, or
     // where the mesh boundary differs a little from the pixel boundary).
     // For now we just set the value to the nearest pixel from the same
     // compartment which does lie inside a triangle
-    for (std::size_t ix = 0; ix < ixAssigned.size(); ++ix) {
-      if (!ixAssigned[ix]) {
-        SPDLOG_DEBUG("pixel {} not in a triangle", ix);
-        // find a neighbouring valid pixel
-        auto ixNeighbour = getIxValidNeighbour(ix, ixAssigned, comp.geometry);
-        SPDLOG_DEBUG("  -> using concentration from pixel {}", ixNeighbour);
-        comp.missingPixels.push_back({ix, ixNeighbour});
-      }
-    }
+    comp.missingPixels = getMissingPixels(ixAssigned, comp.geometry);
+    comp.interpolation =
+        makeInterpolationMatrix(comp, qpi.getNumPoints(), triangleVertices);
+    SPDLOG_DEBUG("  - {} vertices, {} non-zero interpolation weights",
+                 nVertices, comp.interpolation.weights.size());
   }
 }
 
@@ -240,23 +366,47 @@ std::size_t DuneSim::run(double time, double timeout_ms,
   }
   QElapsedTimer timer;
   timer.start();
+  std::atomic<bool> timedOut{false};
+  // independent compartments are run concurrently, so this may be called
+  // from multiple threads
+  std::mutex callbackMutex;
+  auto isStopRequested{[&]() {
+    if (timeout_ms >= 0.0 &&
+        static_cast<double>(timer.elapsed()) >= timeout_ms) {
+      timedOut.store(true);
+      return true;
+    }
+    if (stopRunningCallback) {
+      std::scoped_lock lock{callbackMutex};
+      if (stopRunningCallback()) {
+        stopRequested.store(true);
+      }
+    }
+    return stopRequested.load();
+  }};
+  std::size_t steps{0};
   try {
-    pDuneImpl->run(time);
+    steps = pDuneImpl->run(time, isStopRequested);
+    SPDLOG_DEBUG("{} internal timesteps", steps);
+    for (std::size_t i = 0; i < pDuneImpl->runTimes_ms.size(); ++i) {
+      SPDLOG_DEBUG("model {}: total run time {} ms", i,
+                   pDuneImpl->runTimes_ms[i]);
+    }
+    // also after stopping early, so that the partial progress is available
     updateSpeciesConcentrations();
     currentErrorMessage.clear();
   } catch (const Dune::Exception &e) {
     currentErrorMessage = e.what();
     SPDLOG_ERROR("{}", currentErrorMessage);
   }
-  if (stopRunningCallback && stopRunningCallback()) {
-    SPDLOG_DEBUG("Simulation cancelled: requesting stop");
-    currentErrorMessage = "Simulation cancelled";
-  }
-  if (timeout_ms >= 0.0 && static_cast<double>(timer.elapsed()) >= timeout_ms) {
-    SPDLOG_DEBUG("Simulation timeout: requesting stop");
+  if (timedOut.load()) {
+    SPDLOG_DEBUG("Simulation timeout: stopped after {} timesteps", steps);
     currentErrorMessage = "Simulation timeout";
+  } else if (stopRequested.load()) {
+    SPDLOG_DEBUG("Simulation cancelled: stopped after {} timesteps", steps);
+    currentErrorMessage = "Simulation cancelled";
   }
-  return 1;
+  return steps;
 }
 
 const std::vector<double> &
@@ -264,14 +414,28 @@ DuneSim::getConcentrations(std::size_t compartmentIndex) const {
   return duneCompartments[compartmentIndex].concentration;
 }
 
+void DuneSim::takeConcentrations(std::size_t compartmentIndex,
+                                 std::vector<double> &buffer) {
+  // every pixel is overwritten in updateSpeciesConcentrations(), so the
+  // output buffer can be swapped with any buffer of the same size
+  auto &concentration{duneCompartments[compartmentIndex].concentration};
+  buffer.resize(concentration.size());
+  std::swap(buffer, concentration);
+}
+
 std::size_t DuneSim::getConcentrationPadding() const { return 0; }
 
 const std::string &DuneSim::errorMessage() const { return currentErrorMessage; }
 
 const QImage &DuneSim::errorImage() const { return currentErrorImage; }
 
-void DuneSim::setStopRequested([[maybe_unused]] bool stop) {
-  SPDLOG_DEBUG("Not implemented - ignoring request");
+void DuneSim::setStopRequested(bool stop) { stopRequested.store(stop); }
+
+std::vector<double> DuneSim::getModelRunTimes() const {
+  if (pDuneImpl == nullptr) {
+    return {};
+  }
+  return pDuneImpl->runTimes_ms;
 }
 
 void DuneSim::updateSpeciesConcentrations() {
@@ -281,39 +445,41 @@ void DuneSim::updateSpeciesConcentrations() {
     const auto &gridview{
         pDuneImpl->grid->subDomain(static_cast<int>(comp.index))
             .leafGridView()};
+    // evaluate DUNE grid functions once at each vertex: for first order FEM
+    // these are the coefficients of the basis functions
     std::size_t iTriangle{0};
     for (const auto e : elements(gridview)) {
-      SPDLOG_TRACE("triangle {} ({})", iTriangle,
-                   common::decltypeStr<decltype(e)>());
-      for (const auto &[ix, point] : comp.pixels[iTriangle]) {
-        // evaluate DUNE grid function at this pixel location
-        // convert pixel->global->local
-        Dune::FieldVector<double, 2> localPoint = {point[0], point[1]};
-        SPDLOG_TRACE("  - pixel ({}) -> -> local ({},{})", ix, localPoint[0],
-                     localPoint[1]);
-        std::vector<double> localConcs;
-        localConcs.reserve(nSpecies);
+      for (const auto &[corner, iv] : comp.vertexCorners[iTriangle]) {
+        const auto &c{referenceCorners[static_cast<std::size_t>(corner)]};
+        Dune::FieldVector<double, 2> localPoint = {c[0], c[1]};
         for (std::size_t iSpecies = 0; iSpecies < nSpecies; ++iSpecies) {
-          std::size_t externalSpeciesIndex = comp.speciesIndices[iSpecies];
-          double result{
-              pDuneImpl->evaluateGridFunction(iSpecies, e, localPoint)};
           // convert result from Amount / Length^3 to Amount / Volume
-          result *= volOverL3;
-          SPDLOG_TRACE("    - species[{}] = {}", iSpecies, result);
-          // replace negative values with zero
-          comp.concentration[ix * nSpecies + externalSpeciesIndex] =
-              result < 0 ? 0 : result;
+          comp.vertexValues[iv * nSpecies + comp.speciesIndices[iSpecies]] =
+              volOverL3 *
+              pDuneImpl->evaluateGridFunction(iSpecies, e, localPoint);
         }
       }
       ++iTriangle;
     }
-    // fill in missing pixels with neighbouring value
-    for (const auto &[ixMissing, ixNeighbour] : comp.missingPixels) {
+    // interpolate all species to pixels with a sparse matrix-vector product
+    const auto &m{comp.interpolation};
+    const double *vertexValues{comp.vertexValues.data()};
+    double *concs{comp.concentration.data()};
+    common::parallelFor(m.rowOffsets.size() - 1, [&m, vertexValues, concs,
+                                                  nSpecies](std::size_t ix) {
+      double *c{concs + ix * nSpecies};
+      std::fill(c, c + nSpecies, 0.0);
+      for (std::size_t k = m.rowOffsets[ix]; k < m.rowOffsets[ix + 1]; ++k) {
+        const double *v{vertexValues + m.columns[k] * nSpecies};
+        for (std::size_t iSpecies = 0; iSpecies < nSpecies; ++iSpecies) {
+          c[iSpecies] += m.weights[k] * v[iSpecies];
+        }
+      }
+      // replace negative values with zero
       for (std::size_t iSpecies = 0; iSpecies < nSpecies; ++iSpecies) {
-        comp.concentration[ixMissing * nSpecies + iSpecies] =
-            comp.concentration[ixNeighbour * nSpecies + iSpecies];
+        c[iSpecies] = c[iSpecies] < 0 ? 0 : c[iSpecies];
       }
-    }
+    });
   }
 }
 
@@ -8,6 +8,7 @@
 #include <QPointF>
 #include <QSize>
 #include <array>
+#include <atomic>
 #include <cstddef>
 #include <limits>
 #include <map>
@@ -36,6 +37,13 @@ using PixelLocalPair = std::pair<std::size_t, std::array<double, 2>>;
 
 class DuneImpl;
 
+// sparse pixel x vertex matrix in CSR format
+struct DuneInterpolationMatrix {
+  std::vector<std::size_t> rowOffsets{};
+  std::vector<std::size_t> columns{};
+  std::vector<double> weights{};
+};
+
 struct DuneSimCompartment {
   std::string name;
   std::size_t index;
@@ -47,6 +55,13 @@ struct DuneSimCompartment {
   // index of nearest valid pixel for any missing pixels
   std::vector<std::pair<std::size_t, std::size_t>> missingPixels;
   std::vector<double> concentration;
+  // for each triangle: (corner, vertex index) of the vertices evaluated in
+  // this triangle, such that each vertex is evaluated only once
+  std::vector<std::vector<std::pair<int, std::size_t>>> vertexCorners{};
+  // interpolates vertex values to pixels, including any missing pixels
+  DuneInterpolationMatrix interpolation{};
+  // vertex->species values
+  std::vector<double> vertexValues{};
 };
 
 class DuneSim : public BaseSim {
@@ -64,6 +79,7 @@ private:
   std::string currentErrorMessage{};
   QImage currentErrorImage{};
   double volOverL3;
+  std::atomic<bool> stopRequested{false};
 
 public:
   explicit DuneSim(
@@ -75,10 +91,15 @@ public:
                   const std::function<bool()> &stopRunningCallback) override;
   [[nodiscard]] const std::vector<double> &
   getConcentrations(std::size_t compartmentIndex) const override;
+  void takeConcentrations(std::size_t compartmentIndex,
+                          std::vector<double> &buffer) override;
   [[nodiscard]] std::size_t getConcentrationPadding() const override;
   [[nodiscard]] const std::string &errorMessage() const override;
   [[nodiscard]] const QImage &errorImage() const override;
   void setStopRequested(bool stop) override;
+  // total wall time spent by each DUNE model, in ms: one model per
+  // compartment if the compartments are independent, otherwise one model
+  [[nodiscard]] std::vector<double> getModelRunTimes() const;
 };
 
 } // namespace simulate
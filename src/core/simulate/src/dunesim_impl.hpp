@@ -5,6 +5,9 @@
 #pragma once
 
 #include "dune_headers.hpp"
+#include <cmath>
+#include <cstddef>
+#include <functional>
 
 namespace sme {
 
@@ -25,16 +28,48 @@ public:
   using Elem = decltype(*(elements(std::declval<SubGridView>()).begin()));
   std::vector<Dune::ParameterTree> configs;
   std::shared_ptr<Grid> grid;
+  // total wall time spent in run() by each model, in ms
+  std::vector<double> runTimes_ms;
   explicit DuneImpl(const simulate::DuneConverter &dc);
   virtual ~DuneImpl();
   virtual void setInitial(const simulate::DuneConverter &dc) = 0;
-  virtual void run(double time) = 0;
+  // advance by time, or until isStopRequested() returns true, which is
+  // checked after each internal timestep: returns the number of internal
+  // timesteps. If stopped early, the next call resumes from the current
+  // time, with the same end time as the interrupted call.
+  virtual std::size_t run(double time,
+                          const std::function<bool()> &isStopRequested) = 0;
   virtual void updateGridFunctions(std::size_t compartmentIndex,
                                    std::size_t nSpecies) = 0;
   [[nodiscard]] virtual double evaluateGridFunction(
       std::size_t iSpecies, const Elem &e,
       const Dune::FieldVector<double, 2> &localPoint) const = 0;
 
+protected:
+  // true if time t is before tEnd
+  static bool isBefore(double t, double tEnd) {
+    constexpr double relativeTolerance{1e-12};
+    return tEnd - t > relativeTolerance * std::abs(tEnd);
+  }
+  // advance model from t to tEnd one internal timestep at a time
+  template <typename Stepper, typename Model, typename Output>
+  static std::size_t
+  evolve(const Stepper &stepper, Model &model, double &t, double &dt,
+         double tEnd, Output &&writeOutput,
+         const std::function<bool()> &isStopRequested) {
+    std::size_t steps{0};
+    while (isBefore(t, tEnd)) {
+      double tNext{isBefore(t + dt, tEnd) ? t + dt : tEnd};
+      stepper.evolve(model, dt, tNext, writeOutput);
+      t = tNext;
+      ++steps;
+      if (isStopRequested && isStopRequested()) {
+        break;
+      }
+    }
+    return steps;
+  }
+
 private:
   std::shared_ptr<HostGrid> hostGrid;
 };
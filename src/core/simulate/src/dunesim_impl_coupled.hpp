@@ -7,6 +7,7 @@
 #include "dunefunction.hpp"
 #include "dunesim_impl.hpp"
 #include "simulate_options.hpp"
+#include <chrono>
 #include <memory>
 #include <type_traits>
 
@@ -24,7 +25,10 @@ public:
       decltype(*std::declval<Model>().get_grid_function(0, 0).get())>;
   std::unique_ptr<Model> model;
   std::vector<std::shared_ptr<const GF>> gridFunctions;
+  // end time of the last completed run
   double t0{0.0};
+  // current time, after t0 if the last run was stopped early
+  double t{0.0};
   double dt{1e-3};
   std::string vtkFilename{};
   explicit DuneImplCoupled(const DuneConverter &dc, const DuneOptions &options)
@@ -42,21 +46,34 @@ public:
     dt = configs[0]
              .sub("model.time_stepping")
              .template get<double>("initial_step");
+    runTimes_ms.assign(1, 0.0);
   }
   ~DuneImplCoupled() override = default;
   void setInitial(const DuneConverter &dc) override {
     model->set_initial(makeModelDuneFunctions<GridView>(dc));
   }
-  void run(double time) override {
+  std::size_t run(double time,
+                  const std::function<bool()> &isStopRequested) override {
     auto write_output = [&f = vtkFilename](const auto &state) {
       if (!f.empty()) {
         state.write(f, true);
       }
     };
+    auto start{std::chrono::steady_clock::now()};
     auto stepper{Dune::Copasi::make_default_stepper(
         configs[0].sub("model.time_stepping"))};
-    stepper.evolve(*model.get(), dt, t0 + time, write_output);
-    t0 += time;
+    double tEnd{t0 + time};
+    auto steps{evolve(stepper, *model.get(), t, dt, tEnd, write_output,
+                      isStopRequested)};
+    runTimes_ms[0] += std::chrono::duration<double, std::milli>(
+                          std::chrono::steady_clock::now() - start)
+                          .count();
+    if (isBefore(t, tEnd)) {
+      SPDLOG_DEBUG("Stopped at t={} of [{}, {}]", t, t0, tEnd);
+    } else {
+      t0 = tEnd;
+    }
+    return steps;
   }
   void updateGridFunctions(std::size_t compartmentIndex,
                            std::size_t nSpecies) override {
@@ -1,12 +1,17 @@
 // Dune Implementation for Independent Compartments Model
-//  - provides model
+//  - provides a model for each compartment
+//  - the models are advanced concurrently
 
 #pragma once
 
 #include "duneconverter.hpp"
 #include "dunefunction.hpp"
 #include "dunesim_impl.hpp"
+#include "parallel_for.hpp"
 #include "simulate_options.hpp"
+#include <algorithm>
+#include <chrono>
+#include <exception>
 #include <memory>
 #include <type_traits>
 
@@ -24,7 +29,10 @@ public:
       decltype(*std::declval<Model>().get_grid_function(0).get())>;
   std::vector<std::unique_ptr<Model>> models;
   std::vector<std::shared_ptr<const GF>> gridFunctions;
+  // end time of the last completed run
   double t0{0.0};
+  // current time of each model, after t0 if the last run was stopped early
+  std::vector<double> ts;
   std::vector<double> dts;
   std::string vtkFilename{};
   explicit DuneImplIndependent(const DuneConverter &dc,
@@ -52,6 +60,8 @@ public:
                         .sub("model.time_stepping")
                         .template get<double>("initial_step"));
     }
+    ts.assign(models.size(), 0.0);
+    runTimes_ms.assign(models.size(), 0.0);
   }
   ~DuneImplIndependent() override = default;
   void setInitial(const DuneConverter &dc) override {
@@ -59,20 +69,58 @@ public:
       models[i]->set_initial(makeCompartmentDuneFunctions<SubGridView>(dc, i));
     }
   }
-  void run(double time) override {
+  std::size_t run(double time,
+                  const std::function<bool()> &isStopRequested) override {
     auto write_output = [&f = vtkFilename](const auto &state) {
       if (!f.empty()) {
         state.write(f, true);
       }
     };
-    auto stepper{Dune::Copasi::make_default_stepper(
-        configs[0].sub("model.time_stepping"))};
-    for (std::size_t i = 0; i < models.size(); ++i) {
-      auto *model = models[i].get();
-      double &dt = dts[i];
-      stepper.evolve(*model, dt, t0 + time, write_output);
+    // each model is advanced with its own stepper: an exception is
+    // rethrown once all models have finished
+    std::vector<std::exception_ptr> exceptions(models.size());
+    std::vector<std::size_t> steps(models.size(), 0);
+    double tEnd{t0 + time};
+    auto runModel{[&](std::size_t i) {
+      auto start{std::chrono::steady_clock::now()};
+      try {
+        auto stepper{Dune::Copasi::make_default_stepper(
+            configs[i].sub("model.time_stepping"))};
+        steps[i] = evolve(stepper, *models[i], ts[i], dts[i], tEnd,
+                          write_output, isStopRequested);
+      } catch (...) {
+        exceptions[i] = std::current_exception();
+      }
+      runTimes_ms[i] += std::chrono::duration<double, std::milli>(
+                            std::chrono::steady_clock::now() - start)
+                            .count();
+    }};
+    if (!vtkFilename.empty()) {
+      // all models write to the same file
+      for (std::size_t i = 0; i < models.size(); ++i) {
+        runModel(i);
+      }
+    } else {
+      // the models are independent, so can be advanced concurrently
+      common::parallelFor(models.size(), runModel);
+    }
+    for (const auto &e : exceptions) {
+      if (e != nullptr) {
+        std::rethrow_exception(e);
+      }
+    }
+    if (std::any_of(ts.cbegin(), ts.cend(),
+                    [tEnd](double t) { return isBefore(t, tEnd); })) {
+      SPDLOG_DEBUG("Stopped at t={} of [{}, {}]",
+                   *std::min_element(ts.cbegin(), ts.cend()), t0, tEnd);
+    } else {
+      t0 = tEnd;
+    }
+    std::size_t maxSteps{0};
+    for (auto n : steps) {
+      maxSteps = std::max(maxSteps, n);
     }
-    t0 += time;
+    return maxSteps;
   }
   void updateGridFunctions(std::size_t compartmentIndex,
                            std::size_t nSpecies) override {
@@ -1,4 +1,5 @@
 #include "catch_wrapper.hpp"
+#include "duneconverter_impl.hpp"
 #include "dunesim.hpp"
 #include "model.hpp"
 #include "model_test_utils.hpp"
@@ -81,6 +82,21 @@ TEST_CASE("DuneSim", "[core/simulate/dunesim][core/"
       REQUIRE(diff / sum < 1e-10);
     }
   }
+  SECTION("Uniform concentrations are interpolated to every pixel") {
+    auto m{getExampleModel(Mod::ABtoC)};
+    for (const auto &speciesId : m.getSpecies().getIds("comp")) {
+      m.getSpecies().setInitialConcentration(speciesId, 1.5);
+    }
+    std::vector<std::string> comps{"comp"};
+    simulate::DuneSim duneSim(m, comps);
+    REQUIRE(duneSim.errorMessage().empty());
+    auto nPixels{m.getCompartments().getCompartment("comp")->nPixels()};
+    const auto &c{duneSim.getConcentrations(0)};
+    REQUIRE(c.size() == 3 * nPixels);
+    for (auto v : c) {
+      REQUIRE(v == dbl_approx(1.5));
+    }
+  }
   SECTION("Callback is provided and used to stop simulation") {
     auto m{getExampleModel(Mod::ABtoC)};
     std::vector<std::string> comps{"comp"};
@@ -88,5 +104,88 @@ TEST_CASE("DuneSim", "[core/simulate/dunesim][core/"
     REQUIRE(duneSim.errorMessage().empty());
     duneSim.run(1, -1, []() { return true; });
     REQUIRE(duneSim.errorMessage() == "Simulation cancelled");
+    auto runTimes{duneSim.getModelRunTimes()};
+    REQUIRE(runTimes.size() == 1);
+    REQUIRE(runTimes[0] >= 0.0);
+  }
+  SECTION("Stop and timeout interrupt the run, which can then be resumed") {
+    auto m{getExampleModel(Mod::ABtoC)};
+    std::vector<std::string> comps{"comp"};
+    simulate::DuneSim duneSim(m, comps);
+    simulate::DuneSim uninterrupted(m, comps);
+    REQUIRE(uninterrupted.run(0.5, -1, {}) > 1);
+    REQUIRE(uninterrupted.errorMessage().empty());
+    // stop requested: returns after a single internal timestep
+    duneSim.setStopRequested(true);
+    REQUIRE(duneSim.run(0.5, -1, {}) == 1);
+    REQUIRE(duneSim.errorMessage() == "Simulation cancelled");
+    duneSim.setStopRequested(false);
+    // zero timeout: also returns after a single internal timestep
+    REQUIRE(duneSim.run(0.5, 0, {}) == 1);
+    REQUIRE(duneSim.errorMessage() == "Simulation timeout");
+    // resume the interrupted run
+    REQUIRE(duneSim.run(0.5, -1, {}) > 0);
+    REQUIRE(duneSim.errorMessage().empty());
+    const auto &a{duneSim.getConcentrations(0)};
+    const auto &b{uninterrupted.getConcentrations(0)};
+    REQUIRE(a.size() == b.size());
+    double diff{0};
+    double sum{0};
+    for (std::size_t i = 0; i < a.size(); ++i) {
+      diff += std::abs(a[i] - b[i]);
+      sum += std::abs(a[i]) + std::abs(b[i]);
+    }
+    CAPTURE(sum);
+    CAPTURE(diff);
+    REQUIRE(diff / sum < 1e-10);
+  }
+  SECTION("Independent compartments: concurrent matches sequential") {
+    auto m{getExampleModel(Mod::VerySimpleModel)};
+    // no membrane reactions: each compartment is a separate DUNE model
+    for (const auto &membraneId : m.getMembranes().getIds()) {
+      for (const auto &reactionId : m.getReactions().getIds(membraneId)) {
+        m.getReactions().remove(reactionId);
+      }
+    }
+    REQUIRE(simulate::modelHasIndependentCompartments(m));
+    // non-uniform initial concentrations, so every compartment changes
+    m.getSpecies().setAnalyticConcentration("A_c1", "cos(x/5)+2");
+    m.getSpecies().setAnalyticConcentration("B_c2", "cos(y/5)+2");
+    m.getSpecies().setAnalyticConcentration("A_c3", "cos(x/2)+2");
+    std::vector<std::string> comps{"c1", "c2", "c3"};
+    simulate::DuneSim concurrent(m, comps);
+    // with VTK output the models are advanced one at a time
+    m.getSimulationSettings().options.dune.writeVTKfiles = true;
+    simulate::DuneSim sequential(m, comps);
+    for (std::size_t i = 0; i < 2; ++i) {
+      concurrent.run(0.05, -1, {});
+      sequential.run(0.05, -1, {});
+    }
+    REQUIRE(concurrent.errorMessage().empty());
+    REQUIRE(sequential.errorMessage().empty());
+    for (std::size_t iComp = 0; iComp < comps.size(); ++iComp) {
+      const auto &a{concurrent.getConcentrations(iComp)};
+      const auto &b{sequential.getConcentrations(iComp)};
+      REQUIRE(a.size() == b.size());
+      double diff{0};
+      double sum{0};
+      for (std::size_t i = 0; i < a.size(); ++i) {
+        diff += std::abs(a[i] - b[i]);
+        sum += std::abs(a[i]) + std::abs(b[i]);
+      }
+      CAPTURE(iComp);
+      CAPTURE(sum);
+      CAPTURE(diff);
+      REQUIRE(sum > 0);
+      REQUIRE(diff / sum < 1e-10);
+    }
+    // a run time is reported for each model
+    for (const auto *sim : {&concurrent, &sequential}) {
+      auto runTimes{sim->getModelRunTimes()};
+      REQUIRE(runTimes.size() == comps.size());
+      for (auto t : runTimes) {
+        REQUIRE(t > 0.0);
+      }
+    }
   }
 }
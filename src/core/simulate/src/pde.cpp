@@ -6,9 +6,6 @@
 #include "model_species.hpp"
 #include "symbolic.hpp"
 #include "utils.hpp"
-#include <QList>
-#include <QString>
-#include <QStringList>
 #include <algorithm>
 #include <memory>
 #include <optional>
@@ -43,72 +40,104 @@ Pde::Pde(const model::Model *doc_ptr,
   // construct reaction expressions and stoich matrix
   Reaction reactions(doc_ptr, speciesIDs, reactionIDs);
 
-  // construct symbolic expressions: one rhs + Jacobian for each species
-  rhs.clear();
-  jacobian.clear();
-  for (std::size_t i = 0; i < speciesIDs.size(); ++i) {
-    jacobian.emplace_back();
-    QString r("0.0");
-    auto vars{reactions.getSpeciesIDs()};
-    vars.insert(vars.end(), extraVariables.cbegin(), extraVariables.cend());
-    for (std::size_t j = 0; j < reactions.size(); ++j) {
-      // get reaction term
-      QString expr =
-          QString("%1*(%2) ")
-              .arg(common::dblToQStr(reactions.getMatrixElement(j, i)),
-                   reactions.getExpression(j).c_str());
-      // rescale by supplied reactionScaleFactor
-      auto str = fmt::format("{}", pdeScaleFactors.reaction);
-      expr = QString("((%1)*(%2)) ").arg(expr, str.c_str());
-      SPDLOG_DEBUG("Species {} Reaction {} = {}", speciesIDs.at(i), j,
-                   expr.toStdString());
-      auto constants{reactions.getConstants(j)};
-      if (!substitutions.empty()) {
-        // substitute values of any constants in substitutions map
-        for (auto &[id, v] : constants) {
-          if (auto iter = substitutions.find(id); iter != substitutions.end()) {
-            SPDLOG_INFO("Substituting: {} = {} -> {}", id, v, iter->second);
-            v = iter->second;
-          }
+  auto vars{reactions.getSpeciesIDs()};
+  vars.insert(vars.end(), extraVariables.cbegin(), extraVariables.cend());
+  // parse and inline constants & function calls of each reaction once
+  const auto &functions{doc_ptr->getFunctions().getSymbolicFunctions()};
+  const auto nGlobalConstants{
+      doc_ptr->getParameters().getGlobalConstants().size()};
+  std::vector<common::Symbolic> terms;
+  terms.reserve(reactions.size());
+  for (std::size_t j = 0; j < reactions.size(); ++j) {
+    SPDLOG_DEBUG("Reaction {} = {}", j, reactions.getExpression(j));
+    auto constants{reactions.getConstants(j)};
+    // extra variables are not replaced by the value of a global constant,
+    // which are followed by the local parameters of the reaction: a local
+    // parameter with the same id still takes precedence over both
+    auto globalsEnd{constants.begin() +
+                    static_cast<std::ptrdiff_t>(
+                        std::min(nGlobalConstants, constants.size()))};
+    constants.erase(std::remove_if(constants.begin(), globalsEnd,
+                                   [&extraVariables](const auto &c) {
+                                     return std::find(extraVariables.cbegin(),
+                                                      extraVariables.cend(),
+                                                      c.first) !=
+                                            extraVariables.cend();
+                                   }),
+                    globalsEnd);
+    if (!substitutions.empty()) {
+      // substitute values of any constants in substitutions map
+      for (auto &[id, v] : constants) {
+        if (auto iter = substitutions.find(id); iter != substitutions.end()) {
+          SPDLOG_INFO("Substituting: {} = {} -> {}", id, v, iter->second);
+          v = iter->second;
         }
       }
-      // parse and inline constants & function calls
-      common::Symbolic sym(expr.toStdString(), vars, constants,
-                           doc_ptr->getFunctions().getSymbolicFunctions());
-      if (!sym.isValid()) {
-        throw PdeError(sym.getErrorMessage());
-      }
-      // add term to rhs
-      r.append(QString(" + (%1)").arg(sym.inlinedExpr().c_str()));
     }
-    // reparse full rhs to simplify
-    SPDLOG_DEBUG("Species {} Reparsing all reaction terms", speciesIDs.at(i));
-    // parse expression with symengine to simplify
-    common::Symbolic sym(r.toStdString(), vars);
-    if (!sym.isValid()) {
-      throw PdeError(sym.getErrorMessage());
+    const auto &term{terms.emplace_back(reactions.getExpression(j), vars,
+                                        constants, functions)};
+    if (!term.isValid()) {
+      throw PdeError(term.getErrorMessage());
     }
-    // rescale species (but not the extra variables)
-    SPDLOG_DEBUG("rescaling species");
-    sym.rescale(pdeScaleFactors.species, extraVariables);
-    auto outputSpecies = speciesIDs;
-    if (relabel) {
-      SPDLOG_DEBUG("re-labelling species");
-      outputSpecies = relabelledSpeciesIDs;
-      outputSpecies.insert(outputSpecies.end(),
-                           relabelledExtraVariables.cbegin(),
-                           relabelledExtraVariables.cend());
-      sym.relabel(outputSpecies);
+  }
+  // rhs of each species: stoich coefficients * reaction terms,
+  // rescaled by supplied reactionScaleFactor
+  std::vector<std::vector<double>> coefficients(
+      speciesIDs.size(), std::vector<double>(reactions.size(), 0.0));
+  for (std::size_t i = 0; i < speciesIDs.size(); ++i) {
+    for (std::size_t j = 0; j < reactions.size(); ++j) {
+      coefficients[i][j] =
+          reactions.getMatrixElement(j, i) * pdeScaleFactors.reaction;
     }
-    for (const auto &s : outputSpecies) {
-      jacobian.back().push_back(sym.diff(s));
+  }
+  sym = common::Symbolic::linearCombination(terms, coefficients, vars);
+  if (!sym.isValid()) {
+    throw PdeError(sym.getErrorMessage());
+  }
+  // rescale species (but not the extra variables)
+  SPDLOG_DEBUG("rescaling species");
+  sym.rescale(pdeScaleFactors.species, extraVariables);
+  outputSpecies = speciesIDs;
+  if (relabel) {
+    SPDLOG_DEBUG("re-labelling species");
+    outputSpecies = relabelledSpeciesIDs;
+    outputSpecies.insert(outputSpecies.end(),
+                         relabelledExtraVariables.cbegin(),
+                         relabelledExtraVariables.cend());
+    sym.relabel(outputSpecies);
+  }
+  // rhs for each species, and structurally non-zero Jacobian entries
+  rhs.clear();
+  jacobianPattern.clear();
+  for (std::size_t i = 0; i < speciesIDs.size(); ++i) {
+    rhs.push_back(sym.inlinedExpr(i));
+    auto &row{jacobianPattern.emplace_back()};
+    for (std::size_t j = 0; j < outputSpecies.size(); ++j) {
+      if (sym.dependsOn(outputSpecies[j], i)) {
+        row.push_back(j);
+      }
     }
-    rhs.push_back(sym.inlinedExpr());
+    SPDLOG_DEBUG("Species {} Jacobian non-zero columns: {}", speciesIDs[i],
+                 common::vectorToString(row));
   }
 }
 
 const std::vector<std::string> &Pde::getRHS() const { return rhs; }
+
+const std::vector<std::vector<std::size_t>> &Pde::getJacobianPattern() const {
+  return jacobianPattern;
+}
+
 const std::vector<std::vector<std::string>> &Pde::getJacobian() const {
+  std::call_once(jacobianGenerated, [this]() {
+    // only differentiate the structurally non-zero entries
+    for (std::size_t i = 0; i < rhs.size(); ++i) {
+      auto &row{jacobian.emplace_back(outputSpecies.size(), "0")};
+      for (auto j : jacobianPattern[i]) {
+        row[j] = sym.diff(outputSpecies[j], i);
+      }
+    }
+  });
   return jacobian;
 }
 
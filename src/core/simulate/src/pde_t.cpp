@@ -3,6 +3,7 @@
 #include "model.hpp"
 #include "model_test_utils.hpp"
 #include "pde.hpp"
+#include <thread>
 
 using namespace sme;
 using namespace sme::test;
@@ -53,6 +54,33 @@ TEST_CASE("PDE", "[core/simulate/pde][core/simulate][core][pde]") {
     REQUIRE(symEq(pde.getJacobian()[2][0], "1e5*x"));
     REQUIRE(symEq(pde.getJacobian()[2][1], "1e5*dim"));
     REQUIRE(symEq(pde.getJacobian()[2][2], "0"));
+    // sparsity pattern: only the first two species appear in the reaction
+    const auto &pattern{pde.getJacobianPattern()};
+    REQUIRE(pattern.size() == 5);
+    REQUIRE(pattern[0] == std::vector<std::size_t>{0, 1});
+    REQUIRE(pattern[1] == std::vector<std::size_t>{0, 1});
+    REQUIRE(pattern[2] == std::vector<std::size_t>{0, 1});
+    REQUIRE(pattern[3].empty());
+    REQUIRE(pattern[4].empty());
+  }
+  SECTION("Jacobian requested concurrently is generated once") {
+    auto s{getTestModel("invalid-dune-names")};
+    simulate::Pde pde(&s, {"dim", "x", "x_", "cos", "cos_"}, {"r1"});
+    std::vector<const std::vector<std::vector<std::string>> *> jacobians(4);
+    std::vector<std::thread> threads;
+    for (std::size_t i = 0; i < jacobians.size(); ++i) {
+      threads.emplace_back(
+          [&pde, &jacobians, i]() { jacobians[i] = &pde.getJacobian(); });
+    }
+    for (auto &thread : threads) {
+      thread.join();
+    }
+    for (const auto *jacobian : jacobians) {
+      REQUIRE(jacobian == jacobians[0]);
+    }
+    REQUIRE(jacobians[0]->size() == 5);
+    REQUIRE(symEq((*jacobians[0])[0][0], "-1e5*x"));
+    REQUIRE(symEq((*jacobians[0])[2][1], "1e5*dim"));
   }
   SECTION("simple model with relabeling of variables") {
     auto s{getTestModel("invalid-dune-names")};
@@ -125,4 +153,16 @@ TEST_CASE("PDE", "[core/simulate/pde][core/simulate][core][pde]") {
     REQUIRE(symEq(pde.getJacobian()[2][1], "2.7e6*dim"));
     REQUIRE(symEq(pde.getJacobian()[2][2], "0"));
   }
+  SECTION("extra variables do not replace local parameters") {
+    auto s{getExampleModel(Mod::ABtoC)};
+    std::vector<std::string> speciesIDs{"A", "B", "C"};
+    // k1 is a local parameter of r1: it takes precedence over an extra
+    // variable with the same id, as it would over a global parameter
+    simulate::Pde pde(&s, speciesIDs, {"r1"}, {}, {}, {"k1"});
+    REQUIRE(symEq(pde.getRHS()[2], "0.1*A*B"));
+    // extra variable replaces a global constant
+    s.getReactions().setRateExpression("r1", "A*B*comp");
+    simulate::Pde pdeGlobal(&s, speciesIDs, {"r1"}, {}, {}, {"comp"});
+    REQUIRE(symEq(pdeGlobal.getRHS()[2], "comp*A*B"));
+  }
 }
@@ -12,9 +12,9 @@
 #include <cmath>
 #include <cstdlib>
 #include <memory>
+#include <stdexcept>
 #include <utility>
 #ifdef SPATIAL_MODEL_EDITOR_WITH_TBB
-#include <tbb/global_control.h>
 #include <tbb/task_scheduler_init.h>
 #endif
 #ifdef SPATIAL_MODEL_EDITOR_WITH_OPENMP
@@ -163,7 +163,7 @@ static double getErrorPower(PixelIntegratorType integrator) {
   return errPower;
 }
 
-double PixelSim::doRKAdaptive(double dtMax) {
+double PixelSim::doRKAdaptive(double dtMax, bool reduceFinalStep) {
   // Adaptive timestep Runge-Kutta
   PixelIntegratorError err;
   double dt;
@@ -178,11 +178,27 @@ double PixelSim::doRKAdaptive(double dtMax) {
     } else if (integrator == PixelIntegratorType::RK435) {
       doRK435(dt);
     }
-    // calculate error
+    // calculate error, if this step reaches the end of the run also reduce
+    // the concentrations in the same pass: only used if the step is accepted
+    reductionsValid = reduceFinalStep && dt == dtMax;
     err.abs = 0;
     err.rel = 0;
-    for (const auto &sim : simCompartments) {
-      auto compErr = sim->calculateRKError(epsilon);
+    for (std::size_t ic = 0; ic < simCompartments.size(); ++ic) {
+      const auto &sim{simCompartments[ic]};
+      std::vector<SpeciesReduction> *r{nullptr};
+      if (reductionsValid) {
+        r = &reductions[ic];
+        r->assign(sim->getSpeciesIds().size(),
+                  SpeciesReduction(quantileAccuracy));
+      }
+      PixelIntegratorError compErr;
+      if (useTBB) {
+#ifdef SPATIAL_MODEL_EDITOR_WITH_TBB
+        compErr = sim->calculateRKError_tbb(epsilon, r);
+#endif
+      } else {
+        compErr = sim->calculateRKError(epsilon, r);
+      }
       err.rel = std::max(err.rel, compErr.rel);
       err.abs = std::max(err.abs, compErr.abs);
     }
@@ -207,11 +223,13 @@ double PixelSim::doRKAdaptive(double dtMax) {
           "of the pixels with the largest relative integration error are shown "
           "below in red:",
           problemSpecies);
+      reductionsValid = false;
       return nextTimestep;
     }
     if (err.abs > errMax.abs || err.rel > errMax.rel) {
       SPDLOG_TRACE("discarding step");
       ++discardedSteps;
+      reductionsValid = false;
       for (auto &sim : simCompartments) {
         sim->undoRKStep();
       }
@@ -223,7 +241,8 @@ double PixelSim::doRKAdaptive(double dtMax) {
 PixelSim::PixelSim(
     const model::Model &sbmlDoc, const std::vector<std::string> &compartmentIds,
     const std::vector<std::vector<std::string>> &compartmentSpeciesIds,
-    const std::map<std::string, double, std::less<>> &substitutions)
+    const std::map<std::string, double, std::less<>> &substitutions,
+    const std::vector<std::string> &extraRuntimeParameterIds)
     : doc{sbmlDoc},
       integrator{sbmlDoc.getSimulationSettings().options.pixel.integrator},
       errMax{sbmlDoc.getSimulationSettings().options.pixel.maxErr},
@@ -242,6 +261,49 @@ PixelSim::PixelSim(
     if (spaceDependent) {
       nExtraVars += 2;
     }
+    // parameters targeted by events are runtime inputs to the reaction
+    // kernels, so that an event doesn't require re-compiling the kernels,
+    // as are any extra parameters, e.g. those varied in a parameter scan
+    std::vector<std::pair<std::string, double>> runtimeParameters;
+    const auto &constants{doc.getParameters().getGlobalConstants()};
+    // returns false if id is not a constant global parameter
+    auto addRuntimeParameter{[&](const std::string &id) {
+      if (std::find(runtimeParameterIds.cbegin(), runtimeParameterIds.cend(),
+                    id) != runtimeParameterIds.cend()) {
+        return true;
+      }
+      auto c{std::find_if(constants.cbegin(), constants.cend(),
+                          [&id](const auto &constant) {
+                            return constant.id == id;
+                          })};
+      if (c == constants.cend()) {
+        return false;
+      }
+      double value{c->value};
+      if (auto iter{substitutions.find(id)}; iter != substitutions.cend()) {
+        value = iter->second;
+      }
+      SPDLOG_INFO("Runtime parameter {} = {}", id, value);
+      runtimeParameterIds.push_back(id);
+      runtimeParameters.emplace_back(id, value);
+      return true;
+    }};
+    const auto &events{doc.getEvents()};
+    for (const auto &eventId : events.getIds()) {
+      if (events.isParameter(eventId)) {
+        // otherwise the simulator is re-constructed when the event occurs
+        if (auto id{events.getVariable(eventId).toStdString()};
+            !addRuntimeParameter(id)) {
+          SPDLOG_INFO("Event-targeted parameter {} is not a constant", id);
+        }
+      }
+    }
+    for (const auto &id : extraRuntimeParameterIds) {
+      if (!addRuntimeParameter(id)) {
+        throw std::runtime_error(
+            fmt::format("Unknown runtime parameter '{}'", id));
+      }
+    }
     // add compartments
     for (std::size_t compIndex = 0; compIndex < compartmentIds.size();
          ++compIndex) {
@@ -252,10 +314,11 @@ PixelSim::PixelSim(
           doc, compartment, speciesIds,
           sbmlDoc.getSimulationSettings().options.pixel.doCSE,
           sbmlDoc.getSimulationSettings().options.pixel.optLevel, timeDependent,
-          spaceDependent, substitutions));
+          spaceDependent, substitutions, runtimeParameters));
       maxStableTimestep = std::min(
           maxStableTimestep, simCompartments.back()->getMaxStableTimestep());
     }
+    reductions.resize(simCompartments.size());
     // add membranes
     for (const auto &membrane : doc.getMembranes().getMembranes()) {
       if (auto reacsInMembrane =
@@ -286,16 +349,18 @@ PixelSim::PixelSim(
             doc, &membrane, compA, compB,
             sbmlDoc.getSimulationSettings().options.pixel.doCSE,
             sbmlDoc.getSimulationSettings().options.pixel.optLevel,
-            timeDependent, spaceDependent, substitutions));
+            timeDependent, spaceDependent, substitutions, runtimeParameters));
       }
     }
     // apply existing simulation concentrations if present
     const auto &data{sbmlDoc.getSimulationData()};
-    if (data.concentration.size() > 1 && !data.concentration.back().empty() &&
-        (data.concentration.back().size() == simCompartments.size())) {
-      SPDLOG_INFO("Applying supplied initial concentrations");
-      for (std::size_t i = 0; i < simCompartments.size(); ++i) {
-        simCompartments[i]->setConcentrations(data.concentration.back()[i]);
+    if (data.concentration.size() > 1) {
+      if (auto concs{data.concentration.back()};
+          !concs->empty() && concs->size() == simCompartments.size()) {
+        SPDLOG_INFO("Applying supplied initial concentrations");
+        for (std::size_t i = 0; i < simCompartments.size(); ++i) {
+          simCompartments[i]->setConcentrations((*concs)[i]);
+        }
       }
     }
 #ifdef SPATIAL_MODEL_EDITOR_WITH_TBB
@@ -307,6 +372,7 @@ PixelSim::PixelSim(
       numMaxThreads = static_cast<std::size_t>(
           tbb::task_scheduler_init::default_num_threads());
     }
+    arena.initialize(static_cast<int>(numMaxThreads));
 #elif defined(SPATIAL_MODEL_EDITOR_WITH_OPENMP)
     if (!sbmlDoc.getSimulationSettings().options.pixel.enableMultiThreading) {
       numMaxThreads = 1;
@@ -316,7 +382,6 @@ PixelSim::PixelSim(
       // 0 means use all available threads
       numMaxThreads = ompMaxThreads;
     }
-    omp_set_num_threads(static_cast<int>(numMaxThreads));
 #else
     if (sbmlDoc.getSimulationSettings().options.pixel.enableMultiThreading) {
       SPDLOG_WARN(
@@ -338,25 +403,41 @@ std::size_t PixelSim::run(double time, double timeout_ms,
   SPDLOG_TRACE("  - max abs local err {}", errMax.abs);
   SPDLOG_TRACE("  - max stepsize {}", maxTimestep);
   currentErrorMessage.clear();
+  // the number of threads is limited for this simulation only, so that
+  // simulations running concurrently in other threads are not affected
 #ifdef SPATIAL_MODEL_EDITOR_WITH_TBB
-  tbb::global_control control(tbb::global_control::max_allowed_parallelism,
-                              numMaxThreads);
+  return arena.execute([&]() {
+    return doTimesteps(time, timeout_ms, stopRunningCallback);
+  });
+#else
+#ifdef SPATIAL_MODEL_EDITOR_WITH_OPENMP
+  // sets the number of threads for parallel regions started by this thread
+  omp_set_num_threads(static_cast<int>(numMaxThreads));
+#endif
+  return doTimesteps(time, timeout_ms, stopRunningCallback);
 #endif
+}
+
+std::size_t
+PixelSim::doTimesteps(double time, double timeout_ms,
+                      const std::function<bool()> &stopRunningCallback) {
   QElapsedTimer timer;
   timer.start();
   double tNow = 0;
   std::size_t steps = 0;
   discardedSteps = 0;
+  reductionsValid = false;
   // do timesteps until we reach t
   constexpr double relativeTolerance = 1e-12;
   while (tNow + time * relativeTolerance < time) {
     double maxDt = std::min(maxTimestep, time - tNow);
+    reductionsValid = false;
     if (integrator == PixelIntegratorType::RK101) {
       double timestep = std::min(maxDt, maxStableTimestep);
       doRK101(timestep);
       tNow += timestep;
     } else {
-      tNow += doRKAdaptive(maxDt);
+      tNow += doRKAdaptive(maxDt, maxDt == time - tNow);
       if (!currentErrorMessage.empty()) {
         return steps;
       }
@@ -391,6 +472,20 @@ PixelSim::getConcentrations(std::size_t compartmentIndex) const {
 
 std::size_t PixelSim::getConcentrationPadding() const { return nExtraVars; }
 
+bool PixelSim::takeReductions(std::size_t compartmentIndex,
+                              std::vector<SpeciesReduction> &compReductions) {
+  if (!reductionsValid) {
+    return false;
+  }
+  std::swap(compReductions, reductions[compartmentIndex]);
+  reductions[compartmentIndex].clear();
+  return true;
+}
+
+void PixelSim::setQuantileAccuracy(double relativeAccuracy) {
+  quantileAccuracy = relativeAccuracy;
+}
+
 const std::vector<double> &
 PixelSim::getDcdt(std::size_t compartmentIndex) const {
   return simCompartments[compartmentIndex]->getDcdt();
@@ -403,6 +498,34 @@ double PixelSim::getLowerOrderConcentration(std::size_t compartmentIndex,
       speciesIndex, pixelIndex);
 }
 
+void PixelSim::setSpeciesConcentration(std::size_t compartmentIndex,
+                                       std::size_t speciesIndex,
+                                       const std::vector<double> &values) {
+  simCompartments[compartmentIndex]->setSpeciesConcentration(speciesIndex,
+                                                             values);
+  reductionsValid = false;
+  // discontinuous change: restart adaptive timestep as for a new simulation
+  nextTimestep = initialTimestep;
+}
+
+bool PixelSim::setRuntimeParameter(const std::string &id, double value) {
+  auto iter{std::find(runtimeParameterIds.cbegin(), runtimeParameterIds.cend(),
+                      id)};
+  if (iter == runtimeParameterIds.cend()) {
+    return false;
+  }
+  auto index{static_cast<std::size_t>(iter - runtimeParameterIds.cbegin())};
+  SPDLOG_DEBUG("Setting runtime parameter {} = {}", id, value);
+  for (auto &sim : simCompartments) {
+    sim->setRuntimeParameter(index, value);
+  }
+  for (auto &sim : simMembranes) {
+    sim->setRuntimeParameter(index, value);
+  }
+  nextTimestep = initialTimestep;
+  return true;
+}
+
 const std::string &PixelSim::errorMessage() const {
   return currentErrorMessage;
 }
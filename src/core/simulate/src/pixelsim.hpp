@@ -4,6 +4,7 @@
 
 #include "basesim.hpp"
 #include "simulate_options.hpp"
+#include "simulate_reductions.hpp"
 #include <QImage>
 #include <atomic>
 #include <cstddef>
@@ -12,6 +13,9 @@
 #include <memory>
 #include <string>
 #include <vector>
+#ifdef SPATIAL_MODEL_EDITOR_WITH_TBB
+#include <tbb/task_arena.h>
+#endif
 
 namespace sme {
 
@@ -37,37 +41,60 @@ private:
   void doRK435(double dt);
   void doRKSubstep(double dt, double g1, double g2, double g3, double beta,
                    double delta);
-  double doRKAdaptive(double dtMax);
+  double doRKAdaptive(double dtMax, bool reduceFinalStep = false);
+  std::size_t doTimesteps(double time, double timeout_ms,
+                          const std::function<bool()> &stopRunningCallback);
   std::size_t discardedSteps{0};
   PixelIntegratorType integrator;
   PixelIntegratorError errMax;
   double maxTimestep{std::numeric_limits<double>::max()};
-  double nextTimestep{1e-7};
+  static constexpr double initialTimestep{1e-7};
+  double nextTimestep{initialTimestep};
   double epsilon{1e-14};
   bool useTBB{false};
   std::size_t numMaxThreads{1};
+#ifdef SPATIAL_MODEL_EDITOR_WITH_TBB
+  // limits the threads used by this simulation, created once in constructor
+  tbb::task_arena arena;
+#endif
   std::string currentErrorMessage{};
   QImage currentErrorImage{};
   std::atomic<bool> stopRequested{false};
   std::size_t nExtraVars{0};
+  // compartment->variable reductions of the concentrations at the end of the
+  // last run, if computed while integrating
+  std::vector<std::vector<SpeciesReduction>> reductions;
+  bool reductionsValid{false};
+  double quantileAccuracy{0.0};
+  // event-targeted and user-supplied parameters: inputs to the compiled
+  // reaction kernels
+  std::vector<std::string> runtimeParameterIds;
 
 public:
   explicit PixelSim(
       const model::Model &sbmlDoc,
       const std::vector<std::string> &compartmentIds,
       const std::vector<std::vector<std::string>> &compartmentSpeciesIds,
-      const std::map<std::string, double, std::less<>> &substitutions = {});
+      const std::map<std::string, double, std::less<>> &substitutions = {},
+      const std::vector<std::string> &extraRuntimeParameterIds = {});
   ~PixelSim() override;
   std::size_t run(double time, double timeout_ms,
                   const std::function<bool()> &stopRunningCallback) override;
   [[nodiscard]] const std::vector<double> &
   getConcentrations(std::size_t compartmentIndex) const override;
   [[nodiscard]] std::size_t getConcentrationPadding() const override;
+  bool takeReductions(std::size_t compartmentIndex,
+                      std::vector<SpeciesReduction> &compReductions) override;
+  void setQuantileAccuracy(double relativeAccuracy) override;
   [[nodiscard]] const std::vector<double> &
   getDcdt(std::size_t compartmentIndex) const;
   [[nodiscard]] double getLowerOrderConcentration(std::size_t compartmentIndex,
                                                   std::size_t speciesIndex,
                                                   std::size_t pixelIndex) const;
+  void setSpeciesConcentration(std::size_t compartmentIndex,
+                               std::size_t speciesIndex,
+                               const std::vector<double> &values);
+  bool setRuntimeParameter(const std::string &id, double value);
   [[nodiscard]] const std::string &errorMessage() const override;
   [[nodiscard]] const QImage &errorImage() const override;
   void setStopRequested(bool stop) override;
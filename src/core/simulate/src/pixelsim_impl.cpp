@@ -2,6 +2,7 @@
 #include "geometry.hpp"
 #include "logger.hpp"
 #include "model.hpp"
+#include "parallel_for.hpp"
 #include "pde.hpp"
 #include "utils.hpp"
 #include <QString>
@@ -25,7 +26,8 @@ ReacEval::ReacEval(
     const model::Model &doc, const std::vector<std::string> &speciesIDs,
     const std::vector<std::string> &reactionIDs, double reactionScaleFactor,
     bool doCSE, unsigned optLevel, bool timeDependent, bool spaceDependent,
-    const std::map<std::string, double, std::less<>> &substitutions) {
+    const std::map<std::string, double, std::less<>> &substitutions,
+    const std::vector<std::pair<std::string, double>> &runtimeParameters) {
   // construct reaction expressions and stoich matrix
   PdeScaleFactors pdeScaleFactors;
   pdeScaleFactors.reaction = reactionScaleFactor;
@@ -39,9 +41,16 @@ ReacEval::ReacEval(
     extraVars.push_back(doc.getParameters().getSpatialCoordinates().x.id);
     extraVars.push_back(doc.getParameters().getSpatialCoordinates().y.id);
   }
+  nVariables = speciesIDs.size() + extraVars.size();
+  // runtime parameters are also variables, but don't have a reaction term
+  for (const auto &[id, value] : runtimeParameters) {
+    SPDLOG_TRACE("runtime parameter {} = {}", id, value);
+    extraVars.push_back(id);
+    parameters.push_back(value);
+  }
   Pde pde(&doc, speciesIDs, reactionIDs, {}, pdeScaleFactors, extraVars, {},
           substitutions);
-  // add dt/dt = 1 reaction term, and t,x,y "species"
+  // add dt/dt = 1 reaction term, and t,x,y "species", then runtime parameters
   auto sIds{speciesIDs};
   sIds.insert(sIds.end(), extraVars.cbegin(), extraVars.cend());
   auto rhs{pde.getRHS()};
@@ -70,6 +79,18 @@ void ReacEval::evaluate(double *output, const double *input) const {
   sym.eval(output, input);
 }
 
+bool ReacEval::hasParameters() const { return !parameters.empty(); }
+
+std::vector<double> ReacEval::makeInputBuffer() const {
+  std::vector<double> input(nVariables, 0.0);
+  input.insert(input.end(), parameters.cbegin(), parameters.cend());
+  return input;
+}
+
+void ReacEval::setParameter(std::size_t parameterIndex, double value) {
+  parameters[parameterIndex] = value;
+}
+
 void SimCompartment::spatiallyAverageDcdt() {
   // for any non-spatial species: spatially average dc/dt:
   // roughly equivalent to infinite rate of diffusion
@@ -89,7 +110,8 @@ SimCompartment::SimCompartment(
     const model::Model &doc, const geometry::Compartment *compartment,
     std::vector<std::string> sIds, bool doCSE, unsigned optLevel,
     bool timeDependent, bool spaceDependent,
-    const std::map<std::string, double, std::less<>> &substitutions)
+    const std::map<std::string, double, std::less<>> &substitutions,
+    const std::vector<std::pair<std::string, double>> &runtimeParameters)
     : comp{compartment}, nPixels{compartment->nPixels()}, nSpecies{sIds.size()},
       compartmentId{compartment->getId()}, speciesIds{std::move(sIds)} {
   // get species in compartment
@@ -120,7 +142,8 @@ SimCompartment::SimCompartment(
     reactionIDs = common::toStdString(reacsInCompartment);
   }
   reacEval = ReacEval(doc, speciesIds, reactionIDs, 1.0, doCSE, optLevel,
-                      timeDependent, spaceDependent, substitutions);
+                      timeDependent, spaceDependent, substitutions,
+                      runtimeParameters);
   if (timeDependent) {
     speciesIds.push_back("time");
     diffConstants.push_back(0);
@@ -160,6 +183,11 @@ SimCompartment::SimCompartment(
   assert(concIter == conc.end());
 }
 
+void SimCompartment::setRuntimeParameter(std::size_t parameterIndex,
+                                         double value) {
+  reacEval.setParameter(parameterIndex, value);
+}
+
 void SimCompartment::evaluateDiffusionOperator(std::size_t begin,
                                                std::size_t end) {
 #ifdef SPATIAL_MODEL_EDITOR_WITH_OPENMP
@@ -194,11 +222,30 @@ void SimCompartment::evaluateDiffusionOperator_tbb() {
 #endif
 
 void SimCompartment::evaluateReactions(std::size_t begin, std::size_t end) {
+  if (!reacEval.hasParameters()) {
 #ifdef SPATIAL_MODEL_EDITOR_WITH_OPENMP
 #pragma omp parallel for
 #endif
-  for (std::size_t i = begin; i < end; ++i) {
-    reacEval.evaluate(dcdt.data() + i * nSpecies, conc.data() + i * nSpecies);
+    for (std::size_t i = begin; i < end; ++i) {
+      reacEval.evaluate(dcdt.data() + i * nSpecies,
+                        conc.data() + i * nSpecies);
+    }
+    return;
+  }
+#ifdef SPATIAL_MODEL_EDITOR_WITH_OPENMP
+#pragma omp parallel
+#endif
+  {
+    // runtime parameters are written to each thread's input buffer once,
+    // then only the species of each pixel are copied
+    auto input{reacEval.makeInputBuffer()};
+#ifdef SPATIAL_MODEL_EDITOR_WITH_OPENMP
+#pragma omp for
+#endif
+    for (std::size_t i = begin; i < end; ++i) {
+      std::copy_n(conc.data() + i * nSpecies, nSpecies, input.data());
+      reacEval.evaluate(dcdt.data() + i * nSpecies, input.data());
+    }
   }
 }
 
@@ -370,10 +417,11 @@ void SimCompartment::undoRKStep_tbb() {
 }
 #endif
 
-PixelIntegratorError SimCompartment::calculateRKError(double epsilon) const {
+PixelIntegratorError SimCompartment::calculateRKError(
+    double epsilon, std::size_t beginPixel, std::size_t endPixel,
+    std::vector<SpeciesReduction> *reductions) const {
   PixelIntegratorError err{0.0, 0.0};
-  std::size_t n{conc.size()};
-  for (std::size_t i = 0; i < n; ++i) {
+  for (std::size_t i = beginPixel * nSpecies; i < endPixel * nSpecies; ++i) {
     double localErr = std::abs(conc[i] - s2[i]);
     err.abs = std::max(err.abs, localErr);
     // average current and previous concentrations and add a (hopefully) small
@@ -381,9 +429,76 @@ PixelIntegratorError SimCompartment::calculateRKError(double epsilon) const {
     double localNorm = 0.5 * (conc[i] + s3[i] + epsilon);
     err.rel = std::max(err.rel, localErr / localNorm);
   }
+  if (reductions != nullptr) {
+    // this block of conc is still in cache from the error calculation
+    for (std::size_t ix = beginPixel; ix < endPixel; ++ix) {
+      for (std::size_t is = 0; is < nSpecies; ++is) {
+        (*reductions)[is].add(conc[ix * nSpecies + is]);
+      }
+    }
+  }
+  return err;
+}
+
+// combine the errors and reductions of each block in a fixed order, so that
+// the reductions don't depend on the number of threads
+static PixelIntegratorError
+mergeRKErrors(const std::vector<PixelIntegratorError> &errors,
+              const std::vector<std::vector<SpeciesReduction>> &partials,
+              std::vector<SpeciesReduction> *reductions) {
+  PixelIntegratorError err{0.0, 0.0};
+  for (const auto &e : errors) {
+    err.abs = std::max(err.abs, e.abs);
+    err.rel = std::max(err.rel, e.rel);
+  }
+  if (reductions != nullptr) {
+    for (const auto &partial : partials) {
+      for (std::size_t is = 0; is < partial.size(); ++is) {
+        (*reductions)[is].merge(partial[is]);
+      }
+    }
+  }
   return err;
 }
 
+PixelIntegratorError SimCompartment::calculateRKError(
+    double epsilon, std::vector<SpeciesReduction> *reductions) const {
+  auto blocks{getReductionBlocks(nPixels)};
+  std::vector<PixelIntegratorError> errors(blocks.size());
+  std::vector<std::vector<SpeciesReduction>> partials;
+  if (reductions != nullptr) {
+    partials.assign(blocks.size(), *reductions);
+  }
+  auto nBlocks{blocks.size()};
+#ifdef SPATIAL_MODEL_EDITOR_WITH_OPENMP
+#pragma omp parallel for
+#endif
+  for (std::size_t b = 0; b < nBlocks; ++b) {
+    errors[b] = calculateRKError(epsilon, blocks[b].first, blocks[b].second,
+                                 reductions == nullptr ? nullptr
+                                                       : &partials[b]);
+  }
+  return mergeRKErrors(errors, partials, reductions);
+}
+
+#ifdef SPATIAL_MODEL_EDITOR_WITH_TBB
+PixelIntegratorError SimCompartment::calculateRKError_tbb(
+    double epsilon, std::vector<SpeciesReduction> *reductions) const {
+  auto blocks{getReductionBlocks(nPixels)};
+  std::vector<PixelIntegratorError> errors(blocks.size());
+  std::vector<std::vector<SpeciesReduction>> partials;
+  if (reductions != nullptr) {
+    partials.assign(blocks.size(), *reductions);
+  }
+  common::parallelFor(blocks.size(), [&](std::size_t b) {
+    errors[b] = calculateRKError(epsilon, blocks[b].first, blocks[b].second,
+                                 reductions == nullptr ? nullptr
+                                                       : &partials[b]);
+  });
+  return mergeRKErrors(errors, partials, reductions);
+}
+#endif
+
 std::string SimCompartment::plotRKError(QImage &image, double epsilon,
                                         double max) const {
   if (image.isNull()) {
@@ -429,6 +544,13 @@ void SimCompartment::setConcentrations(
   conc = concentrations;
 }
 
+void SimCompartment::setSpeciesConcentration(
+    std::size_t speciesIndex, const std::vector<double> &values) {
+  for (std::size_t ix = 0; ix < values.size(); ++ix) {
+    conc[ix * nSpecies + speciesIndex] = values[ix];
+  }
+}
+
 double
 SimCompartment::getLowerOrderConcentration(std::size_t speciesIndex,
                                            std::size_t pixelIndex) const {
@@ -452,7 +574,8 @@ SimMembrane::SimMembrane(
     const model::Model &doc, const geometry::Membrane *membrane_ptr,
     SimCompartment *simCompA, SimCompartment *simCompB, bool doCSE,
     unsigned optLevel, bool timeDependent, bool spaceDependent,
-    const std::map<std::string, double, std::less<>> &substitutions)
+    const std::map<std::string, double, std::less<>> &substitutions,
+    const std::vector<std::pair<std::string, double>> &runtimeParameters)
     : membrane(membrane_ptr), compA(simCompA), compB(simCompB) {
   if (timeDependent) {
     ++nExtraVars;
@@ -505,9 +628,9 @@ SimMembrane::SimMembrane(
   // make vector of reaction IDs from membrane
   std::vector<std::string> reactionID =
       common::toStdString(doc.getReactions().getIds(membrane->getId().c_str()));
-  reacEval =
-      ReacEval(doc, speciesIds, reactionID, volOverL3 / pixelWidth, doCSE,
-               optLevel, timeDependent, spaceDependent, substitutions);
+  reacEval = ReacEval(doc, speciesIds, reactionID, volOverL3 / pixelWidth,
+                      doCSE, optLevel, timeDependent, spaceDependent,
+                      substitutions, runtimeParameters);
 }
 
 void SimMembrane::evaluateReactions() {
@@ -527,7 +650,8 @@ void SimMembrane::evaluateReactions() {
     concB = &compB->getConcentrations();
     dcdtB = &compB->getDcdt();
   }
-  std::vector<double> species(nSpeciesA + nSpeciesB + nExtraVars, 0);
+  // followed by any runtime parameters
+  auto species{reacEval.makeInputBuffer()};
   std::vector<double> result(nSpeciesA + nSpeciesB + nExtraVars, 0);
   for (const auto &[ixA, ixB] : membrane->getIndexPairs()) {
     // populate species concentrations: first A, then B, then t,x,y
@@ -556,4 +680,9 @@ void SimMembrane::evaluateReactions() {
   }
 }
 
+void SimMembrane::setRuntimeParameter(std::size_t parameterIndex,
+                                      double value) {
+  reacEval.setParameter(parameterIndex, value);
+}
+
 } // namespace sme::simulate
@@ -1,5 +1,6 @@
 // Pixel simulator implementation
 //  - ReacEval: evaluates reaction terms at a single location
+//     - runtime parameters are kernel inputs that can be changed in place
 //  - SimCompartment: evaluates reactions in a compartment
 //  - SimMembrane: evaluates reactions in a membrane
 
@@ -7,12 +8,15 @@
 
 #include "pde.hpp"
 #include "simulate_options.hpp"
+#include "simulate_reductions.hpp"
 #include "symbolic.hpp"
 #include <QImage>
 #include <QPoint>
 #include <cstddef>
 #include <limits>
+#include <map>
 #include <string>
+#include <utility>
 #include <vector>
 
 namespace sme {
@@ -38,6 +42,10 @@ class ReacEval {
 private:
   // symengine reaction expression
   common::Symbolic sym;
+  // number of species (including t,x,y) supplied as input to evaluate
+  std::size_t nVariables{0};
+  // values of runtime parameters, appended to the species as kernel inputs
+  std::vector<double> parameters;
 
 public:
   ReacEval() = default;
@@ -47,13 +55,20 @@ public:
       double reactionScaleFactor = 1.0, bool doCSE = true,
       unsigned optLevel = 3, bool timeDependent = false,
       bool spaceDependent = false,
-      const std::map<std::string, double, std::less<>> &substitutions = {});
+      const std::map<std::string, double, std::less<>> &substitutions = {},
+      const std::vector<std::pair<std::string, double>> &runtimeParameters =
+          {});
   ReacEval(ReacEval &&) noexcept = default;
   ReacEval(const ReacEval &) = delete;
   ReacEval &operator=(ReacEval &&) noexcept = default;
   ReacEval &operator=(const ReacEval &) = delete;
   ~ReacEval() = default;
+  // input: species (including t,x,y), followed by any runtime parameters
   void evaluate(double *output, const double *input) const;
+  [[nodiscard]] bool hasParameters() const;
+  // input for evaluate with the current runtime parameters, species zero
+  [[nodiscard]] std::vector<double> makeInputBuffer() const;
+  void setParameter(std::size_t parameterIndex, double value);
 };
 
 class SimCompartment {
@@ -81,7 +96,9 @@ public:
       const model::Model &doc, const geometry::Compartment *compartment,
       std::vector<std::string> sIds, bool doCSE = true, unsigned optLevel = 3,
       bool timeDependent = false, bool spaceDependent = false,
-      const std::map<std::string, double, std::less<>> &substitutions = {});
+      const std::map<std::string, double, std::less<>> &substitutions = {},
+      const std::vector<std::pair<std::string, double>> &runtimeParameters =
+          {});
   SimCompartment(SimCompartment &&) noexcept = default;
   SimCompartment(const SimCompartment &) = delete;
   SimCompartment &operator=(SimCompartment &&) noexcept = default;
@@ -101,6 +118,7 @@ public:
   void evaluateReactions_tbb();
 #endif
   void spatiallyAverageDcdt();
+  void setRuntimeParameter(std::size_t parameterIndex, double value);
   void doForwardsEulerTimestep(double dt, std::size_t begin, std::size_t end);
   void doForwardsEulerTimestep(double dt);
 #ifdef SPATIAL_MODEL_EDITOR_WITH_TBB
@@ -136,12 +154,27 @@ public:
 #ifdef SPATIAL_MODEL_EDITOR_WITH_TBB
   void undoRKStep_tbb();
 #endif
-  [[nodiscard]] PixelIntegratorError calculateRKError(double epsilon) const;
+  // if reductions is not null, the concentrations are also added to the
+  // reductions of each species in the same pass over the pixels
+  PixelIntegratorError
+  calculateRKError(double epsilon, std::size_t beginPixel,
+                   std::size_t endPixel,
+                   std::vector<SpeciesReduction> *reductions) const;
+  PixelIntegratorError
+  calculateRKError(double epsilon,
+                   std::vector<SpeciesReduction> *reductions = nullptr) const;
+#ifdef SPATIAL_MODEL_EDITOR_WITH_TBB
+  PixelIntegratorError calculateRKError_tbb(
+      double epsilon,
+      std::vector<SpeciesReduction> *reductions = nullptr) const;
+#endif
   std::string plotRKError(QImage &image, double epsilon, double max) const;
   [[nodiscard]] const std::string &getCompartmentId() const;
   [[nodiscard]] const std::vector<std::string> &getSpeciesIds() const;
   [[nodiscard]] const std::vector<double> &getConcentrations() const;
   void setConcentrations(const std::vector<double> &);
+  void setSpeciesConcentration(std::size_t speciesIndex,
+                               const std::vector<double> &values);
   [[nodiscard]] double getLowerOrderConcentration(std::size_t speciesIndex,
                                                   std::size_t pixelIndex) const;
   [[nodiscard]] const std::vector<QPoint> &getPixels() const;
@@ -163,13 +196,16 @@ public:
       SimCompartment *simCompA, SimCompartment *simCompB, bool doCSE = true,
       unsigned optLevel = 3, bool timeDependent = false,
       bool spaceDependent = false,
-      const std::map<std::string, double, std::less<>> &substitutions = {});
+      const std::map<std::string, double, std::less<>> &substitutions = {},
+      const std::vector<std::pair<std::string, double>> &runtimeParameters =
+          {});
   SimMembrane(SimMembrane &&) noexcept = default;
   SimMembrane(const SimMembrane &) = delete;
   SimMembrane &operator=(SimMembrane &&) noexcept = default;
   SimMembrane &operator=(const SimMembrane &) = delete;
   ~SimMembrane() = default;
   void evaluateReactions();
+  void setRuntimeParameter(std::size_t parameterIndex, double value);
 };
 
 } // namespace simulate
@@ -2,6 +2,7 @@
 #include "model.hpp"
 #include "model_test_utils.hpp"
 #include "pixelsim.hpp"
+#include <algorithm>
 
 using namespace sme;
 using namespace sme::test;
@@ -17,4 +18,64 @@ TEST_CASE("PixelSim", "[core/simulate/pixelsim][core/"
     pixelSim.run(1, -1, []() { return true; });
     REQUIRE(pixelSim.errorMessage() == "Simulation stopped early");
   }
+  SECTION("Event-targeted parameter is updated without re-compiling") {
+    auto m{getExampleModel(Mod::ABtoC)};
+    m.getParameters().add("p");
+    m.getParameters().setExpression("p", "0");
+    m.getReactions().setRateExpression("r1", "p*A*B");
+    m.getEvents().add("e", "p");
+    m.getEvents().setTime("e", 1.0);
+    m.getEvents().setExpression("e", "1");
+    std::vector<std::string> comps{"comp"};
+    std::vector<std::vector<std::string>> specs{{"A", "B", "C"}};
+    simulate::PixelSim pixelSim(m, comps, specs);
+    REQUIRE(pixelSim.errorMessage().empty());
+    REQUIRE(pixelSim.setRuntimeParameter("idontexist", 1.0) == false);
+    // p = 0: no C is produced
+    pixelSim.run(0.1, -1, {});
+    REQUIRE(pixelSim.errorMessage().empty());
+    const auto &c{pixelSim.getConcentrations(0)};
+    double maxC{0};
+    for (std::size_t i = 2; i < c.size(); i += 3) {
+      maxC = std::max(maxC, c[i]);
+    }
+    REQUIRE(maxC == dbl_approx(0.0));
+    // p = 1: C is produced
+    REQUIRE(pixelSim.setRuntimeParameter("p", 1.0) == true);
+    pixelSim.run(0.1, -1, {});
+    REQUIRE(pixelSim.errorMessage().empty());
+    for (std::size_t i = 2; i < c.size(); i += 3) {
+      maxC = std::max(maxC, c[i]);
+    }
+    REQUIRE(maxC > 0.0);
+  }
+  SECTION("Setting one species leaves the others unchanged") {
+    auto m{getExampleModel(Mod::ABtoC)};
+    std::vector<std::string> comps{"comp"};
+    std::vector<std::vector<std::string>> specs{{"A", "B", "C"}};
+    simulate::PixelSim pixelSim(m, comps, specs);
+    pixelSim.run(0.1, -1, {});
+    REQUIRE(pixelSim.errorMessage().empty());
+    const auto before{pixelSim.getConcentrations(0)};
+    const std::size_t stride{3 + pixelSim.getConcentrationPadding()};
+    const std::size_t nPixels{before.size() / stride};
+    pixelSim.setSpeciesConcentration(0, 1, std::vector<double>(nPixels, 7.0));
+    const auto &after{pixelSim.getConcentrations(0)};
+    REQUIRE(after.size() == before.size());
+    for (std::size_t i = 0; i < after.size(); ++i) {
+      if (i % stride == 1) {
+        REQUIRE(after[i] == dbl_approx(7.0));
+      } else {
+        REQUIRE(after[i] == dbl_approx(before[i]));
+      }
+    }
+  }
+  SECTION("Unknown runtime parameter is an error") {
+    auto m{getExampleModel(Mod::ABtoC)};
+    std::vector<std::string> comps{"comp"};
+    std::vector<std::vector<std::string>> specs{{"A", "B", "C"}};
+    simulate::PixelSim pixelSim(m, comps, specs, {}, {"idontexist"});
+    REQUIRE(pixelSim.errorMessage() ==
+            "Unknown runtime parameter 'idontexist'");
+  }
 }
@@ -0,0 +1,308 @@
+#include "result_stream.hpp"
+#include "chunked_file.hpp"
+#include "logger.hpp"
+#include <QByteArray>
+#include <algorithm>
+#include <cstring>
+#include <optional>
+#include <utility>
+
+namespace sme::simulate {
+
+using common::appendValue;
+using common::chunkHeaderBytes;
+using common::readValue;
+
+constexpr common::ChunkedFileMagic fileMagic{'S', 'M', 'E', 'R',
+                                             'E', 'S', 'L', 'T'};
+constexpr std::uint32_t fileVersion{1};
+constexpr std::uint32_t chunkTimepoint{1};
+constexpr std::uint32_t chunkIndex{2};
+
+ResultStreamWriter::ResultStreamWriter(const QString &filename,
+                                       std::size_t maxQueuedTimepoints)
+    : file{filename}, maxQueued{std::max(maxQueuedTimepoints, std::size_t{1})},
+      writer{&ResultStreamWriter::consume, this} {
+  auto header{common::chunkedFileHeader(fileMagic, fileVersion)};
+  std::scoped_lock lock{mutex};
+  if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate) ||
+      file.write(header) != header.size() || !file.flush()) {
+    SPDLOG_WARN("Failed to open file {} for streaming results",
+                filename.toStdString());
+    hasError = true;
+  }
+}
+
+ResultStreamWriter::~ResultStreamWriter() { close(); }
+
+bool ResultStreamWriter::isValid() const {
+  std::scoped_lock lock{mutex};
+  return !hasError;
+}
+
+void ResultStreamWriter::append(
+    double time, std::size_t concPadding,
+    std::shared_ptr<const ConcentrationSnapshot> concentration) {
+  {
+    std::unique_lock lock{mutex};
+    if (stopRequested) {
+      SPDLOG_WARN("Stream closed: ignoring timepoint {}", time);
+      return;
+    }
+    queueChanged.wait(lock, [this]() { return queue.size() < maxQueued; });
+    queue.push_back({time, concPadding, std::move(concentration)});
+  }
+  queueChanged.notify_all();
+}
+
+void ResultStreamWriter::flush() {
+  std::unique_lock lock{mutex};
+  queueChanged.wait(lock, [this]() { return queue.empty() && !isWriting; });
+}
+
+void ResultStreamWriter::close() {
+  {
+    std::scoped_lock lock{mutex};
+    if (stopRequested) {
+      return;
+    }
+    stopRequested = true;
+  }
+  queueChanged.notify_all();
+  // any remaining timepoints are written before the writer returns
+  writer.join();
+  std::scoped_lock lock{mutex};
+  if (!hasError && !writeIndex()) {
+    SPDLOG_WARN("Failed to write index to file {}",
+                file.fileName().toStdString());
+    hasError = true;
+  }
+  file.close();
+}
+
+std::size_t ResultStreamWriter::size() const {
+  std::scoped_lock lock{mutex};
+  return nWritten;
+}
+
+void ResultStreamWriter::consume() {
+  std::unique_lock lock{mutex};
+  while (true) {
+    queueChanged.wait(lock,
+                      [this]() { return !queue.empty() || stopRequested; });
+    if (queue.empty()) {
+      return;
+    }
+    auto timepoint{std::move(queue.front())};
+    queue.pop_front();
+    isWriting = true;
+    bool skip{hasError};
+    lock.unlock();
+    queueChanged.notify_all();
+    bool success{skip || write(timepoint)};
+    lock.lock();
+    if (!skip) {
+      if (success) {
+        ++nWritten;
+      } else {
+        SPDLOG_WARN("Failed to write timepoint {} to file {}", timepoint.time,
+                    file.fileName().toStdString());
+        hasError = true;
+      }
+    }
+    isWriting = false;
+    queueChanged.notify_all();
+  }
+}
+
+bool ResultStreamWriter::write(const Timepoint &timepoint) {
+  const auto &concentration{*timepoint.concentration};
+  std::uint64_t payloadBytes{3 * sizeof(std::uint64_t)};
+  for (const auto &c : concentration) {
+    payloadBytes += sizeof(std::uint64_t) + c.size() * sizeof(double);
+  }
+  QByteArray bytes{common::chunkHeader(chunkTimepoint, payloadBytes)};
+  bytes.reserve(static_cast<qsizetype>(chunkHeaderBytes + payloadBytes));
+  appendValue(bytes, timepoint.time);
+  appendValue(bytes, static_cast<std::uint64_t>(timepoint.concPadding));
+  appendValue(bytes, static_cast<std::uint64_t>(concentration.size()));
+  for (const auto &c : concentration) {
+    appendValue(bytes, static_cast<std::uint64_t>(c.size()));
+    bytes.append(reinterpret_cast<const char *>(c.data()),
+                 static_cast<qsizetype>(c.size() * sizeof(double)));
+  }
+  auto offset{static_cast<std::uint64_t>(file.pos())};
+  // flush after each chunk so the file is readable while the run continues
+  if (file.write(bytes) != bytes.size() || !file.flush()) {
+    return false;
+  }
+  index.emplace_back(timepoint.time, offset);
+  return true;
+}
+
+bool ResultStreamWriter::writeIndex() {
+  QByteArray payload;
+  payload.reserve(static_cast<qsizetype>(
+      sizeof(std::uint64_t) +
+      index.size() * (sizeof(double) + sizeof(std::uint64_t))));
+  appendValue(payload, static_cast<std::uint64_t>(index.size()));
+  for (auto [time, timeOffset] : index) {
+    appendValue(payload, time);
+    appendValue(payload, timeOffset);
+  }
+  return common::writeIndexChunk(file, chunkIndex, payload) && file.flush();
+}
+
+ResultStreamReader::ResultStreamReader(const QString &filename)
+    : file{filename} {
+  // unbuffered: the file may be modified by a writer between reads
+  if (!file.open(QIODevice::ReadOnly | QIODevice::Unbuffered)) {
+    SPDLOG_WARN("Failed to open file {}", filename.toStdString());
+    return;
+  }
+  auto version{common::readChunkedFileVersion(file, fileMagic)};
+  if (!version.has_value()) {
+    SPDLOG_WARN("File {} is not a result stream", filename.toStdString());
+    return;
+  }
+  if (version.value() > fileVersion) {
+    SPDLOG_WARN("Unsupported result stream version {}", version.value());
+    return;
+  }
+  valid = true;
+  scanOffset = common::chunkedFileHeaderBytes;
+  update();
+}
+
+bool ResultStreamReader::readIndex() {
+  auto indexChunk{common::readIndexChunk(file, chunkIndex)};
+  if (!indexChunk.has_value()) {
+    return false;
+  }
+  const auto &payload{indexChunk->payload};
+  if (payload.size() < static_cast<qsizetype>(sizeof(std::uint64_t))) {
+    return false;
+  }
+  const char *ptr{payload.constData()};
+  auto n{readValue<std::uint64_t>(ptr)};
+  if (static_cast<std::uint64_t>(payload.size()) !=
+      sizeof(n) + n * (sizeof(double) + sizeof(std::uint64_t))) {
+    return false;
+  }
+  entries.clear();
+  entries.reserve(n);
+  for (std::uint64_t i = 0; i < n; ++i) {
+    auto time{readValue<double>(ptr)};
+    entries.push_back({time, readValue<std::uint64_t>(ptr)});
+  }
+  complete = true;
+  return true;
+}
+
+std::size_t ResultStreamReader::update() {
+  if (!valid || complete || readIndex()) {
+    return entries.size();
+  }
+  auto fileSize{static_cast<std::uint64_t>(file.size())};
+  while (scanOffset + chunkHeaderBytes <= fileSize) {
+    auto header{common::readChunkHeader(file, scanOffset)};
+    if (!header.has_value() ||
+        scanOffset + chunkHeaderBytes + header->payloadBytes > fileSize) {
+      // final chunk is still being written
+      break;
+    }
+    if (header->type == chunkTimepoint &&
+        header->payloadBytes >= sizeof(double)) {
+      auto bytes{file.read(sizeof(double))};
+      if (bytes.size() != sizeof(double)) {
+        break;
+      }
+      const char *ptr{bytes.constData()};
+      entries.push_back({readValue<double>(ptr), scanOffset});
+    }
+    scanOffset += chunkHeaderBytes + header->payloadBytes;
+  }
+  return entries.size();
+}
+
+bool ResultStreamReader::isValid() const { return valid; }
+
+bool ResultStreamReader::isComplete() const { return complete; }
+
+std::size_t ResultStreamReader::size() const { return entries.size(); }
+
+double ResultStreamReader::getTime(std::size_t timeIndex) const {
+  return entries[timeIndex].time;
+}
+
+std::size_t ResultStreamReader::getConcPadding(std::size_t timeIndex) {
+  if (!file.seek(static_cast<qint64>(entries[timeIndex].offset +
+                                     chunkHeaderBytes + sizeof(double)))) {
+    return 0;
+  }
+  auto bytes{file.read(sizeof(std::uint64_t))};
+  if (bytes.size() != sizeof(std::uint64_t)) {
+    return 0;
+  }
+  const char *ptr{bytes.constData()};
+  return static_cast<std::size_t>(readValue<std::uint64_t>(ptr));
+}
+
+// sizes read from the payload are checked against its length, so that a
+// corrupt chunk can't cause reads beyond the end of the payload
+static std::optional<ConcentrationSnapshot>
+parseConcentrations(const QByteArray &payload) {
+  constexpr auto valueBytes{sizeof(std::uint64_t)};
+  static_assert(sizeof(double) == valueBytes);
+  const char *ptr{payload.constData()};
+  const char *end{ptr + payload.size()};
+  auto remainingValues{[&ptr, end]() {
+    return static_cast<std::uint64_t>(end - ptr) / valueBytes;
+  }};
+  if (remainingValues() < 3) {
+    return {};
+  }
+  ptr += sizeof(double) + sizeof(std::uint64_t);
+  auto nCompartments{readValue<std::uint64_t>(ptr)};
+  // each compartment needs at least its size
+  if (nCompartments > remainingValues()) {
+    return {};
+  }
+  ConcentrationSnapshot concentration(static_cast<std::size_t>(nCompartments));
+  for (auto &c : concentration) {
+    if (remainingValues() < 1) {
+      return {};
+    }
+    auto n{readValue<std::uint64_t>(ptr)};
+    if (n > remainingValues()) {
+      return {};
+    }
+    c.resize(static_cast<std::size_t>(n));
+    std::memcpy(c.data(), ptr, c.size() * sizeof(double));
+    ptr += c.size() * sizeof(double);
+  }
+  if (ptr != end) {
+    return {};
+  }
+  return concentration;
+}
+
+ConcentrationSnapshot
+ResultStreamReader::getConcentrations(std::size_t timeIndex) {
+  auto payload{
+      common::readChunk(file, entries[timeIndex].offset, chunkTimepoint)};
+  if (!payload.has_value()) {
+    SPDLOG_WARN("Failed to read timepoint {} from file {}", timeIndex,
+                file.fileName().toStdString());
+    return {};
+  }
+  auto concentration{parseConcentrations(payload.value())};
+  if (!concentration.has_value()) {
+    SPDLOG_WARN("Invalid timepoint {} in file {}", timeIndex,
+                file.fileName().toStdString());
+    return {};
+  }
+  return std::move(concentration.value());
+}
+
+} // namespace sme::simulate
@@ -0,0 +1,136 @@
+#include "catch_wrapper.hpp"
+#include "result_stream.hpp"
+#include <QFile>
+#include <cstdint>
+#include <memory>
+
+using namespace sme;
+
+static std::shared_ptr<const simulate::ConcentrationSnapshot>
+makeSnapshot(double value) {
+  return std::make_shared<const simulate::ConcentrationSnapshot>(
+      simulate::ConcentrationSnapshot{{value, 2.0 * value, 3.0 * value, 0.0},
+                                      {-value},
+                                      {}});
+}
+
+TEST_CASE("ResultStream", "[core/simulate/result_stream][core/"
+                          "simulate][core][result_stream]") {
+  const char *filename{"tmpresultstream.dat"};
+  SECTION("write, then read") {
+    {
+      simulate::ResultStreamWriter writer(filename, 2);
+      REQUIRE(writer.isValid());
+      for (int i = 0; i < 10; ++i) {
+        writer.append(0.1 * i, 1, makeSnapshot(static_cast<double>(i)));
+      }
+      writer.close();
+      REQUIRE(writer.size() == 10);
+      // appending to a closed stream is ignored
+      writer.append(1.0, 1, makeSnapshot(10.0));
+      REQUIRE(writer.size() == 10);
+    }
+    simulate::ResultStreamReader reader(filename);
+    REQUIRE(reader.isValid());
+    REQUIRE(reader.isComplete());
+    REQUIRE(reader.size() == 10);
+    for (std::size_t i = 0; i < 10; ++i) {
+      auto value{static_cast<double>(i)};
+      REQUIRE(reader.getTime(i) == dbl_approx(0.1 * value));
+      REQUIRE(reader.getConcPadding(i) == 1);
+      REQUIRE(reader.getConcentrations(i) == *makeSnapshot(value));
+    }
+    // random access in any order
+    REQUIRE(reader.getConcentrations(7) == *makeSnapshot(7.0));
+    REQUIRE(reader.getConcentrations(2) == *makeSnapshot(2.0));
+  }
+  SECTION("read while writing") {
+    simulate::ResultStreamWriter writer(filename);
+    writer.append(0.0, 0, makeSnapshot(0.0));
+    writer.append(1.0, 0, makeSnapshot(1.0));
+    writer.flush();
+    REQUIRE(writer.size() == 2);
+    simulate::ResultStreamReader reader(filename);
+    REQUIRE(reader.isValid());
+    REQUIRE(!reader.isComplete());
+    REQUIRE(reader.size() == 2);
+    REQUIRE(reader.getConcentrations(1) == *makeSnapshot(1.0));
+    writer.append(2.0, 0, makeSnapshot(2.0));
+    writer.flush();
+    REQUIRE(reader.size() == 2);
+    REQUIRE(reader.update() == 3);
+    REQUIRE(!reader.isComplete());
+    REQUIRE(reader.getTime(2) == dbl_approx(2.0));
+    REQUIRE(reader.getConcentrations(2) == *makeSnapshot(2.0));
+    writer.close();
+    REQUIRE(reader.update() == 3);
+    REQUIRE(reader.isComplete());
+    REQUIRE(reader.getConcentrations(0) == *makeSnapshot(0.0));
+  }
+  SECTION("incomplete final chunk is ignored") {
+    {
+      simulate::ResultStreamWriter writer(filename);
+      writer.append(0.0, 0, makeSnapshot(0.0));
+      writer.append(1.0, 0, makeSnapshot(1.0));
+    }
+    QFile file(filename);
+    REQUIRE(file.open(QIODevice::ReadWrite));
+    // remove footer, index and part of the last timepoint
+    REQUIRE(file.resize(file.size() - 80));
+    file.close();
+    simulate::ResultStreamReader reader(filename);
+    REQUIRE(reader.isValid());
+    REQUIRE(!reader.isComplete());
+    REQUIRE(reader.size() == 1);
+    REQUIRE(reader.getConcentrations(0) == *makeSnapshot(0.0));
+  }
+  SECTION("corrupt timepoint chunks are not read") {
+    {
+      simulate::ResultStreamWriter writer(filename);
+      for (int i = 0; i < 4; ++i) {
+        writer.append(0.1 * i, 0, makeSnapshot(static_cast<double>(i)));
+      }
+    }
+    QFile file(filename);
+    REQUIRE(file.open(QIODevice::ReadWrite));
+    auto writeValue{[&file](qint64 offset, std::uint64_t value) {
+      REQUIRE(file.seek(offset));
+      REQUIRE(file.write(reinterpret_cast<const char *>(&value),
+                         sizeof(value)) == sizeof(value));
+    }};
+    // each chunk: 16 byte header, then time, padding, number of compartments
+    // and for each compartment its size and values: 88 byte payload
+    constexpr qint64 chunkBytes{16 + 88};
+    constexpr qint64 firstChunk{16};
+    // number of compartments larger than the payload
+    writeValue(firstChunk + 16 + 16, std::uint64_t{1} << 40);
+    // size of first compartment larger than the payload
+    writeValue(firstChunk + chunkBytes + 16 + 24, 1000);
+    // payload truncated to fewer bytes than the number of compartments
+    writeValue(firstChunk + 2 * chunkBytes + 8, 20);
+    file.close();
+    simulate::ResultStreamReader reader(filename);
+    REQUIRE(reader.isValid());
+    REQUIRE(reader.isComplete());
+    REQUIRE(reader.size() == 4);
+    REQUIRE(reader.getConcentrations(0).empty());
+    REQUIRE(reader.getConcentrations(1).empty());
+    REQUIRE(reader.getConcentrations(2).empty());
+    REQUIRE(reader.getConcentrations(3) == *makeSnapshot(3.0));
+  }
+  SECTION("invalid files") {
+    simulate::ResultStreamReader missing("tmpresultstream_missing.dat");
+    REQUIRE(!missing.isValid());
+    REQUIRE(missing.size() == 0);
+    QFile file(filename);
+    REQUIRE(file.open(QIODevice::WriteOnly | QIODevice::Truncate));
+    file.write("not a result stream");
+    file.close();
+    simulate::ResultStreamReader reader(filename);
+    REQUIRE(!reader.isValid());
+    REQUIRE(reader.size() == 0);
+    simulate::ResultStreamWriter writer("invalid_dir/tmpresultstream.dat");
+    REQUIRE(!writer.isValid());
+  }
+  QFile::remove(filename);
+}
@@ -1,4 +1,5 @@
 #include "simulate.hpp"
+#include "conc_image_pyramid.hpp"
 #include "dunesim.hpp"
 #include "geometry.hpp"
 #include "logger.hpp"
@@ -6,12 +7,20 @@
 #include "model.hpp"
 #include "pde.hpp"
 #include "pixelsim.hpp"
+#include "snapshot_publisher.hpp"
 #include "utils.hpp"
+#include <QDir>
 #include <QElapsedTimer>
+#include <QFile>
+#include <QTemporaryFile>
 #include <algorithm>
+#include <cmath>
 #include <limits>
 #include <numeric>
 #include <utility>
+#ifdef SPATIAL_MODEL_EDITOR_WITH_TBB
+#include <tbb/parallel_for.h>
+#endif
 
 namespace sme::simulate {
 
@@ -43,6 +52,47 @@ void Simulation::initModel() {
       compartments.push_back(comp);
     }
   }
+  // pixels grouped by image row, so that images can be drawn one row at a time
+  imageRows.assign(static_cast<std::size_t>(std::max(imageSize.height(), 0)),
+                   {});
+  for (std::size_t ic = 0; ic < compartments.size(); ++ic) {
+    const auto &pixels{compartments[ic]->getPixels()};
+    for (std::size_t ix = 0; ix < pixels.size(); ++ix) {
+      const auto &p{pixels[ix]};
+      imageRows[static_cast<std::size_t>(p.y())].push_back({p.x(), ic, ix});
+    }
+  }
+}
+
+void Simulation::initStorage() {
+  const auto &storage{settings->storage};
+  auto &concentration{data->concentration};
+  if (auto compression{concentration.getCompression()};
+      compression.enabled != storage.compress ||
+      (storage.compress && compression.maxAbsError != storage.maxAbsError)) {
+    compression.enabled = storage.compress;
+    compression.maxAbsError = storage.maxAbsError;
+    concentration.useCompression(compression);
+  }
+  if (storage.useFile == concentration.isMemoryMapped()) {
+    return;
+  }
+  if (!storage.useFile) {
+    concentration.useMemory();
+    return;
+  }
+  // the store removes the file when it is no longer used
+  QTemporaryFile file(QDir::temp().filePath("sme-concentrations-XXXXXX"));
+  file.setAutoRemove(false);
+  if (!file.open()) {
+    SPDLOG_WARN("Failed to create temporary file: using memory");
+    return;
+  }
+  auto filename{file.fileName()};
+  file.close();
+  if (!concentration.useMemoryMappedFile(filename)) {
+    QFile::remove(filename);
+  }
 }
 
 void Simulation::initEvents() {
@@ -93,6 +143,12 @@ void Simulation::initEvents() {
 void Simulation::applyNextEvent() {
   const auto &ev{simEvents.front()};
   SPDLOG_INFO("Applying SimEvent at time {}", ev.time);
+  // events modify the stored concentrations
+  publisher->flush();
+  // the pixel simulator can apply events in place,
+  // otherwise the simulator is re-constructed with the updated values
+  auto *pixelSim{dynamic_cast<PixelSim *>(simulator.get())};
+  bool reinitSimulator{pixelSim == nullptr};
   // apply events to model
   auto &events{model.getEvents()};
   for (const auto &id : ev.ids) {
@@ -102,6 +158,9 @@ void Simulation::applyNextEvent() {
       double val{events.getValue(id.c_str())};
       eventSubstitutions[var] = val;
       SPDLOG_INFO("    {} = {}", var, val);
+      if (pixelSim != nullptr && !pixelSim->setRuntimeParameter(var, val)) {
+        reinitSimulator = true;
+      }
     } else {
       // species initial concentration
       const auto &sId{var};
@@ -118,88 +177,129 @@ void Simulation::applyNextEvent() {
       std::size_t speciesIndex{
           common::element_index(compartmentSpeciesIds[compIndex], sId)};
       SPDLOG_INFO("    species[{}] = {}", speciesIndex, sId);
-      auto &c{data->concentration.back()[compIndex]};
-      const std::size_t stride{simulator->getConcentrationPadding() +
-                               compartmentSpeciesIds[compIndex].size()};
-      SPDLOG_INFO("    stride = {}", stride);
-      for (std::size_t iPixel = 0; iPixel < tempConc.size(); ++iPixel) {
-        c[stride * iPixel + speciesIndex] = tempConc[iPixel];
+      auto concs{*data->concentration.back()};
+      if (pixelSim != nullptr) {
+        // only the targeted species changes in the live simulator state,
+        // which then replaces this compartment in the stored snapshot
+        pixelSim->setSpeciesConcentration(compIndex, speciesIndex, tempConc);
+        concs[compIndex] = pixelSim->getConcentrations(compIndex);
+      } else {
+        auto &c{concs[compIndex]};
+        const std::size_t stride{simulator->getConcentrationPadding() +
+                                 compartmentSpeciesIds[compIndex].size()};
+        SPDLOG_INFO("    stride = {}", stride);
+        for (std::size_t iPixel = 0; iPixel < tempConc.size(); ++iPixel) {
+          c[stride * iPixel + speciesIndex] = tempConc[iPixel];
+        }
       }
+      data->concentration.replaceBack(std::move(concs));
+      pyramid->remove(data->concentration.size() - 1);
     }
   }
-  // re-init simulator
-  simulator.reset();
-  if (settings->simulatorType == SimulatorType::DUNE &&
-      model.getGeometry().getMesh() != nullptr &&
-      model.getGeometry().getMesh()->isValid()) {
-    simulator =
-        std::make_unique<DuneSim>(model, compartmentIds, eventSubstitutions);
-  } else {
-    simulator = std::make_unique<PixelSim>(
-        model, compartmentIds, compartmentSpeciesIds, eventSubstitutions);
+  if (reinitSimulator) {
+    simulator.reset();
+    if (settings->simulatorType == SimulatorType::DUNE &&
+        model.getGeometry().getMesh() != nullptr &&
+        model.getGeometry().getMesh()->isValid()) {
+      simulator =
+          std::make_unique<DuneSim>(model, compartmentIds, eventSubstitutions);
+    } else {
+      simulator = std::make_unique<PixelSim>(model, compartmentIds,
+                                             compartmentSpeciesIds,
+                                             eventSubstitutions,
+                                             runtimeParameterIds);
+    }
+    simulator->setQuantileAccuracy(quantileAccuracy);
   }
   // remove applied simEvent
   simEvents.pop();
 }
 
-static std::vector<AvgMinMax>
-calculateAvgMinMax(const std::vector<double> &concs, std::size_t nSpecies,
-                   std::size_t concPadding) {
-  std::vector<AvgMinMax> avgMinMax(nSpecies);
-  std::size_t stride{nSpecies + concPadding};
-  for (std::size_t ix = 0; ix < concs.size() / stride; ++ix) {
-    for (std::size_t is = 0; is < nSpecies; ++is) {
-      auto &a = avgMinMax[is];
-      double c = concs[ix * stride + is];
-      a.avg += c;
-      a.max = std::max(a.max, c);
-      a.min = std::min(a.min, c);
-    }
+void Simulation::updateConcentrations(double t, bool isTimestep) {
+  SPDLOG_DEBUG("publishing Concentrations at time {}", t);
+  Snapshot snapshot{t, simulator->getConcentrationPadding(), {}, isTimestep};
+  snapshot.concentration.resize(compartments.size());
+  for (std::size_t compIndex = 0; compIndex < compartments.size();
+       ++compIndex) {
+    simulator->takeConcentrations(compIndex,
+                                  snapshot.concentration[compIndex]);
   }
-  for (auto &a : avgMinMax) {
-    a.avg /= static_cast<double>(concs.size()) / static_cast<double>(stride);
-  }
-  return avgMinMax;
-}
-
-void Simulation::updateConcentrations(double t) {
-  SPDLOG_DEBUG("updating Concentrations at time {}", t);
-  data->timePoints.push_back(t);
-  data->concPadding.push_back(simulator->getConcentrationPadding());
-  auto &c = data->concentration.emplace_back();
-  c.reserve(compartments.size());
-  auto &a = data->avgMinMax.emplace_back();
-  a.reserve(compartments.size());
-  if (data->concentrationMax.empty()) {
-    auto &m = data->concentrationMax.emplace_back();
-    for (std::size_t i = 0; i < compartments.size(); ++i) {
-      std::size_t nSpecies = compartmentSpeciesIds[i].size();
-      m.push_back(std::vector<double>(nSpecies, 0.0));
+  // use reductions from the simulator if available for all compartments,
+  // otherwise the publisher computes them
+  snapshot.reductions.resize(compartments.size());
+  for (std::size_t compIndex = 0; compIndex < compartments.size();
+       ++compIndex) {
+    if (!simulator->takeReductions(compIndex,
+                                   snapshot.reductions[compIndex])) {
+      snapshot.reductions.clear();
+      break;
     }
-  } else {
-    data->concentrationMax.push_back(data->concentrationMax.back());
   }
+  lastTimePoint = t;
+  publisher->publish(std::move(snapshot));
+}
+
+void Simulation::recordProbes(double t) {
+  if (probeRecorder == nullptr) {
+    return;
+  }
+  std::vector<const std::vector<double> *> concs;
+  concs.reserve(compartments.size());
   for (std::size_t compIndex = 0; compIndex < compartments.size();
        ++compIndex) {
-    std::size_t nSpecies{compartmentSpeciesIds[compIndex].size()};
-    const auto &compConcs{simulator->getConcentrations(compIndex)};
-    c.push_back(compConcs);
-    a.push_back(
-        calculateAvgMinMax(compConcs, nSpecies, data->concPadding.back()));
-    auto &maxS{data->concentrationMax.back()[compIndex]};
-    for (std::size_t is = 0; is < nSpecies; ++is) {
-      maxS[is] = std::max(maxS[is], a.back()[is].max);
+    concs.push_back(&simulator->getConcentrations(compIndex));
+  }
+  probeRecorder->record(t, concs, simulator->getConcentrationPadding());
+}
+
+std::size_t
+Simulation::runSimulator(double startTime, double time, double timeout_ms,
+                         const std::function<bool()> &stopRunningCallback) {
+  if (probeRecorder == nullptr) {
+    return simulator->run(time, timeout_ms, stopRunningCallback);
+  }
+  QElapsedTimer timer;
+  timer.start();
+  double interval{probeRecorder->getInterval()};
+  // sample times within this fraction of an interval are treated as equal
+  constexpr double fractionIntervalEpsilon{1e-9};
+  const double eps{fractionIntervalEpsilon * interval};
+  const double endTime{startTime + time};
+  double k{std::floor((startTime + eps) / interval) + 1.0};
+  double t{startTime};
+  std::size_t steps{0};
+  while (t < endTime) {
+    double tSample{k * interval};
+    double tNext{tSample > endTime - eps ? endTime : tSample};
+    double remaining_timeout_ms{-1.0};
+    if (timeout_ms >= 0.0) {
+      remaining_timeout_ms =
+          std::max(timeout_ms - static_cast<double>(timer.elapsed()), 0.0);
+    }
+    steps += simulator->run(tNext - t, remaining_timeout_ms,
+                            stopRunningCallback);
+    if (!simulator->errorMessage().empty() || stopRequested.load()) {
+      return steps;
+    }
+    if (std::abs(tNext - tSample) < eps) {
+      recordProbes(tNext);
+      k += 1.0;
     }
+    t = tNext;
   }
+  return steps;
 }
 
-Simulation::Simulation(model::Model &model)
-    : model(model), settings(&model.getSimulationSettings()),
+Simulation::Simulation(model::Model &model,
+                       std::vector<std::string> runtimeParamIds)
+    : runtimeParameterIds{std::move(runtimeParamIds)}, model(model),
+      settings(&model.getSimulationSettings()),
       data{&model.getSimulationData()},
       imageSize(model.getGeometry().getImage().size()) {
   if (data->timePoints.size() <= 1) {
     SPDLOG_INFO("starting new simulation");
     data->clear();
+    initStorage();
   } else {
     SPDLOG_INFO("continuing existing simulation with {} timepoints",
                 data->timePoints.size());
@@ -213,14 +313,50 @@ Simulation::Simulation(model::Model &model)
     simulator =
         std::make_unique<DuneSim>(model, compartmentIds, eventSubstitutions);
   } else {
-    simulator = std::make_unique<PixelSim>(
-        model, compartmentIds, compartmentSpeciesIds, eventSubstitutions);
+    simulator =
+        std::make_unique<PixelSim>(model, compartmentIds, compartmentSpeciesIds,
+                                   eventSubstitutions, runtimeParameterIds);
+  }
+  std::vector<std::size_t> nSpecies;
+  for (const auto &speciesIds : compartmentSpeciesIds) {
+    nSpecies.push_back(speciesIds.size());
+  }
+  // observable values that do not match the timepoints are re-evaluated
+  if (data->observables.size() != data->timePoints.size()) {
+    data->observables.clear();
+  }
+  // reductions are not saved, so are empty for timepoints loaded from a file
+  while (data->reductions.size() < data->timePoints.size()) {
+    std::vector<std::vector<SpeciesReduction>> r;
+    for (auto n : nSpecies) {
+      r.emplace_back(n);
+    }
+    data->reductions.push_back(std::move(r));
   }
+  pyramid =
+      std::make_unique<ConcImagePyramid>(imageSize, compartments, nSpecies);
+  publisher = std::make_unique<SnapshotPublisher>(
+      data, std::move(nSpecies), [this]() {
+        auto timeIndex{nCompletedTimesteps++};
+        if (timestepStoredCallback) {
+          timestepStoredCallback(timeIndex);
+        }
+      });
+  if (const auto &probes{settings->probes};
+      probes.interval > 0.0 && !probes.probes.empty()) {
+    probeRecorder = std::make_unique<ProbeRecorder>(
+        model, probes, compartmentIds, compartmentSpeciesIds);
+  }
+  data->concentration.setRetention(settings->retention);
+  initObservables();
   if (simulator->errorMessage().empty()) {
     nCompletedTimesteps.store(data->timePoints.size());
     if (data->timePoints.empty()) {
+      recordProbes(0);
       updateConcentrations(0);
-      ++nCompletedTimesteps;
+      publisher->flush();
+    } else {
+      lastTimePoint = data->timePoints.back();
     }
   }
 }
@@ -238,8 +374,9 @@ std::size_t Simulation::doMultipleTimesteps(
   isRunning.store(true);
   stopRequested.store(false);
   if (data->timePoints.empty()) {
+    recordProbes(0);
     updateConcentrations(0);
-    ++nCompletedTimesteps;
+    publisher->flush();
   }
   std::size_t nStepsTotal{0};
   for (const auto &timestep : timesteps) {
@@ -250,9 +387,8 @@ std::size_t Simulation::doMultipleTimesteps(
   for (const auto &timestep : timesteps) {
     settings->times.push_back(timestep);
   }
-  // ensure there is enough space that push_back won't cause a reallocation
-  // todo: there should be a mutex/lock here in case reserve() reallocates
-  // to avoid a user getting garbage data while the vector contents are moving
+  // pre-allocate storage for the new timepoints: existing timepoints never
+  // move, so results can safely be read while the simulation is running
   data->reserve(data->size() + nStepsTotal);
   std::size_t steps{0};
   double remaining_timeout_ms{-1.0};
@@ -271,7 +407,7 @@ std::size_t Simulation::doMultipleTimesteps(
       // if an event would occur within this fraction of a timestep then apply
       // it now, rather than doing a minuscule extra simulation step
       constexpr double fractionTimestepEpsilon{1e-12};
-      double currentTime{data->timePoints.back()};
+      double currentTime{lastTimePoint};
       while (std::abs(currentTime - nextEventTime) / time <
              fractionTimestepEpsilon) {
         SPDLOG_INFO("t={}, applying event at {}", currentTime, nextEventTime);
@@ -285,38 +421,49 @@ std::size_t Simulation::doMultipleTimesteps(
         double subTimeStep{nextEventTime - currentTime};
         SPDLOG_INFO("Sub-step of {} to apply event at {}", subTimeStep,
                     nextEventTime);
-        steps += simulator->run(subTimeStep, remaining_timeout_ms,
-                                stopRunningCallback);
+        steps += runSimulator(currentTime, subTimeStep, remaining_timeout_ms,
+                              stopRunningCallback);
         // update intermediate concentrations to be able to apply them to model
-        updateConcentrations(currentTime + subTimeStep);
+        updateConcentrations(currentTime + subTimeStep, false);
         // apply event
         applyNextEvent();
         nextEventTime = simEvents.front().time;
         // remove intermediate concentrations
+        pyramid->remove(data->size() - 1);
         data->pop_back();
+        lastTimePoint = data->timePoints.back();
         currentTime += subTimeStep;
         currentTimeStep -= subTimeStep;
         SPDLOG_INFO("Remaining time step: {}", currentTimeStep);
       }
-      steps += simulator->run(currentTimeStep, remaining_timeout_ms,
-                              stopRunningCallback);
-      if (!simulator->errorMessage().empty() || stopRequested.load()) {
+      steps += runSimulator(currentTime, currentTimeStep, remaining_timeout_ms,
+                            stopRunningCallback);
+      if (!errorMessage().empty() || stopRequested.load()) {
+        publisher->flush();
         isRunning.store(false);
         stopRequested.store(false);
         simulator->setStopRequested(false);
         return steps;
       }
-      updateConcentrations(data->timePoints.back() + time);
-      ++nCompletedTimesteps;
+      updateConcentrations(lastTimePoint + time);
     }
   }
+  publisher->flush();
   isRunning.store(false);
   stopRequested.store(false);
   simulator->setStopRequested(false);
   return steps;
 }
 
+void Simulation::setTimestepStoredCallback(
+    std::function<void(std::size_t timeIndex)> callback) {
+  timestepStoredCallback = std::move(callback);
+}
+
 const std::string &Simulation::errorMessage() const {
+  if (publisher != nullptr && !publisher->errorMessage().empty()) {
+    return publisher->errorMessage();
+  }
   return simulator->errorMessage();
 }
 
@@ -336,7 +483,7 @@ Simulation::getSpeciesColors(std::size_t compartmentIndex) const {
   return compartmentSpeciesColors[compartmentIndex];
 }
 
-const std::vector<double> &Simulation::getTimePoints() const {
+const common::AppendOnlyVector<double> &Simulation::getTimePoints() const {
   return data->timePoints;
 }
 
@@ -346,12 +493,99 @@ const AvgMinMax &Simulation::getAvgMinMax(std::size_t timeIndex,
   return data->avgMinMax[timeIndex][compartmentIndex][speciesIndex];
 }
 
+const SpeciesReduction &
+Simulation::getReduction(std::size_t timeIndex, std::size_t compartmentIndex,
+                         std::size_t speciesIndex) const {
+  return data->reductions[timeIndex][compartmentIndex][speciesIndex];
+}
+
+void Simulation::setQuantileAccuracy(double relativeAccuracy) {
+  quantileAccuracy = relativeAccuracy;
+  simulator->setQuantileAccuracy(relativeAccuracy);
+  publisher->setQuantileAccuracy(relativeAccuracy);
+}
+
+std::vector<std::string>
+Simulation::setObservables(std::vector<Observable> observables) {
+  std::vector<std::string> errors;
+  if (isRunning.load()) {
+    // the evaluator would miss timepoints queued for storage
+    SPDLOG_WARN("Cannot change observables while a simulation is running");
+    errors.assign(observables.size(),
+                  "Cannot change observables while a simulation is running");
+    return errors;
+  }
+  publisher->flush();
+  data->observables.clear();
+  data->observableDefinitions = std::move(observables);
+  return initObservables();
+}
+
+std::vector<std::string> Simulation::initObservables() {
+  std::vector<std::string> errors;
+  if (data->observableDefinitions.empty()) {
+    data->observables.clear();
+    publisher->setObservables(nullptr);
+    return errors;
+  }
+  auto evaluator{std::make_shared<const ObservableEvaluator>(
+      model, data->observableDefinitions, compartmentIds,
+      compartmentSpeciesIds)};
+  const auto &obs{evaluator->getObservables()};
+  for (std::size_t i = 0; i < obs.size(); ++i) {
+    errors.push_back(evaluator->getErrorMessage(i));
+  }
+  // existing timepoints without values, e.g. loaded from an older file
+  std::size_t n{data->timePoints.size()};
+  data->observables.reserve(n);
+  for (std::size_t it = data->observables.size(); it < n; ++it) {
+    auto concs{data->concentration.get(it)};
+    if (concs->empty()) {
+      // concentrations discarded by the retention policy
+      data->observables.push_back(std::vector<double>(
+          obs.size(), std::numeric_limits<double>::quiet_NaN()));
+      continue;
+    }
+    data->observables.push_back(evaluator->evaluate(
+        data->timePoints[it], *concs, data->concPadding[it]));
+  }
+  publisher->setObservables(std::move(evaluator));
+  return errors;
+}
+
+const std::vector<Observable> &Simulation::getObservables() const {
+  return data->observableDefinitions;
+}
+
+std::vector<double>
+Simulation::getObservableValues(std::size_t observableIndex) const {
+  std::vector<double> values;
+  values.reserve(data->observables.size());
+  for (const auto &v : data->observables) {
+    values.push_back(v[observableIndex]);
+  }
+  return values;
+}
+
+ProbeSamples Simulation::getProbeSamples() const {
+  if (probeRecorder == nullptr) {
+    return {};
+  }
+  return probeRecorder->getSamples();
+}
+
 std::vector<double> Simulation::getConc(std::size_t timeIndex,
                                         std::size_t compartmentIndex,
                                         std::size_t speciesIndex) const {
   std::vector<double> c;
-  const auto &compConc = data->concentration[timeIndex][compartmentIndex];
+  auto concs{data->concentration.get(timeIndex)};
   std::size_t nPixels = compartments[compartmentIndex]->nPixels();
+  if (concs->empty()) {
+    // concentrations discarded by the retention policy
+    c.assign(nPixels, std::numeric_limits<double>::quiet_NaN());
+    return c;
+  }
+  const auto &compConc{(*concs)[compartmentIndex]};
   std::size_t nSpecies = compartmentSpeciesIds[compartmentIndex].size();
   c.reserve(nPixels);
   std::size_t stride{nSpecies + data->concPadding[timeIndex]};
@@ -366,7 +600,7 @@ std::vector<double> Simulation::getConcArray(std::size_t timeIndex,
                                              std::size_t speciesIndex) const {
   std::vector<double> c(
       static_cast<std::size_t>(imageSize.width() * imageSize.height()), 0.0);
-  const auto &compConc = data->concentration[timeIndex][compartmentIndex];
+  auto concs{data->concentration.get(timeIndex)};
   const auto &comp = compartments[compartmentIndex];
   std::size_t nPixels = comp->nPixels();
   std::size_t nSpecies = compartmentSpeciesIds[compartmentIndex].size();
@@ -375,13 +609,22 @@ std::vector<double> Simulation::getConcArray(std::size_t timeIndex,
     const auto &point = comp->getPixel(ix);
     auto arrayIndex{static_cast<std::size_t>(
         point.x() + imageSize.width() * (imageSize.height() - 1 - point.y()))};
-    c[arrayIndex] = compConc[ix * stride + speciesIndex];
+    // NaN if discarded by the retention policy
+    c[arrayIndex] = std::numeric_limits<double>::quiet_NaN();
+    if (!concs->empty()) {
+      c[arrayIndex] = (*concs)[compartmentIndex][ix * stride + speciesIndex];
+    }
   }
   return c;
 }
 
 void Simulation::applyConcsToModel(model::Model &m,
                                    std::size_t timeIndex) const {
+  if (!data->concentration.isRetained(timeIndex)) {
+    SPDLOG_WARN("Concentrations of timepoint {} were not retained",
+                timeIndex);
+    return;
+  }
   for (std::size_t iCompartment = 0; iCompartment < compartmentIds.size();
        ++iCompartment) {
     const auto &speciesIds{getSpeciesIds(iCompartment)};
@@ -419,13 +662,20 @@ double Simulation::getLowerOrderConc(std::size_t compartmentIndex,
   return 0;
 }
 
-QImage Simulation::getConcImage(
+// colour ramp for a drawn species: colour * concentration / max
+struct SpeciesColour {
+  std::size_t speciesIndex;
+  double max;
+  double r;
+  double g;
+  double b;
+};
+
+// compartment->colour ramp of each drawn species
+std::vector<std::vector<SpeciesColour>> Simulation::getSpeciesColours(
     std::size_t timeIndex,
     const std::vector<std::vector<std::size_t>> &speciesToDraw,
     bool normaliseOverAllTimepoints, bool normaliseOverAllSpecies) const {
-  if (compartments.empty()) {
-    return QImage();
-  }
   constexpr double minimumNonzeroConc{100.0 *
                                       std::numeric_limits<double>::min()};
   const auto *speciesIndices = &speciesToDraw;
@@ -456,38 +706,128 @@ QImage Simulation::getConcImage(
       std::fill(c.begin(), c.end(), maxC);
     }
   }
-  // apply minimum (avoid dividing by zero)
+  std::vector<std::vector<SpeciesColour>> colours(compartments.size());
   for (std::size_t ic = 0; ic < compartments.size(); ++ic) {
     for (std::size_t is : (*speciesIndices)[ic]) {
-      if (maxConcs[ic][is] < minimumNonzeroConc) {
-        maxConcs[ic][is] = minimumNonzeroConc;
-      }
+      const auto &col{compartmentSpeciesColors[ic][is]};
+      // apply minimum (avoid dividing by zero)
+      colours[ic].push_back({is, std::max(maxConcs[ic][is], minimumNonzeroConc),
+                             static_cast<double>(qRed(col)),
+                             static_cast<double>(qGreen(col)),
+                             static_cast<double>(qBlue(col))});
     }
   }
+  return colours;
+}
+
+// c: the concentrations of one pixel, where species are interleaved with
+// those of the other pixels, so each drawn species is gathered through its
+// index: this loop is not vectorised, the speed-up of getConcImage comes
+// from drawing rows in parallel and writing each scanline directly
+template <typename T>
+static QRgb blendColours(const T *c, const std::vector<SpeciesColour> &cols) {
+  int r{0};
+  int g{0};
+  int b{0};
+  for (const auto &col : cols) {
+    double f{static_cast<double>(c[col.speciesIndex]) / col.max};
+    r += static_cast<int>(col.r * f);
+    g += static_cast<int>(col.g * f);
+    b += static_cast<int>(col.b * f);
+  }
+  return qRgb(std::min(r, 255), std::min(g, 255), std::min(b, 255));
+}
+
+QImage Simulation::getConcImage(
+    std::size_t timeIndex,
+    const std::vector<std::vector<std::size_t>> &speciesToDraw,
+    bool normaliseOverAllTimepoints, bool normaliseOverAllSpecies) const {
+  if (compartments.empty()) {
+    return QImage();
+  }
+  auto colours{getSpeciesColours(timeIndex, speciesToDraw,
+                                 normaliseOverAllTimepoints,
+                                 normaliseOverAllSpecies)};
+  std::vector<std::size_t> strides(compartments.size());
+  for (std::size_t ic = 0; ic < compartments.size(); ++ic) {
+    strides[ic] = compartmentSpeciesIds[ic].size() +
+                  data->concPadding[timeIndex];
+  }
   QImage img(imageSize, QImage::Format_ARGB32_Premultiplied);
+  if (img.isNull()) {
+    return img;
+  }
+  auto concs{data->concentration.get(timeIndex)};
+  if (concs->empty()) {
+    // concentrations discarded by the retention policy
+    img.fill(qRgba(0, 0, 0, 0));
+    return img;
+  }
+  // write each row directly to the image data
+  uchar *bits{img.bits()};
+  auto bytesPerLine{static_cast<std::size_t>(img.bytesPerLine())};
+  auto width{static_cast<std::size_t>(img.width())};
+  auto drawRows{[&](std::size_t begin, std::size_t end) {
+    for (std::size_t y = begin; y < end; ++y) {
+      auto *line{reinterpret_cast<QRgb *>(bits + y * bytesPerLine)};
+      std::fill(line, line + width, qRgba(0, 0, 0, 0));
+      for (const auto &pixel : imageRows[y]) {
+        const auto ic{pixel.compartmentIndex};
+        line[pixel.x] = blendColours(
+            (*concs)[ic].data() + pixel.pixelIndex * strides[ic], colours[ic]);
+      }
+    }
+  }};
+#ifdef SPATIAL_MODEL_EDITOR_WITH_TBB
+  tbb::parallel_for(tbb::blocked_range<std::size_t>(0, imageRows.size()),
+                    [&drawRows](const tbb::blocked_range<std::size_t> &r) {
+                      drawRows(r.begin(), r.end());
+                    });
+#else
+#ifdef SPATIAL_MODEL_EDITOR_WITH_OPENMP
+#pragma omp parallel for
+#endif
+  for (std::size_t y = 0; y < imageRows.size(); ++y) {
+    drawRows(y, y + 1);
+  }
+#endif
+  return img;
+}
+
+QImage Simulation::getConcImagePreview(
+    std::size_t timeIndex, const QSize &displaySize,
+    const std::vector<std::vector<std::size_t>> &speciesToDraw,
+    bool normaliseOverAllTimepoints, bool normaliseOverAllSpecies) const {
+  auto levelIndex{pyramid->findLevel(displaySize)};
+  if (compartments.empty() || levelIndex == pyramid->nLevels()) {
+    return getConcImage(timeIndex, speciesToDraw, normaliseOverAllTimepoints,
+                        normaliseOverAllSpecies);
+  }
+  if (!data->concentration.isRetained(timeIndex)) {
+    pyramid->remove(timeIndex);
+    return getConcImage(timeIndex, speciesToDraw, normaliseOverAllTimepoints,
+                        normaliseOverAllSpecies);
+  }
+  auto levels{pyramid->get(timeIndex)};
+  if (levels == nullptr) {
+    // levels are only computed for timepoints that are displayed
+    levels = pyramid->add(timeIndex, *data->concentration.get(timeIndex),
+                          data->concPadding[timeIndex]);
+  }
+  auto colours{getSpeciesColours(timeIndex, speciesToDraw,
+                                 normaliseOverAllTimepoints,
+                                 normaliseOverAllSpecies)};
+  const auto &level{pyramid->getLevel(levelIndex)};
+  QImage img(level.size, QImage::Format_ARGB32_Premultiplied);
   img.fill(qRgba(0, 0, 0, 0));
-  // iterate over compartments
   for (std::size_t ic = 0; ic < compartments.size(); ++ic) {
-    const auto &pixels{compartments[ic]->getPixels()};
-    const auto &conc{data->concentration[timeIndex][ic]};
-    std::size_t nSpecies = compartmentSpeciesIds[ic].size();
-    std::size_t stride{nSpecies + data->concPadding[timeIndex]};
-    for (std::size_t ix = 0; ix < pixels.size(); ++ix) {
-      const QPoint &p{pixels[ix]};
-      int r = 0;
-      int g = 0;
-      int b = 0;
-      for (std::size_t is : (*speciesIndices)[ic]) {
-        double c = conc[ix * stride + is] / maxConcs[ic][is];
-        const auto &col = compartmentSpeciesColors[ic][is];
-        r += static_cast<int>(qRed(col) * c);
-        g += static_cast<int>(qGreen(col) * c);
-        b += static_cast<int>(qBlue(col) * c);
-      }
-      r = r < 256 ? r : 255;
-      g = g < 256 ? g : 255;
-      b = b < 256 ? b : 255;
-      img.setPixel(p, qRgb(r, g, b));
+    const auto &conc{(*levels)[levelIndex][ic]};
+    const auto nSpecies{compartmentSpeciesIds[ic].size()};
+    const auto &pixels{level.pixels[ic]};
+    for (std::size_t i = 0; i < pixels.size(); ++i) {
+      const auto &p{pixels[i].point};
+      reinterpret_cast<QRgb *>(img.scanLine(p.y()))[p.x()] =
+          blendColours(conc.data() + i * nSpecies, colours[ic]);
     }
   }
   return img;
@@ -498,59 +838,108 @@ Simulation::getPyNames(std::size_t compartmentIndex) const {
   return compartmentSpeciesNames[compartmentIndex];
 }
 
-static std::size_t pointToPyIndex(const QPoint &p, std::size_t w) {
-  auto x{static_cast<std::size_t>(p.x())};
-  auto y{static_cast<std::size_t>(p.y())};
-  return x + w * y;
+// scatter the species values of each compartment pixel into a dense
+// (species, height, width) array, with zero outside the compartment
+static std::vector<double>
+toPyArray(const std::vector<double> &values, std::size_t stride,
+          const std::vector<QPoint> &pixels,
+          const std::vector<std::size_t> &speciesIndices, std::size_t nSpecies,
+          const QSize &imageSize) {
+  const auto w{static_cast<std::size_t>(imageSize.width())};
+  const auto nPixels{w * static_cast<std::size_t>(imageSize.height())};
+  std::vector<double> pyArray(nSpecies * nPixels, 0.0);
+  for (std::size_t ix = 0; ix < pixels.size(); ++ix) {
+    const auto pyIndex{static_cast<std::size_t>(pixels[ix].x()) +
+                       w * static_cast<std::size_t>(pixels[ix].y())};
+    const double *pixelValues{values.data() + ix * stride};
+    for (std::size_t is : speciesIndices) {
+      pyArray[is * nPixels + pyIndex] = pixelValues[is];
+    }
+  }
+  return pyArray;
+}
+
+// dense array for a timepoint whose concentrations were discarded
+static std::vector<double> discardedPyArray(std::size_t nSpecies,
+                                            const QSize &imageSize) {
+  return std::vector<double>(nSpecies *
+                                 static_cast<std::size_t>(imageSize.width()) *
+                                 static_cast<std::size_t>(imageSize.height()),
+                             std::numeric_limits<double>::quiet_NaN());
 }
 
-std::vector<std::vector<double>>
+std::vector<double>
 Simulation::getPyConcs(std::size_t timeIndex,
                        std::size_t compartmentIndex) const {
-  // start with zero concentration everywhere for all species
-  std::vector<std::vector<double>> pyConcs(
-      compartmentSpeciesIds[compartmentIndex].size(),
-      std::vector<double>(
-          static_cast<std::size_t>(imageSize.width() * imageSize.height()),
-          0.0));
-  const auto w{static_cast<std::size_t>(imageSize.width())};
-  const auto &pixels{compartments[compartmentIndex]->getPixels()};
-  const auto &conc{data->concentration[timeIndex][compartmentIndex]};
+  auto concs{data->concentration.get(timeIndex)};
   const std::size_t nSpecies{compartmentSpeciesIds[compartmentIndex].size()};
-  const std::size_t stride{nSpecies + data->concPadding[timeIndex]};
-  for (std::size_t ix = 0; ix < pixels.size(); ++ix) {
-    const auto pyIndex{pointToPyIndex(pixels[ix], w)};
-    for (std::size_t is : compartmentSpeciesIndices[compartmentIndex]) {
-      pyConcs[is][pyIndex] = conc[ix * stride + is];
-    }
+  if (concs->empty()) {
+    return discardedPyArray(nSpecies, imageSize);
   }
-  return pyConcs;
+  return toPyArray((*concs)[compartmentIndex],
+                   nSpecies + data->concPadding[timeIndex],
+                   compartments[compartmentIndex]->getPixels(),
+                   compartmentSpeciesIndices[compartmentIndex], nSpecies,
+                   imageSize);
 }
 
-[[nodiscard]] std::vector<std::vector<double>>
+std::vector<double>
 Simulation::getPyDcdts(std::size_t compartmentIndex) const {
   // dcdt is only available from pixel sim, and only for the last timestep
   PixelSim *pixelSim{dynamic_cast<PixelSim *>(simulator.get())};
   if (pixelSim == nullptr || data->concPadding.empty()) {
     return {};
   }
-  std::vector<std::vector<double>> pyDcdts(
-      compartmentSpeciesIds[compartmentIndex].size(),
-      std::vector<double>(
-          static_cast<std::size_t>(imageSize.width() * imageSize.height()),
-          0.0));
-  const auto w{static_cast<std::size_t>(imageSize.width())};
-  const auto &pixels{compartments[compartmentIndex]->getPixels()};
-  const auto &dcdt{pixelSim->getDcdt(compartmentIndex)};
   const std::size_t nSpecies{compartmentSpeciesIds[compartmentIndex].size()};
-  const std::size_t stride{nSpecies + data->concPadding.back()};
-  for (std::size_t ix = 0; ix < pixels.size(); ++ix) {
-    const auto pyIndex{pointToPyIndex(pixels[ix], w)};
-    for (std::size_t is : compartmentSpeciesIndices[compartmentIndex]) {
-      pyDcdts[is][pyIndex] = dcdt[ix * stride + is];
+  return toPyArray(pixelSim->getDcdt(compartmentIndex),
+                   nSpecies + data->concPadding.back(),
+                   compartments[compartmentIndex]->getPixels(),
+                   compartmentSpeciesIndices[compartmentIndex], nSpecies,
+                   imageSize);
+}
+
+struct SimulationResults::Layout {
+  QSize imageSize{};
+  // compartment->species
+  std::vector<std::vector<std::string>> speciesNames{};
+  std::vector<std::vector<std::size_t>> speciesIndices{};
+  // compartment->pixels
+  std::vector<std::vector<QPoint>> pixels{};
+  // compartment->colour ramp of each species
+  std::vector<std::vector<SpeciesColour>> colours{};
+};
+
+SimulationResults Simulation::getResults(bool includeDcdt) const {
+  SimulationResults results;
+  const std::size_t n{nCompletedTimesteps.load()};
+  if (n == 0) {
+    return results;
+  }
+  auto layout{std::make_shared<SimulationResults::Layout>()};
+  layout->imageSize = imageSize;
+  layout->speciesNames = compartmentSpeciesNames;
+  layout->speciesIndices = compartmentSpeciesIndices;
+  for (const auto *compartment : compartments) {
+    layout->pixels.push_back(compartment->getPixels());
+  }
+  // normalised over all timepoints: same colours for every timepoint
+  layout->colours = getSpeciesColours(n - 1, {}, true, false);
+  results.layout = std::move(layout);
+  results.timePoints.reserve(n);
+  results.concPadding.reserve(n);
+  for (std::size_t i = 0; i < n; ++i) {
+    results.timePoints.push_back(data->timePoints[i]);
+    results.concPadding.push_back(data->concPadding[i]);
+  }
+  results.concentrations = data->concentration.getReader();
+  if (const auto *pixelSim{dynamic_cast<const PixelSim *>(simulator.get())};
+      includeDcdt && pixelSim != nullptr) {
+    for (std::size_t ic = 0; ic < compartments.size(); ++ic) {
+      results.dcdt.push_back(pixelSim->getDcdt(ic));
     }
+    results.dcdtPadding = data->concPadding[n - 1];
   }
-  return pyDcdts;
+  return results;
 }
 
 std::size_t Simulation::getNCompletedTimesteps() const {
@@ -568,4 +957,80 @@ void Simulation::requestStop() {
   simulator->setStopRequested(true);
 }
 
+SimulationResults::SimulationResults()
+    : layout{std::make_shared<const Layout>()} {}
+
+std::size_t SimulationResults::size() const { return timePoints.size(); }
+
+double SimulationResults::getTimePoint(std::size_t timeIndex) const {
+  return timePoints[timeIndex];
+}
+
+const QSize &SimulationResults::getImageSize() const {
+  return layout->imageSize;
+}
+
+std::size_t SimulationResults::getNumCompartments() const {
+  return layout->speciesNames.size();
+}
+
+const std::vector<std::string> &
+SimulationResults::getPyNames(std::size_t compartmentIndex) const {
+  return layout->speciesNames[compartmentIndex];
+}
+
+QImage SimulationResults::getConcImage(std::size_t timeIndex) const {
+  if (layout->pixels.empty()) {
+    return QImage();
+  }
+  QImage img(layout->imageSize, QImage::Format_ARGB32_Premultiplied);
+  if (img.isNull()) {
+    return img;
+  }
+  img.fill(qRgba(0, 0, 0, 0));
+  auto snapshot{concentrations.get(timeIndex)};
+  const auto &concs{*snapshot};
+  if (concs.empty()) {
+    return img;
+  }
+  for (std::size_t ic = 0; ic < layout->pixels.size(); ++ic) {
+    const auto stride{layout->speciesNames[ic].size() + concPadding[timeIndex]};
+    const auto &pixels{layout->pixels[ic]};
+    for (std::size_t ix = 0; ix < pixels.size(); ++ix) {
+      const auto &p{pixels[ix]};
+      reinterpret_cast<QRgb *>(img.scanLine(p.y()))[p.x()] = blendColours(
+          concs[ic].data() + ix * stride, layout->colours[ic]);
+    }
+  }
+  return img;
+}
+
+std::vector<double>
+SimulationResults::getPyConcs(std::size_t timeIndex,
+                              std::size_t compartmentIndex) const {
+  const auto nSpecies{layout->speciesNames[compartmentIndex].size()};
+  auto concs{concentrations.get(timeIndex)};
+  if (concs->empty()) {
+    return discardedPyArray(nSpecies, layout->imageSize);
+  }
+  return toPyArray((*concs)[compartmentIndex],
+                   nSpecies + concPadding[timeIndex],
+                   layout->pixels[compartmentIndex],
+                   layout->speciesIndices[compartmentIndex], nSpecies,
+                   layout->imageSize);
+}
+
+std::vector<double>
+SimulationResults::getPyDcdts(std::size_t timeIndex,
+                              std::size_t compartmentIndex) const {
+  if (dcdt.empty() || timeIndex + 1 != timePoints.size()) {
+    return {};
+  }
+  const auto nSpecies{layout->speciesNames[compartmentIndex].size()};
+  return toPyArray(dcdt[compartmentIndex], nSpecies + dcdtPadding,
+                   layout->pixels[compartmentIndex],
+                   layout->speciesIndices[compartmentIndex], nSpecies,
+                   layout->imageSize);
+}
+
 } // namespace sme::simulate
@@ -37,6 +37,21 @@ static void simulate_Simulation_getConcImage(benchmark::State &state) {
   }
 }
 
+template <typename T>
+static void
+simulate_Simulation_getConcImage_normaliseAll(benchmark::State &state) {
+  T data;
+  data.model.getSimulationSettings().simulatorType =
+      simulate::SimulatorType::Pixel;
+  simulate::Simulation simulation(data.model);
+  simulation.doTimesteps(0.001, 1);
+  QImage img;
+  for (auto _ : state) {
+    img = simulation.getConcImage(1, {}, true, true);
+  }
+}
+
 SME_BENCHMARK(simulate_SimulationDUNE);
 SME_BENCHMARK(simulate_SimulationPIXEL);
 SME_BENCHMARK(simulate_Simulation_getConcImage);
+SME_BENCHMARK(simulate_Simulation_getConcImage_normaliseAll);
@@ -8,6 +8,8 @@ void SimulationData::clear() {
   avgMinMax.clear();
   concentrationMax.clear();
   concPadding.clear();
+  reductions.clear();
+  observables.clear();
   xmlModel.clear();
 }
 
@@ -19,6 +21,8 @@ void SimulationData::reserve(std::size_t n) {
   avgMinMax.reserve(n);
   concentrationMax.reserve(n);
   concPadding.reserve(n);
+  reductions.reserve(n);
+  observables.reserve(n);
 }
 
 void SimulationData::pop_back() {
@@ -27,6 +31,12 @@ void SimulationData::pop_back() {
   avgMinMax.pop_back();
   concentrationMax.pop_back();
   concPadding.pop_back();
+  if (reductions.size() > timePoints.size()) {
+    reductions.pop_back();
+  }
+  if (observables.size() > timePoints.size()) {
+    observables.pop_back();
+  }
 }
 
 } // namespace sme::simulate
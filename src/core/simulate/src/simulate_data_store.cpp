@@ -0,0 +1,997 @@
+#include "simulate_data_store.hpp"
+#include "append_only_vector.hpp"
+#include "logger.hpp"
+#include "parallel_for.hpp"
+#include <QByteArray>
+#include <QFile>
+#include <QFileInfo>
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <mutex>
+#include <stdexcept>
+#include <utility>
+
+namespace sme::simulate {
+
+// each encoded compartment starts with a flags byte and a quantisation step
+constexpr char flagCompressed{1};
+constexpr char flagDelta{2};
+constexpr char flagQuantised{4};
+constexpr int headerBytes{1 + sizeof(double)};
+// quantised values larger than this may not survive rescaling exactly
+constexpr double maxQuantisedValue{1125899906842624.0};
+
+static std::uint64_t toBits(double value) {
+  std::uint64_t bits;
+  std::memcpy(&bits, &value, sizeof(bits));
+  return bits;
+}
+
+static double fromBits(std::uint64_t bits) {
+  double value;
+  std::memcpy(&value, &bits, sizeof(value));
+  return value;
+}
+
+static std::uint64_t zigzag(std::int64_t value) {
+  return (static_cast<std::uint64_t>(value) << 1) ^
+         static_cast<std::uint64_t>(value >> 63);
+}
+
+static std::int64_t unzigzag(std::uint64_t value) {
+  return static_cast<std::int64_t>(value >> 1) ^
+         -static_cast<std::int64_t>(value & 1);
+}
+
+static std::int64_t quantise(double value, double step) {
+  return static_cast<std::int64_t>(std::llround(value / step));
+}
+
+static bool canQuantise(const std::vector<double> &values, double step) {
+  return std::all_of(values.cbegin(), values.cend(), [step](double v) {
+    return std::isfinite(v) && std::abs(v / step) < maxQuantisedValue;
+  });
+}
+
+// timepoints can only be delta encoded if the layout is unchanged
+static bool isCompatible(const ConcentrationSnapshot &a,
+                         const ConcentrationSnapshot &b) {
+  if (a.size() != b.size()) {
+    return false;
+  }
+  for (std::size_t i = 0; i < a.size(); ++i) {
+    if (a[i].size() != b[i].size()) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// encode values, relative to previous values if not nullptr
+// decoded is set to the values that will be obtained when decoding
+static QByteArray encodeValues(const std::vector<double> &values,
+                               const std::vector<double> *previous,
+                               const ConcentrationCompression &compression,
+                               std::vector<double> &decoded) {
+  std::size_t n{values.size()};
+  char flags{0};
+  double step{0.0};
+  if (compression.enabled) {
+    flags |= flagCompressed;
+  }
+  if (previous != nullptr) {
+    flags |= flagDelta;
+  }
+  if (compression.enabled && compression.maxAbsError > 0.0) {
+    step = 2.0 * compression.maxAbsError;
+    if (canQuantise(values, step) &&
+        (previous == nullptr || canQuantise(*previous, step))) {
+      flags |= flagQuantised;
+    }
+  }
+  std::vector<std::uint64_t> words(n, 0);
+  if ((flags & flagQuantised) != 0) {
+    decoded.resize(n);
+    for (std::size_t i = 0; i < n; ++i) {
+      auto q{quantise(values[i], step)};
+      auto qPrevious{previous == nullptr ? 0 : quantise((*previous)[i], step)};
+      words[i] = zigzag(q - qPrevious);
+      decoded[i] = static_cast<double>(q) * step;
+    }
+  } else {
+    decoded = values;
+    for (std::size_t i = 0; i < n; ++i) {
+      words[i] = toBits(values[i]);
+      if (previous != nullptr) {
+        words[i] ^= toBits((*previous)[i]);
+      }
+    }
+  }
+  QByteArray blob(headerBytes, '\0');
+  blob[0] = flags;
+  std::memcpy(blob.data() + 1, &step, sizeof(step));
+  auto nBytes{static_cast<int>(n * sizeof(std::uint64_t))};
+  if ((flags & flagCompressed) == 0) {
+    blob.append(reinterpret_cast<const char *>(words.data()), nBytes);
+    return blob;
+  }
+  if (n == 0) {
+    return blob;
+  }
+  // group bytes by significance: deltas are mostly small, so the most
+  // significant bytes are mostly zero and compress well
+  QByteArray shuffled(nBytes, '\0');
+  auto *dest{reinterpret_cast<unsigned char *>(shuffled.data())};
+  for (std::size_t b = 0; b < sizeof(std::uint64_t); ++b) {
+    for (std::size_t i = 0; i < n; ++i) {
+      dest[b * n + i] = static_cast<unsigned char>(words[i] >> (8 * b));
+    }
+  }
+  blob.append(qCompress(shuffled, compression.level));
+  return blob;
+}
+
+static std::vector<QByteArray>
+encodeSnapshot(const ConcentrationSnapshot &snapshot,
+               const ConcentrationSnapshot *previous,
+               const ConcentrationCompression &compression,
+               ConcentrationSnapshot &decoded) {
+  std::vector<QByteArray> blobs(snapshot.size());
+  decoded.resize(snapshot.size());
+  common::parallelFor(snapshot.size(), [&](std::size_t i) {
+    const std::vector<double> *previousValues{nullptr};
+    if (previous != nullptr) {
+      previousValues = &(*previous)[i];
+    }
+    blobs[i] =
+        encodeValues(snapshot[i], previousValues, compression, decoded[i]);
+  });
+  return blobs;
+}
+
+// uncompressed encoded values, independent of the previous timepoint
+struct EncodedWords {
+  char flags{0};
+  double step{0.0};
+  std::vector<std::uint64_t> words{};
+};
+
+static EncodedWords uncompressWords(const QByteArray &blob) {
+  EncodedWords w;
+  if (blob.size() < headerBytes) {
+    SPDLOG_WARN("Invalid encoded timepoint of {} bytes", blob.size());
+    return w;
+  }
+  w.flags = blob[0];
+  std::memcpy(&w.step, blob.constData() + 1, sizeof(w.step));
+  const auto *payload{
+      reinterpret_cast<const uchar *>(blob.constData() + headerBytes)};
+  auto nPayloadBytes{blob.size() - headerBytes};
+  if ((w.flags & flagCompressed) == 0) {
+    w.words.resize(static_cast<std::size_t>(nPayloadBytes) /
+                   sizeof(std::uint64_t));
+    std::memcpy(w.words.data(), payload,
+                w.words.size() * sizeof(std::uint64_t));
+    return w;
+  }
+  if (nPayloadBytes == 0) {
+    return w;
+  }
+  auto shuffled{qUncompress(payload, nPayloadBytes)};
+  std::size_t n{static_cast<std::size_t>(shuffled.size()) /
+                sizeof(std::uint64_t)};
+  w.words.assign(n, 0);
+  const auto *src{
+      reinterpret_cast<const unsigned char *>(shuffled.constData())};
+  for (std::size_t b = 0; b < sizeof(std::uint64_t); ++b) {
+    for (std::size_t i = 0; i < n; ++i) {
+      w.words[i] |= static_cast<std::uint64_t>(src[b * n + i]) << (8 * b);
+    }
+  }
+  return w;
+}
+
+static std::vector<double> decodeWords(const EncodedWords &w,
+                                       const std::vector<double> *previous) {
+  std::size_t n{w.words.size()};
+  std::vector<double> values(n, 0.0);
+  if ((w.flags & flagDelta) == 0 || previous == nullptr ||
+      previous->size() != n) {
+    previous = nullptr;
+  }
+  if ((w.flags & flagQuantised) != 0) {
+    for (std::size_t i = 0; i < n; ++i) {
+      auto q{unzigzag(w.words[i])};
+      if (previous != nullptr) {
+        q += quantise((*previous)[i], w.step);
+      }
+      values[i] = static_cast<double>(q) * w.step;
+    }
+    return values;
+  }
+  for (std::size_t i = 0; i < n; ++i) {
+    auto bits{w.words[i]};
+    if (previous != nullptr) {
+      bits ^= toBits((*previous)[i]);
+    }
+    values[i] = fromBits(bits);
+  }
+  return values;
+}
+
+static ConcentrationSnapshot
+decodeSnapshot(const std::vector<EncodedWords> &words,
+               const ConcentrationSnapshot *previous) {
+  ConcentrationSnapshot snapshot(words.size());
+  common::parallelFor(words.size(), [&](std::size_t i) {
+    const std::vector<double> *previousValues{nullptr};
+    if (previous != nullptr && i < previous->size()) {
+      previousValues = &(*previous)[i];
+    }
+    snapshot[i] = decodeWords(words[i], previousValues);
+  });
+  return snapshot;
+}
+
+static bool isDeltaEncoded(const std::vector<QByteArray> &blobs) {
+  return std::any_of(blobs.cbegin(), blobs.cend(), [](const auto &blob) {
+    return !blob.isEmpty() && (blob[0] & flagDelta) != 0;
+  });
+}
+
+struct ConcentrationStore::Storage {
+  // encoded timepoint, stored either in memory or in the file
+  struct Record {
+    // decoding requires the previous timepoint
+    bool isDelta{false};
+    // per compartment encoded data if stored in memory
+    std::vector<QByteArray> blobs{};
+    // location of per compartment encoded data if stored in file
+    bool inFile{false};
+    qint64 offset{0};
+    std::vector<qint64> nBytes{};
+  };
+  mutable std::mutex mutex{};
+  // nullptr if timepoint is not resident in memory
+  common::AppendOnlyVector<std::shared_ptr<const ConcentrationSnapshot>>
+      snapshots{};
+  // empty if all timepoints are resident in memory
+  std::vector<Record> records{};
+  std::unique_ptr<QFile> file{};
+  // false if the file is an existing file which must not be modified: any
+  // new timepoints are then stored in memory
+  bool ownsFile{true};
+  ConcentrationCompression compression{};
+  RetentionPolicy retention{};
+  std::size_t maxResident{0};
+  // resident timepoints, least recently used first
+  std::deque<std::size_t> lru{};
+  // if all timepoints are resident they can be read without locking
+  std::atomic<bool> lockFreeReads{true};
+  // encoded timepoints released from an existing file are kept in records
+  [[nodiscard]] bool isInMemory() const {
+    return file == nullptr && !compression.enabled && records.empty();
+  }
+  void updateLockFreeReads() {
+    lockFreeReads.store(isInMemory(), std::memory_order_release);
+  }
+  void forget(std::size_t timeIndex) {
+    if (auto iter{std::find(lru.begin(), lru.end(), timeIndex)};
+        iter != lru.end()) {
+      lru.erase(iter);
+    }
+  }
+  // mark timepoint as most recently used, evict least recently used timepoints
+  void touch(std::size_t timeIndex) {
+    if (isInMemory()) {
+      return;
+    }
+    forget(timeIndex);
+    lru.push_back(timeIndex);
+    while (lru.size() > maxResident) {
+      SPDLOG_TRACE("evicting timepoint {}", lru.front());
+      snapshots[lru.front()].reset();
+      lru.pop_front();
+    }
+  }
+  [[nodiscard]] bool isRetained(std::size_t timeIndex) const {
+    if (isInMemory()) {
+      return !std::atomic_load(&snapshots[timeIndex])->empty();
+    }
+    const auto &record{records[timeIndex]};
+    return record.inFile ? !record.nBytes.empty() : !record.blobs.empty();
+  }
+  // replace the encoded data of an existing timepoint: kept in memory so
+  // that the following timepoints in the file are not overwritten
+  void keepBlobs(std::size_t timeIndex, std::vector<QByteArray> &&blobs) {
+    auto &record{records[timeIndex]};
+    record.isDelta = isDeltaEncoded(blobs);
+    record.inFile = false;
+    record.blobs = std::move(blobs);
+  }
+  [[nodiscard]] std::vector<QByteArray> readBlobs(std::size_t timeIndex) const;
+  // false if writing to the file failed
+  bool writeBlobs(std::size_t timeIndex, std::vector<QByteArray> &&blobs);
+  void discard(std::size_t timeIndex);
+  void applyRetention(std::size_t timeIndex);
+  // after adding a timepoint: apply to the one that is no longer recent
+  void applyRetention() {
+    if (snapshots.size() > retention.keepLast) {
+      applyRetention(snapshots.size() - retention.keepLast - 1);
+    }
+  }
+  std::shared_ptr<const ConcentrationSnapshot> get(std::size_t timeIndex);
+  // as above, but takes the lock if required
+  std::shared_ptr<const ConcentrationSnapshot> load(std::size_t timeIndex) {
+    if (lockFreeReads.load(std::memory_order_acquire)) {
+      return std::atomic_load(&snapshots[timeIndex]);
+    }
+    std::scoped_lock lock{mutex};
+    return get(timeIndex);
+  }
+  void store(std::size_t timeIndex, ConcentrationSnapshot &&snapshot);
+  Storage() = default;
+  Storage(const Storage &) = delete;
+  Storage &operator=(const Storage &) = delete;
+  ~Storage() {
+    if (file != nullptr && ownsFile) {
+      file->remove();
+    }
+  }
+};
+
+std::vector<QByteArray>
+ConcentrationStore::Storage::readBlobs(std::size_t timeIndex) const {
+  const auto &record{records[timeIndex]};
+  if (!record.inFile) {
+    return record.blobs;
+  }
+  std::vector<QByteArray> blobs;
+  blobs.reserve(record.nBytes.size());
+  qint64 nTotalBytes{0};
+  for (auto n : record.nBytes) {
+    nTotalBytes += n;
+  }
+  if (nTotalBytes == 0) {
+    blobs.resize(record.nBytes.size());
+    return blobs;
+  }
+  if (uchar *mapped{file->map(record.offset, nTotalBytes)}; mapped != nullptr) {
+    const auto *data{reinterpret_cast<const char *>(mapped)};
+    for (auto n : record.nBytes) {
+      blobs.emplace_back(data, static_cast<int>(n));
+      data += n;
+    }
+    file->unmap(mapped);
+    return blobs;
+  }
+  SPDLOG_WARN("Failed to map {} bytes at offset {} of file {}", nTotalBytes,
+              record.offset, file->fileName().toStdString());
+  file->seek(record.offset);
+  for (auto n : record.nBytes) {
+    blobs.push_back(file->read(n));
+  }
+  return blobs;
+}
+
+bool ConcentrationStore::Storage::writeBlobs(std::size_t timeIndex,
+                                             std::vector<QByteArray> &&blobs) {
+  auto &record{records[timeIndex]};
+  record.isDelta = isDeltaEncoded(blobs);
+  if (file == nullptr || !ownsFile) {
+    record.inFile = false;
+    record.blobs = std::move(blobs);
+    return true;
+  }
+  record.inFile = true;
+  record.blobs.clear();
+  record.offset = 0;
+  if (timeIndex > 0) {
+    const auto &previous{records[timeIndex - 1]};
+    record.offset = previous.offset;
+    for (auto n : previous.nBytes) {
+      record.offset += n;
+    }
+  }
+  record.nBytes.clear();
+  bool success{file->resize(record.offset) && file->seek(record.offset)};
+  for (const auto &blob : blobs) {
+    record.nBytes.push_back(blob.size());
+    success = success && file->write(blob) == blob.size();
+  }
+  if (!(success && file->flush())) {
+    SPDLOG_ERROR("Failed to write timepoint to file {}",
+                 file->fileName().toStdString());
+    return false;
+  }
+  return true;
+}
+
+std::shared_ptr<const ConcentrationSnapshot>
+ConcentrationStore::Storage::get(std::size_t timeIndex) {
+  if (auto snapshot{snapshots[timeIndex]}; snapshot != nullptr) {
+    touch(timeIndex);
+    return snapshot;
+  }
+  // decode from the last resident timepoint or keyframe
+  std::size_t first{timeIndex};
+  while (first > 0 && records[first].isDelta &&
+         snapshots[first - 1] == nullptr) {
+    --first;
+  }
+  SPDLOG_TRACE("decoding timepoints {}-{}", first, timeIndex);
+  std::size_t n{timeIndex - first + 1};
+  std::vector<std::vector<QByteArray>> blobs;
+  std::vector<std::pair<std::size_t, std::size_t>> blobIndices;
+  blobs.reserve(n);
+  for (std::size_t i = 0; i < n; ++i) {
+    auto &b{blobs.emplace_back(readBlobs(first + i))};
+    for (std::size_t j = 0; j < b.size(); ++j) {
+      blobIndices.emplace_back(i, j);
+    }
+  }
+  // uncompress all compartments of all timepoints in parallel
+  std::vector<std::vector<EncodedWords>> words(n);
+  for (std::size_t i = 0; i < n; ++i) {
+    words[i].resize(blobs[i].size());
+  }
+  common::parallelFor(blobIndices.size(), [&](std::size_t k) {
+    auto i{blobIndices[k].first};
+    auto j{blobIndices[k].second};
+    words[i][j] = uncompressWords(blobs[i][j]);
+  });
+  blobs.clear();
+  // then undo the delta encoding one timepoint at a time
+  std::shared_ptr<const ConcentrationSnapshot> snapshot{};
+  if (first > 0) {
+    snapshot = snapshots[first - 1];
+  }
+  for (std::size_t i = 0; i < n; ++i) {
+    snapshot = std::make_shared<const ConcentrationSnapshot>(
+        decodeSnapshot(words[i], snapshot.get()));
+    snapshots[first + i] = snapshot;
+    touch(first + i);
+  }
+  return snapshot;
+}
+
+void ConcentrationStore::Storage::store(std::size_t timeIndex,
+                                        ConcentrationSnapshot &&snapshot) {
+  if (isInMemory()) {
+    auto ptr{
+        std::make_shared<const ConcentrationSnapshot>(std::move(snapshot))};
+    if (timeIndex == snapshots.size()) {
+      snapshots.push_back(std::move(ptr));
+    } else {
+      // may be concurrently read without locking
+      std::atomic_store(&snapshots[timeIndex], std::move(ptr));
+    }
+    return;
+  }
+  std::shared_ptr<const ConcentrationSnapshot> previous{};
+  if (compression.enabled && timeIndex > 0 &&
+      timeIndex % std::max(compression.keyframeInterval, std::size_t{1}) !=
+          0) {
+    previous = get(timeIndex - 1);
+    if (!isCompatible(*previous, snapshot)) {
+      previous.reset();
+    }
+  }
+  auto decoded{std::make_shared<ConcentrationSnapshot>()};
+  auto blobs{encodeSnapshot(snapshot, previous.get(), compression, *decoded)};
+  // a new timepoint is only visible to readers once it has been stored
+  bool isNew{timeIndex == snapshots.size()};
+  if (isNew) {
+    records.emplace_back();
+  }
+  if (!writeBlobs(timeIndex, std::move(blobs))) {
+    if (isNew) {
+      records.pop_back();
+    }
+    throw std::runtime_error("Failed to write timepoint to file " +
+                             file->fileName().toStdString());
+  }
+  if (isNew) {
+    snapshots.emplace_back(std::move(decoded));
+  } else {
+    snapshots[timeIndex] = std::move(decoded);
+  }
+  touch(timeIndex);
+}
+
+void ConcentrationStore::Storage::discard(std::size_t timeIndex) {
+  if (!isRetained(timeIndex)) {
+    return;
+  }
+  SPDLOG_TRACE("discarding timepoint {}", timeIndex);
+  if (isInMemory()) {
+    // may be concurrently read without locking
+    std::atomic_store(&snapshots[timeIndex],
+                      std::make_shared<const ConcentrationSnapshot>());
+    return;
+  }
+  // the next timepoint can no longer be decoded relative to this one, so
+  // re-encode it on its own: the decoded values are unchanged
+  if (std::size_t next{timeIndex + 1};
+      next < records.size() && records[next].isDelta) {
+    auto snapshot{get(next)};
+    ConcentrationSnapshot decoded;
+    keepBlobs(next, encodeSnapshot(*snapshot, nullptr, compression, decoded));
+  }
+  keepBlobs(timeIndex, {});
+  forget(timeIndex);
+  snapshots[timeIndex].reset();
+}
+
+// discard the timepoint if it is no longer one of the most recent ones
+// and is not one of the older timepoints that are kept
+void ConcentrationStore::Storage::applyRetention(std::size_t timeIndex) {
+  if (retention.keepLast == 0 ||
+      timeIndex + retention.keepLast >= snapshots.size()) {
+    return;
+  }
+  if (retention.keepEvery > 0 && timeIndex % retention.keepEvery == 0) {
+    return;
+  }
+  discard(timeIndex);
+}
+
+ConcentrationStore::ConcentrationStore()
+    : storage{std::make_shared<Storage>()} {}
+
+ConcentrationStore::ConcentrationStore(
+    std::initializer_list<ConcentrationSnapshot> snapshots)
+    : ConcentrationStore() {
+  *this = snapshots;
+}
+
+ConcentrationStore::ConcentrationStore(ConcentrationStore &&) noexcept =
+    default;
+
+ConcentrationStore &
+ConcentrationStore::operator=(ConcentrationStore &&) noexcept = default;
+
+ConcentrationStore &ConcentrationStore::operator=(
+    std::initializer_list<ConcentrationSnapshot> snapshots) {
+  clear();
+  reserve(snapshots.size());
+  for (const auto &snapshot : snapshots) {
+    push_back(snapshot);
+  }
+  return *this;
+}
+
+ConcentrationStore::~ConcentrationStore() = default;
+
+bool ConcentrationStore::useMemoryMappedFile(
+    const QString &filename, std::size_t maxResidentTimepoints) {
+  // ensure any existing data is in memory before changing storage
+  useMemory();
+  std::scoped_lock lock{storage->mutex};
+  auto file{std::make_unique<QFile>(filename)};
+  if (!file->open(QIODevice::ReadWrite | QIODevice::Truncate)) {
+    SPDLOG_WARN("Failed to open file {}: using memory", filename.toStdString());
+    return false;
+  }
+  SPDLOG_INFO("Storing concentrations in file {}, max {} resident timepoints",
+              filename.toStdString(), maxResidentTimepoints);
+  auto &s{*storage};
+  bool wasInMemory{s.isInMemory()};
+  s.file = std::move(file);
+  s.updateLockFreeReads();
+  s.maxResident = std::max(maxResidentTimepoints, std::size_t{1});
+  if (wasInMemory) {
+    s.records.clear();
+    s.records.resize(s.snapshots.size());
+    s.lru.clear();
+  }
+  for (std::size_t i = 0; i < s.snapshots.size(); ++i) {
+    if (wasInMemory) {
+      ConcentrationSnapshot decoded;
+      s.writeBlobs(i, encodeSnapshot(*s.snapshots[i], nullptr, s.compression,
+                                     decoded));
+      s.touch(i);
+    } else {
+      auto blobs{std::move(s.records[i].blobs)};
+      s.writeBlobs(i, std::move(blobs));
+    }
+  }
+  if (!s.lru.empty()) {
+    // evict any timepoints beyond the new limit
+    s.touch(s.lru.back());
+  }
+  return true;
+}
+
+void ConcentrationStore::useMemory() {
+  std::scoped_lock lock{storage->mutex};
+  auto &s{*storage};
+  if (s.file == nullptr) {
+    return;
+  }
+  if (s.compression.enabled) {
+    // keep compressed timepoints, but in memory instead of in the file
+    for (std::size_t i = 0; i < s.records.size(); ++i) {
+      s.records[i].blobs = s.readBlobs(i);
+      s.records[i].inFile = false;
+    }
+  } else {
+    common::AppendOnlyVector<std::shared_ptr<const ConcentrationSnapshot>>
+        snapshots;
+    snapshots.reserve(s.snapshots.size());
+    for (std::size_t i = 0; i < s.snapshots.size(); ++i) {
+      snapshots.push_back(s.get(i));
+    }
+    s.snapshots = std::move(snapshots);
+    s.records.clear();
+    s.lru.clear();
+    s.maxResident = 0;
+  }
+  if (s.ownsFile) {
+    s.file->remove();
+  }
+  s.file.reset();
+  s.ownsFile = true;
+  s.updateLockFreeReads();
+}
+
+bool ConcentrationStore::isMemoryMapped() const {
+  std::scoped_lock lock{storage->mutex};
+  return storage->file != nullptr && storage->ownsFile;
+}
+
+void ConcentrationStore::releaseExistingFile(const QString &filename) {
+  std::scoped_lock lock{storage->mutex};
+  auto &s{*storage};
+  if (s.file == nullptr || s.ownsFile ||
+      QFileInfo(s.file->fileName()) != QFileInfo(filename)) {
+    return;
+  }
+  SPDLOG_INFO("Releasing file {}: keeping {} encoded timepoints in memory",
+              filename.toStdString(), s.records.size());
+  for (std::size_t i = 0; i < s.records.size(); ++i) {
+    if (auto &record{s.records[i]}; record.inFile) {
+      record.blobs = s.readBlobs(i);
+      record.inFile = false;
+      record.offset = 0;
+    }
+  }
+  s.file.reset();
+  s.ownsFile = true;
+  s.updateLockFreeReads();
+}
+
+bool ConcentrationStore::isReadingFrom(const QString &filename) const {
+  std::scoped_lock lock{storage->mutex};
+  const auto &s{*storage};
+  return s.file != nullptr && !s.ownsFile &&
+         QFileInfo(s.file->fileName()) == QFileInfo(filename);
+}
+
+std::size_t ConcentrationStore::getNumUnchangedFileTimepoints() const {
+  std::scoped_lock lock{storage->mutex};
+  const auto &s{*storage};
+  if (s.file == nullptr || s.ownsFile) {
+    return 0;
+  }
+  std::size_t n{0};
+  while (n < s.records.size() &&
+         (s.records[n].inFile || !s.isRetained(n))) {
+    ++n;
+  }
+  return n;
+}
+
+void ConcentrationStore::useExistingFileLocations(
+    std::size_t first,
+    const std::vector<ConcentrationFileLocation> &locations) {
+  std::scoped_lock lock{storage->mutex};
+  auto &s{*storage};
+  if (s.file == nullptr || s.ownsFile ||
+      first + locations.size() > s.records.size()) {
+    return;
+  }
+  for (std::size_t i = 0; i < locations.size(); ++i) {
+    auto &record{s.records[first + i]};
+    // timepoints in the file are encoded independently
+    record.isDelta = false;
+    record.blobs.clear();
+    record.inFile = true;
+    record.offset = locations[i].offset;
+    record.nBytes = locations[i].nBytes;
+  }
+}
+
+bool ConcentrationStore::useExistingFile(
+    const QString &filename,
+    const std::vector<ConcentrationFileLocation> &locations,
+    std::size_t maxResidentTimepoints) {
+  useMemory();
+  clear();
+  std::scoped_lock lock{storage->mutex};
+  auto file{std::make_unique<QFile>(filename)};
+  if (!file->open(QIODevice::ReadOnly)) {
+    SPDLOG_WARN("Failed to open file {}", filename.toStdString());
+    return false;
+  }
+  SPDLOG_INFO("Reading {} timepoints from file {}, max {} resident timepoints",
+              locations.size(), filename.toStdString(),
+              maxResidentTimepoints);
+  auto &s{*storage};
+  s.file = std::move(file);
+  s.ownsFile = false;
+  s.maxResident = std::max(maxResidentTimepoints, std::size_t{1});
+  s.snapshots.reserve(locations.size());
+  s.records.reserve(locations.size());
+  for (const auto &location : locations) {
+    s.snapshots.emplace_back();
+    auto &record{s.records.emplace_back()};
+    record.inFile = true;
+    record.offset = location.offset;
+    record.nBytes = location.nBytes;
+  }
+  s.updateLockFreeReads();
+  return true;
+}
+
+void ConcentrationStore::useCompression(
+    const ConcentrationCompression &compression,
+    std::size_t maxResidentTimepoints) {
+  QString filename;
+  if (isMemoryMapped()) {
+    std::scoped_lock lock{storage->mutex};
+    filename = storage->file->fileName();
+  }
+  useMemory();
+  {
+    std::scoped_lock lock{storage->mutex};
+    auto &s{*storage};
+    SPDLOG_INFO("Compression {}, max abs error {}, keyframe interval {}",
+                compression.enabled, compression.maxAbsError,
+                compression.keyframeInterval);
+    // re-encode existing timepoints with the new compression settings
+    Storage next;
+    next.compression = compression;
+    if (compression.enabled) {
+      next.maxResident = std::max(maxResidentTimepoints, std::size_t{1});
+    }
+    next.snapshots.reserve(s.snapshots.size());
+    next.records.reserve(s.snapshots.size());
+    for (std::size_t i = 0; i < s.snapshots.size(); ++i) {
+      next.store(i, ConcentrationSnapshot(*s.get(i)));
+    }
+    s.snapshots = std::move(next.snapshots);
+    s.records = std::move(next.records);
+    s.lru = std::move(next.lru);
+    s.compression = next.compression;
+    s.maxResident = next.maxResident;
+    s.updateLockFreeReads();
+  }
+  if (!filename.isEmpty()) {
+    useMemoryMappedFile(filename, maxResidentTimepoints);
+  }
+}
+
+ConcentrationCompression ConcentrationStore::getCompression() const {
+  std::scoped_lock lock{storage->mutex};
+  return storage->compression;
+}
+
+std::size_t ConcentrationStore::getMaxResidentTimepoints() const {
+  std::scoped_lock lock{storage->mutex};
+  if (storage->isInMemory()) {
+    return storage->snapshots.size();
+  }
+  return storage->maxResident;
+}
+
+std::size_t ConcentrationStore::getNumResidentTimepoints() const {
+  std::scoped_lock lock{storage->mutex};
+  return static_cast<std::size_t>(
+      std::count_if(storage->snapshots.cbegin(), storage->snapshots.cend(),
+                    [](const auto &snapshot) { return snapshot != nullptr; }));
+}
+
+void ConcentrationStore::setRetention(const RetentionPolicy &retention) {
+  std::scoped_lock lock{storage->mutex};
+  auto &s{*storage};
+  SPDLOG_INFO("Retention: keep last {}, keep every {}", retention.keepLast,
+              retention.keepEvery);
+  s.retention = retention;
+  for (std::size_t i = 0; i < s.snapshots.size(); ++i) {
+    s.applyRetention(i);
+  }
+}
+
+RetentionPolicy ConcentrationStore::getRetention() const {
+  std::scoped_lock lock{storage->mutex};
+  return storage->retention;
+}
+
+bool ConcentrationStore::isRetained(std::size_t timeIndex) const {
+  std::scoped_lock lock{storage->mutex};
+  return storage->isRetained(timeIndex);
+}
+
+std::size_t ConcentrationStore::getNumRetainedTimepoints() const {
+  std::scoped_lock lock{storage->mutex};
+  std::size_t n{0};
+  for (std::size_t i = 0; i < storage->snapshots.size(); ++i) {
+    if (storage->isRetained(i)) {
+      ++n;
+    }
+  }
+  return n;
+}
+
+std::size_t ConcentrationStore::size() const {
+  return storage->snapshots.size();
+}
+
+bool ConcentrationStore::empty() const { return size() == 0; }
+
+std::shared_ptr<const ConcentrationSnapshot>
+ConcentrationStore::get(std::size_t timeIndex) const {
+  return storage->load(timeIndex);
+}
+
+std::shared_ptr<const ConcentrationSnapshot> ConcentrationStore::back() const {
+  return get(size() - 1);
+}
+
+ConcentrationStore::Reader ConcentrationStore::getReader() const {
+  return Reader(storage);
+}
+
+ConcentrationStore::Reader::Reader(std::shared_ptr<Storage> sharedStorage)
+    : storage{std::move(sharedStorage)} {}
+
+std::shared_ptr<const ConcentrationSnapshot>
+ConcentrationStore::Reader::get(std::size_t timeIndex) const {
+  return storage->load(timeIndex);
+}
+
+void ConcentrationStore::push_back(ConcentrationSnapshot snapshot) {
+  std::scoped_lock lock{storage->mutex};
+  auto &s{*storage};
+  s.store(s.snapshots.size(), std::move(snapshot));
+  s.applyRetention();
+}
+
+void ConcentrationStore::replaceBack(ConcentrationSnapshot snapshot) {
+  std::scoped_lock lock{storage->mutex};
+  storage->store(storage->snapshots.size() - 1, std::move(snapshot));
+}
+
+void ConcentrationStore::pop_back() {
+  std::scoped_lock lock{storage->mutex};
+  auto &s{*storage};
+  s.snapshots.pop_back();
+  s.forget(s.snapshots.size());
+  if (!s.records.empty()) {
+    if (s.records.back().inFile && s.ownsFile) {
+      s.file->resize(s.records.back().offset);
+    }
+    s.records.pop_back();
+  }
+}
+
+void ConcentrationStore::clear() {
+  if (storage.use_count() > 1) {
+    // shared with a reader, which keeps the existing storage
+    auto next{std::make_shared<Storage>()};
+    {
+      std::scoped_lock lock{storage->mutex};
+      next->compression = storage->compression;
+      next->retention = storage->retention;
+      if (next->compression.enabled) {
+        next->maxResident = storage->maxResident;
+      }
+    }
+    next->updateLockFreeReads();
+    storage = std::move(next);
+    return;
+  }
+  std::scoped_lock lock{storage->mutex};
+  auto &s{*storage};
+  s.snapshots.clear();
+  s.records.clear();
+  s.lru.clear();
+  if (s.file != nullptr && s.ownsFile) {
+    s.file->resize(0);
+  } else if (s.file != nullptr) {
+    // stop reading from the existing file
+    s.file.reset();
+    s.ownsFile = true;
+    if (!s.compression.enabled) {
+      s.maxResident = 0;
+    }
+    s.updateLockFreeReads();
+  }
+}
+
+void ConcentrationStore::reserve(std::size_t n) {
+  std::scoped_lock lock{storage->mutex};
+  storage->snapshots.reserve(n);
+  if (!storage->isInMemory()) {
+    storage->records.reserve(n);
+  }
+}
+
+std::vector<std::string>
+ConcentrationStore::getCompressedTimepoint(std::size_t timeIndex,
+                                           bool independent) const {
+  std::scoped_lock lock{storage->mutex};
+  auto &s{*storage};
+  std::vector<QByteArray> blobs;
+  if (!s.records.empty() && !(independent && s.records[timeIndex].isDelta) &&
+      (s.compression.enabled ||
+       (s.records[timeIndex].inFile && !s.ownsFile))) {
+    // already compressed
+    blobs = s.readBlobs(timeIndex);
+  } else {
+    // re-encode with the current compression settings, or losslessly
+    ConcentrationCompression compression{};
+    if (s.compression.enabled) {
+      compression = s.compression;
+    }
+    compression.enabled = true;
+    std::shared_ptr<const ConcentrationSnapshot> previous{};
+    if (!independent &&
+        timeIndex % std::max(compression.keyframeInterval, std::size_t{1}) !=
+            0) {
+      previous = s.get(timeIndex - 1);
+    }
+    auto snapshot{s.get(timeIndex)};
+    if (previous != nullptr && !isCompatible(*previous, *snapshot)) {
+      previous.reset();
+    }
+    ConcentrationSnapshot decoded;
+    blobs = encodeSnapshot(*snapshot, previous.get(), compression, decoded);
+  }
+  std::vector<std::string> compressed;
+  compressed.reserve(blobs.size());
+  for (const auto &blob : blobs) {
+    compressed.push_back(blob.toStdString());
+  }
+  return compressed;
+}
+
+void ConcentrationStore::pushCompressedTimepoint(
+    const std::vector<std::string> &compressed) {
+  std::scoped_lock lock{storage->mutex};
+  auto &s{*storage};
+  std::vector<QByteArray> blobs;
+  blobs.reserve(compressed.size());
+  for (const auto &c : compressed) {
+    blobs.emplace_back(c.data(), static_cast<int>(c.size()));
+  }
+  std::size_t timeIndex{s.snapshots.size()};
+  if (s.compression.enabled) {
+    // store as is, decode on demand
+    s.records.emplace_back();
+    if (!s.writeBlobs(timeIndex, std::move(blobs))) {
+      s.records.pop_back();
+      throw std::runtime_error("Failed to write timepoint to file " +
+                               s.file->fileName().toStdString());
+    }
+    s.snapshots.emplace_back();
+  } else {
+    std::shared_ptr<const ConcentrationSnapshot> previous{};
+    if (timeIndex > 0 && isDeltaEncoded(blobs)) {
+      previous = s.get(timeIndex - 1);
+    }
+    std::vector<EncodedWords> words(blobs.size());
+    common::parallelFor(blobs.size(), [&](std::size_t i) {
+      words[i] = uncompressWords(blobs[i]);
+    });
+    s.store(timeIndex, decodeSnapshot(words, previous.get()));
+  }
+  s.applyRetention();
+}
+
+} // namespace sme::simulate
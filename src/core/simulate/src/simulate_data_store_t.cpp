@@ -0,0 +1,347 @@
+#include "catch_wrapper.hpp"
+#include "simulate_data_store.hpp"
+#include <QFile>
+#include <cmath>
+#include <limits>
+#include <cereal/archives/binary.hpp>
+#include <sstream>
+
+using namespace sme;
+
+static simulate::ConcentrationSnapshot makeSnapshot(double value) {
+  return {{value, 2.0 * value, 3.0 * value}, {-value}, {}};
+}
+
+// smoothly varying values that change slowly over time
+static simulate::ConcentrationSnapshot makeSmoothSnapshot(std::size_t t) {
+  simulate::ConcentrationSnapshot snapshot{std::vector<double>(1000),
+                                           std::vector<double>(20)};
+  for (auto &c : snapshot) {
+    for (std::size_t i = 0; i < c.size(); ++i) {
+      c[i] = 1.0 + std::sin(0.01 * static_cast<double>(i)) *
+                       std::exp(-0.01 * static_cast<double>(t));
+    }
+  }
+  return snapshot;
+}
+
+TEST_CASE("SimulateDataStore", "[core/simulate/simulate_data_store][core/"
+                               "simulate][core][simulate_data_store]") {
+  SECTION("in memory") {
+    simulate::ConcentrationStore store;
+    REQUIRE(store.isMemoryMapped() == false);
+    REQUIRE(store.empty());
+    for (int i = 0; i < 5; ++i) {
+      store.push_back(makeSnapshot(i));
+    }
+    REQUIRE(store.size() == 5);
+    REQUIRE(store.getNumResidentTimepoints() == 5);
+    auto c{store.get(3)};
+    REQUIRE(c->size() == 3);
+    REQUIRE((*c)[0][1] == dbl_approx(6.0));
+    REQUIRE((*c)[1][0] == dbl_approx(-3.0));
+    REQUIRE((*c)[2].empty());
+    // snapshot remains valid after it is removed from the store
+    store.pop_back();
+    store.pop_back();
+    REQUIRE(store.size() == 3);
+    REQUIRE((*c)[0][2] == dbl_approx(9.0));
+    store.replaceBack(makeSnapshot(7));
+    REQUIRE((*store.back())[1][0] == dbl_approx(-7.0));
+    store.clear();
+    REQUIRE(store.empty());
+  }
+  SECTION("memory-mapped file") {
+    simulate::ConcentrationStore store{makeSnapshot(1), makeSnapshot(2)};
+    REQUIRE(store.size() == 2);
+    REQUIRE(store.useMemoryMappedFile("tmpconcstore.dat", 3) == true);
+    REQUIRE(store.isMemoryMapped() == true);
+    REQUIRE(store.getMaxResidentTimepoints() == 3);
+    REQUIRE(QFile::exists("tmpconcstore.dat"));
+    for (int i = 3; i < 10; ++i) {
+      store.push_back(makeSnapshot(i));
+      REQUIRE(store.getNumResidentTimepoints() <= 3);
+    }
+    REQUIRE(store.size() == 9);
+    REQUIRE(store.getNumResidentTimepoints() == 3);
+    // evicted timepoints are read back from the file
+    for (std::size_t i = 0; i < store.size(); ++i) {
+      auto c{store.get(i)};
+      double v{static_cast<double>(i + 1)};
+      REQUIRE((*c)[0][0] == dbl_approx(v));
+      REQUIRE((*c)[0][1] == dbl_approx(2.0 * v));
+      REQUIRE((*c)[0][2] == dbl_approx(3.0 * v));
+      REQUIRE((*c)[1][0] == dbl_approx(-v));
+      REQUIRE((*c)[2].empty());
+      REQUIRE(store.getNumResidentTimepoints() <= 3);
+    }
+    store.pop_back();
+    store.replaceBack(makeSnapshot(-1));
+    store.push_back(makeSnapshot(11));
+    REQUIRE(store.size() == 9);
+    REQUIRE((*store.get(0))[0][0] == dbl_approx(1.0));
+    REQUIRE((*store.get(7))[0][0] == dbl_approx(-1.0));
+    REQUIRE((*store.get(8))[0][0] == dbl_approx(11.0));
+    // switch back to memory: all timepoints resident, file removed
+    store.useMemory();
+    REQUIRE(store.isMemoryMapped() == false);
+    REQUIRE(store.getNumResidentTimepoints() == 9);
+    REQUIRE(!QFile::exists("tmpconcstore.dat"));
+    REQUIRE((*store.get(4))[1][0] == dbl_approx(-5.0));
+  }
+  SECTION("serialization compatible with vector of snapshots") {
+    std::vector<simulate::ConcentrationSnapshot> v{makeSnapshot(1),
+                                                   makeSnapshot(5)};
+    std::stringstream ss;
+    {
+      cereal::BinaryOutputArchive ar(ss);
+      ar(v);
+    }
+    simulate::ConcentrationStore store;
+    REQUIRE(store.useMemoryMappedFile("tmpconcstore2.dat", 1) == true);
+    {
+      cereal::BinaryInputArchive ar(ss);
+      ar(store);
+    }
+    REQUIRE(store.size() == 2);
+    REQUIRE((*store.get(1))[0][2] == dbl_approx(15.0));
+    std::stringstream ss2;
+    {
+      cereal::BinaryOutputArchive ar(ss2);
+      ar(store);
+    }
+    REQUIRE(ss2.str() == ss.str());
+  }
+  SECTION("lossless compression") {
+    simulate::ConcentrationStore store{makeSnapshot(1)};
+    simulate::ConcentrationCompression compression{};
+    compression.enabled = true;
+    compression.keyframeInterval = 4;
+    store.useCompression(compression, 2);
+    REQUIRE(store.getCompression().enabled == true);
+    REQUIRE(store.getMaxResidentTimepoints() == 2);
+    REQUIRE(store.size() == 1);
+    REQUIRE((*store.get(0))[0][2] == dbl_approx(3.0));
+    store.pop_back();
+    for (std::size_t t = 0; t < 11; ++t) {
+      store.push_back(makeSmoothSnapshot(t));
+      REQUIRE(store.getNumResidentTimepoints() <= 2);
+    }
+    REQUIRE(store.size() == 11);
+    // decoding is exact, in any order
+    for (std::size_t t : {10, 0, 5, 6, 7, 3, 9, 1}) {
+      auto c{store.get(t)};
+      auto expected{makeSmoothSnapshot(t)};
+      REQUIRE(*c == expected);
+      REQUIRE(store.getNumResidentTimepoints() <= 2);
+    }
+    store.replaceBack(makeSmoothSnapshot(20));
+    REQUIRE(*store.get(10) == makeSmoothSnapshot(20));
+    // compressed timepoints in a memory-mapped file
+    REQUIRE(store.useMemoryMappedFile("tmpconcstore3.dat", 3) == true);
+    REQUIRE(store.getCompression().enabled == true);
+    REQUIRE(store.getNumResidentTimepoints() <= 3);
+    REQUIRE(*store.get(9) == makeSmoothSnapshot(9));
+    REQUIRE(*store.get(2) == makeSmoothSnapshot(2));
+    store.push_back(makeSmoothSnapshot(11));
+    REQUIRE(*store.get(11) == makeSmoothSnapshot(11));
+    // disable compression
+    store.useCompression({});
+    REQUIRE(store.isMemoryMapped() == true);
+    REQUIRE(*store.get(4) == makeSmoothSnapshot(4));
+    store.useMemory();
+    REQUIRE(store.getNumResidentTimepoints() == 12);
+    REQUIRE(*store.get(1) == makeSmoothSnapshot(1));
+  }
+  SECTION("reader") {
+    simulate::ConcentrationStore store;
+    simulate::ConcentrationCompression compression{};
+    compression.enabled = true;
+    store.useCompression(compression, 2);
+    for (std::size_t t = 0; t < 6; ++t) {
+      store.push_back(makeSmoothSnapshot(t));
+    }
+    auto reader{store.getReader()};
+    // snapshots are read on demand, not held by the reader
+    for (std::size_t t = 0; t < 6; ++t) {
+      REQUIRE(*reader.get(t) == makeSmoothSnapshot(t));
+      REQUIRE(store.getNumResidentTimepoints() <= 2);
+    }
+    // reader keeps the existing timepoints if the store is cleared
+    store.clear();
+    REQUIRE(store.empty());
+    REQUIRE(store.getCompression().enabled == true);
+    store.push_back(makeSnapshot(1));
+    REQUIRE((*store.get(0))[0][2] == dbl_approx(3.0));
+    for (std::size_t t = 0; t < 6; ++t) {
+      REQUIRE(*reader.get(t) == makeSmoothSnapshot(t));
+    }
+    // or replaced
+    auto reader2{store.getReader()};
+    store = simulate::ConcentrationStore{};
+    REQUIRE((*reader2.get(0))[1][0] == dbl_approx(-1.0));
+  }
+  SECTION("lossy compression") {
+    simulate::ConcentrationStore store;
+    simulate::ConcentrationCompression compression{};
+    compression.enabled = true;
+    compression.maxAbsError = 1e-6;
+    store.useCompression(compression, 1);
+    for (std::size_t t = 0; t < 20; ++t) {
+      store.push_back(makeSmoothSnapshot(t));
+    }
+    // non-finite values are stored losslessly
+    auto snapshot{makeSmoothSnapshot(20)};
+    snapshot[1][3] = std::numeric_limits<double>::infinity();
+    store.push_back(snapshot);
+    for (std::size_t t = 0; t < 20; ++t) {
+      auto c{store.get(t)};
+      auto expected{makeSmoothSnapshot(t)};
+      for (std::size_t i = 0; i < expected.size(); ++i) {
+        for (std::size_t j = 0; j < expected[i].size(); ++j) {
+          REQUIRE(std::abs((*c)[i][j] - expected[i][j]) <= 1e-6);
+        }
+      }
+    }
+    REQUIRE((*store.get(20))[1] == snapshot[1]);
+    REQUIRE(std::abs((*store.get(20))[0][7] - snapshot[0][7]) <= 1e-6);
+  }
+  SECTION("compressed serialization") {
+    simulate::ConcentrationStore store;
+    for (std::size_t t = 0; t < 20; ++t) {
+      store.push_back(makeSmoothSnapshot(t));
+    }
+    std::stringstream ssUncompressed;
+    {
+      cereal::BinaryOutputArchive ar(ssUncompressed);
+      ar(store);
+    }
+    std::stringstream ss;
+    {
+      cereal::BinaryOutputArchive ar(ss);
+      store.saveCompressed(ar);
+    }
+    REQUIRE(ss.str().size() < ssUncompressed.str().size());
+    // uncompressed store
+    simulate::ConcentrationStore storeA;
+    {
+      cereal::BinaryInputArchive ar(ss);
+      storeA.loadCompressed(ar);
+    }
+    REQUIRE(storeA.getCompression().enabled == false);
+    REQUIRE(storeA.size() == 20);
+    for (std::size_t t = 0; t < 20; ++t) {
+      REQUIRE(*storeA.get(t) == makeSmoothSnapshot(t));
+    }
+    // compressed store
+    simulate::ConcentrationStore storeB;
+    simulate::ConcentrationCompression compression{};
+    compression.enabled = true;
+    storeB.useCompression(compression, 3);
+    ss.seekg(0);
+    {
+      cereal::BinaryInputArchive ar(ss);
+      storeB.loadCompressed(ar);
+    }
+    REQUIRE(storeB.size() == 20);
+    REQUIRE(storeB.getNumResidentTimepoints() == 0);
+    for (std::size_t t = 0; t < 20; ++t) {
+      REQUIRE(*storeB.get(19 - t) == makeSmoothSnapshot(19 - t));
+    }
+    REQUIRE(storeB.getNumResidentTimepoints() == 3);
+    // saving compressed store re-uses compressed data
+    std::stringstream ssB;
+    {
+      cereal::BinaryOutputArchive ar(ssB);
+      storeB.saveCompressed(ar);
+    }
+    simulate::ConcentrationStore storeC;
+    {
+      cereal::BinaryInputArchive ar(ssB);
+      storeC.loadCompressed(ar);
+    }
+    REQUIRE(storeC.getCompression().enabled == true);
+    REQUIRE(storeC.size() == 20);
+    REQUIRE(*storeC.get(13) == makeSmoothSnapshot(13));
+  }
+  SECTION("retention policy") {
+    simulate::RetentionPolicy retention{};
+    retention.keepLast = 3;
+    retention.keepEvery = 4;
+    auto isKept{[&retention](std::size_t t, std::size_t n) {
+      return t + retention.keepLast >= n || t % retention.keepEvery == 0;
+    }};
+    auto check{[&isKept](const simulate::ConcentrationStore &s) {
+      for (std::size_t t = 0; t < s.size(); ++t) {
+        CAPTURE(t);
+        REQUIRE(s.isRetained(t) == isKept(t, s.size()));
+        if (isKept(t, s.size())) {
+          REQUIRE(*s.get(t) == makeSmoothSnapshot(t));
+        } else {
+          REQUIRE(s.get(t)->empty());
+        }
+      }
+    }};
+    simulate::ConcentrationCompression compression{};
+    compression.enabled = true;
+    compression.keyframeInterval = 16;
+    SECTION("in memory") {
+      simulate::ConcentrationStore store;
+      for (std::size_t t = 0; t < 10; ++t) {
+        store.push_back(makeSmoothSnapshot(t));
+      }
+      REQUIRE(store.getNumRetainedTimepoints() == 10);
+      // applied to existing timepoints
+      store.setRetention(retention);
+      REQUIRE(store.getRetention().keepLast == 3);
+      REQUIRE(store.getNumRetainedTimepoints() == 5);
+      check(store);
+      // then to each new timepoint
+      for (std::size_t t = 10; t < 20; ++t) {
+        store.push_back(makeSmoothSnapshot(t));
+        check(store);
+      }
+      REQUIRE(store.getNumRetainedTimepoints() == 8);
+      // only statistics of older timepoints
+      retention.keepEvery = 0;
+      store.setRetention(retention);
+      REQUIRE(store.getNumRetainedTimepoints() == 3);
+      REQUIRE(store.size() == 20);
+    }
+    SECTION("compressed, in memory-mapped file") {
+      simulate::ConcentrationStore store;
+      store.useCompression(compression, 2);
+      store.setRetention(retention);
+      REQUIRE(store.useMemoryMappedFile("tmpconcstore4.dat", 2) == true);
+      for (std::size_t t = 0; t < 20; ++t) {
+        store.push_back(makeSmoothSnapshot(t));
+      }
+      // remaining delta encoded timepoints can still be decoded
+      REQUIRE(store.getNumRetainedTimepoints() == 8);
+      check(store);
+      store.useMemory();
+      check(store);
+    }
+    SECTION("compressed serialization") {
+      simulate::ConcentrationStore store;
+      store.useCompression(compression, 2);
+      store.setRetention(retention);
+      for (std::size_t t = 0; t < 20; ++t) {
+        store.push_back(makeSmoothSnapshot(t));
+      }
+      check(store);
+      std::stringstream ss;
+      {
+        cereal::BinaryOutputArchive ar(ss);
+        store.saveCompressed(ar);
+      }
+      simulate::ConcentrationStore loaded;
+      {
+        cereal::BinaryInputArchive ar(ss);
+        loaded.loadCompressed(ar);
+      }
+      REQUIRE(loaded.size() == 20);
+      check(loaded);
+    }
+  }
+}
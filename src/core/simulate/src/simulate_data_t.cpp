@@ -23,6 +23,8 @@ TEST_CASE("SimulateData",
   REQUIRE(data.concentrationMax.size() == 2);
   REQUIRE(data.concPadding.size() == 2);
   SECTION("clear()") {
+    data.observableDefinitions = {{"obs", "1"}};
+    data.observables = {{1.0}, {2.0}};
     data.clear();
     REQUIRE(data.timePoints.empty());
     REQUIRE(data.concentration.empty());
@@ -30,14 +32,17 @@ TEST_CASE("SimulateData",
     REQUIRE(data.concentrationMax.empty());
     REQUIRE(data.concPadding.empty());
     REQUIRE(data.xmlModel.empty());
+    REQUIRE(data.observables.empty());
+    // observable definitions are kept for the next simulation
+    REQUIRE(data.observableDefinitions.size() == 1);
   }
   SECTION("pop_back()") {
     data.pop_back();
     REQUIRE(data.timePoints.size() == 1);
     REQUIRE(data.timePoints.back() == dbl_approx(0.0));
     REQUIRE(data.concentration.size() == 1);
-    REQUIRE(data.concentration.back()[0][0] == dbl_approx(1.2));
-    REQUIRE(data.concentration.back()[0][1] == dbl_approx(-0.881));
+    REQUIRE((*data.concentration.back())[0][0] == dbl_approx(1.2));
+    REQUIRE((*data.concentration.back())[0][1] == dbl_approx(-0.881));
     REQUIRE(data.avgMinMax.size() == 1);
     REQUIRE(data.avgMinMax.back()[0][0].avg == dbl_approx(1.0));
     REQUIRE(data.avgMinMax.back()[0][0].min == dbl_approx(2.0));
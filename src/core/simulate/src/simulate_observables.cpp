@@ -0,0 +1,205 @@
+#include "simulate_observables.hpp"
+#include "geometry.hpp"
+#include "logger.hpp"
+#include "model.hpp"
+#include "parallel_for.hpp"
+#include "simulate_reductions.hpp"
+#include "utils.hpp"
+#include <algorithm>
+#include <limits>
+#include <utility>
+
+namespace sme::simulate {
+
+static bool reducesOver(const Observable &observable,
+                        const std::string &compartmentId) {
+  const auto &ids{observable.compartmentIds};
+  return ids.empty() ||
+         std::find(ids.cbegin(), ids.cend(), compartmentId) != ids.cend();
+}
+
+ObservableEvaluator::ObservableEvaluator(
+    const model::Model &model, std::vector<Observable> observableDefinitions,
+    const std::vector<std::string> &compartmentIds,
+    const std::vector<std::vector<std::string>> &compartmentSpeciesIds)
+    : observables{std::move(observableDefinitions)},
+      errorMessages(observables.size()) {
+  // variables: all species, then x, y, t
+  std::vector<std::string> variables;
+  for (const auto &speciesIds : compartmentSpeciesIds) {
+    for (const auto &speciesId : speciesIds) {
+      if (std::find(variables.cbegin(), variables.cend(), speciesId) ==
+          variables.cend()) {
+        variables.push_back(speciesId);
+      }
+    }
+  }
+  const auto &coords{model.getParameters().getSpatialCoordinates()};
+  variables.push_back(coords.x.id);
+  variables.push_back(coords.y.id);
+  variables.push_back("t");
+  nVariables = variables.size();
+  std::vector<std::pair<std::string, double>> constants;
+  for (const auto &c : model.getParameters().getGlobalConstants()) {
+    constants.emplace_back(c.id, c.value);
+  }
+  const auto &functions{model.getFunctions().getSymbolicFunctions()};
+  // check each observable separately, so that one invalid expression
+  // doesn't prevent the others from being evaluated
+  std::vector<bool> valid(observables.size(), false);
+  for (std::size_t i = 0; i < observables.size(); ++i) {
+    const auto &o{observables[i]};
+    common::Symbolic sym(o.expression, variables, constants, functions);
+    valid[i] = sym.isValid();
+    if (!valid[i]) {
+      errorMessages[i] = sym.getErrorMessage();
+      SPDLOG_WARN("Invalid observable '{}' = '{}': {}", o.name, o.expression,
+                  errorMessages[i]);
+    }
+  }
+  double pixelWidth{model.getGeometry().getPixelWidth()};
+  pixelArea = pixelWidth * pixelWidth;
+  auto origin{model.getGeometry().getPhysicalOrigin()};
+  compartments.resize(compartmentIds.size());
+  for (std::size_t ic = 0; ic < compartmentIds.size(); ++ic) {
+    auto &c{compartments[ic]};
+    std::vector<std::string> expressions;
+    for (std::size_t i = 0; i < observables.size(); ++i) {
+      if (valid[i] && reducesOver(observables[i], compartmentIds[ic])) {
+        c.observableIndices.push_back(i);
+        expressions.push_back(observables[i].expression);
+      }
+    }
+    if (expressions.empty()) {
+      continue;
+    }
+    for (const auto &speciesId : compartmentSpeciesIds[ic]) {
+      c.speciesVariables.push_back(
+          common::element_index(variables, speciesId));
+    }
+    const auto *comp{
+        model.getCompartments().getCompartment(compartmentIds[ic].c_str())};
+    c.nPixels = comp->nPixels();
+    c.x.reserve(c.nPixels);
+    c.y.reserve(c.nPixels);
+    int height{comp->getCompartmentImage().height()};
+    for (const auto &pixel : comp->getPixels()) {
+      // pixels have y=0 in top-left, convert to bottom-left
+      c.x.push_back(origin.x() + static_cast<double>(pixel.x()) * pixelWidth);
+      c.y.push_back(origin.y() +
+                    static_cast<double>(height - 1 - pixel.y()) * pixelWidth);
+    }
+    c.symbolic.emplace(expressions, variables, constants, functions);
+    c.symbolic->compile();
+    if (c.symbolic->isCompiled()) {
+      continue;
+    }
+    // find the observables that can't be compiled, then compile the others
+    std::vector<std::size_t> compiledIndices;
+    expressions.clear();
+    for (auto i : c.observableIndices) {
+      const auto &o{observables[i]};
+      common::Symbolic sym(o.expression, variables, constants, functions);
+      sym.compile();
+      if (sym.isCompiled()) {
+        compiledIndices.push_back(i);
+        expressions.push_back(o.expression);
+      } else if (errorMessages[i].empty()) {
+        errorMessages[i] = sym.getErrorMessage();
+        SPDLOG_WARN("Failed to compile observable '{}' = '{}': {}", o.name,
+                    o.expression, errorMessages[i]);
+      }
+    }
+    c.observableIndices = std::move(compiledIndices);
+    c.symbolic.reset();
+    if (expressions.empty()) {
+      continue;
+    }
+    c.symbolic.emplace(expressions, variables, constants, functions);
+    c.symbolic->compile();
+    if (!c.symbolic->isCompiled()) {
+      for (auto i : c.observableIndices) {
+        errorMessages[i] = c.symbolic->getErrorMessage();
+      }
+      c.symbolic.reset();
+    }
+  }
+}
+
+const std::vector<Observable> &ObservableEvaluator::getObservables() const {
+  return observables;
+}
+
+const std::string &
+ObservableEvaluator::getErrorMessage(std::size_t observableIndex) const {
+  return errorMessages[observableIndex];
+}
+
+std::vector<double>
+ObservableEvaluator::evaluate(double time,
+                              const ConcentrationSnapshot &concentrations,
+                              std::size_t concPadding) const {
+  std::vector<SpeciesReduction> reductions(observables.size());
+  for (std::size_t ic = 0; ic < compartments.size(); ++ic) {
+    const auto &c{compartments[ic]};
+    if (!c.symbolic.has_value()) {
+      continue;
+    }
+    const auto &concs{concentrations[ic]};
+    std::size_t stride{c.speciesVariables.size() + concPadding};
+    std::size_t nObs{c.observableIndices.size()};
+    auto blocks{getReductionBlocks(c.nPixels)};
+    std::vector<std::vector<SpeciesReduction>> partials(
+        blocks.size(), std::vector<SpeciesReduction>(nObs));
+    common::parallelFor(blocks.size(), [&](std::size_t b) {
+      std::vector<double> vars(nVariables, 0.0);
+      std::vector<double> results(nObs, 0.0);
+      vars[nVariables - 1] = time;
+      auto &partial{partials[b]};
+      for (std::size_t ix = blocks[b].first; ix < blocks[b].second; ++ix) {
+        for (std::size_t is = 0; is < c.speciesVariables.size(); ++is) {
+          vars[c.speciesVariables[is]] = concs[ix * stride + is];
+        }
+        vars[nVariables - 3] = c.x[ix];
+        vars[nVariables - 2] = c.y[ix];
+        c.symbolic->eval(results.data(), vars.data());
+        for (std::size_t i = 0; i < nObs; ++i) {
+          partial[i].add(results[i]);
+        }
+      }
+    });
+    // merged in block order, so the result doesn't depend on the threads
+    for (const auto &partial : partials) {
+      for (std::size_t i = 0; i < nObs; ++i) {
+        reductions[c.observableIndices[i]].merge(partial[i]);
+      }
+    }
+  }
+  std::vector<double> values(observables.size(),
+                             std::numeric_limits<double>::quiet_NaN());
+  for (std::size_t i = 0; i < observables.size(); ++i) {
+    const auto &r{reductions[i]};
+    // an observable that failed to compile for any of its compartments
+    // would only be partly reduced
+    if (r.count == 0 || !errorMessages[i].empty()) {
+      continue;
+    }
+    switch (observables[i].reduction) {
+    case ObservableReduction::Integral:
+      values[i] = r.getIntegral(pixelArea);
+      break;
+    case ObservableReduction::Average:
+      values[i] = r.sum / static_cast<double>(r.count);
+      break;
+    case ObservableReduction::Min:
+      values[i] = r.min;
+      break;
+    case ObservableReduction::Max:
+      values[i] = r.max;
+      break;
+    }
+  }
+  return values;
+}
+
+} // namespace sme::simulate
@@ -0,0 +1,128 @@
+#include "catch_wrapper.hpp"
+#include "geometry.hpp"
+#include "model.hpp"
+#include "model_test_utils.hpp"
+#include "simulate.hpp"
+#include "simulate_observables.hpp"
+#include "utils.hpp"
+#include <cmath>
+
+using namespace sme;
+using namespace sme::test;
+
+TEST_CASE("SimulateObservables",
+          "[core/simulate/simulate_observables][core/simulate][core][simulate_"
+          "observables]") {
+  auto m{getExampleModel(Mod::VerySimpleModel)};
+  m.getSimulationSettings().simulatorType = simulate::SimulatorType::Pixel;
+  simulate::Simulation sim(m);
+  sim.doTimesteps(0.2, 2);
+  REQUIRE(sim.getTimePoints().size() == 3);
+  REQUIRE(sim.getObservables().empty());
+  double pixelWidth{m.getGeometry().getPixelWidth()};
+  double pixelArea{pixelWidth * pixelWidth};
+  auto nPixels{[&m](const char *compartmentId) {
+    return static_cast<double>(
+        m.getCompartments().getCompartment(compartmentId)->nPixels());
+  }};
+  // avg of species in compartment
+  auto avg{[&sim](std::size_t it, std::size_t ic, const char *speciesId) {
+    auto is{common::element_index(sim.getSpeciesIds(ic), speciesId)};
+    return sim.getAvgMinMax(it, ic, is).avg;
+  }};
+  using Reduction = simulate::ObservableReduction;
+  auto errors{sim.setObservables(
+      {{"area_c2", "1", {"c2"}},
+       {"total_A_c2", "A_c2", {"c2"}},
+       {"avg_A_c2", "A_c2", {"c2"}, Reduction::Average},
+       {"max_t", "2*t", {}, Reduction::Max},
+       {"min_x", "x", {"c1"}, Reduction::Min},
+       {"total_B", "B_c1 + B_c2 + B_c3", {}},
+       {"invalid", "idontexist + ", {}}})};
+  REQUIRE(errors.size() == 7);
+  for (std::size_t i = 0; i < 6; ++i) {
+    REQUIRE(errors[i].empty());
+  }
+  REQUIRE(!errors[6].empty());
+  REQUIRE(sim.getObservables().size() == 7);
+  REQUIRE(sim.getObservables()[1].name == "total_A_c2");
+  auto check{[&](std::size_t nTimepoints) {
+    for (std::size_t i = 0; i < 7; ++i) {
+      REQUIRE(sim.getObservableValues(i).size() == nTimepoints);
+    }
+    for (std::size_t it = 0; it < nTimepoints; ++it) {
+      double t{sim.getTimePoints()[it]};
+      REQUIRE(sim.getObservableValues(0)[it] ==
+              dbl_approx(nPixels("c2") * pixelArea));
+      REQUIRE(sim.getObservableValues(1)[it] ==
+              dbl_approx(avg(it, 1, "A_c2") * nPixels("c2") * pixelArea));
+      REQUIRE(sim.getObservableValues(2)[it] == dbl_approx(avg(it, 1, "A_c2")));
+      REQUIRE(sim.getObservableValues(3)[it] == dbl_approx(2.0 * t));
+      REQUIRE(sim.getObservableValues(4)[it] >=
+              m.getGeometry().getPhysicalOrigin().x());
+      double totalB{avg(it, 0, "B_c1") * nPixels("c1") +
+                    avg(it, 1, "B_c2") * nPixels("c2") +
+                    avg(it, 2, "B_c3") * nPixels("c3")};
+      REQUIRE(sim.getObservableValues(5)[it] ==
+              dbl_approx(totalB * pixelArea));
+      REQUIRE(std::isnan(sim.getObservableValues(6)[it]));
+    }
+  }};
+  // existing timepoints are evaluated
+  check(3);
+  // new timepoints are evaluated during the simulation
+  sim.doTimesteps(0.2, 2);
+  REQUIRE(sim.getTimePoints().size() == 5);
+  check(5);
+  // observables cannot be changed while a simulation is running
+  std::vector<std::string> runningErrors;
+  sim.setTimestepStoredCallback([&sim, &runningErrors](std::size_t) {
+    runningErrors = sim.setObservables({{"one", "1", {}}});
+  });
+  sim.doTimesteps(0.2, 1);
+  sim.setTimestepStoredCallback({});
+  REQUIRE(runningErrors.size() == 1);
+  REQUIRE(runningErrors[0] ==
+          "Cannot change observables while a simulation is running");
+  REQUIRE(sim.getObservables().size() == 7);
+  check(6);
+  {
+    // a new simulation of the model keeps the observables and their values
+    simulate::Simulation sim2(m);
+    REQUIRE(sim2.getObservables().size() == 7);
+    REQUIRE(sim2.getObservables()[5].name == "total_B");
+    REQUIRE(sim2.getObservableValues(5).size() == 6);
+    REQUIRE(sim2.getObservableValues(5) == sim.getObservableValues(5));
+  }
+  // remove observables
+  REQUIRE(sim.setObservables({}).empty());
+  REQUIRE(sim.getObservables().empty());
+  REQUIRE(sim.getSimulationData().observables.size() == 0);
+  sim.doTimesteps(0.2, 1);
+  REQUIRE(sim.getSimulationData().observables.size() == 0);
+}
+
+TEST_CASE("SimulateObservables: observable that fails to compile",
+          "[core/simulate/simulate_observables][core/simulate][core][simulate_"
+          "observables]") {
+  auto m{getExampleModel(Mod::VerySimpleModel)};
+  m.getSimulationSettings().simulatorType = simulate::SimulatorType::Pixel;
+  simulate::Simulation sim(m);
+  sim.doTimesteps(0.2, 1);
+  double pixelWidth{m.getGeometry().getPixelWidth()};
+  double nPixelsC2{static_cast<double>(
+      m.getCompartments().getCompartment("c2")->nPixels())};
+  // valid expression that can't be compiled, reduced over all compartments
+  auto errors{sim.setObservables(
+      {{"area_c2", "1", {"c2"}}, {"not_compiled", "1/0", {}}})};
+  REQUIRE(errors.size() == 2);
+  REQUIRE(errors[0].empty());
+  REQUIRE(errors[1].substr(0, 28) == "Failed to compile expression");
+  sim.doTimesteps(0.2, 1);
+  for (std::size_t it = 0; it < 3; ++it) {
+    // the other observable compiled with it is still evaluated
+    REQUIRE(sim.getObservableValues(0)[it] ==
+            dbl_approx(nPixelsC2 * pixelWidth * pixelWidth));
+    REQUIRE(std::isnan(sim.getObservableValues(1)[it]));
+  }
+}
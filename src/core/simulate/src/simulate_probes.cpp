@@ -0,0 +1,147 @@
+#include "simulate_probes.hpp"
+#include "geometry.hpp"
+#include "logger.hpp"
+#include "model.hpp"
+#include <algorithm>
+#include <limits>
+
+namespace sme::simulate {
+
+// indices of the pixels of the compartment covered by the probe
+static std::vector<std::size_t>
+getProbePixels(const Probe &probe, const geometry::Compartment &compartment,
+               const QPointF &origin, double pixelWidth) {
+  std::vector<std::size_t> pixels;
+  bool isPoint{probe.width <= 0.0 && probe.height <= 0.0};
+  int height{compartment.getCompartmentImage().height()};
+  for (std::size_t ix = 0; ix < compartment.nPixels(); ++ix) {
+    const auto &p{compartment.getPixel(ix)};
+    // bottom-left corner of pixel: y=0 is the top of the image
+    double x0{origin.x() + static_cast<double>(p.x()) * pixelWidth};
+    double y0{origin.y() +
+              static_cast<double>(height - 1 - p.y()) * pixelWidth};
+    if (isPoint) {
+      if (probe.x >= x0 && probe.x < x0 + pixelWidth && probe.y >= y0 &&
+          probe.y < y0 + pixelWidth) {
+        pixels.push_back(ix);
+        break;
+      }
+    } else {
+      double cx{x0 + 0.5 * pixelWidth};
+      double cy{y0 + 0.5 * pixelWidth};
+      if (cx >= probe.x && cx <= probe.x + probe.width && cy >= probe.y &&
+          cy <= probe.y + probe.height) {
+        pixels.push_back(ix);
+      }
+    }
+  }
+  return pixels;
+}
+
+ProbeRecorder::ProbeRecorder(
+    const model::Model &model, const ProbeOptions &options,
+    const std::vector<std::string> &compartmentIds,
+    const std::vector<std::vector<std::string>> &compartmentSpeciesIds)
+    : interval{options.interval},
+      capacity{std::max(options.capacity, std::size_t{1})} {
+  double pixelWidth{model.getGeometry().getPixelWidth()};
+  auto origin{model.getGeometry().getPhysicalOrigin()};
+  // reserved so that the columns can point to the pixels of each probe
+  probePixels.reserve(options.probes.size());
+  for (const auto &probe : options.probes) {
+    auto &pixels{probePixels.emplace_back()};
+    auto iter{std::find(compartmentIds.cbegin(), compartmentIds.cend(),
+                        probe.compartmentId)};
+    if (iter == compartmentIds.cend()) {
+      SPDLOG_WARN("Probe '{}': compartment '{}' is not simulated", probe.name,
+                  probe.compartmentId);
+      continue;
+    }
+    auto ic{static_cast<std::size_t>(iter - compartmentIds.cbegin())};
+    const auto *comp{
+        model.getCompartments().getCompartment(probe.compartmentId.c_str())};
+    pixels = getProbePixels(probe, *comp, origin, pixelWidth);
+    if (pixels.empty()) {
+      SPDLOG_WARN("Probe '{}' does not cover any pixels of compartment '{}'",
+                  probe.name, probe.compartmentId);
+    }
+    const auto &speciesIds{compartmentSpeciesIds[ic]};
+    for (std::size_t is = 0; is < speciesIds.size(); ++is) {
+      columns.push_back({ic, is, speciesIds.size(), &pixels});
+      names.push_back(probe.name + "/" + speciesIds[is]);
+    }
+  }
+}
+
+double ProbeRecorder::getInterval() const { return interval; }
+
+const std::vector<std::string> &ProbeRecorder::getNames() const {
+  return names;
+}
+
+void ProbeRecorder::record(
+    double time, const std::vector<const std::vector<double> *> &concentrations,
+    std::size_t concPadding) {
+  std::vector<double> row(columns.size(),
+                          std::numeric_limits<double>::quiet_NaN());
+  for (std::size_t i = 0; i < columns.size(); ++i) {
+    const auto &c{columns[i]};
+    if (c.pixels->empty()) {
+      continue;
+    }
+    const auto &concs{*concentrations[c.compartmentIndex]};
+    std::size_t stride{c.nSpecies + concPadding};
+    double sum{0.0};
+    for (auto ix : *c.pixels) {
+      sum += concs[ix * stride + c.speciesIndex];
+    }
+    row[i] = sum / static_cast<double>(c.pixels->size());
+  }
+  std::scoped_lock lock{mutex};
+  if (times.size() < capacity) {
+    times.push_back(time);
+    values.insert(values.end(), row.cbegin(), row.cend());
+    return;
+  }
+  // buffer is full: overwrite the oldest sample
+  times[first] = time;
+  std::copy(row.cbegin(), row.cend(),
+            values.begin() +
+                static_cast<std::ptrdiff_t>(first * columns.size()));
+  first = (first + 1) % capacity;
+  ++nOverwritten;
+}
+
+ProbeSamples ProbeRecorder::getSamples() const {
+  ProbeSamples samples;
+  samples.names = names;
+  std::scoped_lock lock{mutex};
+  auto n{times.size()};
+  samples.times.reserve(n);
+  samples.values.reserve(n);
+  for (std::size_t i = 0; i < n; ++i) {
+    auto j{(first + i) % n};
+    samples.times.push_back(times[j]);
+    auto begin{values.cbegin() +
+               static_cast<std::ptrdiff_t>(j * columns.size())};
+    samples.values.emplace_back(
+        begin, begin + static_cast<std::ptrdiff_t>(columns.size()));
+  }
+  samples.nOverwritten = nOverwritten;
+  return samples;
+}
+
+std::size_t ProbeRecorder::size() const {
+  std::scoped_lock lock{mutex};
+  return times.size();
+}
+
+void ProbeRecorder::clear() {
+  std::scoped_lock lock{mutex};
+  times.clear();
+  values.clear();
+  first = 0;
+  nOverwritten = 0;
+}
+
+} // namespace sme::simulate
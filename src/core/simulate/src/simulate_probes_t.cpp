@@ -0,0 +1,95 @@
+#include "catch_wrapper.hpp"
+#include "geometry.hpp"
+#include "model.hpp"
+#include "model_test_utils.hpp"
+#include "simulate.hpp"
+#include "simulate_probes.hpp"
+#include <cmath>
+
+using namespace sme;
+using namespace sme::test;
+
+TEST_CASE("SimulateProbes",
+          "[core/simulate/simulate_probes][core/simulate][core][simulate_"
+          "probes]") {
+  auto m{getExampleModel(Mod::VerySimpleModel)};
+  m.getSimulationSettings().simulatorType = simulate::SimulatorType::Pixel;
+  const auto *c2{m.getCompartments().getCompartment("c2")};
+  double w{m.getGeometry().getPixelWidth()};
+  auto origin{m.getGeometry().getPhysicalOrigin()};
+  int height{c2->getCompartmentImage().height()};
+  // centre of the first pixel of c2
+  const auto &p{c2->getPixel(0)};
+  double x{origin.x() + (static_cast<double>(p.x()) + 0.5) * w};
+  double y{origin.y() + (static_cast<double>(height - 1 - p.y()) + 0.5) * w};
+  simulate::ProbeOptions options;
+  options.probes = {{"point", "c2", x, y, 0.0, 0.0},
+                    {"all", "c2", origin.x() - 1.0, origin.y() - 1.0, 1e6, 1e6},
+                    {"outside", "c2", origin.x() - 10.0, origin.y(), 1.0, 1.0},
+                    {"invalid", "idontexist", x, y, 0.0, 0.0}};
+  options.interval = 0.01;
+  SECTION("ProbeRecorder ring buffer") {
+    options.capacity = 3;
+    simulate::ProbeRecorder recorder(m, options, {"c2"}, {{"A_c2", "B_c2"}});
+    REQUIRE(recorder.getInterval() == dbl_approx(0.01));
+    REQUIRE(recorder.getNames() ==
+            std::vector<std::string>{"point/A_c2", "point/B_c2", "all/A_c2",
+                                     "all/B_c2", "outside/A_c2",
+                                     "outside/B_c2"});
+    // padding of 1 after the two species
+    std::vector<double> concs(3 * c2->nPixels(), 1.0);
+    concs[0] = 2.0;
+    for (int i = 0; i < 5; ++i) {
+      concs[1] = static_cast<double>(i);
+      recorder.record(static_cast<double>(i), {&concs}, 1);
+    }
+    REQUIRE(recorder.size() == 3);
+    auto samples{recorder.getSamples()};
+    REQUIRE(samples.nOverwritten == 2);
+    REQUIRE(samples.times == std::vector<double>{2.0, 3.0, 4.0});
+    REQUIRE(samples.values.size() == 3);
+    for (std::size_t i = 0; i < 3; ++i) {
+      const auto &v{samples.values[i]};
+      REQUIRE(v.size() == 6);
+      REQUIRE(v[0] == dbl_approx(2.0));
+      REQUIRE(v[1] == dbl_approx(samples.times[i]));
+      REQUIRE(v[2] > 1.0);
+      REQUIRE(v[2] < 2.0);
+      REQUIRE(std::isnan(v[4]));
+      REQUIRE(std::isnan(v[5]));
+    }
+    recorder.clear();
+    REQUIRE(recorder.size() == 0);
+    REQUIRE(recorder.getSamples().times.empty());
+  }
+  SECTION("Simulation records probes between timepoints") {
+    m.getSimulationSettings().probes = options;
+    simulate::Simulation sim(m);
+    sim.doTimesteps(0.05, 2);
+    REQUIRE(sim.getTimePoints().size() == 3);
+    auto samples{sim.getProbeSamples()};
+    REQUIRE(samples.names.size() == 6);
+    REQUIRE(samples.times.size() == 11);
+    REQUIRE(samples.nOverwritten == 0);
+    for (std::size_t i = 0; i < 11; ++i) {
+      REQUIRE(samples.times[i] ==
+              dbl_approx(0.01 * static_cast<double>(i)));
+    }
+    // samples that coincide with timepoints
+    std::size_t ic{1};
+    for (std::size_t it = 0; it < 3; ++it) {
+      const auto &v{samples.values[5 * it]};
+      for (std::size_t is = 0; is < 2; ++is) {
+        REQUIRE(v[is] == dbl_approx(sim.getConc(it, ic, is)[0]));
+        REQUIRE(v[2 + is] == dbl_approx(sim.getAvgMinMax(it, ic, is).avg));
+      }
+    }
+  }
+  SECTION("No probes without an interval") {
+    options.interval = 0.0;
+    m.getSimulationSettings().probes = options;
+    simulate::Simulation sim(m);
+    sim.doTimesteps(0.05, 1);
+    REQUIRE(sim.getProbeSamples().times.empty());
+  }
+}
@@ -0,0 +1,201 @@
+#include "simulate_reductions.hpp"
+#include "parallel_for.hpp"
+#include <cmath>
+
+namespace sme::simulate {
+
+// values with a smaller magnitude are counted as zero
+constexpr double minSketchMagnitude{std::numeric_limits<double>::min()};
+// if exceeded, the buckets with the smallest magnitudes are combined
+constexpr int maxSketchBuckets{2048};
+// reductions are split into blocks of at least this many items
+constexpr std::size_t minBlockSize{1024};
+constexpr std::size_t maxBlocks{256};
+
+void QuantileSketch::Buckets::add(int index, std::size_t count) {
+  if (counts.empty()) {
+    offset = index;
+    counts.assign(1, count);
+    return;
+  }
+  int last{offset + static_cast<int>(counts.size()) - 1};
+  int newLast{std::max(last, index)};
+  int newOffset{
+      std::max(std::min(offset, index), newLast - maxSketchBuckets + 1)};
+  index = std::max(index, newOffset);
+  if (newOffset != offset || newLast != last) {
+    std::vector<std::size_t> newCounts(
+        static_cast<std::size_t>(newLast - newOffset + 1), 0);
+    for (std::size_t i = 0; i < counts.size(); ++i) {
+      int j{std::max(offset + static_cast<int>(i), newOffset) - newOffset};
+      newCounts[static_cast<std::size_t>(j)] += counts[i];
+    }
+    counts = std::move(newCounts);
+    offset = newOffset;
+  }
+  counts[static_cast<std::size_t>(index - offset)] += count;
+}
+
+QuantileSketch::QuantileSketch(double relativeAccuracy)
+    : relativeAccuracy{relativeAccuracy},
+      gamma{(1.0 + relativeAccuracy) / (1.0 - relativeAccuracy)},
+      logGamma{std::log(gamma)} {}
+
+int QuantileSketch::getIndex(double magnitude) const {
+  return static_cast<int>(std::ceil(std::log(magnitude) / logGamma));
+}
+
+double QuantileSketch::getValue(int index) const {
+  return 2.0 * std::exp(static_cast<double>(index) * logGamma) / (gamma + 1.0);
+}
+
+void QuantileSketch::add(double value) {
+  if (!std::isfinite(value)) {
+    return;
+  }
+  ++n;
+  if (std::abs(value) < minSketchMagnitude) {
+    ++nZero;
+  } else if (value > 0) {
+    positive.add(getIndex(value), 1);
+  } else {
+    negative.add(getIndex(-value), 1);
+  }
+}
+
+void QuantileSketch::merge(const QuantileSketch &other) {
+  for (std::size_t i = 0; i < other.positive.counts.size(); ++i) {
+    if (auto c{other.positive.counts[i]}; c > 0) {
+      positive.add(other.positive.offset + static_cast<int>(i), c);
+    }
+  }
+  for (std::size_t i = 0; i < other.negative.counts.size(); ++i) {
+    if (auto c{other.negative.counts[i]}; c > 0) {
+      negative.add(other.negative.offset + static_cast<int>(i), c);
+    }
+  }
+  nZero += other.nZero;
+  n += other.n;
+}
+
+double QuantileSketch::getRelativeAccuracy() const { return relativeAccuracy; }
+
+std::size_t QuantileSketch::size() const { return n; }
+
+double QuantileSketch::getQuantile(double q) const {
+  if (n == 0) {
+    return std::numeric_limits<double>::quiet_NaN();
+  }
+  q = std::clamp(q, 0.0, 1.0);
+  auto rank{static_cast<std::size_t>(q * static_cast<double>(n - 1))};
+  std::size_t total{0};
+  // in ascending order: negative values with decreasing magnitude, zeros,
+  // then positive values with increasing magnitude
+  const auto &neg{negative.counts};
+  for (auto i{neg.size()}; i > 0; --i) {
+    total += neg[i - 1];
+    if (total > rank) {
+      return -getValue(negative.offset + static_cast<int>(i - 1));
+    }
+  }
+  total += nZero;
+  if (total > rank) {
+    return 0.0;
+  }
+  const auto &pos{positive.counts};
+  for (std::size_t i = 0; i < pos.size(); ++i) {
+    total += pos[i];
+    if (total > rank) {
+      return getValue(positive.offset + static_cast<int>(i));
+    }
+  }
+  return getValue(positive.offset + static_cast<int>(pos.size()) - 1);
+}
+
+SpeciesReduction::SpeciesReduction(double quantileAccuracy) {
+  if (quantileAccuracy > 0.0) {
+    sketch.emplace(quantileAccuracy);
+  }
+}
+
+void SpeciesReduction::merge(const SpeciesReduction &other) {
+  count += other.count;
+  sum += other.sum;
+  sumSquares += other.sumSquares;
+  min = std::min(min, other.min);
+  max = std::max(max, other.max);
+  if (other.sketch.has_value()) {
+    if (sketch.has_value()) {
+      sketch->merge(other.sketch.value());
+    } else {
+      sketch = other.sketch;
+    }
+  }
+}
+
+AvgMinMax SpeciesReduction::getAvgMinMax() const {
+  AvgMinMax a;
+  if (count > 0) {
+    a.avg = sum / static_cast<double>(count);
+    a.min = min;
+    a.max = std::max(max, 0.0);
+  }
+  return a;
+}
+
+double SpeciesReduction::getL2Norm() const { return std::sqrt(sumSquares); }
+
+double SpeciesReduction::getIntegral(double pixelArea) const {
+  return sum * pixelArea;
+}
+
+double SpeciesReduction::getQuantile(double q) const {
+  if (!sketch.has_value()) {
+    return std::numeric_limits<double>::quiet_NaN();
+  }
+  return sketch->getQuantile(q);
+}
+
+std::vector<std::pair<std::size_t, std::size_t>>
+getReductionBlocks(std::size_t n) {
+  std::vector<std::pair<std::size_t, std::size_t>> blocks;
+  if (n == 0) {
+    return blocks;
+  }
+  std::size_t nBlocks{std::clamp(n / minBlockSize, std::size_t{1}, maxBlocks)};
+  blocks.reserve(nBlocks);
+  for (std::size_t i = 0; i < nBlocks; ++i) {
+    blocks.emplace_back(i * n / nBlocks, (i + 1) * n / nBlocks);
+  }
+  return blocks;
+}
+
+std::vector<SpeciesReduction>
+reduceConcentrations(const std::vector<double> &concs, std::size_t nSpecies,
+                     std::size_t concPadding, double quantileAccuracy) {
+  std::vector<SpeciesReduction> reductions(nSpecies,
+                                           SpeciesReduction(quantileAccuracy));
+  std::size_t stride{nSpecies + concPadding};
+  if (stride == 0) {
+    return reductions;
+  }
+  auto blocks{getReductionBlocks(concs.size() / stride)};
+  std::vector<std::vector<SpeciesReduction>> partials(blocks.size(),
+                                                      reductions);
+  common::parallelFor(blocks.size(), [&](std::size_t b) {
+    auto &partial{partials[b]};
+    for (std::size_t ix = blocks[b].first; ix < blocks[b].second; ++ix) {
+      for (std::size_t is = 0; is < nSpecies; ++is) {
+        partial[is].add(concs[ix * stride + is]);
+      }
+    }
+  });
+  for (const auto &partial : partials) {
+    for (std::size_t is = 0; is < nSpecies; ++is) {
+      reductions[is].merge(partial[is]);
+    }
+  }
+  return reductions;
+}
+
+} // namespace sme::simulate
@@ -0,0 +1,117 @@
+#include "catch_wrapper.hpp"
+#include "simulate_reductions.hpp"
+#include <algorithm>
+#include <cmath>
+#include <random>
+
+using namespace sme;
+
+TEST_CASE("SimulateReductions",
+          "[core/simulate/simulate_reductions][core/simulate][core][simulate_"
+          "reductions]") {
+  SECTION("QuantileSketch") {
+    simulate::QuantileSketch sketch(0.01);
+    REQUIRE(sketch.size() == 0);
+    REQUIRE(std::isnan(sketch.getQuantile(0.5)));
+    std::mt19937 gen(12345);
+    std::uniform_real_distribution<double> dist(-10.0, 100.0);
+    std::vector<double> values;
+    for (int i = 0; i < 5000; ++i) {
+      values.push_back(dist(gen));
+    }
+    values.push_back(0.0);
+    values.push_back(std::numeric_limits<double>::quiet_NaN());
+    for (auto v : values) {
+      sketch.add(v);
+    }
+    // NaN is ignored
+    values.pop_back();
+    REQUIRE(sketch.size() == values.size());
+    std::sort(values.begin(), values.end());
+    for (double q : {0.0, 0.01, 0.25, 0.5, 0.9, 0.99, 1.0}) {
+      auto rank{static_cast<std::size_t>(
+          q * static_cast<double>(values.size() - 1))};
+      double exact{values[rank]};
+      REQUIRE(std::abs(sketch.getQuantile(q) - exact) <=
+              0.01 * std::abs(exact) + 1e-12);
+    }
+    // merging two halves gives the same result as adding all values
+    simulate::QuantileSketch a(0.01);
+    simulate::QuantileSketch b(0.01);
+    for (std::size_t i = 0; i < values.size(); ++i) {
+      (i % 2 == 0 ? a : b).add(values[i]);
+    }
+    a.merge(b);
+    REQUIRE(a.size() == sketch.size());
+    for (double q : {0.0, 0.1, 0.5, 0.75, 1.0}) {
+      REQUIRE(a.getQuantile(q) == dbl_approx(sketch.getQuantile(q)));
+    }
+  }
+  SECTION("SpeciesReduction") {
+    simulate::SpeciesReduction r;
+    REQUIRE(r.count == 0);
+    REQUIRE(std::isnan(r.getQuantile(0.5)));
+    auto a0{r.getAvgMinMax()};
+    REQUIRE(a0.avg == dbl_approx(0.0));
+    for (double v : {-1.0, 2.0, 3.0}) {
+      r.add(v);
+    }
+    REQUIRE(r.count == 3);
+    REQUIRE(r.sum == dbl_approx(4.0));
+    REQUIRE(r.getL2Norm() == dbl_approx(std::sqrt(14.0)));
+    REQUIRE(r.getIntegral(0.5) == dbl_approx(2.0));
+    auto a{r.getAvgMinMax()};
+    REQUIRE(a.avg == dbl_approx(4.0 / 3.0));
+    REQUIRE(a.min == dbl_approx(-1.0));
+    REQUIRE(a.max == dbl_approx(3.0));
+    // max is at least zero
+    simulate::SpeciesReduction n;
+    n.add(-2.0);
+    REQUIRE(n.getAvgMinMax().max == dbl_approx(0.0));
+    r.merge(n);
+    REQUIRE(r.count == 4);
+    REQUIRE(r.getAvgMinMax().min == dbl_approx(-2.0));
+    REQUIRE(r.getAvgMinMax().max == dbl_approx(3.0));
+  }
+  SECTION("getReductionBlocks") {
+    REQUIRE(simulate::getReductionBlocks(0).empty());
+    for (std::size_t n :
+         std::vector<std::size_t>{1, 100, 1024, 5000, 1000000}) {
+      auto blocks{simulate::getReductionBlocks(n)};
+      REQUIRE(!blocks.empty());
+      REQUIRE(blocks.front().first == 0);
+      REQUIRE(blocks.back().second == n);
+      for (std::size_t i = 1; i < blocks.size(); ++i) {
+        REQUIRE(blocks[i].first == blocks[i - 1].second);
+      }
+    }
+  }
+  SECTION("reduceConcentrations") {
+    // 3 species + 1 padding
+    constexpr std::size_t nPixels{5000};
+    std::vector<double> concs;
+    for (std::size_t ix = 0; ix < nPixels; ++ix) {
+      auto x{static_cast<double>(ix)};
+      concs.insert(concs.end(), {x, 1.0, -x, 99.0});
+    }
+    auto r{simulate::reduceConcentrations(concs, 3, 1, 0.01)};
+    REQUIRE(r.size() == 3);
+    for (const auto &ri : r) {
+      REQUIRE(ri.count == nPixels);
+      REQUIRE(ri.sketch.has_value());
+    }
+    double n{static_cast<double>(nPixels)};
+    REQUIRE(r[0].sum == dbl_approx(0.5 * n * (n - 1.0)));
+    REQUIRE(r[0].getAvgMinMax().min == dbl_approx(0.0));
+    REQUIRE(r[0].getAvgMinMax().max == dbl_approx(n - 1.0));
+    REQUIRE(r[1].getAvgMinMax().avg == dbl_approx(1.0));
+    REQUIRE(std::abs(r[1].getQuantile(0.5) - 1.0) <= 0.01 + 1e-12);
+    REQUIRE(r[2].getAvgMinMax().min == dbl_approx(1.0 - n));
+    REQUIRE(std::abs(r[2].getQuantile(0.0) - (1.0 - n)) <=
+            0.01 * (n - 1.0) + 1e-12);
+    // padding is not included
+    REQUIRE(r[2].getAvgMinMax().max == dbl_approx(0.0));
+    // no quantiles by default
+    REQUIRE(!simulate::reduceConcentrations(concs, 3, 1)[0].sketch.has_value());
+  }
+}
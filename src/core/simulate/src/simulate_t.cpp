@@ -299,6 +299,155 @@ TEST_CASE("Simulate: very_simple_model, 2d geometry",
   }
 }
 
+TEST_CASE("Simulate: very_simple_model, reductions",
+          "[core/simulate/simulate][core/simulate][core][simulate][pixel]") {
+  auto s{getExampleModel(Mod::VerySimpleModel)};
+  auto &options{s.getSimulationSettings().options};
+  s.getSimulationSettings().simulatorType = simulate::SimulatorType::Pixel;
+  for (auto integrator : {simulate::PixelIntegratorType::RK101,
+                          simulate::PixelIntegratorType::RK212,
+                          simulate::PixelIntegratorType::RK435}) {
+    options.pixel.integrator = integrator;
+    options.pixel.maxTimestep = 0.01;
+    s.getSimulationData().clear();
+    simulate::Simulation sim(s);
+    sim.setQuantileAccuracy(0.01);
+    sim.doTimesteps(0.1, 2);
+    REQUIRE(sim.getTimePoints().size() == 3);
+    for (std::size_t it = 1; it < 3; ++it) {
+      for (std::size_t ic = 0; ic < 3; ++ic) {
+        for (std::size_t is = 0; is < sim.getSpeciesIds(ic).size(); ++is) {
+          auto conc{sim.getConc(it, ic, is)};
+          const auto &r{sim.getReduction(it, ic, is)};
+          const auto &a{sim.getAvgMinMax(it, ic, is)};
+          REQUIRE(r.count == conc.size());
+          REQUIRE(r.getAvgMinMax().avg == dbl_approx(a.avg));
+          REQUIRE(r.getAvgMinMax().min == dbl_approx(a.min));
+          REQUIRE(r.getAvgMinMax().max == dbl_approx(a.max));
+          double sum{0.0};
+          for (auto c : conc) {
+            sum += c;
+          }
+          REQUIRE(r.sum == dbl_approx(sum));
+          auto maxConc{*std::max_element(conc.cbegin(), conc.cend())};
+          REQUIRE(std::abs(r.getQuantile(1.0) - maxConc) <=
+                  0.01 * std::abs(maxConc) + 1e-12);
+        }
+      }
+    }
+  }
+}
+
+TEST_CASE("Simulate: very_simple_model, retention policy",
+          "[core/simulate/simulate][core/simulate][core][simulate][pixel]") {
+  auto s{getExampleModel(Mod::VerySimpleModel)};
+  s.getSimulationSettings().simulatorType = simulate::SimulatorType::Pixel;
+  s.getSimulationSettings().retention.keepLast = 2;
+  s.getSimulationSettings().retention.keepEvery = 3;
+  simulate::Simulation sim(s);
+  sim.doTimesteps(0.05, 7);
+  const auto &data{sim.getSimulationData()};
+  auto nPixels{s.getCompartments().getCompartment("c2")->nPixels()};
+  REQUIRE(sim.getTimePoints().size() == 8);
+  // statistics of every timepoint are kept
+  REQUIRE(data.avgMinMax.size() == 8);
+  REQUIRE(data.concentrationMax.size() == 8);
+  // full concentrations only of timepoints 0, 3, 6 and the last two
+  REQUIRE(data.concentration.getNumRetainedTimepoints() == 4);
+  for (std::size_t it = 0; it < 8; ++it) {
+    bool retained{it % 3 == 0 || it >= 6};
+    REQUIRE(data.concentration.isRetained(it) == retained);
+    auto isNaN{[](double c) { return std::isnan(c); }};
+    auto conc{sim.getConc(it, 1, 0)};
+    REQUIRE(conc.size() == nPixels);
+    REQUIRE(std::all_of(conc.cbegin(), conc.cend(), isNaN) == !retained);
+    auto pyConcs{sim.getPyConcs(it, 1)};
+    REQUIRE(std::any_of(pyConcs.cbegin(), pyConcs.cend(), isNaN) ==
+            !retained);
+  }
+  // continuing the simulation keeps applying the policy
+  sim.doTimesteps(0.05, 2);
+  REQUIRE(data.avgMinMax.size() == 10);
+  REQUIRE(data.concentration.getNumRetainedTimepoints() == 5);
+  REQUIRE(!data.concentration.isRetained(7));
+  REQUIRE(data.concentration.isRetained(9));
+}
+
+TEST_CASE("Simulate: very_simple_model, compressed storage",
+          "[core/simulate/simulate][core/simulate][core][simulate][pixel]") {
+  auto s{getExampleModel(Mod::VerySimpleModel)};
+  s.getSimulationSettings().simulatorType = simulate::SimulatorType::Pixel;
+  s.getSimulationSettings().options.pixel.enableMultiThreading = false;
+  simulate::Simulation ref(s);
+  ref.doTimesteps(0.05, 4);
+  std::vector<simulate::ConcentrationSnapshot> refConcs;
+  for (std::size_t it = 0; it < 5; ++it) {
+    refConcs.push_back(*ref.getSimulationData().concentration.get(it));
+  }
+  REQUIRE(!s.getSimulationData().concentration.getCompression().enabled);
+  double maxAbsError{};
+  SECTION("lossless") { maxAbsError = 0.0; }
+  SECTION("lossy") { maxAbsError = 1e-6; }
+  s.getSimulationData().clear();
+  s.getSimulationSettings().storage.compress = true;
+  s.getSimulationSettings().storage.maxAbsError = maxAbsError;
+  simulate::Simulation sim(s);
+  sim.doTimesteps(0.05, 4);
+  const auto &concentration{sim.getSimulationData().concentration};
+  REQUIRE(concentration.getCompression().enabled);
+  REQUIRE(concentration.getCompression().maxAbsError ==
+          dbl_approx(maxAbsError));
+  REQUIRE(concentration.size() == 5);
+  for (std::size_t it = 0; it < 5; ++it) {
+    const auto &a{*concentration.get(it)};
+    const auto &b{refConcs[it]};
+    REQUIRE(a.size() == b.size());
+    for (std::size_t ic = 0; ic < a.size(); ++ic) {
+      REQUIRE(a[ic].size() == b[ic].size());
+      for (std::size_t i = 0; i < a[ic].size(); ++i) {
+        // allow for rounding errors when rescaling quantised values
+        REQUIRE(std::abs(a[ic][i] - b[ic][i]) <= maxAbsError * (1 + 1e-6));
+      }
+    }
+  }
+  // a new simulation without compression stores the concentrations as is
+  s.getSimulationData().clear();
+  s.getSimulationSettings().storage.compress = false;
+  simulate::Simulation sim2(s);
+  REQUIRE(!sim2.getSimulationData().concentration.getCompression().enabled);
+}
+
+TEST_CASE("Simulate: very_simple_model, file storage",
+          "[core/simulate/simulate][core/simulate][core][simulate][pixel]") {
+  auto s{getExampleModel(Mod::VerySimpleModel)};
+  s.getSimulationSettings().simulatorType = simulate::SimulatorType::Pixel;
+  s.getSimulationSettings().options.pixel.enableMultiThreading = false;
+  simulate::Simulation ref(s);
+  ref.doTimesteps(0.05, 4);
+  std::vector<simulate::ConcentrationSnapshot> refConcs;
+  for (std::size_t it = 0; it < 5; ++it) {
+    refConcs.push_back(*ref.getSimulationData().concentration.get(it));
+  }
+  REQUIRE(!s.getSimulationData().concentration.isMemoryMapped());
+  s.getSimulationData().clear();
+  s.getSimulationSettings().storage.useFile = true;
+  simulate::Simulation sim(s);
+  sim.doTimesteps(0.05, 4);
+  const auto &concentration{sim.getSimulationData().concentration};
+  REQUIRE(concentration.isMemoryMapped());
+  REQUIRE(concentration.size() == 5);
+  REQUIRE(concentration.getNumResidentTimepoints() <=
+          concentration.getMaxResidentTimepoints());
+  for (std::size_t it = 0; it < 5; ++it) {
+    REQUIRE(*concentration.get(it) == refConcs[it]);
+  }
+  // a new simulation without the setting stores the concentrations in memory
+  s.getSimulationData().clear();
+  s.getSimulationSettings().storage.useFile = false;
+  simulate::Simulation sim2(s);
+  REQUIRE(!sim2.getSimulationData().concentration.isMemoryMapped());
+}
+
 TEST_CASE("Simulate: very_simple_model, failing Pixel sim",
           "[core/simulate/simulate][core/simulate][core][simulate][pixel]") {
   auto s{getExampleModel(Mod::VerySimpleModel)};
@@ -940,7 +1089,6 @@ TEST_CASE("Pixel simulator: brusselator model, RK2, RK3, RK4",
                                               (c4_accurate[i] + eps));
       }
       CAPTURE(multithreaded);
-      CAPTURE(integrator);
       REQUIRE(maxRelDiff < maxAllowedRelErr);
     }
   }
@@ -1043,6 +1191,13 @@ TEST_CASE("getConcImage",
       REQUIRE(img2.pixel(49, 43) == qRgb(0, 0, 0));
       REQUIRE(img2.pixel(33, 8) == qRgb(31, 93, 39));
     }
+
+    // small image: preview is the full image at any display size
+    for (const auto &displaySize : {QSize(1, 1), QSize(50, 50)}) {
+      REQUIRE(sim.getConcImagePreview(1, displaySize) == sim.getConcImage(1));
+      REQUIRE(sim.getConcImagePreview(1, displaySize, {}, true, true) ==
+              sim.getConcImage(1, {}, true, true));
+    }
   }
 }
 
@@ -1062,24 +1217,29 @@ TEST_CASE("PyConc",
       REQUIRE(sim.getPyNames(0)[1] == "B");
       REQUIRE(sim.getPyNames(0)[2] == "C");
       auto pyConcs0{sim.getPyConcs(0, 0)};
-      REQUIRE(pyConcs0.size() == 3);
-      const auto &cA0 = pyConcs0[0];
-      REQUIRE(cA0.size() == 100 * 100);
-      REQUIRE(cA0[0] == dbl_approx(0.0));
+      REQUIRE(pyConcs0.size() == 3 * 100 * 100);
+      REQUIRE(pyConcs0[0] == dbl_approx(0.0));
 
       auto pyConcs1{sim.getPyConcs(1, 0)};
-      REQUIRE(pyConcs1.size() == 3);
-      const auto &cA1{pyConcs1[0]};
-      REQUIRE(cA1.size() == 100 * 100);
-      REQUIRE(cA1[0] == dbl_approx(0.0));
+      REQUIRE(pyConcs1.size() == 3 * 100 * 100);
+      REQUIRE(pyConcs1[0] == dbl_approx(0.0));
+      // species values are scattered to their pixel location in each image
+      const auto &pixels{
+          s.getCompartments().getCompartment("comp")->getPixels()};
+      for (std::size_t is = 0; is < 3; ++is) {
+        auto c{sim.getConcArray(1, 0, is)};
+        for (std::size_t ix = 0; ix < pixels.size(); ix += 97) {
+          auto pyIndex{static_cast<std::size_t>(pixels[ix].x() +
+                                                100 * pixels[ix].y())};
+          REQUIRE(pyConcs1[is * 100 * 100 + pyIndex] == dbl_approx(c[ix]));
+        }
+      }
 
       // onlh have dcdt for last timepoint of pixel sim:
       auto pyDcdts1{sim.getPyDcdts(0)};
       if (simType == simulate::SimulatorType::Pixel) {
-        REQUIRE(pyDcdts1.size() == 3);
-        const auto &dA1 = pyDcdts1[0];
-        REQUIRE(dA1.size() == 100 * 100);
-        REQUIRE(dA1[0] == dbl_approx(0.0));
+        REQUIRE(pyDcdts1.size() == 3 * 100 * 100);
+        REQUIRE(pyDcdts1[0] == dbl_approx(0.0));
       } else {
         REQUIRE(pyDcdts1.size() == 0);
       }
@@ -1087,14 +1247,54 @@ TEST_CASE("PyConc",
   }
 }
 
+TEST_CASE("SimulationResults",
+          "[core/simulate/simulate][core/simulate][core][simulate][python]") {
+  auto s{getExampleModel(Mod::ABtoC)};
+  s.getSimulationSettings().simulatorType = simulate::SimulatorType::Pixel;
+  auto sim{std::make_unique<simulate::Simulation>(s)};
+  REQUIRE(sim->getResults().size() == 0);
+  sim->doTimesteps(0.01, 2);
+  REQUIRE(sim->getTimePoints().size() == 3);
+  auto results{sim->getResults(true)};
+  REQUIRE(results.size() == 3);
+  REQUIRE(results.getImageSize() == QSize(100, 100));
+  REQUIRE(results.getNumCompartments() == 1);
+  REQUIRE(results.getPyNames(0) == sim->getPyNames(0));
+  std::vector<QImage> images;
+  std::vector<std::vector<double>> pyConcs;
+  for (std::size_t i = 0; i < 3; ++i) {
+    REQUIRE(results.getTimePoint(i) == dbl_approx(sim->getTimePoints()[i]));
+    images.push_back(sim->getConcImage(i, {}, true));
+    pyConcs.push_back(sim->getPyConcs(i, 0));
+    REQUIRE(results.getConcImage(i) == images.back());
+    REQUIRE(results.getPyConcs(i, 0) == pyConcs.back());
+  }
+  // dcdt only for last timepoint, and only if requested
+  auto pyDcdts{sim->getPyDcdts(0)};
+  REQUIRE(!pyDcdts.empty());
+  REQUIRE(results.getPyDcdts(0, 0).empty());
+  REQUIRE(results.getPyDcdts(2, 0) == pyDcdts);
+  REQUIRE(sim->getResults().getPyDcdts(2, 0).empty());
+  // results remain valid after the simulation and its data are deleted
+  sim.reset();
+  s.getSimulationData().clear();
+  for (std::size_t i = 0; i < 3; ++i) {
+    REQUIRE(results.getConcImage(i) == images[i]);
+    REQUIRE(results.getPyConcs(i, 0) == pyConcs[i]);
+  }
+  REQUIRE(results.getPyDcdts(2, 0) == pyDcdts);
+}
+
 static double rel_diff(const simulate::SimulationData &a,
                        const simulate::SimulationData &b, std::size_t iTimeA,
                        std::size_t iTimeB) {
   double d{0.0};
   double n{0.0};
-  for (std::size_t iC = 0; iC < a.concentration[iTimeA].size(); ++iC) {
-    const auto &cA{a.concentration[iTimeA][iC]};
-    const auto &cB{b.concentration[iTimeB][iC]};
+  auto concsA{a.concentration.get(iTimeA)};
+  auto concsB{b.concentration.get(iTimeB)};
+  for (std::size_t iC = 0; iC < concsA->size(); ++iC) {
+    const auto &cA{(*concsA)[iC]};
+    const auto &cB{(*concsB)[iC]};
     // normalise to max conc over all species & points in each compartment
     double norm{*std::max_element(cA.cbegin(), cA.cend())};
     if (norm == 0.0) {
@@ -1556,6 +1756,39 @@ TEST_CASE("doMultipleTimesteps vs doTimesteps",
   }
 }
 
+TEST_CASE("Pixel simulation with runtime parameters",
+          "[core/simulate/simulate][core/simulate][core][simulate]") {
+  auto m1{getExampleModel(Mod::GrayScott)};
+  m1.getSimulationSettings().simulatorType = simulate::SimulatorType::Pixel;
+  simulate::Simulation sim1(m1);
+  sim1.doMultipleTimesteps({{2, 5.0}});
+  const auto &data1{m1.getSimulationData()};
+  // same results if parameters are inputs to the compiled kernels
+  auto m2{getExampleModel(Mod::GrayScott)};
+  m2.getSimulationSettings().simulatorType = simulate::SimulatorType::Pixel;
+  simulate::Simulation sim2(m2, {"k", "f"});
+  REQUIRE(sim2.errorMessage().empty());
+  sim2.doMultipleTimesteps({{2, 5.0}});
+  const auto &data2{m2.getSimulationData()};
+  REQUIRE(data1.size() == 3);
+  REQUIRE(data2.size() == 3);
+  for (std::size_t i = 0; i < data1.size(); ++i) {
+    REQUIRE(rel_diff(data1, data2, i, i) < 1e-10);
+  }
+  // a different value of a runtime parameter re-uses the compiled kernels
+  // from sim2, and gives different results
+  auto m3{getExampleModel(Mod::GrayScott)};
+  m3.getSimulationSettings().simulatorType = simulate::SimulatorType::Pixel;
+  m3.getParameters().setExpression("k", "0.05");
+  simulate::Simulation sim3(m3, {"k", "f"});
+  REQUIRE(sim3.errorMessage().empty());
+  sim3.doMultipleTimesteps({{2, 5.0}});
+  const auto &data3{m3.getSimulationData()};
+  REQUIRE(data3.size() == 3);
+  REQUIRE(rel_diff(data1, data3, 0, 0) == dbl_approx(0.0));
+  REQUIRE(rel_diff(data1, data3, 2, 2) > 1e-6);
+}
+
 TEST_CASE("Events: setting species concentrations",
           "[core/simulate/simulate][core/simulate][core][simulate][events]") {
   auto m1{getExampleModel(Mod::VerySimpleModel)};
@@ -1602,27 +1835,27 @@ TEST_CASE("Events: setting species concentrations",
     // t=0.1
     REQUIRE(data.timePoints[1] == dbl_approx(0.1));
     // B_c1=9
-    REQUIRE(data.concentration[1][0][3] == dbl_approx(9.0));
-    REQUIRE(data.concentration[1][0][16] == dbl_approx(9.0));
-    REQUIRE(data.concentration[1][0][38] == dbl_approx(9.0));
+    REQUIRE((*data.concentration.get(1))[0][3] == dbl_approx(9.0));
+    REQUIRE((*data.concentration.get(1))[0][16] == dbl_approx(9.0));
+    REQUIRE((*data.concentration.get(1))[0][38] == dbl_approx(9.0));
     // t=0.2
     REQUIRE(data.timePoints[2] == dbl_approx(0.2));
     // B_c1=2
-    REQUIRE(data.concentration[2][0][3] == dbl_approx(2.0));
-    REQUIRE(data.concentration[2][0][16] == dbl_approx(2.0));
-    REQUIRE(data.concentration[2][0][38] == dbl_approx(2.0));
+    REQUIRE((*data.concentration.get(2))[0][3] == dbl_approx(2.0));
+    REQUIRE((*data.concentration.get(2))[0][16] == dbl_approx(2.0));
+    REQUIRE((*data.concentration.get(2))[0][38] == dbl_approx(2.0));
     // B_c2=27 (odd indices)
-    REQUIRE(data.concentration[2][1][183] == dbl_approx(27));
-    REQUIRE(data.concentration[2][1][197] == dbl_approx(27));
-    REQUIRE(data.concentration[2][1][203] == dbl_approx(27));
+    REQUIRE((*data.concentration.get(2))[1][183] == dbl_approx(27));
+    REQUIRE((*data.concentration.get(2))[1][197] == dbl_approx(27));
+    REQUIRE((*data.concentration.get(2))[1][203] == dbl_approx(27));
     // A_c2=6 (even indices)
-    REQUIRE(data.concentration[2][1][4] == dbl_approx(6.0));
-    REQUIRE(data.concentration[2][1][16] == dbl_approx(6.0));
-    REQUIRE(data.concentration[2][1][40] == dbl_approx(6.0));
+    REQUIRE((*data.concentration.get(2))[1][4] == dbl_approx(6.0));
+    REQUIRE((*data.concentration.get(2))[1][16] == dbl_approx(6.0));
+    REQUIRE((*data.concentration.get(2))[1][40] == dbl_approx(6.0));
     // A_c3=123 (even indices)
-    REQUIRE(data.concentration[2][2][4] == dbl_approx(123.0));
-    REQUIRE(data.concentration[2][2][16] == dbl_approx(123.0));
-    REQUIRE(data.concentration[2][2][40] == dbl_approx(123.0));
+    REQUIRE((*data.concentration.get(2))[2][4] == dbl_approx(123.0));
+    REQUIRE((*data.concentration.get(2))[2][16] == dbl_approx(123.0));
+    REQUIRE((*data.concentration.get(2))[2][40] == dbl_approx(123.0));
   }
 }
 
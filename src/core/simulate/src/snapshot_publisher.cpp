@@ -0,0 +1,144 @@
+#include "snapshot_publisher.hpp"
+#include "logger.hpp"
+#include <algorithm>
+#include <exception>
+#include <utility>
+
+namespace sme::simulate {
+
+SnapshotPublisher::SnapshotPublisher(
+    SimulationData *simulationData,
+    std::vector<std::size_t> compartmentNSpecies,
+    std::function<void()> timestepStoredCallback,
+    std::size_t maxQueuedSnapshots)
+    : data{simulationData}, nSpecies{std::move(compartmentNSpecies)},
+      timestepStored{std::move(timestepStoredCallback)},
+      maxQueued{std::max(maxQueuedSnapshots, std::size_t{1})},
+      consumer{&SnapshotPublisher::consume, this} {}
+
+SnapshotPublisher::~SnapshotPublisher() {
+  {
+    std::scoped_lock lock{mutex};
+    stopRequested = true;
+  }
+  queueChanged.notify_all();
+  // any remaining snapshots are stored before the consumer returns
+  consumer.join();
+}
+
+void SnapshotPublisher::publish(Snapshot &&snapshot) {
+  {
+    std::unique_lock lock{mutex};
+    queueChanged.wait(lock, [this]() { return queue.size() < maxQueued; });
+    queue.push_back(std::move(snapshot));
+  }
+  queueChanged.notify_all();
+}
+
+void SnapshotPublisher::flush() {
+  std::unique_lock lock{mutex};
+  queueChanged.wait(lock, [this]() { return queue.empty() && !isStoring; });
+}
+
+void SnapshotPublisher::setQuantileAccuracy(double relativeAccuracy) {
+  quantileAccuracy = relativeAccuracy;
+}
+
+void SnapshotPublisher::setObservables(
+    std::shared_ptr<const ObservableEvaluator> evaluator) {
+  std::scoped_lock lock{mutex};
+  observables = std::move(evaluator);
+}
+
+const std::string &SnapshotPublisher::errorMessage() const {
+  static const std::string noError{};
+  return storeFailed.load() ? storeErrorMessage : noError;
+}
+
+void SnapshotPublisher::consume() {
+  std::unique_lock lock{mutex};
+  while (true) {
+    queueChanged.wait(lock,
+                      [this]() { return !queue.empty() || stopRequested; });
+    if (queue.empty()) {
+      return;
+    }
+    auto snapshot{std::move(queue.front())};
+    queue.pop_front();
+    isStoring = true;
+    lock.unlock();
+    queueChanged.notify_all();
+    try {
+      store(std::move(snapshot));
+    } catch (const std::exception &e) {
+      SPDLOG_ERROR("Failed to store snapshot: {}", e.what());
+      if (!storeFailed.load()) {
+        storeErrorMessage = e.what();
+        storeFailed.store(true);
+      }
+    }
+    lock.lock();
+    isStoring = false;
+    queueChanged.notify_all();
+  }
+}
+
+void SnapshotPublisher::store(Snapshot &&snapshot) {
+  SPDLOG_DEBUG("storing snapshot at time {}", snapshot.time);
+  std::vector<std::vector<AvgMinMax>> a;
+  a.reserve(nSpecies.size());
+  auto &r{snapshot.reductions};
+  r.resize(nSpecies.size());
+  std::vector<std::vector<double>> m;
+  if (data->concentrationMax.empty()) {
+    for (auto n : nSpecies) {
+      m.emplace_back(n, 0.0);
+    }
+  } else {
+    m = data->concentrationMax.back();
+  }
+  for (std::size_t compIndex = 0; compIndex < nSpecies.size(); ++compIndex) {
+    auto &rc{r[compIndex]};
+    if (rc.size() < nSpecies[compIndex]) {
+      rc = reduceConcentrations(snapshot.concentration[compIndex],
+                                nSpecies[compIndex], snapshot.concPadding,
+                                quantileAccuracy);
+    }
+    // simulator reductions may include additional non-species variables
+    rc.resize(nSpecies[compIndex]);
+    auto &ac{a.emplace_back()};
+    ac.reserve(rc.size());
+    for (std::size_t is = 0; is < rc.size(); ++is) {
+      ac.push_back(rc[is].getAvgMinMax());
+      m[compIndex][is] = std::max(m[compIndex][is], ac[is].max);
+    }
+  }
+  std::shared_ptr<const ObservableEvaluator> evaluator;
+  {
+    std::scoped_lock lock{mutex};
+    evaluator = observables;
+  }
+  std::vector<double> observableValues;
+  if (evaluator != nullptr) {
+    observableValues = evaluator->evaluate(
+        snapshot.time, snapshot.concentration, snapshot.concPadding);
+  }
+  // concentrations are stored first, as this may fail, e.g. if they cannot
+  // be written to a file: nothing else is then added, so the timepoint
+  // indices of all data remain consistent
+  data->concentration.push_back(std::move(snapshot.concentration));
+  if (evaluator != nullptr) {
+    data->observables.push_back(std::move(observableValues));
+  }
+  data->avgMinMax.push_back(std::move(a));
+  data->concentrationMax.push_back(std::move(m));
+  data->concPadding.push_back(snapshot.concPadding);
+  data->reductions.push_back(std::move(r));
+  // timepoint is published last, once all other data is available
+  data->timePoints.push_back(snapshot.time);
+  if (snapshot.isTimestep && timestepStored) {
+    timestepStored();
+  }
+}
+
+} // namespace sme::simulate
@@ -0,0 +1,86 @@
+// Snapshot publisher
+//  - stores simulation snapshots in SimulationData on a consumer thread
+//  - the consumer appends the snapshot to the concentration store, which may
+//    write it to disk, along with its per species reductions (avg/min/max)
+//  - reductions are taken from the snapshot if the simulator already
+//    computed them while integrating, otherwise they are computed here as
+//    a parallel reduction over the pixels
+//  - spatial observables, if any, are evaluated for each snapshot
+//  - the integration thread only hands off the concentration buffers,
+//    so storage overlaps with the next integration interval
+//  - an exception while storing a snapshot is caught on the consumer thread,
+//    the first error message is kept and later snapshots are still stored:
+//    a snapshot that could not be stored adds no data, so the timepoints of
+//    all stored data remain consistent
+
+#pragma once
+
+#include "simulate_data.hpp"
+#include "simulate_observables.hpp"
+#include "simulate_reductions.hpp"
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace sme::simulate {
+
+struct Snapshot {
+  double time{0.0};
+  std::size_t concPadding{0};
+  ConcentrationSnapshot concentration{};
+  // false for intermediate snapshots, e.g. when a step is split by an event
+  bool isTimestep{true};
+  // compartment->species, empty if not computed by the simulator
+  std::vector<std::vector<SpeciesReduction>> reductions{};
+};
+
+class SnapshotPublisher {
+private:
+  SimulationData *data;
+  // compartment->number of species
+  std::vector<std::size_t> nSpecies;
+  std::function<void()> timestepStored;
+  std::size_t maxQueued;
+  std::atomic<double> quantileAccuracy{0.0};
+  std::mutex mutex{};
+  std::condition_variable queueChanged{};
+  std::deque<Snapshot> queue{};
+  std::shared_ptr<const ObservableEvaluator> observables{};
+  bool isStoring{false};
+  bool stopRequested{false};
+  // set once, and only then is storeErrorMessage read by other threads
+  std::atomic<bool> storeFailed{false};
+  std::string storeErrorMessage{};
+  std::thread consumer;
+  void consume();
+  void store(Snapshot &&snapshot);
+
+public:
+  explicit SnapshotPublisher(SimulationData *simulationData,
+                             std::vector<std::size_t> compartmentNSpecies,
+                             std::function<void()> timestepStoredCallback = {},
+                             std::size_t maxQueuedSnapshots = 4);
+  SnapshotPublisher(const SnapshotPublisher &) = delete;
+  SnapshotPublisher &operator=(const SnapshotPublisher &) = delete;
+  ~SnapshotPublisher();
+  // queue snapshot for storage, blocks if too many snapshots are queued
+  void publish(Snapshot &&snapshot);
+  // wait until all published snapshots have been stored
+  void flush();
+  // quantiles are estimated for reductions computed by the publisher if
+  // relativeAccuracy is positive
+  void setQuantileAccuracy(double relativeAccuracy);
+  // evaluate these observables for subsequent snapshots, none if null
+  void setObservables(std::shared_ptr<const ObservableEvaluator> evaluator);
+  // first error from storing a snapshot, empty if none
+  [[nodiscard]] const std::string &errorMessage() const;
+};
+
+} // namespace sme::simulate
@@ -0,0 +1,99 @@
+#include "catch_wrapper.hpp"
+#include "snapshot_publisher.hpp"
+#include <atomic>
+#include <stdexcept>
+
+using namespace sme;
+
+// compartment 0: 3 pixels, 2 species, compartment 1: 2 pixels, 1 species
+static simulate::Snapshot makeSnapshot(double t, bool isTimestep = true) {
+  return {t, 0, {{t, 1.0, 2.0 * t, 1.0, 3.0 * t, 4.0}, {-t, t}}, isTimestep};
+}
+
+TEST_CASE("SnapshotPublisher", "[core/simulate/snapshot_publisher][core/"
+                               "simulate][core][snapshot_publisher]") {
+  simulate::SimulationData data;
+  std::atomic<std::size_t> nTimesteps{0};
+  SECTION("publish and flush") {
+    simulate::SnapshotPublisher publisher(&data, {2, 1},
+                                          [&nTimesteps]() { ++nTimesteps; });
+    for (int i = 0; i < 10; ++i) {
+      publisher.publish(makeSnapshot(static_cast<double>(i), i % 3 != 1));
+    }
+    publisher.flush();
+    REQUIRE(nTimesteps == 7);
+    REQUIRE(data.size() == 10);
+    REQUIRE(data.concentration.size() == 10);
+    REQUIRE(data.avgMinMax.size() == 10);
+    REQUIRE(data.concentrationMax.size() == 10);
+    REQUIRE(data.concPadding.size() == 10);
+    REQUIRE(data.reductions.size() == 10);
+    for (std::size_t i = 0; i < 10; ++i) {
+      auto t{static_cast<double>(i)};
+      REQUIRE(data.timePoints[i] == dbl_approx(t));
+      REQUIRE((*data.concentration.get(i))[0][4] == dbl_approx(3.0 * t));
+      const auto &a{data.avgMinMax[i]};
+      REQUIRE(a.size() == 2);
+      REQUIRE(a[0][0].avg == dbl_approx(2.0 * t));
+      REQUIRE(a[0][0].min == dbl_approx(t));
+      REQUIRE(a[0][0].max == dbl_approx(3.0 * t));
+      REQUIRE(a[0][1].avg == dbl_approx(2.0));
+      REQUIRE(a[1][0].min == dbl_approx(-t));
+      REQUIRE(a[1][0].max == dbl_approx(t));
+      // running max over all timepoints
+      REQUIRE(data.concentrationMax[i][0][0] == dbl_approx(3.0 * t));
+      REQUIRE(data.concentrationMax[i][0][1] == dbl_approx(4.0));
+      REQUIRE(data.concentrationMax[i][1][0] == dbl_approx(t));
+      const auto &r{data.reductions[i]};
+      REQUIRE(r.size() == 2);
+      REQUIRE(r[0].size() == 2);
+      REQUIRE(r[0][0].sum == dbl_approx(6.0 * t));
+      REQUIRE(r[1][0].count == 2);
+    }
+  }
+  SECTION("exception while storing is reported, not thrown") {
+    simulate::SnapshotPublisher publisher(&data, {2, 1}, [&nTimesteps]() {
+      if (++nTimesteps == 2) {
+        throw std::runtime_error("failed to store");
+      }
+    });
+    REQUIRE(publisher.errorMessage().empty());
+    for (int i = 0; i < 4; ++i) {
+      publisher.publish(makeSnapshot(static_cast<double>(i)));
+    }
+    publisher.flush();
+    REQUIRE(publisher.errorMessage() == "failed to store");
+    // later snapshots are still stored
+    REQUIRE(nTimesteps == 4);
+    REQUIRE(data.size() == 4);
+  }
+  SECTION("reductions from the simulator are used if available") {
+    simulate::SnapshotPublisher publisher(&data, {2, 1});
+    auto snapshot{makeSnapshot(1.0)};
+    // simulator reductions may include additional variables
+    snapshot.reductions.resize(2);
+    snapshot.reductions[0].resize(3);
+    snapshot.reductions[0][0].add(7.0);
+    snapshot.reductions[1].resize(1);
+    snapshot.reductions[1][0].add(-3.0);
+    publisher.publish(std::move(snapshot));
+    publisher.flush();
+    REQUIRE(data.reductions[0][0].size() == 2);
+    REQUIRE(data.reductions[0][0][0].sum == dbl_approx(7.0));
+    REQUIRE(data.avgMinMax[0][0][0].avg == dbl_approx(7.0));
+    REQUIRE(data.avgMinMax[0][1][0].min == dbl_approx(-3.0));
+  }
+  SECTION("destructor stores queued snapshots") {
+    {
+      simulate::SnapshotPublisher publisher(
+          &data, {2, 1}, [&nTimesteps]() { ++nTimesteps; }, 1);
+      for (int i = 0; i < 5; ++i) {
+        publisher.publish(makeSnapshot(static_cast<double>(i)));
+      }
+    }
+    REQUIRE(nTimesteps == 5);
+    REQUIRE(data.size() == 5);
+    REQUIRE(data.timePoints.back() == dbl_approx(4.0));
+    REQUIRE((*data.concentration.back())[1][1] == dbl_approx(4.0));
+  }
+}
@@ -3,6 +3,7 @@
 #include "ui_dialogsimulationoptions.h"
 #include "utils.hpp"
 #include <QString>
+#include <algorithm>
 #ifdef SPATIAL_MODEL_EDITOR_WITH_TBB
 #include <tbb/task_scheduler_init.h>
 #endif
@@ -53,13 +54,16 @@ static sme::simulate::PixelIntegratorType toPixelIntegratorEnum(int index) {
 }
 
 DialogSimulationOptions::DialogSimulationOptions(
-    const sme::simulate::Options &options, QWidget *parent)
+    const sme::simulate::Options &options,
+    const sme::simulate::StorageOptions &storageOptions,
+    const sme::simulate::RetentionPolicy &retentionPolicy, QWidget *parent)
     : QDialog(parent), ui{std::make_unique<Ui::DialogSimulationOptions>()},
-      opt{options} {
+      opt{options}, storageOpt{storageOptions}, retention{retentionPolicy} {
   ui->setupUi(this);
   setupConnections();
   loadDuneOpts();
   loadPixelOpts();
+  loadStorageOpts();
 }
 
 DialogSimulationOptions::~DialogSimulationOptions() = default;
@@ -68,6 +72,16 @@ const sme::simulate::Options &DialogSimulationOptions::getOptions() const {
   return opt;
 }
 
+const sme::simulate::StorageOptions &
+DialogSimulationOptions::getStorageOptions() const {
+  return storageOpt;
+}
+
+const sme::simulate::RetentionPolicy &
+DialogSimulationOptions::getRetentionPolicy() const {
+  return retention;
+}
+
 void DialogSimulationOptions::setupConnections() {
   connect(ui->buttonBox, &QDialogButtonBox::accepted, this,
           &DialogSimulationOptions::accept);
@@ -115,6 +129,19 @@ void DialogSimulationOptions::setupConnections() {
           &DialogSimulationOptions::spnPixelOptLevel_valueChanged);
   connect(ui->btnPixelReset, &QPushButton::clicked, this,
           &DialogSimulationOptions::resetPixelToDefaults);
+  // Storage tab
+  connect(ui->chkStorageFile, &QCheckBox::stateChanged, this,
+          &DialogSimulationOptions::chkStorageFile_stateChanged);
+  connect(ui->chkStorageCompress, &QCheckBox::stateChanged, this,
+          &DialogSimulationOptions::chkStorageCompress_stateChanged);
+  connect(ui->txtStorageMaxAbsErr, &QLineEdit::editingFinished, this,
+          &DialogSimulationOptions::txtStorageMaxAbsErr_editingFinished);
+  connect(ui->spnStorageKeepLast, qOverload<int>(&QSpinBox::valueChanged),
+          this, &DialogSimulationOptions::spnStorageKeepLast_valueChanged);
+  connect(ui->spnStorageKeepEvery, qOverload<int>(&QSpinBox::valueChanged),
+          this, &DialogSimulationOptions::spnStorageKeepEvery_valueChanged);
+  connect(ui->btnStorageReset, &QPushButton::clicked, this,
+          &DialogSimulationOptions::resetStorageToDefaults);
 }
 
 void DialogSimulationOptions::loadDuneOpts() {
@@ -263,3 +290,48 @@ void DialogSimulationOptions::resetPixelToDefaults() {
   opt.pixel = sme::simulate::PixelOptions{};
   loadPixelOpts();
 }
+
+void DialogSimulationOptions::loadStorageOpts() {
+  ui->chkStorageFile->setChecked(storageOpt.useFile);
+  ui->chkStorageCompress->setChecked(storageOpt.compress);
+  ui->txtStorageMaxAbsErr->setText(dblToQString(storageOpt.maxAbsError));
+  ui->txtStorageMaxAbsErr->setEnabled(storageOpt.compress);
+  ui->spnStorageKeepLast->setValue(static_cast<int>(std::min(
+      retention.keepLast,
+      static_cast<std::size_t>(ui->spnStorageKeepLast->maximum()))));
+  ui->spnStorageKeepEvery->setValue(static_cast<int>(std::min(
+      retention.keepEvery,
+      static_cast<std::size_t>(ui->spnStorageKeepEvery->maximum()))));
+  // older timepoints only exist if some are discarded
+  ui->spnStorageKeepEvery->setEnabled(retention.keepLast > 0);
+}
+
+void DialogSimulationOptions::chkStorageFile_stateChanged() {
+  storageOpt.useFile = ui->chkStorageFile->isChecked();
+}
+
+void DialogSimulationOptions::chkStorageCompress_stateChanged() {
+  storageOpt.compress = ui->chkStorageCompress->isChecked();
+  loadStorageOpts();
+}
+
+void DialogSimulationOptions::txtStorageMaxAbsErr_editingFinished() {
+  storageOpt.maxAbsError =
+      std::max(ui->txtStorageMaxAbsErr->text().toDouble(), 0.0);
+  loadStorageOpts();
+}
+
+void DialogSimulationOptions::spnStorageKeepLast_valueChanged(int value) {
+  retention.keepLast = static_cast<std::size_t>(value);
+  loadStorageOpts();
+}
+
+void DialogSimulationOptions::spnStorageKeepEvery_valueChanged(int value) {
+  retention.keepEvery = static_cast<std::size_t>(value);
+}
+
+void DialogSimulationOptions::resetStorageToDefaults() {
+  storageOpt = sme::simulate::StorageOptions{};
+  retention = sme::simulate::RetentionPolicy{};
+  loadStorageOpts();
+}
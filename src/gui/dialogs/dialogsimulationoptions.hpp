@@ -11,10 +11,15 @@ class DialogSimulationOptions : public QDialog {
   Q_OBJECT
 
 public:
-  explicit DialogSimulationOptions(const sme::simulate::Options &options,
-                                   QWidget *parent = nullptr);
+  explicit DialogSimulationOptions(
+      const sme::simulate::Options &options,
+      const sme::simulate::StorageOptions &storageOptions = {},
+      const sme::simulate::RetentionPolicy &retentionPolicy = {},
+      QWidget *parent = nullptr);
   ~DialogSimulationOptions();
   const sme::simulate::Options &getOptions() const;
+  const sme::simulate::StorageOptions &getStorageOptions() const;
+  const sme::simulate::RetentionPolicy &getRetentionPolicy() const;
 
 private:
   void setupConnections();
@@ -39,6 +44,15 @@ private:
   void chkPixelCSE_stateChanged();
   void spnPixelOptLevel_valueChanged(int value);
   void resetPixelToDefaults();
+  void loadStorageOpts();
+  void chkStorageFile_stateChanged();
+  void chkStorageCompress_stateChanged();
+  void txtStorageMaxAbsErr_editingFinished();
+  void spnStorageKeepLast_valueChanged(int value);
+  void spnStorageKeepEvery_valueChanged(int value);
+  void resetStorageToDefaults();
   std::unique_ptr<Ui::DialogSimulationOptions> ui;
   sme::simulate::Options opt;
+  sme::simulate::StorageOptions storageOpt;
+  sme::simulate::RetentionPolicy retention;
 };
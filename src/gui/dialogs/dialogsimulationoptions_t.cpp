@@ -26,7 +26,11 @@ TEST_CASE("DialogSimulationOptions", "[gui/dialogs/simulationoptions][gui/"
   options.pixel.maxThreads = 0;
   options.pixel.doCSE = true;
   options.pixel.optLevel = 3;
-  DialogSimulationOptions dia(options);
+  sme::simulate::StorageOptions storage;
+  storage.compress = true;
+  storage.maxAbsError = 1e-4;
+  sme::simulate::RetentionPolicy retention{10, 3};
+  DialogSimulationOptions dia(options, storage, retention);
   ModalWidgetTimer mwt;
   SECTION("user does nothing: unchanged") {
     mwt.addUserAction();
@@ -50,6 +54,12 @@ TEST_CASE("DialogSimulationOptions", "[gui/dialogs/simulationoptions][gui/"
     REQUIRE(opt.pixel.maxThreads == 0);
     REQUIRE(opt.pixel.doCSE == true);
     REQUIRE(opt.pixel.optLevel == 3);
+    const auto &storageOpt{dia.getStorageOptions()};
+    REQUIRE(storageOpt.useFile == false);
+    REQUIRE(storageOpt.compress == true);
+    REQUIRE(storageOpt.maxAbsError == dbl_approx(1e-4));
+    REQUIRE(dia.getRetentionPolicy().keepLast == 10);
+    REQUIRE(dia.getRetentionPolicy().keepEvery == 3);
   }
   SECTION("user changes Dune values") {
     mwt.addUserAction({"Tab", "Tab", "Down", "Down", "9", "Tab", ".",
@@ -115,5 +125,45 @@ TEST_CASE("DialogSimulationOptions", "[gui/dialogs/simulationoptions][gui/"
     REQUIRE(opt.pixel.enableMultiThreading == defaultOpts.enableMultiThreading);
     REQUIRE(opt.pixel.maxThreads == defaultOpts.maxThreads);
   }
+  SECTION("user changes Storage values") {
+    mwt.addUserAction({"Right", "Right", "Tab", " ", "Tab", "Tab", "2", "e",
+                       "-", "6", "Tab", "5", "Tab", "2"});
+    mwt.start();
+    dia.exec();
+    const auto &storageOpt{dia.getStorageOptions()};
+    REQUIRE(storageOpt.useFile == true);
+    REQUIRE(storageOpt.compress == true);
+    REQUIRE(storageOpt.maxAbsError == dbl_approx(2e-6));
+    REQUIRE(dia.getRetentionPolicy().keepLast == 5);
+    REQUIRE(dia.getRetentionPolicy().keepEvery == 2);
+  }
+  SECTION("user keeps all timepoints") {
+    mwt.addUserAction({"Right", "Right", "Tab", "Tab", "Tab", "Tab", "0"});
+    mwt.start();
+    dia.exec();
+    REQUIRE(dia.getRetentionPolicy().keepLast == 0);
+    REQUIRE(dia.getRetentionPolicy().keepEvery == 3);
+  }
+  SECTION("user disables compression") {
+    mwt.addUserAction({"Right", "Right", "Tab", "Tab", " "});
+    mwt.start();
+    dia.exec();
+    const auto &storageOpt{dia.getStorageOptions()};
+    REQUIRE(storageOpt.useFile == false);
+    REQUIRE(storageOpt.compress == false);
+  }
+  SECTION("user resets to Storage defaults") {
+    mwt.addUserAction({"Right", "Right", "Tab", " ", "Tab", "Tab", "Tab",
+                       "Tab", "Tab", " "});
+    mwt.start();
+    dia.exec();
+    sme::simulate::StorageOptions defaultOpts{};
+    const auto &storageOpt{dia.getStorageOptions()};
+    REQUIRE(storageOpt.useFile == defaultOpts.useFile);
+    REQUIRE(storageOpt.compress == defaultOpts.compress);
+    REQUIRE(storageOpt.maxAbsError == dbl_approx(defaultOpts.maxAbsError));
+    REQUIRE(dia.getRetentionPolicy().keepLast == 0);
+    REQUIRE(dia.getRetentionPolicy().keepEvery == 0);
+  }
 }
 #endif
@@ -607,8 +607,13 @@ void MainWindow::actionInvert_y_axis_triggered(bool checked) {
 }
 
 void MainWindow::actionSimulation_options_triggered() {
-  DialogSimulationOptions dialog(model.getSimulationSettings().options);
+  auto &settings{model.getSimulationSettings()};
+  DialogSimulationOptions dialog(settings.options, settings.storage,
+                                 settings.retention);
   if (dialog.exec() == QDialog::Accepted) {
+    // storage options only apply when a new simulation is started
+    settings.storage = dialog.getStorageOptions();
+    settings.retention = dialog.getRetentionPolicy();
     tabSimulate->setOptions(dialog.getOptions());
     tabMain_currentChanged(ui->tabMain->currentIndex());
   }
@@ -15,6 +15,7 @@
 #include <QProgressDialog>
 #include <algorithm>
 #include <future>
+#include <utility>
 
 TabSimulate::TabSimulate(sme::model::Model &m, QLabelMouseTracker *mouseTracker,
                          QWidget *parent)
@@ -130,7 +131,7 @@ void TabSimulate::loadModelData() {
   plt->clear();
   ui->hslideTime->setMinimum(0);
   ui->hslideTime->setMaximum(0);
-  images.clear();
+  setImageRenderers(false);
   time.clear();
   // Note: this reset is required to delete all current DUNE objects *before*
   // creating a new one, otherwise the new ones make use of the existing ones,
@@ -195,6 +196,7 @@ void TabSimulate::loadModelData() {
     displayOptions.showSpecies.resize(nSpecies, true);
   }
   updateSpeciesToDraw();
+  setImageRenderers();
   updatePlotAndImages();
   finalizePlotAndImages();
 }
@@ -277,15 +279,23 @@ void TabSimulate::btnSimulate_clicked() {
 }
 
 void TabSimulate::btnSliceImage_clicked() {
-  DialogImageSlice dialog(model.getGeometry().getImage(), images, time,
-                          flipYAxis);
+  auto allImages{getAllImages()};
+  if (!allImages.has_value()) {
+    return;
+  }
+  DialogImageSlice dialog(model.getGeometry().getImage(), allImages.value(),
+                          time, flipYAxis);
   if (dialog.exec() == QDialog::Accepted) {
     SPDLOG_DEBUG("todo: save current slice settings");
   }
 }
 
 void TabSimulate::btnExport_clicked() {
-  DialogExport dialog(images, plt.get(), model, *sim.get(),
+  auto allImages{getAllImages()};
+  if (!allImages.has_value()) {
+    return;
+  }
+  DialogExport dialog(allImages.value(), plt.get(), model, *sim.get(),
                       ui->hslideTime->value());
   if (dialog.exec() == QDialog::Accepted) {
     SPDLOG_DEBUG("todo: save current export settings");
@@ -307,6 +317,70 @@ void TabSimulate::updateSpeciesToDraw() {
   }
 }
 
+sme::simulate::ConcImageCache::Renderer
+TabSimulate::makeImageRenderer(const QSize &displaySize) const {
+  // the renderer is used from a worker thread, so it gets its own copy of
+  // the display options
+  // an empty displaySize renders full resolution images
+  return [s = sim.get(), displaySize, speciesToDraw = compartmentSpeciesToDraw,
+          allTime = displayOptions.normaliseOverAllTimepoints,
+          allSpecies = displayOptions.normaliseOverAllSpecies](
+             std::size_t timeIndex) {
+    if (displaySize.isEmpty()) {
+      return s->getConcImage(timeIndex, speciesToDraw, allTime, allSpecies);
+    }
+    return s->getConcImagePreview(timeIndex, displaySize, speciesToDraw,
+                                  allTime, allSpecies);
+  };
+}
+
+void TabSimulate::setImageRenderers(bool enable) {
+  if (!enable) {
+    images.setRenderer({});
+    fullImages.setRenderer({});
+    return;
+  }
+  images.setRenderer(makeImageRenderer(previewSize));
+  fullImages.setRenderer(makeImageRenderer());
+}
+
+std::optional<QVector<QImage>> TabSimulate::getAllImages() {
+  auto nTimepoints{static_cast<std::size_t>(time.size())};
+  QProgressDialog progress("Rendering images...", "Cancel", 0,
+                           static_cast<int>(nTimepoints), this);
+  progress.setWindowModality(Qt::WindowModal);
+  // rendered on a worker thread, while the modal progress dialog keeps
+  // processing events
+  auto rendered{fullImages.getAll(nTimepoints, [&progress](std::size_t n) {
+    progress.setValue(static_cast<int>(n));
+    return !progress.wasCanceled();
+  })};
+  if (rendered.size() != nTimepoints) {
+    SPDLOG_DEBUG("rendering images cancelled");
+    return {};
+  }
+  QVector<QImage> allImages;
+  allImages.reserve(time.size());
+  for (auto &image : rendered) {
+    allImages.push_back(std::move(image));
+  }
+  return allImages;
+}
+
+void TabSimulate::displayImage(std::size_t timeIndex) {
+  // previews are re-rendered if the image is now displayed at a larger size,
+  // e.g. after zooming in
+  if (auto displaySize{lblGeometry->size()};
+      displaySize.width() > previewSize.width() ||
+      displaySize.height() > previewSize.height()) {
+    previewSize = displaySize;
+    images.setRenderer(makeImageRenderer(previewSize));
+  }
+  lblGeometry->setImage(
+      images.get(timeIndex, static_cast<std::size_t>(time.size())),
+      model.getGeometry().getImage().size());
+}
+
 void TabSimulate::updatePlotAndImages() {
   if (sim == nullptr) {
     return;
@@ -319,7 +393,6 @@ void TabSimulate::updatePlotAndImages() {
   for (std::size_t i = n0; i < n; ++i) {
     SPDLOG_DEBUG("adding timepoint {}", i);
     // process new results
-    images.push_back(sim->getConcImage(i, compartmentSpeciesToDraw));
     time.push_back(sim->getTimePoints()[i]);
     int speciesIndex = 0;
     for (std::size_t ic = 0; ic < sim->getCompartmentIds().size(); ++ic) {
@@ -329,10 +402,13 @@ void TabSimulate::updatePlotAndImages() {
         ++speciesIndex;
       }
     }
-    lblGeometry->setImage(images.back());
     plt->plot->rescaleAxes(true);
     plt->plot->replot(QCustomPlot::RefreshPriority::rpQueuedReplot);
   }
+  if (n > n0) {
+    // only the latest image is displayed, others are rendered when needed
+    displayImage(n - 1);
+  }
 }
 
 void TabSimulate::finalizePlotAndImages() {
@@ -365,13 +441,8 @@ void TabSimulate::finalizePlotAndImages() {
   }
   plt->update(displayOptions.showSpecies, displayOptions.showMinMax);
   updateSpeciesToDraw();
-  // update all images
-  for (int iTime = 0; iTime < time.size(); ++iTime) {
-    images[iTime] = sim->getConcImage(static_cast<std::size_t>(iTime),
-                                      compartmentSpeciesToDraw,
-                                      displayOptions.normaliseOverAllTimepoints,
-                                      displayOptions.normaliseOverAllSpecies);
-  }
+  // display options may have changed: images are re-rendered when needed
+  setImageRenderers();
   plt->setVerticalLine(time.back());
   // enable slider to choose time to display
   ui->hslideTime->setEnabled(true);
@@ -382,8 +453,10 @@ void TabSimulate::finalizePlotAndImages() {
   if (const auto &err{sim->errorMessage()}; err == "Simulation stopped early") {
     // reset simulation after early stop as it may contain a partial timestep
     SPDLOG_INFO("resetting simulation after early stop");
+    setImageRenderers(false);
     sim.reset();
     sim = std::make_unique<sme::simulate::Simulation>(model);
+    setImageRenderers();
   }
 }
 
@@ -428,10 +501,10 @@ void TabSimulate::graphClicked(const QMouseEvent *event) {
 }
 
 void TabSimulate::hslideTime_valueChanged(int value) {
-  if (images.size() <= value) {
+  if (time.size() <= value) {
     return;
   }
-  lblGeometry->setImage(images[value]);
+  displayImage(static_cast<std::size_t>(value));
   plt->setVerticalLine(time[value]);
   plt->plot->replot();
   ui->lblCurrentTime->setText(
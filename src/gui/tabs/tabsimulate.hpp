@@ -1,12 +1,14 @@
 // TabSimulate
 
 #pragma once
+#include "conc_image_cache.hpp"
 #include "dialogdisplayoptions.hpp"
 #include "plotwrapper.hpp"
 #include "simulate.hpp"
 #include <QWidget>
 #include <future>
 #include <memory>
+#include <optional>
 
 namespace Ui {
 class TabSimulate;
@@ -44,7 +46,11 @@ private:
   std::unique_ptr<sme::simulate::Simulation> sim;
   sme::model::DisplayOptions displayOptions;
   QVector<double> time;
-  QVector<QImage> images;
+  sme::simulate::ConcImageCache images;
+  // full resolution images for export, rendered when needed
+  sme::simulate::ConcImageCache fullImages{{}, 256 * 1024 * 1024, 0};
+  // size of displayed image that previews are rendered for
+  QSize previewSize{};
   QStringList compartmentNames;
   std::vector<QStringList> speciesNames;
   std::vector<std::vector<std::size_t>> compartmentSpeciesToDraw;
@@ -61,6 +67,11 @@ private:
   void btnSliceImage_clicked();
   void btnExport_clicked();
   void updateSpeciesToDraw();
+  sme::simulate::ConcImageCache::Renderer
+  makeImageRenderer(const QSize &displaySize = {}) const;
+  void setImageRenderers(bool enable = true);
+  std::optional<QVector<QImage>> getAllImages();
+  void displayImage(std::size_t timeIndex);
   void updatePlotAndImages();
   void finalizePlotAndImages();
   void btnDisplayOptions_clicked();
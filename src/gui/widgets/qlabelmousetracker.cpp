@@ -9,8 +9,10 @@ QLabelMouseTracker::QLabelMouseTracker(QWidget *parent) : QLabel(parent) {
   setWordWrap(true);
 }
 
-void QLabelMouseTracker::setImage(const QImage &img) {
+void QLabelMouseTracker::setImage(const QImage &img,
+                                  const QSize &originalSize) {
   image = img;
+  sourceSize = originalSize.isEmpty() ? img.size() : originalSize;
   if (flipYAxis) {
     image = image.mirrored();
   }
@@ -40,9 +42,9 @@ int QLabelMouseTracker::getMaskIndex() const { return maskIndex; }
 
 QPointF QLabelMouseTracker::getRelativePosition() const {
   auto xRelPos{static_cast<double>(currentPixel.x()) /
-               static_cast<double>(image.width())};
+               static_cast<double>(sourceSize.width())};
   auto yRelPos{static_cast<double>(currentPixel.y()) /
-               static_cast<double>(image.height())};
+               static_cast<double>(sourceSize.height())};
   auto xAspectRatioFactor{static_cast<double>(pixmapImageSize.width()) /
                           static_cast<double>(pixmap.width())};
   auto yAspectRatioFactor{static_cast<double>(pixmapImageSize.height()) /
@@ -58,8 +60,11 @@ void QLabelMouseTracker::mousePressEvent(QMouseEvent *ev) {
     // update current colour and emit mouseClicked signal
     auto imagePixel{currentPixel};
     if (flipYAxis) {
-      imagePixel.setY(image.height() - 1 - imagePixel.y());
+      imagePixel.setY(sourceSize.height() - 1 - imagePixel.y());
     }
+    // scale to pixel of displayed image, which may be a preview
+    imagePixel.setX((imagePixel.x() * image.width()) / sourceSize.width());
+    imagePixel.setY((imagePixel.y() * image.height()) / sourceSize.height());
     colour = image.pixelColor(imagePixel).rgb();
     SPDLOG_DEBUG("imagePixel ({},{}) -> colour {:x}", imagePixel.x(),
                  imagePixel.y(), colour);
@@ -99,11 +104,12 @@ bool QLabelMouseTracker::setCurrentPixel(const QPoint &pos) {
       pos.y() < 0) {
     return false;
   }
-  currentPixel.setX((image.width() * (pos.x() - offset.x())) /
+  currentPixel.setX((sourceSize.width() * (pos.x() - offset.x())) /
                     pixmapImageSize.width());
-  currentPixel.setY((image.height() * pos.y()) / pixmapImageSize.height());
+  currentPixel.setY((sourceSize.height() * pos.y()) /
+                    pixmapImageSize.height());
   if (flipYAxis) {
-    currentPixel.setY(image.height() - currentPixel.y() - 1);
+    currentPixel.setY(sourceSize.height() - currentPixel.y() - 1);
   }
   SPDLOG_TRACE("mouse at ({},{}) -> pixel ({},{})", pos.x(), pos.y(),
                currentPixel.x(), currentPixel.y());
@@ -2,6 +2,7 @@
 //  - a modified QLabel
 //  - displays (and rescales without interpolation) an image,
 //  - tracks the mouse location in terms of the pixels of the original image
+//  - the displayed image can be a downsampled preview of the original image
 //  - provides the colour of the last pixel that was clicked on
 //  - emits a signal when the user clicks the mouse, along with the colour of
 //  the pixel that was clicked on
@@ -16,7 +17,9 @@ class QLabelMouseTracker : public QLabel {
 public:
   explicit QLabelMouseTracker(QWidget *parent = nullptr);
   // QImage used for pixel location and colour
-  void setImage(const QImage &img);
+  // if originalSize is given, img is a preview of an image of this size,
+  // and pixel locations refer to the pixels of the original image
+  void setImage(const QImage &img, const QSize &originalSize = {});
   const QImage &getImage() const;
   // QImage mask used to translate pixel location to index
   void setMaskImage(const QImage &img);
@@ -54,6 +57,8 @@ private:
   bool setCurrentPixel(const QPoint &pos);
   void resizeImage(const QSize &size);
   QImage image;
+  // size of original image, used for pixel locations
+  QSize sourceSize{};
   // Pixmap used to display scaled version of image
   QPixmap pixmap;
   // size of actual image in pixmap (may be smaller than pixmap)
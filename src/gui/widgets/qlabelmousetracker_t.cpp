@@ -199,3 +199,49 @@ TEST_CASE("QLabelMouseTracker: image and mask", tags) {
   REQUIRE(mouseTracker.getColour() == QColor(144, 97, 193).rgb());
   REQUIRE(mouseTracker.getMaskIndex() == 12944736);
 }
+
+TEST_CASE("QLabelMouseTracker: preview of larger image", tags) {
+  // 2x2 preview of a 20x20 image:
+  // 1 2
+  // 3 4
+  QLabelMouseTracker mouseTracker;
+  QImage img(2, 2, QImage::Format_RGB32);
+  QRgb col1 = QColor(12, 243, 154).rgba();
+  QRgb col2 = QColor(34, 92, 14).rgba();
+  QRgb col3 = QColor(88, 43, 91).rgba();
+  QRgb col4 = QColor(108, 13, 55).rgba();
+  img.setPixel(0, 0, col1);
+  img.setPixel(1, 0, col2);
+  img.setPixel(0, 1, col3);
+  img.setPixel(1, 1, col4);
+  mouseTracker.show();
+  mouseTracker.resize(100, 100);
+  wait();
+  mouseTracker.setImage(img, {20, 20});
+  REQUIRE(mouseTracker.getImage().size() == img.size());
+
+  std::vector<QRgb> clicks;
+  std::vector<QPoint> points;
+  QObject::connect(&mouseTracker, &QLabelMouseTracker::mouseClicked,
+                   [&clicks](QRgb c) { clicks.push_back(c); });
+  QObject::connect(&mouseTracker, &QLabelMouseTracker::mouseOver,
+                   [&points](QPoint p) { points.push_back(p); });
+
+  // mouse location is given in pixels of the original image
+  sendMouseMove(&mouseTracker, {35, 80});
+  REQUIRE(points.back() == QPoint(7, 16));
+  REQUIRE(mouseTracker.getRelativePosition().x() == dbl_approx(0.35));
+  REQUIRE(mouseTracker.getRelativePosition().y() == dbl_approx(0.80));
+  // colour is that of the displayed preview pixel
+  sendMouseClick(&mouseTracker, {35, 80});
+  REQUIRE(clicks.back() == col3);
+  sendMouseMove(&mouseTracker, {99, 5});
+  REQUIRE(points.back() == QPoint(19, 1));
+  sendMouseClick(&mouseTracker, {99, 5});
+  REQUIRE(clicks.back() == col2);
+
+  // without an original size the image is its own original
+  mouseTracker.setImage(img);
+  sendMouseMove(&mouseTracker, {35, 80});
+  REQUIRE(points.back() == QPoint(0, 1));
+}